@@ -0,0 +1,117 @@
+// Throughput benchmarks for the hot paths of loading and saving vaults.
+// Vaults are kept in a MemoryBackend so that the numbers don't include disk I/O.
+// Run a Release build: ./manpass_benchmarks
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "crypto/Base64.h"
+#include "crypto/Cryptography.h"
+#include "storage/MemoryBackend.h"
+#include "vault/CredentialEntry.h"
+#include "vault/NoteEntry.h"
+#include "Storage.h"
+
+using namespace cryptography;
+
+// Runs fn repeatedly (at least 5 times and for at least half a second) and reports the best throughput
+static void benchmark(const std::string& name, size_t bytesPerRun, const std::function<void()>& fn) {
+    using Clock = std::chrono::steady_clock;
+    double best = 0;
+    int runs = 0;
+    const auto start = Clock::now();
+    while (runs < 5 || Clock::now() - start < std::chrono::milliseconds(500)) {
+        const auto runStart = Clock::now();
+        fn();
+        const double seconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+        if (best == 0 || seconds < best)
+            best = seconds;
+        runs++;
+    }
+    std::printf("%-40s %10.3f ms %10.2f MB/s\n", name.c_str(), best * 1e3, bytesPerRun / best / 1e6);
+}
+
+static const char* isaName(Base64Isa isa) {
+    switch (isa) {
+        case Base64Isa::SCALAR: return "scalar";
+        case Base64Isa::SSE41: return "sse4.1";
+        case Base64Isa::AVX2: return "avx2";
+    }
+    return "";
+}
+
+static std::vector<uint8_t> randomBytes(size_t size) {
+    std::vector<uint8_t> data(size);
+    uint32_t state = 1;
+    for (auto& byte : data) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(state >> 16);
+    }
+    return data;
+}
+
+static void benchmarkBase64() {
+    const size_t size = 64 * 1024 * 1024;
+    const std::vector<uint8_t> data = randomBytes(size);
+    std::string encoded(base64EncodedSize(size), '\0');
+    std::vector<uint8_t> decoded(base64DecodedMaxSize(encoded.size()));
+
+    for (Base64Isa isa : {Base64Isa::SCALAR, Base64Isa::SSE41, Base64Isa::AVX2}) {
+        if (!base64IsaSupported(isa))
+            continue;
+        benchmark(std::string("base64 encode (") + isaName(isa) + ")", size, [&] {
+            base64Encode(data.data(), data.size(), encoded.data(), isa);
+        });
+        benchmark(std::string("base64 decode (") + isaName(isa) + ")", encoded.size(), [&] {
+            base64Decode(encoded, decoded.data(), isa);
+        });
+    }
+    benchmark("Botan::base64_encode", size, [&] {
+        Botan::base64_encode(data.data(), data.size());
+    });
+    benchmark("Botan::base64_decode", encoded.size(), [&] {
+        Botan::base64_decode(decoded.data(), encoded.data(), encoded.size());
+    });
+}
+
+static void benchmarkVault() {
+    storage::Storage storage(std::make_unique<storage::MemoryBackend>());
+    std::string password_str = "benchmark";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+
+    // Roughly 25 MB of notes (large pasted keys and certificates) plus many small credentials
+    vault::Vault vault("Benchmark");
+    vault.cryptoKDFIterations = 1; // Leave the KDF out of the picture
+    auto folder = std::make_unique<vault::Folder>("Data");
+    const std::string note = base64Encode(randomBytes(768 * 1024)); // Looks like a PEM body, doesn't compress much
+    for (int i = 0; i < 25; i++)
+        folder->addEntry(std::make_unique<vault::NoteEntry>(note), "note " + std::to_string(i));
+    for (int i = 0; i < 10000; i++)
+        folder->addEntry(std::make_unique<vault::CredentialEntry>("user" + std::to_string(i), "password" + std::to_string(i)), "login " + std::to_string(i));
+    vault.addFolder(std::move(folder));
+
+    // Throughput is reported relative to the serialized (plaintext) vault
+    SecureBuffer serialized;
+    vault::serializeVault(vault, serialized);
+    const size_t size = serialized.size();
+    storage.saveVault(vault, password);
+
+    benchmark("save vault (memory backend)", size, [&] {
+        storage.saveVault(vault, password);
+    });
+    benchmark("load vault (memory backend)", size, [&] {
+        storage.loadVault("Benchmark", password);
+    });
+    benchmark("load vault view (memory backend)", size, [&] {
+        storage.loadVaultView("Benchmark", password);
+    });
+}
+
+int main() {
+    benchmarkBase64();
+    benchmarkVault();
+    return 0;
+}
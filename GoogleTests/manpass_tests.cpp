@@ -6,11 +6,46 @@
 #include "../include/vault/Folder.h"
 #include "../include/vault/CredentialEntry.h"
 #include "../include/vault/NoteEntry.h"
+#include "../include/vault/AttachmentEntry.h"
+#include "../include/vault/VaultView.h"
+#include "../include/vault/PersistentMap.h"
+#include "../include/vault/UndoStack.h"
+#include "../include/vault/EntryIndex.h"
+#include "../include/vault/PasswordAudit.h"
+#include "../include/vault/Import.h"
+#include "../include/vault/Export.h"
+#include "../include/vault/PathPattern.h"
+#include "../include/vault/Transfer.h"
 #include "../include/json/json.hpp"
 #include "../include/crypto/EncryptedBlob.h"
 #include "../include/crypto/Cryptography.h"
+#include "../include/crypto/SecureArena.h"
+#include "../include/crypto/Compression.h"
+#include "../include/crypto/Base64.h"
 #include "../include/Storage.h"
+#include "../include/OutputWriter.h"
+#include "../include/PrivateFile.h"
+#include "../include/storage/MemoryBackend.h"
+#include "../include/storage/BreachDatabase.h"
 #include "../include/crypto/GetMasterPassword.h"
+#include "../include/crypto/KeySource.h"
+#include "../include/agent/AgentProtocol.h"
+#include "../include/agent/Agent.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 using json = nlohmann::json;
 using namespace vault;
@@ -535,6 +570,83 @@ TEST(VaultDeserializationTest, ValidEmptyVaultDeserializes) {
     EXPECT_TRUE(vault.getFolderNames().empty());
 }
 
+// --------- VAULT VIEW TESTS -----------
+
+static SecureBuffer toBuffer(const std::string& serialized) {
+    return SecureBuffer(serialized.begin(), serialized.end());
+}
+
+TEST(VaultViewTest, IndexesFoldersAndEntries) {
+    Vault vault("ViewVault");
+    auto accounts = std::make_unique<Folder>("Accounts");
+    accounts->addEntry(std::make_unique<CredentialEntry>("alice", "a123"), "alice");
+    accounts->addEntry(std::make_unique<NoteEntry>("Recovery codes"), "codes");
+    vault.addFolder(std::move(accounts));
+    vault.addFolder(std::make_unique<Folder>("Empty"));
+
+    json j = vault;
+    VaultView view(toBuffer(j.dump()));
+
+    EXPECT_EQ(view.getName(), "ViewVault");
+    EXPECT_EQ(view.getFolderNames().size(), 2);
+    EXPECT_TRUE(view.folderExists("Accounts"));
+    EXPECT_TRUE(view.getEntryNames("Empty").empty());
+
+    EXPECT_TRUE(view.entryExists("Accounts", "alice"));
+    EXPECT_FALSE(view.entryExists("Accounts", "bob"));
+    EXPECT_EQ(view.getEntryType("Accounts", "alice"), EntryType::CREDENTIAL);
+    EXPECT_EQ(view.getEntryType("Accounts", "codes"), EntryType::NOTE);
+
+    // A moved view still reads its own buffer
+    VaultView moved(std::move(view));
+    EXPECT_EQ(dynamic_cast<const NoteEntry&>(moved.getEntry("Accounts", "codes")).getNoteText(), "Recovery codes");
+    VaultView assigned(toBuffer(json(Vault("Other")).dump()));
+    assigned = std::move(moved);
+    EXPECT_EQ(dynamic_cast<const CredentialEntry&>(assigned.getEntry("Accounts", "alice")).getPassword(), "a123");
+}
+
+TEST(VaultViewTest, MaterializesRequestedEntry) {
+    Vault vault("ViewVault");
+    auto folder = std::make_unique<Folder>("F");
+    folder->addEntry(std::make_unique<CredentialEntry>("usérñámè", "p\"ä\\ß😊"), "login");
+    folder->addEntry(std::make_unique<NoteEntry>("Line 1\nLine 2\n\tIndented"), "note");
+    vault.addFolder(std::move(folder));
+
+    json j = vault;
+    VaultView view(toBuffer(j.dump(4))); // Whitespace must not matter
+
+    const auto* cred = dynamic_cast<const CredentialEntry*>(&view.getEntry("F", "login"));
+    ASSERT_NE(cred, nullptr);
+    EXPECT_EQ(cred->getUsername(), "usérñámè");
+    EXPECT_EQ(cred->getPassword(), "p\"ä\\ß😊");
+
+    const auto* note = dynamic_cast<const NoteEntry*>(&view.getEntry("F", "note"));
+    ASSERT_NE(note, nullptr);
+    EXPECT_EQ(note->getNoteText(), "Line 1\nLine 2\n\tIndented");
+
+    // The materialized entry is cached
+    EXPECT_EQ(&view.getEntry("F", "note"), note);
+}
+
+TEST(VaultViewTest, NonexistentFolderOrEntryThrows) {
+    Vault vault("ViewVault");
+    vault.addFolder(std::make_unique<Folder>("F"));
+    json j = vault;
+    VaultView view(toBuffer(j.dump()));
+
+    EXPECT_THROW(view.getEntryNames("NotThere"), std::out_of_range);
+    EXPECT_THROW(view.getEntry("F", "NotThere"), std::out_of_range);
+}
+
+TEST(VaultViewTest, MalformedInputThrows) {
+    EXPECT_THROW(VaultView(toBuffer("{ invalid json }")), std::invalid_argument);
+    EXPECT_THROW(VaultView(toBuffer(R"({"folders":[]})")), std::invalid_argument);
+    EXPECT_THROW(VaultView(toBuffer(R"({"name":"V","folders":[{"name":"F"}]})")), std::invalid_argument);
+
+    VaultView view(toBuffer(R"({"name":"V","folders":[{"name":"F","entries":[{"name":"e","type":"UNKNOWN"}]}]})"));
+    EXPECT_THROW(view.getEntryNames("F"), std::invalid_argument);
+}
+
 // Cryptography Tests
 
 TEST(CryptoTest, EncryptDecryptVault) {
@@ -566,6 +678,181 @@ TEST(CryptoTest, EncryptDecryptVault) {
     EXPECT_EQ(cred->getPassword(), "secret");
 }
 
+TEST(CryptoTest, EncryptDecryptInPlace) {
+    std::string password_str = "my_secure_password";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+    std::string plaintext = "{\"folders\":[],\"name\":\"In place\"}";
+
+    SecureBuffer buffer(plaintext.begin(), plaintext.end());
+    EncryptedBlob blob = encryptInPlace(buffer, password, "AES-256/GCM", "PBKDF2(SHA-256)", "irXIESN9HIWI6dnKTEXb7A==", 100);
+    EXPECT_EQ(buffer.size(), plaintext.size() + 16); // Ciphertext and GCM tag
+
+    // The string based decrypt has to understand the in place output
+    blob.base64Ciphertext = Botan::base64_encode(buffer.data(), buffer.size());
+    EXPECT_EQ(decrypt(blob, password), plaintext);
+
+    decryptInPlace(blob, password, buffer);
+    EXPECT_EQ(std::string(buffer.begin(), buffer.end()), plaintext);
+}
+
+TEST(CryptoTest, CompressDecompressRoundTrip) {
+    std::string plaintext;
+    for (int i = 0; i < 5000; i++)
+        plaintext += R"({"name":"entry )" + std::to_string(i) + R"(","password":"secret","type":"CREDENTIAL"},)";
+
+    for (const std::string& compression : {std::string("none"), defaultCompression()}) {
+        SecureBuffer buffer(plaintext.begin(), plaintext.end());
+        compress(compression, buffer);
+        if (compression != "none") {
+            EXPECT_LT(buffer.size(), plaintext.size());
+        }
+        decompress(compression, buffer);
+        EXPECT_EQ(std::string(buffer.begin(), buffer.end()), plaintext);
+    }
+
+    SecureBuffer buffer(plaintext.begin(), plaintext.end());
+    EXPECT_THROW(compress("unknown", buffer), std::invalid_argument);
+}
+
+TEST(CryptoTest, Base64MatchesBotan) {
+    std::vector<uint8_t> data(1000);
+    uint32_t state = 12345;
+    for (auto& byte : data) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(state >> 16);
+    }
+
+    for (Base64Isa isa : {Base64Isa::SCALAR, Base64Isa::SSE41, Base64Isa::AVX2}) {
+        if (!base64IsaSupported(isa))
+            continue;
+        // Every length up to a few vector blocks exercises all tail and padding cases
+        for (size_t size = 0; size < 200; size++) {
+            std::string expected = Botan::base64_encode(data.data(), size);
+            std::string encoded(base64EncodedSize(size), '\0');
+            base64Encode(data.data(), size, encoded.data(), isa);
+            ASSERT_EQ(encoded, expected) << "size " << size;
+
+            std::vector<uint8_t> decoded(base64DecodedMaxSize(encoded.size()));
+            decoded.resize(base64Decode(encoded, decoded.data(), isa));
+            ASSERT_EQ(decoded, std::vector<uint8_t>(data.begin(), data.begin() + size)) << "size " << size;
+        }
+    }
+}
+
+TEST(CryptoTest, Base64DecodeWhitespaceAndMalformedInput) {
+    std::string text = "The quick brown fox jumps over the lazy dog, then over the lazy cat";
+    std::string encoded = base64Encode(text);
+
+    // Whitespace is skipped like Botan does, wherever it appears (also inside the vectorized blocks)
+    std::string wrapped;
+    for (size_t i = 0; i < encoded.size(); i++) {
+        wrapped += encoded[i];
+        if (i % 19 == 18)
+            wrapped += "\r\n";
+    }
+    auto decoded = base64Decode<std::vector<uint8_t>>(wrapped);
+    EXPECT_EQ(std::string(decoded.begin(), decoded.end()), text);
+
+    EXPECT_THROW(base64Decode<std::vector<uint8_t>>(encoded.substr(0, 33) + "*" + encoded.substr(34)), std::invalid_argument);
+    EXPECT_THROW(base64Decode<std::vector<uint8_t>>("QQ==QQ=="), std::invalid_argument); // Data after padding
+    EXPECT_THROW(base64Decode<std::vector<uint8_t>>("Q==="), std::invalid_argument);
+    EXPECT_THROW(base64Decode<std::vector<uint8_t>>("QUJD\xC3\xA9"), std::invalid_argument); // Non-ASCII
+}
+
+TEST(CryptoTest, EncryptDecryptChaCha20Poly1305) {
+    std::string password_str = "my_secure_password";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+    std::string plaintext = "{\"folders\":[],\"name\":\"ChaCha\"}";
+
+    EncryptedBlob blob = encrypt(plaintext, password, "ChaCha20Poly1305", "PBKDF2(SHA-256)", "irXIESN9HIWI6dnKTEXb7A==", 100);
+    EXPECT_EQ(blob.algorithm, "ChaCha20Poly1305");
+    EXPECT_EQ(decrypt(blob, password), plaintext);
+
+    // The algorithm is part of the authenticated header once compression is recorded
+    SecureBuffer buffer(plaintext.begin(), plaintext.end());
+    blob = encryptInPlace(buffer, password, "ChaCha20Poly1305", "PBKDF2(SHA-256)", "irXIESN9HIWI6dnKTEXb7A==", 100, "none");
+    blob.algorithm = "AES-256/GCM";
+    EXPECT_THROW(decryptInPlace(blob, password, buffer), std::runtime_error);
+}
+
+TEST(CryptoTest, PreferredAlgorithmIsAccepted) {
+    std::string preferred = preferredAlgorithm();
+    EXPECT_NE(std::find(acceptedAlgorithms.begin(), acceptedAlgorithms.end(), preferred), acceptedAlgorithms.end());
+    EXPECT_EQ(preferredAlgorithm(), preferred); // Decided once
+
+    std::vector<AlgorithmThroughput> results = measureAlgorithms(4096);
+    ASSERT_EQ(results.size(), acceptedAlgorithms.size());
+    for (const AlgorithmThroughput& result : results) {
+        EXPECT_GT(result.bytesPerSecond, 0);
+    }
+}
+
+// Seals plaintext with a StreamEncryptor (fed in uneven pieces) and returns the sealed chunks
+static std::vector<SecureBuffer> sealChunks(const std::string& plaintext, const Botan::secure_vector<char>& password, size_t chunkSize, EncryptedBlob& blob) {
+    std::vector<SecureBuffer> chunks;
+    StreamEncryptor encryptor(password, "AES-256/GCM", "PBKDF2(SHA-256)", "irXIESN9HIWI6dnKTEXb7A==", 100, "none",
+        [&chunks](const uint8_t* data, size_t size) { chunks.emplace_back(data, data + size); }, chunkSize);
+    const auto* data = reinterpret_cast<const uint8_t*>(plaintext.data());
+    for (size_t offset = 0; offset < plaintext.size(); offset += 7) {
+        encryptor.write(data + offset, std::min<size_t>(7, plaintext.size() - offset));
+    }
+    encryptor.finish();
+    blob = encryptor.getBlob();
+    return chunks;
+}
+
+static std::string openChunks(const std::vector<SecureBuffer>& chunks, const Botan::secure_vector<char>& password, const EncryptedBlob& blob) {
+    std::string plaintext;
+    StreamDecryptor decryptor(blob, password, [&plaintext](const uint8_t* data, size_t size) { plaintext.append(data, data + size); });
+    for (const SecureBuffer& chunk : chunks) {
+        decryptor.write(chunk.data(), chunk.size());
+    }
+    decryptor.finish();
+    return plaintext;
+}
+
+TEST(CryptoTest, StreamEncryptDecryptRoundTrip) {
+    std::string password_str = "my_secure_password";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+
+    // Empty input, partial last chunk and input that ends exactly on a chunk boundary
+    for (size_t size : {0, 10, 64, 100}) {
+        std::string plaintext(size, 'p');
+        for (size_t i = 0; i < size; i++)
+            plaintext[i] = static_cast<char>('a' + i % 26);
+
+        EncryptedBlob blob;
+        std::vector<SecureBuffer> chunks = sealChunks(plaintext, password, 32, blob);
+        EXPECT_EQ(chunks.size(), size == 0 ? 1 : (size + 31) / 32);
+        EXPECT_EQ(blob.chunkSize, 32u);
+        EXPECT_EQ(openChunks(chunks, password, blob), plaintext);
+    }
+}
+
+TEST(CryptoTest, StreamDecryptDetectsTamperedStream) {
+    std::string password_str = "my_secure_password";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+    std::string plaintext(100, 'x');
+
+    EncryptedBlob blob;
+    std::vector<SecureBuffer> chunks = sealChunks(plaintext, password, 32, blob);
+    ASSERT_EQ(chunks.size(), 4u);
+
+    // Truncated at a chunk boundary
+    std::vector<SecureBuffer> truncated(chunks.begin(), chunks.end() - 1);
+    EXPECT_THROW(openChunks(truncated, password, blob), std::runtime_error);
+
+    // Reordered chunks
+    std::vector<SecureBuffer> reordered = chunks;
+    std::swap(reordered[0], reordered[1]);
+    EXPECT_THROW(openChunks(reordered, password, blob), std::runtime_error);
+
+    // Header changed (chunk size is authenticated)
+    EncryptedBlob changed = blob;
+    changed.chunkSize = 33;
+    EXPECT_THROW(openChunks(chunks, password, changed), std::runtime_error);
+}
+
 TEST(CryptoTest, EncryptDecryptUnsupportedAlgorithmsThrows) {
     EncryptedBlob blob;
     blob.base64Ciphertext = "a";
@@ -601,6 +888,816 @@ TEST(CryptoTest, DecryptArbitratyStringAndGetPasswordFromSTDIN) {
     EXPECT_EQ(encrypted, "Test plaintext");
 }
 
+// Secure arena tests
+
+TEST(SecureArenaTest, RecyclesAndWipesBlocks) {
+    SecureArena arena(4096);
+    char* block = static_cast<char*>(arena.allocate(24));
+    std::memcpy(block, "correct horse battery", 22);
+    EXPECT_EQ(arena.bytesInUse(), 32); // Rounded up to the size class
+
+    arena.deallocate(block, 24);
+    EXPECT_EQ(arena.bytesInUse(), 0);
+    for (int i = 0; i < 32; i++) {
+        EXPECT_EQ(block[i], 0);
+    }
+
+    // The freed block is reused for the next allocation of the same class
+    EXPECT_EQ(arena.allocate(30), block);
+}
+
+TEST(SecureArenaTest, LargeAllocationsAndReset) {
+    SecureArena arena(4096);
+    void* large = arena.allocate(100000);
+    std::memset(large, 0xAB, 100000);
+    arena.allocate(16);
+    EXPECT_GE(arena.bytesInUse(), 100016);
+
+    arena.deallocate(large, 100000);
+    arena.reset();
+    EXPECT_EQ(arena.bytesInUse(), 0);
+
+    // Every secret string in the process lives in the global arena
+    EXPECT_THROW(SecureArena::global().reset(), std::logic_error);
+}
+
+TEST(SecureArenaTest, ShortSecretsAreInTheArenaAndWiped) {
+    // Short enough for the small-string buffer of std::string, which would keep it inside the entry object
+    const char* password;
+    {
+        auto entry = std::make_unique<CredentialEntry>("me", "hunter2");
+        password = entry->getPassword().data();
+        EXPECT_TRUE(SecureArena::global().contains(password));
+        EXPECT_TRUE(SecureArena::global().contains(entry->getUsername().data()));
+        EXPECT_FALSE(SecureArena::global().contains(entry.get()));
+
+        // Moving hands over the block, no copy of the characters is made
+        SecureString moved("hunter2");
+        const char* block = moved.data();
+        SecureString target = std::move(moved);
+        EXPECT_EQ(target.data(), block);
+    }
+    // Freed arena blocks stay mapped (for reuse), wiped
+    for (int i = 0; i < 7; i++) {
+        EXPECT_EQ(password[i], 0);
+    }
+}
+
+TEST(SecureArenaTest, SecureStringUsesGlobalArena) {
+    size_t before = SecureArena::global().bytesInUse();
+    {
+        SecureString secret(1000, 'x');
+        EXPECT_GT(SecureArena::global().bytesInUse(), before);
+    }
+    EXPECT_EQ(SecureArena::global().bytesInUse(), before);
+}
+
+TEST(SerializationTest, SerializeVaultMatchesJsonDump) {
+    Vault vault("Vault \"quoted\"");
+    auto folder = std::make_unique<Folder>("Folder");
+    folder->addEntry(std::make_unique<CredentialEntry>("user\n", "päß\t\x01"), "login");
+    folder->addEntry(std::make_unique<NoteEntry>("note \\ text"), "note");
+    vault.addFolder(std::move(folder));
+
+    SecureBuffer serialized;
+    serializeVault(vault, serialized);
+
+    json j = vault;
+    EXPECT_EQ(json::parse(serialized.begin(), serialized.end()), j);
+    EXPECT_EQ(std::string(serialized.begin(), serialized.end()), j.dump());
+}
+
+// Entry metadata tests
+TEST(MetadataTest, SerializedInJsonDumpOrder) {
+    Vault vault("Vault");
+    auto folder = std::make_unique<Folder>("Folder");
+    auto credential = std::make_unique<CredentialEntry>("user", "pass");
+    credential->getMetadata() = {100, 200, 7200, {}};
+    credential->getMetadata().addTag("work");
+    credential->getMetadata().addTag("email");
+    credential->getMetadata().addTag("work");
+    folder->addEntry(std::move(credential), "login");
+    auto note = std::make_unique<NoteEntry>("text");
+    note->getMetadata().created = 5;
+    note->getMetadata().addTag("misc");
+    folder->addEntry(std::move(note), "note");
+    std::vector<SecureString> chunks = {SecureString("a2V5")};
+    auto attachment = std::make_unique<AttachmentEntry>("id_rsa", 3, chunks);
+    attachment->getMetadata() = {1, 2, 3600, {"ssh"}};
+    folder->addEntry(std::move(attachment), "key");
+    vault.addFolder(std::move(folder));
+
+    SecureBuffer serialized;
+    serializeVault(vault, serialized);
+    json j = vault;
+    EXPECT_EQ(std::string(serialized.begin(), serialized.end()), j.dump());
+
+    // Both readers get the same metadata back, the view without materializing the entry
+    for (const auto& entryJson : j["folders"][0]["entries"]) {
+        EXPECT_EQ(parseEntry(entryJson)->getMetadata().tags, vault.getEntry("Folder", entryJson["name"]).getMetadata().tags);
+    }
+    VaultView view(serialized);
+    EntryMetadata metadata = view.getEntryMetadata("Folder", "login");
+    EXPECT_EQ(metadata.tags, (std::vector<std::string>{"email", "work"}));
+    EXPECT_EQ(metadata.created, 100);
+    EXPECT_EQ(metadata.modified, 200);
+    EXPECT_EQ(metadata.lastUsed, 7200);
+    EXPECT_EQ(view.getEntry("Folder", "key").getMetadata().tags, std::vector<std::string>{"ssh"});
+    EXPECT_EQ(view.getEntryMetadata("Folder", "note").created, 5);
+}
+
+TEST(MetadataTest, LastUsedIsRounded) {
+    EntryMetadata metadata;
+    EXPECT_TRUE(metadata.markUsed(3 * lastUsedGranularity + 10));
+    EXPECT_EQ(metadata.lastUsed, 3 * lastUsedGranularity);
+    EXPECT_FALSE(metadata.markUsed(4 * lastUsedGranularity - 1));
+    EXPECT_TRUE(metadata.markUsed(4 * lastUsedGranularity));
+}
+
+TEST(MetadataTest, IndexAnswersRangeAndTagQueries) {
+    Vault vault("Vault");
+    vault.addFolder(std::make_unique<Folder>("A"));
+    vault.addFolder(std::make_unique<Folder>("B"));
+    for (int i = 0; i < 100; i++) {
+        auto entry = std::make_unique<CredentialEntry>("user", "pass");
+        entry->getMetadata().modified = 1000 + i * 10;
+        entry->getMetadata().created = 1000;
+        if (i % 10 == 0)
+            entry->getMetadata().addTag("rotate");
+        vault.addEntry(i % 2 ? "A" : "B", "entry" + std::to_string(i), std::move(entry));
+    }
+
+    EntryIndex index(vault);
+    EXPECT_EQ(index.size(), 100u);
+
+    std::vector<EntryPath> old = index.inRange({TimeField::MODIFIED, std::numeric_limits<int64_t>::min(), 1050});
+    ASSERT_EQ(old.size(), 5u);
+    EXPECT_EQ(old[0].entry, "entry0");
+    EXPECT_EQ(old[4].entry, "entry4");
+
+    EntryFilter filter;
+    filter.tags = {"rotate"};
+    filter.ranges = {{TimeField::MODIFIED, 1200}, {TimeField::CREATED, 0, 1001}};
+    std::vector<EntryPath> matches = index.query(filter);
+    ASSERT_EQ(matches.size(), 8u);
+    EXPECT_EQ(matches[0], (EntryPath{"B", "entry20"}));
+    EXPECT_TRUE(std::is_sorted(matches.begin(), matches.end()));
+
+    // Within one folder (the folder is a range of the index, nothing is filtered out afterwards)
+    filter.folder = "A";
+    EXPECT_TRUE(index.query(filter).empty());
+    filter.folder = "B";
+    EXPECT_EQ(index.query(filter).size(), 8u);
+    EXPECT_EQ(index.inRange({TimeField::MODIFIED, std::numeric_limits<int64_t>::min(), 1050}, "A").size(), 2u);
+    EXPECT_EQ(index.withTag("rotate", "B").size(), 10u);
+    EXPECT_EQ(index.query({{}, {}, "A"}).size(), 50u);
+    filter.folder.clear();
+
+    // Keeping the index up to date
+    EntryMetadata updated;
+    updated.modified = 1;
+    index.add({"B", "entry20"}, updated);
+    EXPECT_EQ(index.query(filter).size(), 7u);
+    EXPECT_EQ(index.inRange({TimeField::MODIFIED, 0, 2}).size(), 1u);
+    index.remove({"B", "entry20"});
+    EXPECT_EQ(index.size(), 99u);
+    EXPECT_TRUE(index.withTag("missing").empty());
+    EXPECT_EQ(index.query({}).size(), 99u);
+}
+
+// Password audit tests
+TEST(AuditTest, SipHashMatchesReferenceVector) {
+    SipHashKey key;
+    for (uint8_t i = 0; i < 16; i++) key[i] = i;
+    std::vector<uint8_t> message(15);
+    for (uint8_t i = 0; i < 15; i++) message[i] = i;
+    EXPECT_EQ(sipHash24(key, message.data(), message.size()), 0xa129ca6149be45e5ULL);
+    EXPECT_EQ(sipHash24(key, nullptr, 0), 0x726fdb47dd0e0e31ULL);
+}
+
+TEST(AuditTest, StrengthEstimateSpotsPatterns) {
+    EXPECT_EQ(estimatePasswordStrength("").weakness, "empty password");
+    EXPECT_EQ(estimatePasswordStrength("P@ssw0rd123").weakness, "common password");
+    EXPECT_EQ(estimatePasswordStrength("abcabcabcabc").weakness, "repeated pattern");
+    EXPECT_EQ(estimatePasswordStrength("zyxwvutsrq98765").weakness, "repeats or sequences");
+    EXPECT_EQ(estimatePasswordStrength("x7#Kq").weakness, "too short");
+    EXPECT_LT(estimatePasswordStrength("correcthorse").bits, weakPasswordBits);
+
+    PasswordStrength strong = estimatePasswordStrength("t9#Vm2!qLx8$Rw4z");
+    EXPECT_GT(strong.bits, weakPasswordBits);
+    EXPECT_TRUE(strong.weakness.empty());
+}
+
+TEST(AuditTest, FindsReusedAndWeakPasswords) {
+    PasswordAudit audit;
+    audit.add({"work", "mail", "a"}, audit.inspect("t9#Vm2!qLx8$Rw4z"));
+    audit.add({"home", "mail", "b"}, audit.inspect("t9#Vm2!qLx8$Rw4z"));
+    audit.add({"home", "bank", "c"}, audit.inspect("t9#Vm2!qLx8$Rw4Z"));
+    audit.add({"home", "misc", "d"}, audit.inspect("123456"));
+    for (int i = 0; i < 5000; i++) {
+        audit.add({"bulk", "f", std::to_string(i)}, audit.inspect("unique-" + std::to_string(i) + "-Kq#9xPz!"));
+    }
+    audit.add({"bulk", "g", "x"}, audit.inspect("123456"));
+    audit.add({"bulk", "g", "y"}, audit.inspect("123456"));
+
+    auto reused = audit.reusedPasswords();
+    ASSERT_EQ(reused.size(), 2u);
+    EXPECT_EQ(reused[0], (std::vector<CredentialPath>{{"bulk", "g", "x"}, {"bulk", "g", "y"}, {"home", "misc", "d"}}));
+    EXPECT_EQ(reused[1], (std::vector<CredentialPath>{{"home", "mail", "b"}, {"work", "mail", "a"}}));
+
+    auto weak = audit.weakPasswords();
+    ASSERT_EQ(weak.size(), 3u);
+    EXPECT_EQ(weak[0].strength.weakness, "common password");
+    EXPECT_EQ(audit.size(), 5006u);
+
+    // The keys are per audit, hashes can't be matched across audits
+    PasswordAudit other;
+    EXPECT_NE(other.inspect("123456").hash, audit.inspect("123456").hash);
+}
+
+TEST(AuditTest, BreachDatabaseFindsDigestsInTextAndRawCorpora) {
+    auto dir = std::filesystem::temp_directory_path() / "manpass_test_breaches";
+    std::filesystem::create_directories(dir);
+
+    // SHA-1 of "password", the rest is random
+    std::vector<std::vector<uint8_t>> corpus{{0x5b, 0xaa, 0x61, 0xe4, 0xc9, 0xb9, 0x3f, 0x3f, 0x06, 0x82,
+                                              0x25, 0x0b, 0x6c, 0xf8, 0x33, 0x1b, 0x7e, 0xe6, 0x8f, 0xd8}};
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 50000; i++) {
+        std::vector<uint8_t> digest(20);
+        for (auto& byte : digest) byte = static_cast<uint8_t>(random());
+        corpus.push_back(digest);
+    }
+    std::sort(corpus.begin(), corpus.end());
+    std::vector<std::vector<uint8_t>> absent;
+    for (int i = 0; i < 1000; i++) {
+        std::vector<uint8_t> digest(20);
+        for (auto& byte : digest) byte = static_cast<uint8_t>(random());
+        if (!std::binary_search(corpus.begin(), corpus.end(), digest))
+            absent.push_back(digest);
+    }
+
+    // Pwned Passwords layout: uppercase hex, a count, CRLF
+    {
+        std::ofstream text(dir / "sha1.txt", std::ios::binary);
+        std::ofstream raw(dir / "sha1.bin", std::ios::binary);
+        for (size_t i = 0; i < corpus.size(); i++) {
+            char hex[3];
+            for (uint8_t byte : corpus[i]) {
+                std::snprintf(hex, sizeof(hex), "%02X", byte);
+                text << hex;
+            }
+            text << ":" << i + 1 << "\r\n";
+            raw.write(reinterpret_cast<const char*>(corpus[i].data()), 20);
+        }
+    }
+
+    for (const char* name : {"sha1.txt", "sha1.bin"}) {
+        SCOPED_TRACE(name);
+        bool counted = std::string(name) == "sha1.txt";
+        BreachDatabase database(dir / name);
+        EXPECT_EQ(database.getDigestSize(), 20u);
+
+        std::vector<SecureBuffer> digests;
+        for (const auto& digest : corpus) digests.emplace_back(digest.begin(), digest.end());
+        for (const auto& digest : absent) digests.emplace_back(digest.begin(), digest.end());
+        std::shuffle(digests.begin(), digests.end(), random);
+        std::vector<uint64_t> breaches = database.lookup(digests);
+        for (size_t i = 0; i < digests.size(); i++) {
+            std::vector<uint8_t> digest(digests[i].begin(), digests[i].end());
+            auto found = std::lower_bound(corpus.begin(), corpus.end(), digest);
+            if (found == corpus.end() || *found != digest)
+                ASSERT_EQ(breaches[i], 0u);
+            else
+                ASSERT_EQ(breaches[i], counted ? static_cast<uint64_t>(found - corpus.begin() + 1) : 1u);
+        }
+
+        SecureBuffer password = database.digest("password");
+        EXPECT_GT(database.lookup(password.data()), 0u);
+        EXPECT_EQ(database.lookup(database.digest("t9#Vm2!qLx8$Rw4z").data()), 0u);
+    }
+
+    // NTLM corpora are told apart by their line length
+    {
+        std::ofstream text(dir / "ntlm.txt", std::ios::binary);
+        text << "0000000000000000000000000000000A:1\n8846F7EAEE8FB117AD06BDD830B7586C:42\n";
+    }
+    BreachDatabase ntlm(dir / "ntlm.txt");
+    EXPECT_EQ(ntlm.getHash(), BreachHash::NTLM);
+    EXPECT_EQ(ntlm.lookup(ntlm.digest("password").data()), 42u);
+
+    {
+        std::ofstream broken(dir / "broken.bin", std::ios::binary);
+        broken << "not a corpus";
+    }
+    EXPECT_THROW(BreachDatabase(dir / "broken.bin"), std::runtime_error);
+    std::filesystem::remove_all(dir);
+
+    PasswordAudit audit;
+    PasswordReport report = audit.inspect("password");
+    report.breaches = 3;
+    audit.add({"v", "f", "a"}, report);
+    audit.add({"v", "f", "b"}, audit.inspect("t9#Vm2!qLx8$Rw4z"));
+    ASSERT_EQ(audit.breachedPasswords().size(), 1u);
+    EXPECT_EQ(audit.breachedPasswords()[0].credential, (CredentialPath{"v", "f", "a"}));
+}
+
+// Import tests
+std::vector<ImportedRecord> readRecords(const std::string& input, ImportFormat format) {
+    std::istringstream stream(input);
+    std::vector<ImportedRecord> records;
+    readImportRecords(stream, format, [&](ImportedRecord& record) { records.push_back(std::move(record)); });
+    return records;
+}
+
+TEST(ImportTest, ReadsCsvAndJsonLines) {
+    auto csv = readRecords("\xEF\xBB\xBFname,url,username,password,note\r\n"
+                           "mail,https://mail.example.com/login,me@example.com,\"p,w\"\"1\",\"two\nlines\"\r\n"
+                           "\r\n"
+                           ",https://user:x@shop.example.com:8080/cart?a=1,buyer,pw2,\r\n", ImportFormat::CSV);
+    ASSERT_EQ(csv.size(), 2u);
+    EXPECT_EQ(csv[0].name, "mail");
+    EXPECT_EQ(csv[0].password, "p,w\"1");
+    EXPECT_EQ(csv[0].notes, "two\nlines");
+    EXPECT_EQ(csv[1].url, "https://user:x@shop.example.com:8080/cart?a=1");
+    EXPECT_THROW(readRecords("a,b\n1,2\n", ImportFormat::CSV), std::runtime_error);
+    EXPECT_THROW(readRecords("name,password\nx,\"open\n", ImportFormat::CSV), std::runtime_error);
+
+    auto lines = readRecords("{\"title\":\"a\",\"login\":\"u\",\"password\":\"p\\u00e9\",\"extra\":null}\n"
+                             "{\"name\":\"b\",\"type\":\"note\",\"notes\":\"text\"}\n", ImportFormat::JSON);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[0].username, "u");
+    EXPECT_EQ(lines[0].password, "p\xC3\xA9");
+    EXPECT_TRUE(lines[1].note);
+    EXPECT_EQ(readRecords("[{\"name\":\"a\",\"password\":\"p\"}, {\"name\":\"b\"}]", ImportFormat::JSON).size(), 2u);
+    EXPECT_THROW(readRecords("[{\"name\":\"a\"", ImportFormat::JSON), std::runtime_error);
+}
+
+TEST(ImportTest, ReadsBitwardenAndKeePassExports) {
+    auto bitwarden = readRecords(R"({"encrypted": false,
+        "folders": [{"id": "f1", "name": "Work/Mail"}],
+        "items": [
+            {"id": "1", "folderId": "f1", "type": 1, "name": "mail", "notes": null,
+             "login": {"uris": [{"match": null, "uri": "https://mail.example.com"}], "username": "me", "password": "pw", "totp": "SEED"},
+             "fields": [{"name": "pin", "value": "1234", "type": 0}]},
+            {"id": "2", "folderId": null, "type": 3, "name": "card", "notes": "visa",
+             "card": {"cardholderName": "Me", "number": "4111", "code": null}}
+        ]})", ImportFormat::BITWARDEN);
+    ASSERT_EQ(bitwarden.size(), 2u);
+    EXPECT_EQ(bitwarden[0].folder, "Work/Mail");
+    EXPECT_EQ(bitwarden[0].url, "https://mail.example.com");
+    EXPECT_EQ(bitwarden[0].notes, "TOTP: SEED\npin: 1234");
+    EXPECT_TRUE(bitwarden[1].note);
+    EXPECT_EQ(bitwarden[1].notes, "visa\ncardholderName: Me\nnumber: 4111");
+    EXPECT_THROW(readRecords(R"({"encrypted": true, "items": []})", ImportFormat::BITWARDEN), std::runtime_error);
+
+    auto keepass = readRecords(R"(<?xml version="1.0" encoding="utf-8" standalone="yes"?>
+<KeePassFile>
+  <Meta><DatabaseName>db</DatabaseName><RecycleBinUUID>BIN=</RecycleBinUUID></Meta>
+  <Root>
+    <Group><UUID>ROOT=</UUID><Name>Database</Name>
+      <Entry><String><Key>Title</Key><Value>top</Value></String><String><Key>Password</Key><Value Protected="True">a&amp;b&#x41;&lt;</Value></String></Entry>
+      <Group><UUID>G1=</UUID><Name>Internet</Name>
+        <Group><UUID>G2=</UUID><Name>Mail</Name>
+          <Entry>
+            <String><Key>Notes</Key><Value><![CDATA[<raw> & text]]></Value></String>
+            <String><Key>Title</Key><Value>mail</Value></String>
+            <String><Key>UserName</Key><Value>me</Value></String>
+            <String><Key>Recovery</Key><Value>code</Value></String>
+            <History><Entry><String><Key>Title</Key><Value>old</Value></String></Entry></History>
+          </Entry>
+        </Group>
+      </Group>
+      <Group><UUID>BIN=</UUID><Name>Recycle Bin</Name>
+        <Entry><String><Key>Title</Key><Value>deleted</Value></String></Entry>
+      </Group>
+    </Group>
+  </Root>
+</KeePassFile>)", ImportFormat::KEEPASS_XML);
+    ASSERT_EQ(keepass.size(), 2u);
+    EXPECT_EQ(keepass[0].folder, "");
+    EXPECT_EQ(keepass[0].password, "a&bA<");
+    EXPECT_EQ(keepass[1].folder, "Internet.Mail");
+    EXPECT_EQ(keepass[1].name, "mail");
+    EXPECT_EQ(keepass[1].notes, "<raw> & text\nRecovery: code");
+    EXPECT_THROW(readRecords("<KeePassFile><Root></KeePassFile>", ImportFormat::KEEPASS_XML), std::runtime_error);
+}
+
+TEST(ImportTest, ConflictPoliciesAndCompanionNotes) {
+    auto importInto = [](Vault& vault, ConflictPolicy policy) {
+        VaultImporter importer(vault, policy);
+        std::istringstream input("folder,name,url,username,password,notes\n"
+                                 "Web/Mail,mail,https://mail.example.com,me,new,\n"
+                                 ",,https://shop.example.com/x,buyer,pw,\n"
+                                 ",memo,,,,just text\n");
+        readImportRecords(input, ImportFormat::CSV, [&](ImportedRecord& record) { importer.add(record); });
+        return importer.getStats();
+    };
+
+    Vault vault("v");
+    vault.addFolder(std::make_unique<Folder>("Web.Mail"));
+    vault.addEntry("Web.Mail", "mail", std::make_unique<CredentialEntry>("me", "old"));
+
+    ImportStats skipped = importInto(vault, ConflictPolicy::SKIP);
+    EXPECT_EQ(skipped.skipped, 1u);
+    EXPECT_EQ(skipped.added, 2u);
+    EXPECT_EQ(dynamic_cast<const CredentialEntry&>(vault.getEntry("Web.Mail", "mail")).getPassword(), "old");
+    // Named after the host, so the URL needs no companion note
+    EXPECT_TRUE(vault.entryExists(defaultImportFolder, "shop.example.com"));
+    EXPECT_FALSE(vault.entryExists(defaultImportFolder, "shop.example.com (notes)"));
+    EXPECT_EQ(dynamic_cast<const NoteEntry&>(vault.getEntry(defaultImportFolder, "memo")).getNoteText(), "just text");
+
+    ImportStats overwritten = importInto(vault, ConflictPolicy::OVERWRITE);
+    // The companion note of the skipped credential is new
+    EXPECT_EQ(overwritten.overwritten, 3u);
+    EXPECT_EQ(overwritten.added, 1u);
+    const Entry& mail = vault.getEntry("Web.Mail", "mail");
+    EXPECT_EQ(dynamic_cast<const CredentialEntry&>(mail).getPassword(), "new");
+    ASSERT_EQ(mail.getHistory().getRevisions(mail).size(), 1u);
+
+    ImportStats renamed = importInto(vault, ConflictPolicy::RENAME);
+    EXPECT_EQ(renamed.renamed, 3u);
+    EXPECT_EQ(renamed.added, 1u);
+    EXPECT_TRUE(vault.entryExists("Web.Mail", "mail (2) (notes)"));
+    EXPECT_TRUE(vault.entryExists(defaultImportFolder, "memo (2)"));
+}
+
+// Export tests
+TEST(ExportTest, RowsReadBackByImport) {
+    Vault vault("Exported");
+    auto folder = std::make_unique<Folder>("Web");
+    folder->addEntry(std::make_unique<CredentialEntry>("me@example.com", "p,w\"1\u00e9"), "mail");
+    folder->addEntry(std::make_unique<NoteEntry>("two\nlines, \"quoted\""), "memo");
+    folder->addEntry(std::make_unique<AttachmentEntry>("key.pem", 10, std::vector<SecureString>{}), "key");
+    vault.addFolder(std::move(folder));
+    SecureBuffer serialized;
+    serializeVault(vault, serialized);
+    VaultView view(std::move(serialized));
+
+    for (ExportFormat format : {ExportFormat::JSONL, ExportFormat::CSV}) {
+        std::ostringstream output;
+        ExportWriter writer(format, output);
+        size_t written = 0;
+        view.forEachEntry([&](const std::string& folderName, const std::string& entryName, const Entry& entry) {
+            written += writer.write(folderName, entryName, entry);
+        });
+        writer.finish();
+        EXPECT_EQ(written, 2u);
+        EXPECT_EQ(writer.getBytesWritten(), output.str().size());
+
+        auto records = readRecords(output.str(), format == ExportFormat::CSV ? ImportFormat::CSV : ImportFormat::JSON);
+        ASSERT_EQ(records.size(), 2u);
+        EXPECT_EQ(records[0].folder, "Web");
+        EXPECT_EQ(records[0].name, "mail");
+        EXPECT_FALSE(records[0].note);
+        EXPECT_EQ(records[0].username, "me@example.com");
+        EXPECT_EQ(records[0].password, "p,w\"1\u00e9");
+        EXPECT_EQ(records[1].name, "memo");
+        EXPECT_TRUE(records[1].note);
+        EXPECT_EQ(records[1].notes, "two\nlines, \"quoted\"");
+    }
+    EXPECT_THROW(parseExportFormat("xml"), std::invalid_argument);
+}
+
+// Path pattern tests
+TEST(PathPatternTest, MatchesFoldersAndEntries) {
+    Vault vault("Patterns");
+    for (std::string folderName : {"prod-eu", "prod-us", "staging"}) {
+        auto folder = std::make_unique<Folder>(folderName);
+        folder->addEntry(std::make_unique<CredentialEntry>("u", "p"), "db-2");
+        folder->addEntry(std::make_unique<CredentialEntry>("u", "p"), "db-1");
+        folder->addEntry(std::make_unique<NoteEntry>("n"), "dbx-notes");
+        vault.addFolder(std::move(folder));
+    }
+    SecureBuffer serialized;
+    serializeVault(vault, serialized);
+    VaultView view(std::move(serialized));
+
+    EXPECT_TRUE(isPathPattern("prod-*"));
+    EXPECT_TRUE(isPathPattern("db-[12]"));
+    EXPECT_FALSE(isPathPattern("prod-eu"));
+    EXPECT_TRUE(matchesPathPattern("db-?", "db-1"));
+    EXPECT_FALSE(matchesPathPattern("db-?", "dbx-notes"));
+    EXPECT_TRUE(matchesPathPattern("\\*", "*"));
+    EXPECT_FALSE(matchesPathPattern("\\*", "a"));
+
+    std::vector<std::string> expectedFolders{"prod-eu", "prod-us"};
+    EXPECT_EQ(matchFolders(vault, "prod-*"), expectedFolders);
+    EXPECT_EQ(matchFolders(view, "prod-*"), expectedFolders);
+    EXPECT_TRUE(matchFolders(vault, "dev-*").empty());
+
+    // Both give the same matches, sorted by folder and then entry
+    for (const auto& matches : {matchEntries(vault, "prod-*", "db-?"), matchEntries(view, "prod-*", "db-?")}) {
+        ASSERT_EQ(matches.size(), 4u);
+        EXPECT_EQ(matches[0].folder, "prod-eu");
+        EXPECT_EQ(matches[0].entry, "db-1");
+        EXPECT_EQ(matches[1].entry, "db-2");
+        EXPECT_EQ(matches[3].folder, "prod-us");
+        EXPECT_EQ(matches[3].entry, "db-2");
+    }
+    EXPECT_EQ(matchEntries(view, "*", "*notes").size(), 3u);
+    EXPECT_TRUE(matchEntries(view, "staging", "db-[3-9]").empty());
+}
+
+// Transfer tests
+TEST(TransferTest, MovesBetweenVaultsWithoutCopying) {
+    Vault source("Source");
+    source.cryptoKDFIterations = 100;
+    source.addFolder(std::make_unique<Folder>("prod"));
+    source.addEntry("prod", "db-1", std::make_unique<CredentialEntry>("u1", "p1"));
+    source.addEntry("prod", "db-2", std::make_unique<CredentialEntry>("u2", "p2"));
+    source.addEntry("prod", "notes", std::make_unique<NoteEntry>("n"));
+    Vault target("Target");
+    target.addFolder(std::make_unique<Folder>("prod"));
+    target.addEntry("prod", "db-2", std::make_unique<NoteEntry>("taken"));
+
+    // Nothing is overwritten
+    EXPECT_THROW(planTransfer(source, "prod", "db-*", target, "prod", ""), std::runtime_error);
+    EXPECT_THROW(planTransfer(source, "prod", "db-*", target, "archive", "db"), std::runtime_error);
+    EXPECT_THROW(planTransfer(source, "dev", "*", target, "archive", ""), std::runtime_error);
+
+    std::vector<TransferPath> paths = planTransfer(source, "prod", "db-*", target, "archive", "");
+    ASSERT_EQ(paths.size(), 2u);
+    const Entry* moved = &std::as_const(source).getEntry("prod", "db-1");
+    applyTransfer(source, target, paths, true);
+    EXPECT_FALSE(source.entryExists("prod", "db-1"));
+    EXPECT_FALSE(source.entryExists("prod", "db-2"));
+    EXPECT_TRUE(source.entryExists("prod", "notes"));
+    EXPECT_EQ(&std::as_const(target).getEntry("archive", "db-1"), moved); // The same entry, not a copy
+    EXPECT_EQ(dynamic_cast<const CredentialEntry&>(std::as_const(target).getEntry("archive", "db-2")).getPassword(), "p2");
+
+    // Applying the paths again (an interrupted move being finished) changes nothing
+    EXPECT_TRUE(applyTransfer(source, target, paths, true).empty());
+    EXPECT_EQ(target.getFolder("archive").getEntryNames().size(), 2u);
+
+    // A source path that differs from its copy is not deleted
+    source.addEntry("prod", "db-1", std::make_unique<CredentialEntry>("u1", "changed"));
+    std::vector<TransferPath> kept = applyTransfer(source, target, paths, true);
+    ASSERT_EQ(kept.size(), 1u);
+    EXPECT_EQ(kept[0].from.entry, "db-1");
+    EXPECT_TRUE(source.entryExists("prod", "db-1"));
+    EXPECT_EQ(&std::as_const(target).getEntry("archive", "db-1"), moved);
+    source.getFolder("prod").deleteEntry("db-1");
+
+    // A copied folder shares its entries until one side modifies them
+    applyTransfer(target, target, planTransfer(target, "archive", "", target, "backup", ""), false);
+    EXPECT_EQ(&std::as_const(target).getEntry("backup", "db-1"), moved);
+    target.getEntry("backup", "db-1").getMetadata().addTag("changed");
+    EXPECT_NE(&std::as_const(target).getEntry("backup", "db-1"), moved);
+    EXPECT_TRUE(std::as_const(target).getEntry("archive", "db-1").getMetadata().tags.empty());
+
+    // The marker keeps the paths encrypted with the source vault's password
+    Botan::secure_vector<char> password{'p', 'w'};
+    std::string marker = encodeTransferMarker(source, {"Target", paths}, password);
+    EXPECT_EQ(marker.find("db-1"), std::string::npos);
+    EXPECT_EQ(transferMarkerTarget(marker), "Target");
+    TransferMarker decoded = decodeTransferMarker(marker, password);
+    ASSERT_EQ(decoded.paths.size(), 2u);
+    EXPECT_EQ(decoded.paths[1].from.entry, "db-2");
+    EXPECT_EQ(decoded.paths[1].to.folder, "archive");
+    EXPECT_THROW(decodeTransferMarker(marker, Botan::secure_vector<char>{'x'}), std::runtime_error);
+
+    // The source vault refuses other writes until the move is finished
+    Storage storage(std::make_unique<MemoryBackend>());
+    storage.saveVault(source, password);
+    storage.writeMoveMarker("Source", marker);
+    EXPECT_THROW(storage.saveVault(source, password), std::runtime_error);
+    EXPECT_THROW(storage.deleteVault("Source"), std::runtime_error);
+    storage.saveMovingVault(source, password);
+    storage.removeMoveMarker("Source");
+    storage.saveVault(source, password);
+}
+
+// Output tests
+TEST(OutputTest, WriterBuffersUntilFinished) {
+    std::ostringstream stream;
+    {
+        OutputWriter out(stream);
+        out << "{\"name\":";
+        out.json("a \"b\"\n") << ",\"size\":" << uint64_t{42} << '}' << "\n";
+        EXPECT_TRUE(stream.str().empty());
+        out.finish();
+    }
+    EXPECT_EQ(stream.str(), "{\"name\":\"a \\\"b\\\"\\n\",\"size\":42}\n");
+    EXPECT_EQ(json::parse(stream.str())["name"], "a \"b\"\n");
+
+    // Large listings go out in blocks, a failed command drops what wasn't written
+    std::ostringstream listing;
+    {
+        OutputWriter out(listing);
+        for (int i = 0; i < 20000; i++) {
+            out << "entry\n";
+        }
+        EXPECT_GT(listing.str().size(), 0u);
+        EXPECT_LT(listing.str().size(), 120000u);
+    }
+    EXPECT_LT(listing.str().size(), 120000u);
+    EXPECT_EQ(parseOutputFormat("json"), OutputFormat::JSON);
+    EXPECT_THROW(parseOutputFormat("yaml"), std::invalid_argument);
+}
+
+TEST(OutputTest, PrivateFileIsNewAndOwnerOnly) {
+    auto dir = std::filesystem::temp_directory_path() / "manpass_test_private";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::string path = (dir / "secret").string();
+    {
+        PrivateFile file(path);
+        file.stream() << "plaintext";
+        file.close();
+    }
+    EXPECT_EQ(std::filesystem::status(path).permissions(), std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+
+    // Neither an existing file nor a symlink is written through
+    EXPECT_THROW(PrivateFile{path}, std::runtime_error);
+    std::filesystem::create_symlink(dir / "elsewhere", dir / "link");
+    EXPECT_THROW(PrivateFile{(dir / "link").string()}, std::runtime_error);
+    EXPECT_FALSE(std::filesystem::exists(dir / "elsewhere"));
+
+    // Without close() the file doesn't stay
+    {
+        PrivateFile file((dir / "partial").string());
+        file.stream() << "part";
+    }
+    EXPECT_FALSE(std::filesystem::exists(dir / "partial"));
+    std::filesystem::remove_all(dir);
+}
+
+// Entry history tests
+TEST(HistoryTest, RecordsRevisionsAsDeltas) {
+    // A large note edited a few times only grows by the size of the edits
+    std::string text;
+    for (int i = 0; i < 2000; i++)
+        text += "line " + std::to_string(i) + " of a long note with ünicode\n";
+    std::vector<std::string> values{text};
+    for (int i = 1; i <= 4; i++) {
+        std::string edited = values.back();
+        edited.replace(edited.size() / (i + 1), 10, "edit #" + std::to_string(i));
+        values.push_back(edited);
+    }
+
+    auto current = std::make_unique<NoteEntry>(values[0]);
+    for (size_t i = 1; i < values.size(); i++) {
+        auto next = std::make_unique<NoteEntry>(values[i]);
+        next->getHistory() = std::move(current->getHistory());
+        next->getHistory().record(*current, *next, defaultHistoryRetention, 1000 + i);
+        current = std::move(next);
+    }
+    EXPECT_EQ(current->getHistory().size(), 4u);
+    EXPECT_LT(current->getHistory().raw().size(), 1000u);
+
+    std::vector<Revision> revisions = current->getHistory().getRevisions(*current);
+    ASSERT_EQ(revisions.size(), 4u);
+    for (size_t i = 0; i < revisions.size(); i++) {
+        EXPECT_EQ(revisions[i].time, static_cast<int64_t>(1000 + values.size() - 1 - i));
+        EXPECT_EQ(dynamic_cast<const NoteEntry&>(*revisions[i].entry).getNoteText(), values[values.size() - 2 - i]);
+    }
+
+    // The history is valid JSON for the DOM path as well
+    EXPECT_TRUE(json::parse(current->getHistory().raw()).is_array());
+
+    // Dropping the oldest revisions doesn't touch the newer ones
+    current->getHistory().truncate(2);
+    revisions = current->getHistory().getRevisions(*current);
+    ASSERT_EQ(revisions.size(), 2u);
+    EXPECT_EQ(dynamic_cast<const NoteEntry&>(*revisions[1].entry).getNoteText(), values[values.size() - 3]);
+    current->getHistory().truncate(0);
+    EXPECT_TRUE(current->getHistory().empty());
+}
+
+TEST(HistoryTest, HistorySurvivesSaveAndLoad) {
+    Storage storage(std::make_unique<MemoryBackend>());
+    std::string password_str = "testpass";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+
+    Vault vault("History");
+    vault.cryptoKDFIterations = 100;
+    vault.historyRetention = 2;
+    auto folder = std::make_unique<Folder>("Logins");
+    auto credential = std::make_unique<CredentialEntry>("user", "first");
+    for (std::string password : {"second", "third", "fourth"}) {
+        auto rotated = std::make_unique<CredentialEntry>("user", password);
+        rotated->getHistory() = std::move(credential->getHistory());
+        rotated->getHistory().record(*credential, *rotated, vault.historyRetention);
+        credential = std::move(rotated);
+    }
+    folder->addEntry(std::move(credential), "login");
+    vault.addFolder(std::move(folder));
+    storage.saveVault(vault, password);
+
+    // The full load keeps the history without decoding it, the view decodes it on request
+    Vault loaded = storage.loadVault("History", password);
+    EXPECT_EQ(loaded.historyRetention, 2u);
+    EXPECT_EQ(loaded.getEntry("Logins", "login").getHistory().raw(), vault.getEntry("Logins", "login").getHistory().raw());
+
+    VaultView view = storage.loadVaultView("History", password);
+    const Entry& entry = view.getEntry("Logins", "login");
+    std::vector<Revision> revisions = entry.getHistory().getRevisions(entry);
+    ASSERT_EQ(revisions.size(), 2u);
+    EXPECT_EQ(dynamic_cast<const CredentialEntry&>(*revisions[0].entry).getPassword(), "third");
+    EXPECT_EQ(dynamic_cast<const CredentialEntry&>(*revisions[1].entry).getPassword(), "second");
+
+    // The json DOM path reads the same history
+    json j = loaded.getEntry("Logins", "login");
+    EXPECT_EQ(parseEntry(j)->getHistory().size(), 2u);
+}
+
+// Snapshot tests
+TEST(SnapshotTest, PersistentMapCopiesAreIsolated) {
+    PersistentMap<int> map;
+    for (int i = 0; i < 2000; i++) {
+        map.set("key" + std::to_string(i), i);
+    }
+    PersistentMap<int> snapshot = map;
+
+    for (int i = 0; i < 2000; i += 2) {
+        EXPECT_TRUE(map.erase("key" + std::to_string(i)));
+    }
+    map.set("key1", -1);
+    map.set("extra", 42);
+    EXPECT_FALSE(map.erase("missing"));
+
+    EXPECT_EQ(snapshot.size(), 2000u);
+    EXPECT_EQ(map.size(), 1001u);
+    for (int i = 0; i < 2000; i++) {
+        ASSERT_NE(snapshot.find("key" + std::to_string(i)), nullptr);
+        EXPECT_EQ(*snapshot.find("key" + std::to_string(i)), i);
+    }
+    EXPECT_EQ(map.find("key0"), nullptr);
+    EXPECT_EQ(*map.find("key1"), -1);
+    EXPECT_EQ(*map.find("extra"), 42);
+
+    size_t visited = 0;
+    for (const auto& [key, value] : map) {
+        EXPECT_EQ(map.find(key), &value);
+        visited++;
+    }
+    EXPECT_EQ(visited, map.size());
+
+    // Only what changed is reported
+    std::map<std::string, std::pair<bool, bool>> changes;
+    PersistentMap<int>::diff(snapshot, map, [&](const std::string& key, const int* before, const int* after) {
+        changes[key] = {before != nullptr, after != nullptr};
+    });
+    EXPECT_EQ(changes.size(), 1002u);
+    EXPECT_EQ(changes["key1"], std::make_pair(true, true));
+    EXPECT_EQ(changes["key0"], std::make_pair(true, false));
+    EXPECT_EQ(changes["extra"], std::make_pair(false, true));
+}
+
+TEST(SnapshotTest, EditsDoNotReachSnapshots) {
+    Vault vault("Vault");
+    vault.addFolder(std::make_unique<Folder>("Logins"));
+    vault.addFolder(std::make_unique<Folder>("Notes"));
+    vault.addEntry("Logins", "mail", std::make_unique<CredentialEntry>("user", "old"));
+    vault.addEntry("Notes", "note", std::make_unique<NoteEntry>("text"));
+    vault.getEntry("Logins", "mail").getHistory().setRaw("[{\"time\":1,\"text\":\"x\",\"type\":\"NOTE\"}]");
+
+    Vault snapshot = vault;
+    vault.getEntry("Logins", "mail").getHistory().truncate(0);
+    vault.getFolder("Logins").addEntry(std::make_unique<NoteEntry>("new"), "added");
+    vault.deleteFolder("Notes");
+
+    EXPECT_EQ(snapshot.getEntry("Logins", "mail").getHistory().size(), 1u);
+    EXPECT_TRUE(vault.getEntry("Logins", "mail").getHistory().empty());
+    EXPECT_FALSE(snapshot.entryExists("Logins", "added"));
+    EXPECT_TRUE(snapshot.folderExists("Notes"));
+
+    std::vector<VaultChange> changes = diff(snapshot, vault);
+    ASSERT_EQ(changes.size(), 3u);
+    EXPECT_EQ(changes[0].kind, VaultChange::Kind::ADDED);
+    EXPECT_EQ(changes[0].entry, "added");
+    EXPECT_EQ(changes[1].kind, VaultChange::Kind::MODIFIED);
+    EXPECT_EQ(changes[1].entry, "mail");
+    EXPECT_EQ(changes[2].kind, VaultChange::Kind::REMOVED);
+    EXPECT_EQ(changes[2].folder, "Notes");
+    EXPECT_EQ(changes[2].entry, "");
+    EXPECT_TRUE(diff(vault, Vault(vault)).empty());
+}
+
+TEST(SnapshotTest, UndoAndRedo) {
+    Vault vault("Vault");
+    vault.addFolder(std::make_unique<Folder>("Logins"));
+    UndoStack undo;
+
+    undo.record(vault);
+    vault.addEntry("Logins", "mail", std::make_unique<CredentialEntry>("user", "pass"));
+    undo.record(vault);
+    vault.changeFolderName("Logins", "Accounts");
+
+    undo.undo(vault);
+    EXPECT_TRUE(vault.entryExists("Logins", "mail"));
+    undo.undo(vault);
+    EXPECT_FALSE(vault.entryExists("Logins", "mail"));
+    EXPECT_FALSE(undo.canUndo());
+    EXPECT_THROW(undo.undo(vault), std::out_of_range);
+
+    undo.redo(vault);
+    undo.redo(vault);
+    EXPECT_TRUE(vault.entryExists("Accounts", "mail"));
+    EXPECT_FALSE(undo.canRedo());
+}
+
 // Storage tests
 
 static std::filesystem::path makeTempDir() {
@@ -694,3 +1791,699 @@ TEST(StorageTest, WrongPasswordThrows) {
     Botan::secure_vector<char> password_wrong(wrong_pass_str.begin(), wrong_pass_str.end());
     EXPECT_THROW(storage.loadVault("SecVault", password_wrong), std::exception);
 }
+
+TEST(StorageTest, CompressionHeaderIsAuthenticated) {
+    auto tempDir = makeTempDir();
+    Storage storage(tempDir);
+    std::string password_str = "testpass";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+
+    Vault vault("Packed");
+    vault.cryptoKDFIterations = 100;
+    vault.cryptoCompression = "none";
+    auto folder = std::make_unique<Folder>("Notes");
+    folder->addEntry(std::make_unique<NoteEntry>("text"), "note1");
+    vault.addFolder(std::move(folder));
+    storage.saveVault(vault, password);
+
+    auto filePath = tempDir / "Packed.json";
+    json j;
+    {
+        std::ifstream ifs(filePath);
+        ifs >> j;
+    }
+    EXPECT_EQ(j["Compression"].get<std::string>(), "none");
+    EXPECT_EQ(j["ChunkSize"].get<size_t>(), defaultChunkSize);
+    EXPECT_EQ(storage.loadVault("Packed", password).cryptoCompression, "none");
+
+    // Changing the header without re-encrypting has to be detected
+    j["Compression"] = "zlib";
+    {
+        std::ofstream ofs(filePath);
+        ofs << j.dump(4);
+    }
+    EXPECT_THROW(storage.loadVault("Packed", password), std::runtime_error);
+}
+
+TEST(StorageTest, LoadLegacyVaultWithoutCompression) {
+    auto tempDir = makeTempDir();
+    Storage storage(tempDir);
+    std::string password_str = "testpass";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+
+    // Vault file in the format written before compression was added
+    std::string plaintext = R"({"folders":[{"entries":[],"name":"F"}],"name":"Legacy"})";
+    EncryptedBlob blob = encrypt(plaintext, password, "AES-256/GCM", "PBKDF2(SHA-256)", "irXIESN9HIWI6dnKTEXb7A==", 100);
+    json j;
+    j["Algorithm"] = blob.algorithm;
+    j["KDF"] = blob.kdf;
+    j["KDFIterations"] = blob.kdfIterations;
+    j["Salt"] = blob.base64Salt;
+    j["Nonce"] = blob.base64Nonce;
+    j["Data"] = blob.base64Ciphertext;
+    std::ofstream ofs(tempDir / "Legacy.json");
+    ofs << j.dump(4);
+    ofs.close();
+
+    Vault loaded = storage.loadVault("Legacy", password);
+    EXPECT_TRUE(loaded.folderExists("F"));
+    EXPECT_EQ(loaded.cryptoCompression, defaultCompression()); // Upgraded on the next save
+}
+
+TEST(StorageTest, EverySaveHasItsOwnSalt) {
+    Storage storage(std::make_unique<MemoryBackend>());
+    std::string password_str = "testpass";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+
+    Vault vault("Resaved");
+    vault.cryptoKDFIterations = 100;
+    storage.saveVault(vault, password);
+    json first = json::parse(storage.getBackend().readBlob("Resaved"));
+    storage.saveVault(vault, password);
+    json second = json::parse(storage.getBackend().readBlob("Resaved"));
+
+    // A new key per save, the nonce prefix only has to be unique within one
+    EXPECT_NE(first["Salt"], second["Salt"]);
+    EXPECT_NE(first["Nonce"], second["Nonce"]);
+    EXPECT_NE(second["Salt"].get<std::string>(), vault.cryptoBase64Salt);
+    EXPECT_EQ(storage.loadVault("Resaved", password).cryptoBase64Salt, second["Salt"].get<std::string>());
+}
+
+TEST(StorageTest, MemoryBackendRoundTrip) {
+    Storage storage(std::make_unique<MemoryBackend>());
+    std::string password_str = "testpass";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+
+    Vault vault("InMemory");
+    vault.cryptoKDFIterations = 100;
+    auto folder = std::make_unique<Folder>("Logins");
+    folder->addEntry(std::make_unique<CredentialEntry>("user", "pass"), "login1");
+    // Larger than a few encryption chunks
+    std::string certificate = base64Encode(std::vector<uint8_t>(3 * defaultChunkSize, 0x5A));
+    folder->addEntry(std::make_unique<NoteEntry>(certificate), "certificate");
+    vault.addFolder(std::move(folder));
+    storage.saveVault(vault, password);
+
+    EXPECT_TRUE(storage.vaultExists("InMemory"));
+    EXPECT_EQ(storage.getAllVaultNames(), std::vector<std::string>{"InMemory"});
+    EXPECT_NE(storage.getBackend().readBlob("InMemory").find("\"Data\""), std::string::npos);
+
+    Vault loaded = storage.loadVault("InMemory", password);
+    const auto* cred = dynamic_cast<const CredentialEntry*>(&loaded.getEntry("Logins", "login1"));
+    ASSERT_NE(cred, nullptr);
+    EXPECT_EQ(cred->getPassword(), "pass");
+    const auto* note = dynamic_cast<const NoteEntry*>(&loaded.getEntry("Logins", "certificate"));
+    ASSERT_NE(note, nullptr);
+    EXPECT_EQ(note->getNoteText(), certificate);
+
+    // Same round trip with the other cipher
+    vault.cryptoAlgorithm = "ChaCha20Poly1305";
+    storage.saveVault(vault, password);
+    EXPECT_EQ(storage.loadVault("InMemory", password).cryptoAlgorithm, "ChaCha20Poly1305");
+
+    EXPECT_TRUE(storage.deleteVault("InMemory"));
+    EXPECT_FALSE(storage.deleteVault("InMemory"));
+    EXPECT_THROW(storage.loadVault("InMemory", password), std::runtime_error);
+}
+
+TEST(StorageTest, PosixBackendWritesAtomically) {
+    auto tempDir = makeTempDir();
+    PosixFileBackend backend(tempDir);
+
+    backend.writeBlob("blob", "first");
+    backend.writeBlob("blob", "second");
+    EXPECT_EQ(backend.readBlob("blob"), "second");
+    EXPECT_FALSE(std::filesystem::exists(tempDir / "blob.json.tmp"));
+
+    {
+        auto lock = backend.lock("blob");
+        EXPECT_EQ(backend.listBlobs(), std::vector<std::string>{"blob"}); // The lock file is not a blob
+    }
+    EXPECT_TRUE(backend.removeBlob("blob"));
+    EXPECT_FALSE(backend.blobExists("blob"));
+    EXPECT_THROW(backend.readBlob("blob"), std::runtime_error);
+
+    // The holder removes the lock file with the blob, a lock() waiting meanwhile locks the file that replaces it
+    auto lock = backend.lock("blob");
+    std::atomic<bool> acquired = false;
+    std::thread other([&] {
+        auto otherLock = backend.lock("blob");
+        acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    backend.removeLock("blob");
+    EXPECT_FALSE(std::filesystem::exists(tempDir / "blob.lock"));
+    lock.reset();
+    other.join();
+    EXPECT_TRUE(acquired);
+    EXPECT_TRUE(std::filesystem::exists(tempDir / "blob.lock"));
+}
+
+TEST(StorageTest, PosixBackendMapsBlobs) {
+    auto tempDir = makeTempDir();
+    PosixFileBackend backend(tempDir);
+
+    std::string contents(1 << 20, 'x');
+    contents.front() = '{';
+    contents.back() = '}';
+    backend.writeBlob("large", contents);
+    auto mapping = backend.mapBlob("large");
+    EXPECT_EQ(mapping->data(), contents);
+
+    // Replacing the file doesn't invalidate an existing mapping
+    backend.writeBlob("large", "{}");
+    EXPECT_EQ(mapping->data().size(), contents.size());
+    EXPECT_EQ(backend.mapBlob("large")->data(), "{}");
+
+    backend.writeBlob("empty", "");
+    EXPECT_TRUE(backend.mapBlob("empty")->data().empty());
+    EXPECT_THROW(backend.mapBlob("missing"), std::runtime_error);
+}
+
+TEST(StorageTest, MemoryBackendLockIsExclusive) {
+    MemoryBackend backend;
+    auto lock = backend.lock("vault");
+
+    std::atomic<bool> acquired = false;
+    std::thread other([&] {
+        auto otherLock = backend.lock("vault");
+        acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(acquired);
+
+    lock.reset();
+    other.join();
+    EXPECT_TRUE(acquired);
+}
+
+TEST(StorageTest, LoadVaultViewRoundTrip) {
+    auto tempDir = makeTempDir();
+    Storage storage(tempDir);
+    std::string password_str = "testpass";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+
+    Vault vault("ViewVault");
+    auto folder = std::make_unique<Folder>("Logins");
+    folder->addEntry(std::make_unique<CredentialEntry>("user", "pass"), "login1");
+    vault.addFolder(std::move(folder));
+    storage.saveVault(vault, password);
+
+    VaultView view = storage.loadVaultView("ViewVault", password);
+    EXPECT_EQ(view.getName(), "ViewVault");
+    const auto* cred = dynamic_cast<const CredentialEntry*>(&view.getEntry("Logins", "login1"));
+    ASSERT_NE(cred, nullptr);
+    EXPECT_EQ(cred->getPassword(), "pass");
+}
+
+// Deterministic pseudo-random bytes standing in for a binary file
+static std::string randomFile(size_t size, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::string data(size, '\0');
+    for (auto& c : data)
+        c = static_cast<char>(generator());
+    return data;
+}
+
+TEST(StorageTest, AttachmentChunksAreContentDefined) {
+    std::string data = randomFile(4 * 1024 * 1024, 1);
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+
+    size_t chunks = 0;
+    for (size_t offset = 0; offset < data.size(); chunks++) {
+        size_t length = findChunkBoundary(bytes + offset, data.size() - offset);
+        EXPECT_LE(length, maxAttachmentChunkSize);
+        if (offset + length < data.size()) {
+            EXPECT_GE(length, minAttachmentChunkSize);
+        }
+        offset += length;
+    }
+    EXPECT_GT(chunks, 16u); // Roughly 64 KiB on average, not cut at the maximum size every time
+
+    // Inserting bytes at the front only changes the chunks around the edit
+    ChunkStore store(std::make_shared<MemoryBackend>());
+    std::istringstream original(data), edited("inserted" + data);
+    auto first = store.storeAttachment(original, "file");
+    size_t storedChunks = store.getBackend().listBlobs().size();
+    auto second = store.storeAttachment(edited, "file");
+    EXPECT_LE(store.getBackend().listBlobs().size(), storedChunks + 2);
+    EXPECT_EQ(first->getChunkKeys().back(), second->getChunkKeys().back());
+    EXPECT_EQ(second->getSize(), data.size() + 8);
+}
+
+TEST(StorageTest, AttachmentRoundTripAndDeduplication) {
+    Storage storage(std::make_unique<MemoryBackend>());
+    std::string password_str = "testpass";
+    Botan::secure_vector<char> password(password_str.begin(), password_str.end());
+    std::string contents = randomFile(1024 * 1024 + 123, 2);
+
+    for (std::string name : {"First", "Second"}) {
+        Vault vault(name);
+        vault.cryptoKDFIterations = 100;
+        auto folder = std::make_unique<Folder>("Keys");
+        std::istringstream file(contents);
+        folder->addEntry(storage.getChunkStore().storeAttachment(file, "id_ed25519"), "deploy");
+        vault.addFolder(std::move(folder));
+        storage.saveVault(vault, password);
+    }
+
+    // Both vaults reference the same chunks, and the chunks are not mistaken for vaults
+    StorageBackend& chunks = storage.getChunkStore().getBackend();
+    size_t storedChunks = chunks.listBlobs().size();
+    EXPECT_GT(storedChunks, 1u);
+    EXPECT_EQ(storage.getAllVaultNames().size(), 2u);
+    EXPECT_LT(storage.getBackend().readBlob("First").size(), 64u * 1024);
+
+    VaultView view = storage.loadVaultView("Second", password);
+    EXPECT_EQ(view.getEntryType("Keys", "deploy"), EntryType::ATTACHMENT);
+    const auto& attachment = dynamic_cast<const AttachmentEntry&>(view.getEntry("Keys", "deploy"));
+    EXPECT_EQ(attachment.getFileName(), "id_ed25519");
+    EXPECT_EQ(attachment.getSize(), contents.size());
+    std::string restored;
+    storage.getChunkStore().readAttachment(attachment, [&restored](const uint8_t* data, size_t size) {
+        restored.append(reinterpret_cast<const char*>(data), size);
+    });
+    EXPECT_EQ(restored, contents);
+
+    // The full load path and the json DOM path read the same references
+    Vault loaded = storage.loadVault("First", password);
+    json j = loaded.getEntry("Keys", "deploy");
+    auto parsed = parseEntry(j);
+    const auto& parsedAttachment = dynamic_cast<const AttachmentEntry&>(*parsed);
+    EXPECT_EQ(parsedAttachment.getChunkKeys(), attachment.getChunkKeys());
+
+    // A tampered chunk is rejected
+    std::string name = chunks.listBlobs().front();
+    std::string sealed = chunks.readBlob(name);
+    sealed.back() ^= 1;
+    chunks.writeBlob(name, sealed);
+    EXPECT_THROW(storage.getChunkStore().readAttachment(attachment, [](const uint8_t*, size_t) {}), std::runtime_error);
+}
+
+TEST(StorageTest, PosixBackendKeepsChunksApart) {
+    auto tempDir = makeTempDir();
+    Storage storage(tempDir);
+    std::istringstream file(randomFile(100 * 1024, 3));
+    auto attachment = storage.getChunkStore().storeAttachment(file, "blob.bin");
+
+    EXPECT_EQ(attachment->getSize(), 100u * 1024);
+    EXPECT_TRUE(std::filesystem::is_directory(tempDir / "attachments"));
+    EXPECT_EQ(storage.getChunkStore().getBackend().listBlobs().size(), attachment->getChunkKeys().size());
+    EXPECT_TRUE(storage.getAllVaultNames().empty());
+}
+
+TEST(StorageTest, GenerationsFollowChangesFromOtherProcesses) {
+    auto tempDir = makeTempDir();
+    Storage storage(tempDir), other(tempDir); // other stands for another process writing the directory
+    Botan::secure_vector<char> password{'p', 'w'};
+    Vault vault("v");
+    vault.cryptoKDFIterations = 100;
+    storage.saveVault(vault, password);
+
+    uint64_t generation = storage.vaultGeneration("v");
+    EXPECT_EQ(storage.getAllVaultNames(), std::vector<std::string>{"v"});
+    EXPECT_GE(storage.changeDescriptor(), 0);
+    storage.loadVault("v", password);
+    EXPECT_EQ(storage.vaultGeneration("v"), generation); // Reading doesn't change it
+
+    other.saveVault(vault, password);
+    uint64_t changed = storage.vaultGeneration("v");
+    EXPECT_NE(changed, generation);
+    EXPECT_EQ(storage.vaultGeneration("v"), changed);
+
+    // The listing is cached until a vault file comes or goes
+    Vault second("w");
+    second.cryptoKDFIterations = 100;
+    other.saveVault(second, password);
+    EXPECT_EQ(storage.getAllVaultNames().size(), 2u);
+    other.deleteVault("v");
+    EXPECT_EQ(storage.getAllVaultNames(), std::vector<std::string>{"w"});
+    EXPECT_NE(storage.vaultGeneration("v"), changed);
+}
+
+TEST(StorageTest, CopyAttachmentToArchive) {
+    Storage storage(std::make_unique<MemoryBackend>()), archive(std::make_unique<MemoryBackend>());
+    std::string contents = randomFile(300 * 1024, 4);
+    std::istringstream file(contents);
+    auto attachment = storage.getChunkStore().storeAttachment(file, "backup.tar");
+
+    // The chunks are copied sealed, once, and the keys in the entry read them back from the archive
+    storage.getChunkStore().copyAttachment(*attachment, archive.getChunkStore());
+    storage.getChunkStore().copyAttachment(*attachment, archive.getChunkStore());
+    StorageBackend& copied = archive.getChunkStore().getBackend();
+    EXPECT_EQ(copied.listBlobs(), storage.getChunkStore().getBackend().listBlobs());
+    std::string restored;
+    archive.getChunkStore().readAttachment(*attachment, [&restored](const uint8_t* data, size_t size) {
+        restored.append(reinterpret_cast<const char*>(data), size);
+    });
+    EXPECT_EQ(restored, contents);
+
+    // A chunk missing from the source is reported (unless the target already has it)
+    Storage empty(std::make_unique<MemoryBackend>()), target(std::make_unique<MemoryBackend>());
+    EXPECT_NO_THROW(empty.getChunkStore().copyAttachment(*attachment, archive.getChunkStore()));
+    EXPECT_THROW(empty.getChunkStore().copyAttachment(*attachment, target.getChunkStore()), std::runtime_error);
+}
+
+// Key source tests
+static std::string toString(const Botan::secure_vector<char>& password) {
+    return std::string(password.begin(), password.end());
+}
+
+TEST(KeySourceTest, DescriptorAndKeyfile) {
+    // One line per password, the last one without a line break
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::string lines = "first\r\n\nthird";
+    ASSERT_EQ(write(fds[1], lines.data(), lines.size()), static_cast<ssize_t>(lines.size()));
+    close(fds[1]);
+    FdKeySource descriptor(fds[0]);
+    EXPECT_EQ(toString(descriptor.getPassword("v")), "first");
+    EXPECT_EQ(toString(descriptor.getPassword("v")), "");
+    EXPECT_EQ(toString(descriptor.getPassword("v")), "third");
+    EXPECT_THROW(descriptor.getPassword("v"), std::runtime_error);
+    close(fds[0]);
+
+    auto tempDir = makeTempDir();
+    std::filesystem::create_directories(tempDir);
+    std::ofstream(tempDir / "key", std::ios::binary) << std::string(100000, 'k');
+    KeyfileKeySource keyfile(tempDir / "key");
+    std::string key = toString(keyfile.getPassword("v"));
+    EXPECT_EQ(key.size(), 64u);
+    EXPECT_EQ(toString(keyfile.getPassword("w")), key);
+
+    // Combined with a password, the key depends on both
+    ASSERT_EQ(pipe(fds), 0);
+    ASSERT_EQ(write(fds[1], "a\nb\na\n", 6), 6);
+    close(fds[1]);
+    KeyfileKeySource combined(tempDir / "key", std::make_unique<FdKeySource>(fds[0]));
+    std::string withA = toString(combined.getPassword("v"));
+    EXPECT_NE(withA, key);
+    EXPECT_NE(toString(combined.getPassword("v")), withA);
+    EXPECT_EQ(toString(combined.getPassword("v")), withA);
+    close(fds[0]);
+
+    EXPECT_THROW(KeyfileKeySource(tempDir / "missing").getPassword("v"), std::runtime_error);
+}
+
+TEST(KeySourceTest, AgentAnswersOverTheSocket) {
+    auto tempDir = makeTempDir();
+    std::filesystem::create_directories(tempDir);
+    std::filesystem::permissions(tempDir, std::filesystem::perms::owner_all, std::filesystem::perm_options::replace);
+    std::string socketPath = (tempDir / "agent.sock").string();
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socketPath.c_str());
+    ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    ASSERT_EQ(listen(listener, 4), 0);
+
+    // Knows the key of "v" only
+    std::thread agentThread([listener]() {
+        for (int i = 0; i < 2; i++) {
+            int client = accept(listener, nullptr, nullptr);
+            SecureBuffer message;
+            ASSERT_TRUE(agent::readFrame(client, message));
+            agent::FieldReader reader(message.data(), message.size());
+            EXPECT_EQ(reader.readByte(), static_cast<uint8_t>(agent::Opcode::GET_KEY));
+            bool known = reader.readField() == "v";
+            EXPECT_TRUE(reader.atEnd());
+            agent::beginFrame(message, static_cast<uint8_t>(known ? agent::Status::OK : agent::Status::ERROR));
+            agent::appendField(message, known ? "secret" : "Vault is not unlocked");
+            agent::finishFrame(message);
+            agent::writeFrame(client, message);
+            close(client);
+        }
+    });
+
+    AgentKeySource source(socketPath);
+    EXPECT_EQ(toString(source.getPassword("v")), "secret");
+    EXPECT_THROW(source.getPassword("w"), std::runtime_error);
+    agentThread.join();
+
+    // A socket in a directory others can get into may not be the user's agent
+    std::filesystem::permissions(tempDir, std::filesystem::perms::group_exec, std::filesystem::perm_options::add);
+    EXPECT_THROW(agent::AgentClient{socketPath}, std::runtime_error);
+    std::filesystem::permissions(tempDir, std::filesystem::perms::group_exec, std::filesystem::perm_options::remove);
+    close(listener);
+    EXPECT_THROW(AgentKeySource(socketPath).getPassword("v"), std::runtime_error);
+}
+
+// Agent tests
+TEST(AgentTest, ServesResidentVaultsToConcurrentClients) {
+    auto tempDir = makeTempDir();
+    std::filesystem::create_directories(tempDir);
+    std::string socketPath = (tempDir / "run" / "agent.sock").string();
+
+    Vault vault("v");
+    vault.addFolder(std::make_unique<Folder>("prod"));
+    vault.addFolder(std::make_unique<Folder>("empty"));
+    vault.addEntry("prod", "db", std::make_unique<CredentialEntry>("admin", "s3cret"));
+    vault.addEntry("prod", "memo", std::make_unique<NoteEntry>("text"));
+
+    {
+        agent::Agent server(socketPath);
+        server.addVault(vault, Botan::secure_vector<char>{'p', 'w'});
+        server.listen();
+        EXPECT_EQ(std::filesystem::status(tempDir / "run").permissions() & std::filesystem::perms::all, std::filesystem::perms::owner_all);
+        EXPECT_THROW(agent::Agent(socketPath).listen(), std::runtime_error); // Already taken
+        std::thread serverThread([&server]() { server.run(); });
+
+        // Clients connected at the same time are all served
+        std::atomic<int> served{0};
+        std::vector<std::thread> clients;
+        for (int i = 0; i < 8; i++) {
+            clients.emplace_back([&]() {
+                agent::AgentClient client(socketPath);
+                for (int j = 0; j < 50; j++) {
+                    agent::FieldReader reader = client.request(agent::Opcode::SHOW, {"v", "prod", "db"});
+                    EXPECT_EQ(reader.readField(), "prod");
+                    EXPECT_EQ(reader.readField(), "db");
+                    EXPECT_EQ(reader.readByte(), static_cast<uint8_t>(EntryType::CREDENTIAL));
+                    auto entry = materializeEntry(reader.readField(), EntryType::CREDENTIAL);
+                    EXPECT_EQ(dynamic_cast<CredentialEntry&>(*entry).getPassword(), "s3cret");
+                    EXPECT_TRUE(reader.atEnd());
+                }
+                served++;
+            });
+        }
+        for (std::thread& client : clients) {
+            client.join();
+        }
+        EXPECT_EQ(served, 8);
+
+        {
+            agent::AgentClient client(socketPath);
+            agent::FieldReader list = client.request(agent::Opcode::LIST, {"v", "*", ""});
+            EXPECT_EQ(list.readField(), "empty"); // An empty folder is a record without an entry
+            EXPECT_EQ(list.readField(), "");
+            list.readByte();
+            EXPECT_EQ(list.readField(), "prod");
+            EXPECT_EQ(list.readField(), "db");
+            list.readByte();
+            EXPECT_EQ(list.readField(), "prod");
+            EXPECT_EQ(list.readField(), "memo");
+            EXPECT_EQ(list.readByte(), static_cast<uint8_t>(EntryType::NOTE));
+            EXPECT_TRUE(list.atEnd());
+
+            EXPECT_EQ(client.request(agent::Opcode::GET_KEY, {"v"}).readField(), "pw");
+            EXPECT_TRUE(client.request(agent::Opcode::SHOW, {"v", "*", "x*"}).atEnd()); // A pattern may match nothing
+            EXPECT_THROW(client.request(agent::Opcode::SHOW, {"v", "prod", "nope"}), std::runtime_error);
+            EXPECT_THROW(client.request(agent::Opcode::GET_KEY, {"w"}), std::runtime_error);
+        }
+
+        server.stop();
+        serverThread.join();
+    }
+    EXPECT_FALSE(std::filesystem::exists(socketPath));
+}
+
+TEST(AgentTest, ReadersSeeWholeVersionsWhileWritesAreSaved) {
+    auto tempDir = makeTempDir();
+    std::filesystem::create_directories(tempDir);
+    std::string socketPath = (tempDir / "run" / "agent.sock").string();
+    Storage storage(std::make_unique<MemoryBackend>());
+    Botan::secure_vector<char> password{'p', 'w'};
+
+    Vault vault("v");
+    vault.cryptoKDFIterations = 100;
+    vault.historyRetention = 3;
+    vault.addFolder(std::make_unique<Folder>("prod"));
+    vault.addEntry("prod", "counter", std::make_unique<NoteEntry>("0"));
+    storage.saveVault(vault, password);
+
+    auto serialize = [](const Entry& entry) {
+        SecureBuffer object(1, '{');
+        appendEntryMembers(object, entry, nullptr, &entry.getMetadata(), {});
+        object.push_back('}');
+        return std::string(object.begin(), object.end());
+    };
+    const std::string note(1, static_cast<char>(EntryType::NOTE));
+
+    agent::Agent server(socketPath, &storage, {std::chrono::milliseconds(1), 64});
+    server.addVault(vault, password);
+    server.listen();
+    std::thread serverThread([&server]() { server.run(4); });
+
+    // Readers never see a value older than one they have seen already, nor a half-replaced entry
+    const int writes = 100;
+    std::atomic<bool> writing{true};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&]() {
+            agent::AgentClient client(socketPath);
+            int last = 0;
+            while (writing) {
+                agent::FieldReader reader = client.request(agent::Opcode::SHOW, {"v", "prod", "counter"});
+                reader.readField();
+                reader.readField();
+                EXPECT_EQ(reader.readByte(), static_cast<uint8_t>(EntryType::NOTE));
+                auto entry = materializeEntry(reader.readField(), EntryType::NOTE);
+                int value = std::stoi(std::string(dynamic_cast<NoteEntry&>(*entry).getNoteText()));
+                EXPECT_GE(value, last);
+                last = value;
+            }
+        });
+    }
+
+    agent::AgentClient writer(socketPath);
+    for (int i = 1; i <= writes; i++) {
+        writer.request(agent::Opcode::REPLACE_ENTRY, {"v", "prod", "counter", note, serialize(NoteEntry(std::to_string(i)))});
+    }
+    writing = false;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    writer.request(agent::Opcode::ADD_ENTRY, {"v", "prod", "tmp", note, serialize(NoteEntry("x"))});
+    EXPECT_THROW(writer.request(agent::Opcode::ADD_ENTRY, {"v", "prod", "tmp", note, serialize(NoteEntry("y"))}), std::runtime_error);
+    EXPECT_THROW(writer.request(agent::Opcode::ADD_ENTRY, {"v", "nope", "tmp", note, serialize(NoteEntry("y"))}), std::runtime_error);
+    writer.request(agent::Opcode::DELETE_ENTRY, {"v", "prod", "tmp"});
+    EXPECT_THROW(writer.request(agent::Opcode::DELETE_ENTRY, {"v", "prod", "tmp"}), std::runtime_error);
+
+    server.stop();
+    serverThread.join();
+
+    // Every write was saved, replacing kept the older values as revisions
+    Vault saved = storage.loadVault("v", password);
+    EXPECT_EQ(dynamic_cast<const NoteEntry&>(saved.getEntry("prod", "counter")).getNoteText(), std::to_string(writes));
+    EXPECT_EQ(saved.getEntry("prod", "counter").getHistory().size(), 3u);
+    EXPECT_FALSE(saved.entryExists("prod", "tmp"));
+}
+
+// Counts the blobs written, i.e. the vault saves
+class CountingBackend : public MemoryBackend {
+public:
+    std::atomic<int> writes{0};
+    std::unique_ptr<BlobWriter> openWriter(const std::string& name) override {
+        writes++;
+        return MemoryBackend::openWriter(name);
+    }
+};
+
+TEST(AgentTest, GroupsConcurrentWritesIntoOneSave) {
+    auto tempDir = makeTempDir();
+    std::filesystem::create_directories(tempDir);
+    std::string socketPath = (tempDir / "run" / "agent.sock").string();
+    auto backend = std::make_unique<CountingBackend>();
+    CountingBackend& counting = *backend;
+    Storage storage(std::move(backend));
+    Botan::secure_vector<char> password{'p', 'w'};
+
+    Vault vault("v");
+    vault.cryptoKDFIterations = 100;
+    vault.addFolder(std::make_unique<Folder>("inbox"));
+    storage.saveVault(vault, password);
+    counting.writes = 0;
+
+    agent::Agent server(socketPath, &storage, {std::chrono::milliseconds(200), 1000});
+    server.addVault(vault, password);
+    server.listen();
+    std::thread serverThread([&server]() { server.run(2); });
+
+    // Every client is answered only once its write is saved, and the writes made in one window share the save
+    const int clients = 40;
+    std::atomic<int> acknowledged{0};
+    std::vector<std::thread> writers;
+    for (int i = 0; i < clients; i++) {
+        writers.emplace_back([&, i]() {
+            agent::AgentClient client(socketPath);
+            NoteEntry note("note " + std::to_string(i));
+            SecureBuffer object(1, '{');
+            appendEntryMembers(object, note, nullptr, &note.getMetadata(), {});
+            object.push_back('}');
+            std::string name = i == 0 ? "taken" : "n" + std::to_string(i);
+            client.request(agent::Opcode::ADD_ENTRY, {"v", "inbox", name, std::string(1, static_cast<char>(EntryType::NOTE)),
+                std::string(object.begin(), object.end())});
+            // A failed write of the group doesn't fail the others
+            EXPECT_THROW(client.request(agent::Opcode::DELETE_ENTRY, {"v", "inbox", "missing"}), std::runtime_error);
+            // The next request of the connection sees the write
+            EXPECT_FALSE(client.request(agent::Opcode::SHOW, {"v", "inbox", name}).atEnd());
+            acknowledged++;
+        });
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    EXPECT_EQ(acknowledged, clients);
+    EXPECT_LT(counting.writes, clients);
+
+    server.stop();
+    serverThread.join();
+    EXPECT_EQ(storage.loadVault("v", password).getFolder("inbox").getEntryNames().size(), static_cast<size_t>(clients));
+}
+
+TEST(AgentTest, LoadsVaultsChangedByOtherProcessesAgain) {
+    auto tempDir = makeTempDir();
+    std::string socketPath = (tempDir / "run" / "agent.sock").string();
+    Storage storage(tempDir / "vaults"), other(tempDir / "vaults");
+    Botan::secure_vector<char> password{'p', 'w'};
+
+    Vault vault("v");
+    vault.cryptoKDFIterations = 100;
+    vault.addFolder(std::make_unique<Folder>("f"));
+    vault.addEntry("f", "note", std::make_unique<NoteEntry>("old"));
+    storage.saveVault(vault, password);
+
+    agent::Agent server(socketPath, &storage, {std::chrono::milliseconds(1), 64});
+    server.addVault(vault, password, storage.vaultGeneration("v"));
+    server.listen();
+    std::thread serverThread([&server]() { server.run(1); });
+    agent::AgentClient client(socketPath);
+    auto noteText = [&client](const std::string& entry) {
+        agent::FieldReader reader = client.request(agent::Opcode::SHOW, {"v", "f", entry});
+        reader.readField();
+        reader.readField();
+        reader.readByte();
+        auto note = materializeEntry(reader.readField(), EntryType::NOTE);
+        return std::string(dynamic_cast<NoteEntry&>(*note).getNoteText());
+    };
+
+    // Another process replaces the note, the agent serves the new value once it has seen the change
+    Vault changed = other.loadVault("v", password);
+    changed.getFolder("f").replaceEntry("note", "note", std::make_unique<NoteEntry>("new"), 10);
+    other.saveVault(changed, password);
+    std::string text;
+    for (int i = 0; i < 500 && (text = noteText("note")) != "new"; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(text, "new");
+
+    // A write through the agent right after another process wrote keeps what it wrote
+    changed.addEntry("f", "external", std::make_unique<NoteEntry>("x"));
+    other.saveVault(changed, password);
+    NoteEntry added("added");
+    SecureBuffer object(1, '{');
+    appendEntryMembers(object, added, nullptr, &added.getMetadata(), {});
+    object.push_back('}');
+    client.request(agent::Opcode::ADD_ENTRY, {"v", "f", "added", std::string(1, static_cast<char>(EntryType::NOTE)),
+        std::string(object.begin(), object.end())});
+    EXPECT_EQ(noteText("added"), "added");
+
+    server.stop();
+    serverThread.join();
+    Vault saved = other.loadVault("v", password);
+    EXPECT_EQ(dynamic_cast<const NoteEntry&>(saved.getEntry("f", "note")).getNoteText(), "new");
+    EXPECT_EQ(saved.getEntry("f", "note").getHistory().size(), 1u);
+    EXPECT_TRUE(saved.entryExists("f", "added"));
+    EXPECT_TRUE(saved.entryExists("f", "external"));
+}
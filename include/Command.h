@@ -6,9 +6,16 @@
 #define COMMAND_H
 
 #include <string>
+#include <vector>
+#include "agent/Agent.h"
+#include "OutputWriter.h"
+#include "crypto/KeySource.h"
 #include "Storage.h"
+#include "storage/BreachDatabase.h"
+#include "vault/EntryIndex.h"
 
 using namespace storage;
+using cryptography::KeySource;
 
 class Command {
 public:
@@ -18,128 +25,373 @@ public:
 
 class AddVaultCommand : public Command {
 public:
-    AddVaultCommand(std::string vaultName, Storage& storage);
+    AddVaultCommand(std::string vaultName, std::string compression, std::string algorithm, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     const std::string vaultName;
+    const std::string compression;
+    const std::string algorithm;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class AddFolderCommand : public Command {
 public:
-    AddFolderCommand(std::string vaultName, std::string folderName, Storage& storage);
+    AddFolderCommand(std::string vaultName, std::string folderName, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class AddCredentialCommand : public Command {
 public:
-    AddCredentialCommand(std::string vaultName, std::string folderName, std::string credentialName, Storage& storage);
+    AddCredentialCommand(std::string vaultName, std::string folderName, std::string credentialName, std::vector<std::string> tags, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName, credentialName;
+    std::vector<std::string> tags;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class AddNoteCommand : public Command {
 public:
-    AddNoteCommand(std::string vaultName, std::string folderName, std::string noteName, Storage& storage);
+    AddNoteCommand(std::string vaultName, std::string folderName, std::string noteName, std::vector<std::string> tags, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName, noteName;
+    std::vector<std::string> tags;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+class AddAttachmentCommand : public Command {
+public:
+    AddAttachmentCommand(std::string vaultName, std::string folderName, std::string attachmentName, std::string filePath, std::vector<std::string> tags, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderName, attachmentName, filePath;
+    std::vector<std::string> tags;
+    KeySource& keySource;
     Storage& storage;
 };
 
 // Show names of all vaults
+// The show commands print through an OutputWriter, as text or as JSON lines, with a single flush at the end
 class ShowCommand : public Command {
 public:
-    ShowCommand(Storage& storage);
+    ShowCommand(OutputFormat format, Storage& storage);
     void execute() override;
 private:
+    OutputFormat format;
     Storage& storage;
 };
 
 class ShowVaultCommand : public Command {
 public:
-    ShowVaultCommand(std::string vaultName, Storage& storage);
+    ShowVaultCommand(std::string vaultName, OutputFormat format, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName;
+    OutputFormat format;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class ShowFolderCommand : public Command {
 public:
-    ShowFolderCommand(std::string vaultName, std::string folderName, Storage& storage);
+    ShowFolderCommand(std::string vaultName, std::string folderName, OutputFormat format, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName;
+    OutputFormat format;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class ShowEntryCommand : public Command {
 public:
-    ShowEntryCommand(std::string vaultName, std::string folderName, std::string entryName, Storage& storage);
+    // revision 0 shows the current value, 1 the one before it and so on
+    // Only with recordUse is the vault saved (with the entry's lastUsed), showing doesn't write otherwise
+    ShowEntryCommand(std::string vaultName, std::string folderName, std::string entryName, size_t revision, std::string extractPath, OutputFormat format,
+                     bool recordUse, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName, entryName;
+    size_t revision;
+    std::string extractPath;
+    OutputFormat format;
+    bool recordUse;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Shows everything a path pattern matches with one unlock: with an empty entryPattern the matching folders
+// and their entries (like ShowVaultCommand), otherwise the values of the matching entries
+class ShowMatchesCommand : public Command {
+public:
+    ShowMatchesCommand(std::string vaultName, std::string folderPattern, std::string entryPattern, OutputFormat format, bool recordUse, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderPattern, entryPattern;
+    OutputFormat format;
+    bool recordUse;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class UpdateVaultCommand : public Command {
 public:
-    UpdateVaultCommand(std::string vaultName, Storage& storage);
+    // The new master password comes from newPasswordSource, never from keySource (which gives the current one)
+    UpdateVaultCommand(std::string vaultName, KeySource& newPasswordSource, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName;
+    KeySource& newPasswordSource;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class UpdateFolderCommand : public Command {
 public:
-    UpdateFolderCommand(std::string vaultName, std::string folderName, Storage& storage);
+    UpdateFolderCommand(std::string vaultName, std::string folderName, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class UpdateEntryCommand : public Command {
 public:
-    UpdateEntryCommand(std::string vaultName, std::string folderName, std::string entryName, Storage& storage);
+    // With tags to add or remove only the tags are changed, otherwise the new value is prompted for
+    UpdateEntryCommand(std::string vaultName, std::string folderName, std::string entryName, std::vector<std::string> addTags, std::vector<std::string> removeTags, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName, entryName;
+    std::vector<std::string> addTags, removeTags;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Updates every entry a path pattern matches after one confirmation, and saves the vault once.
+// With tags to add or remove only the tags are changed, otherwise a new value is prompted for each entry
+class UpdateMatchesCommand : public Command {
+public:
+    UpdateMatchesCommand(std::string vaultName, std::string folderPattern, std::string entryPattern, std::vector<std::string> addTags, std::vector<std::string> removeTags, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderPattern, entryPattern;
+    std::vector<std::string> addTags, removeTags;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class DeleteVaultCommand : public Command {
 public:
-    DeleteVaultCommand(std::string vaultName, Storage& storage);
+    DeleteVaultCommand(std::string vaultName, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class DeleteFolderCommand : public Command {
 public:
-    DeleteFolderCommand(std::string vaultName, std::string folderName, Storage& storage);
+    DeleteFolderCommand(std::string vaultName, std::string folderName, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName;
+    KeySource& keySource;
     Storage& storage;
 };
 
 class DeleteEntryCommand : public Command {
 public:
-    DeleteEntryCommand(std::string vaultName, std::string folderName, std::string entryName, Storage& storage);
+    DeleteEntryCommand(std::string vaultName, std::string folderName, std::string entryName, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderName, entryName;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Deletes the matching folders (empty entryPattern) or entries after one confirmation, and saves the vault once
+class DeleteMatchesCommand : public Command {
+public:
+    DeleteMatchesCommand(std::string vaultName, std::string folderPattern, std::string entryPattern, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderPattern, entryPattern;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Lists previous revisions of an entry (without their contents)
+class HistoryCommand : public Command {
+public:
+    HistoryCommand(std::string vaultName, std::string folderName, std::string entryName, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderName, entryName;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+class RestoreRevisionCommand : public Command {
+public:
+    RestoreRevisionCommand(std::string vaultName, std::string folderName, std::string entryName, size_t revision, KeySource& keySource, Storage& storage);
     void execute() override;
 private:
     std::string vaultName, folderName, entryName;
+    size_t revision;
+    KeySource& keySource;
     Storage& storage;
 };
 
+class SetHistoryRetentionCommand : public Command {
+public:
+    SetHistoryRetentionCommand(std::string vaultName, size_t retention, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName;
+    size_t retention;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Lists entries matching the filter (only their metadata is read, no secrets are decoded)
+class ListCommand : public Command {
+public:
+    // Empty folderName lists the whole vault
+    ListCommand(std::string vaultName, std::string folderName, vault::EntryFilter filter, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderName;
+    vault::EntryFilter filter;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Reports reused, weak and breached passwords across the given vaults (never printing the passwords)
+class AuditCommand : public Command {
+public:
+    // Empty vaultNames audits every vault, an empty breachDatabasePath skips the breach check
+    AuditCommand(std::vector<std::string> vaultNames, std::string breachDatabasePath, storage::BreachHash breachHash, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::vector<std::string> vaultNames;
+    std::string breachDatabasePath;
+    storage::BreachHash breachHash;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Imports an export of another password manager with one load and one save of the vault
+class ImportCommand : public Command {
+public:
+    // An empty folderName keeps the folders of the export, an empty format is told by the file extension
+    ImportCommand(std::string vaultName, std::string folderName, std::string filePath, std::string format, std::string conflictPolicy, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderName, filePath, format, conflictPolicy;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Unlocks the vaults and serves them from memory to clients on the agent's socket, until SIGINT or SIGTERM.
+// Writes made through the agent are saved in groups (see agent/Agent.h)
+class AgentCommand : public Command {
+public:
+    AgentCommand(std::vector<std::string> vaultNames, agent::GroupCommit groupCommit, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::vector<std::string> vaultNames;
+    agent::GroupCommit groupCommit;
+    KeySource& keySource;
+    Storage& storage;
+};
+
+// Shows a vault, folder, entry or the matches of a pattern from a vault the agent keeps unlocked: no master
+// password, no key derivation and no decryption. The output is the one of the corresponding Show*Command
+// (the agent only reads, so lastUsed is not recorded)
+class AgentShowCommand : public Command {
+public:
+    AgentShowCommand(std::string vaultName, std::string folderName, std::string entryName, OutputFormat format, std::string socketPath);
+    void execute() override;
+private:
+    std::string vaultName, folderName, entryName;
+    OutputFormat format;
+    std::string socketPath;
+};
+
+// Adds a credential or note (type) to a vault the agent keeps unlocked, the agent saves it.
+// Prompts like AddCredentialCommand and AddNoteCommand
+class AgentAddEntryCommand : public Command {
+public:
+    AgentAddEntryCommand(std::string vaultName, std::string folderName, std::string entryName, vault::EntryType type, std::vector<std::string> tags, std::string socketPath);
+    void execute() override;
+private:
+    std::string vaultName, folderName, entryName;
+    vault::EntryType type;
+    std::vector<std::string> tags;
+    std::string socketPath;
+};
+
+// Deletes an entry from a vault the agent keeps unlocked, after asking for confirmation
+class AgentDeleteEntryCommand : public Command {
+public:
+    AgentDeleteEntryCommand(std::string vaultName, std::string folderName, std::string entryName, std::string socketPath);
+    void execute() override;
+private:
+    std::string vaultName, folderName, entryName;
+    std::string socketPath;
+};
+
+// Moves or copies folders (empty entryName) or entries within a vault or into another vault, without the secrets
+// passing through the terminal. The source may hold patterns (see vault/PathPattern.h).
+// A move between vaults goes through a marker (see vault/Transfer.h), a move that was interrupted is finished
+// before the next one out of the same vault (with recoverOnly nothing else is done)
+class TransferCommand : public Command {
+public:
+    TransferCommand(std::string vaultName, std::string folderName, std::string entryName, std::string targetVaultName,
+                    std::string targetFolderName, std::string targetEntryName, bool move, bool recoverOnly, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderName, entryName;
+    std::string targetVaultName, targetFolderName, targetEntryName;
+    bool move, recoverOnly;
+    KeySource& keySource;
+    Storage& storage;
+
+    // Returns false if there was no interrupted move out of the vault
+    bool finishInterruptedMove(const Botan::secure_vector<char>& masterPassword, const Botan::secure_vector<char>* targetPassword);
+};
+
+// Streams the entries of a vault to a file or standard output, or writes a re-encrypted copy of the vault
+// with its attachments to an archive directory
+class ExportCommand : public Command {
+public:
+    // An empty folderName exports the whole vault, an empty filePath writes to standard output.
+    // archivePath replaces the plaintext output if set, its password comes from archivePasswordSource
+    ExportCommand(std::string vaultName, std::string folderName, std::string filePath, std::string format, std::string archivePath,
+        KeySource* archivePasswordSource, KeySource& keySource, Storage& storage);
+    void execute() override;
+private:
+    std::string vaultName, folderName, filePath, format, archivePath;
+    KeySource* archivePasswordSource;
+    KeySource& keySource;
+    Storage& storage;
+
+    void exportArchive();
+};
+
+class CalibrateCommand : public Command {
+public:
+    void execute() override;
+};
+
 #endif //COMMAND_H
\ No newline at end of file
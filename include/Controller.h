@@ -8,6 +8,7 @@
 #include <iostream>
 #include "parser/Parser.h"
 #include "crypto/Cryptography.h"
+#include "crypto/KeySource.h"
 #include "Storage.h"
 #include "Command.h"
 
@@ -23,6 +24,10 @@ public:
 
 private:
     Storage& storage;
+    // Passed to every command that needs master passwords
+    std::unique_ptr<KeySource> keySource;
+    // The password a command sets, never from keySource (see makeNewPasswordSource)
+    std::unique_ptr<KeySource> newPasswordSource;
     std::unique_ptr<Command> command;
 };
 
@@ -0,0 +1,51 @@
+// include/OutputWriter.h
+#ifndef OUTPUTWRITER_H
+#define OUTPUTWRITER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include "crypto/SecureArena.h"
+
+// How the show commands print their results
+enum class OutputFormat {
+    TEXT,
+    JSON // One JSON object per line (a listing prints a line per item, an entry a single object)
+};
+
+// "text" or "json", throws std::invalid_argument otherwise
+OutputFormat parseOutputFormat(std::string_view name);
+
+// Collects what a command prints (or exports) and hands it to the stream in large blocks instead of flushing every line.
+// Output usually holds secrets, so the buffer is in the secure arena.
+// Whatever is still buffered when the writer is destroyed without finish() is dropped (the command failed)
+class OutputWriter {
+public:
+    explicit OutputWriter(std::ostream& output);
+
+    OutputWriter& operator<<(std::string_view text);
+    OutputWriter& operator<<(char c);
+    OutputWriter& operator<<(uint64_t number);
+
+    // Appends text as a quoted JSON string
+    OutputWriter& json(std::string_view text);
+
+    // Writes out the buffer and flushes the stream (once per command).
+    // Throws std::runtime_error if the stream fails
+    void finish();
+
+    // Everything appended so far, including what is still buffered
+    uint64_t getBytesWritten() const;
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+private:
+    std::ostream& output;
+    cryptography::SecureString buffer;
+    uint64_t bytesWritten = 0; // Handed to the stream
+
+    void writeIfFull();
+};
+
+#endif //OUTPUTWRITER_H
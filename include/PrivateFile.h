@@ -0,0 +1,38 @@
+// include/PrivateFile.h
+#ifndef PRIVATEFILE_H
+#define PRIVATEFILE_H
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+// A new file for plaintext written out of a vault (attachments, exports), readable only by the owner.
+// It is created with mode 0600 and O_EXCL | O_NOFOLLOW, so there is no moment when another user can open it,
+// and an existing file or a symlink planted at the path is refused instead of being overwritten or followed.
+// The file is removed again unless close() succeeds, so a failed command leaves no partial copy behind
+class PrivateFile : private std::streambuf {
+public:
+    // Throws std::runtime_error if the file can't be created (also if anything exists at path)
+    explicit PrivateFile(std::string path);
+    ~PrivateFile() override;
+
+    // Unbuffered, the writers using it collect large blocks themselves. Fails (badbit) on write errors
+    std::ostream& stream();
+
+    // Throws std::runtime_error if a write failed or the data couldn't be written out
+    void close();
+
+    PrivateFile(const PrivateFile&) = delete;
+    PrivateFile& operator=(const PrivateFile&) = delete;
+
+private:
+    std::string path;
+    int fd = -1;
+    bool failed = false;
+    std::ostream output;
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override;
+    int_type overflow(int_type c) override;
+};
+
+#endif //PRIVATEFILE_H
@@ -9,9 +9,19 @@
 #include <string>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
 #include <vault/Vault.h>
+#include <vault/VaultView.h>
+#include <json/JsonScanner.h>
 #include <crypto/Cryptography.h>
+#include <crypto/Compression.h>
 #include <json/json.hpp>
+#include <storage/StorageBackend.h>
+#include <storage/PosixFileBackend.h>
+#include <storage/ChunkStore.h>
 #include <unistd.h>
 #include <cstdlib> // For getenv
 #include <stdexcept> // For runtime_error
@@ -27,29 +37,83 @@ using json = nlohmann::json;
 
 namespace storage {
 
-// Manage saving and loading Vaults to disk with encryption
+// Manage saving and loading encrypted Vaults. Where the vault files are kept is up to the StorageBackend
 class Storage {
 public:
-    // Constructs a Storage manager using the given directory (relative to executable)
+    // Constructs a Storage manager keeping vault files in the given directory (relative to executable)
+    // Attachment chunks go to its "attachments" subdirectory
     explicit Storage(const std::filesystem::path& directory = "vaults");
 
+    // Constructs a Storage manager on top of any backend (e.g. MemoryBackend in tests and benchmarks)
+    // Attachment chunks go to the backend's "attachments" namespace
+    explicit Storage(std::unique_ptr<StorageBackend> backend);
+
     // Saves the given vault to a JSON file encrypted with masterPassword
-    // Throws on I/O or encryption errors
+    // Throws on I/O or encryption errors, or if a move out of the vault is pending (see checkNoPendingMove)
     void saveVault(const vault::Vault& vault, const Botan::secure_vector<char>& masterPassword) const;
 
+    // saveVault for the move itself, which writes the source vault while its marker exists
+    void saveMovingVault(const vault::Vault& vault, const Botan::secure_vector<char>& masterPassword) const;
+
     // Loads and decrypts the vault with the given name using masterPassword
     // Throws on I/O, JSON parse, or decryption errors
     vault::Vault loadVault(const std::string& vaultName, const Botan::secure_vector<char>& masterPassword) const;
 
-    // Returns whatever is returned by std::filesystem::remove
+    // Loads and decrypts the vault like loadVault, but returns a lazily materialized read-only view
+    // Used by commands that only read a small part of the vault
+    vault::VaultView loadVaultView(const std::string& vaultName, const Botan::secure_vector<char>& masterPassword) const;
+
+    // Returns false if the vault did not exist. Throws if a move out of the vault is pending
+    // The caller holds the vault's lock (lockVault), its lock file is removed with the vault
     bool deleteVault(const std::string& vaultName);
 
     bool vaultExists(const std::string& vaultName) const;
 
+    // Cached until the backend's listing generation changes (a vault file added, removed or renamed)
     std::vector<std::string> getAllVaultNames() const;
 
+    // Changes whenever the vault file is written or removed, by this process or another one.
+    // A vault loaded while it had the same generation is still current (see StorageBackend::generation)
+    uint64_t vaultGeneration(const std::string& vaultName) const;
+
+    // Becomes readable when vault generations may have changed, -1 if the backend can't tell
+    int changeDescriptor() const;
+
+    // Exclusive lock on the vault. Commands hold it from loading a vault until the modified vault is saved,
+    // so that two processes can't overwrite each other's changes
+    std::unique_ptr<BlobLock> lockVault(const std::string& vaultName);
+
+    StorageBackend& getBackend() const;
+
+    // Store holding the contents of attachment entries (shared by all vaults)
+    ChunkStore& getChunkStore() const;
+
+    // Marker of a move out of the vault into another one (see vault/Transfer.h), kept in the "moves" namespace.
+    // There is at most one per source vault, the move holds the vault's lock while the marker exists
+    void writeMoveMarker(const std::string& sourceVault, std::string_view marker);
+    std::optional<std::string> readMoveMarker(const std::string& sourceVault) const;
+    void removeMoveMarker(const std::string& sourceVault);
+
+    // Throws std::runtime_error if the vault has a move marker. Until the move is finished the moved paths may be
+    // in both vaults, and writing the source vault would make finishing it delete whatever the write changed
+    void checkNoPendingMove(const std::string& vaultName) const;
+
 private:
-    std::filesystem::path vaultsDir; // Directory where vault files are stored
+    void writeVault(const vault::Vault& vault, const Botan::secure_vector<char>& masterPassword) const;
+
+    std::unique_ptr<StorageBackend> backend;
+    std::unique_ptr<ChunkStore> chunkStore;
+    std::shared_ptr<StorageBackend> moveMarkers;
+
+    mutable std::mutex namesMutex; // Guards the two below
+    mutable std::optional<std::vector<std::string>> cachedNames;
+    mutable uint64_t cachedNamesGeneration = 0;
+
+    // Reads the vault file and returns the decrypted serialized vault. The blob read from the file is stored in blob
+    cryptography::SecureBuffer readAndDecrypt(const std::string& vaultName, const Botan::secure_vector<char>& masterPassword, cryptography::EncryptedBlob& blob) const;
+
+    // Decrypts a vault written with chunked encryption (blob.chunkSize > 0)
+    static cryptography::SecureBuffer decryptChunked(std::string_view base64Ciphertext, const Botan::secure_vector<char>& masterPassword, const cryptography::EncryptedBlob& blob);
 };
 
 fs::path getDefaultVaultsDirectory();
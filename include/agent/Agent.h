@@ -0,0 +1,171 @@
+/*
+The agent keeps unlocked vaults in memory and answers requests on a Unix socket (see AgentProtocol.h),
+so reading from a vault costs neither a key derivation nor a decryption, only a lookup.
+Clients are served by worker threads, each running its own non-blocking epoll loop (the listening socket is
+shared, every new client goes to one of them): requests are answered as soon as their frame is complete and
+responses that don't fit in the socket buffer are finished when it drains.
+Every resident vault is an immutable snapshot behind an atomic pointer. A request takes the current snapshot
+and reads only from it, without locks, so readers never wait for writers nor see a half-made change. A write
+builds the next version of the vault, saves it and only then publishes it, writes to one vault take turns.
+Writes are committed in groups: those arriving within a short window of each other (or the first so many) are
+applied together and saved once, and every client of the group gets its response once that save is on disk.
+The agent follows the generations of its vault files (see StorageBackend::generation): a vault changed by another
+process is loaded again as soon as the change is seen, and a write only reloads the vault if its file changed.
+Only processes of the user running the agent are served (their credentials are checked with SO_PEERCRED).
+*/
+
+// include/agent/Agent.h
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <botan/secmem.h>
+#include "agent/AgentProtocol.h"
+#include "crypto/SecureArena.h"
+#include "vault/Vault.h"
+
+namespace storage {
+    class Storage;
+}
+
+namespace agent {
+
+    // Writes to a vault arriving within window of the first one waiting are saved together,
+    // a group is saved right away once it has maxWrites
+    struct GroupCommit {
+        std::chrono::milliseconds window{50};
+        size_t maxWrites = 64;
+    };
+
+    class Agent {
+    public:
+        // Writes are saved through storage. Without it they only change the resident vaults (used in tests)
+        explicit Agent(std::string socketPath, storage::Storage* storage = nullptr, GroupCommit groupCommit = {});
+        ~Agent();
+        Agent(const Agent&) = delete;
+        Agent& operator=(const Agent&) = delete;
+
+        // Makes the vault resident. Its master password is kept as well, GET_KEY hands it out.
+        // generation is the one of the vault file when the vault was loaded. Vaults are added before run()
+        void addVault(vault::Vault vault, Botan::secure_vector<char> masterPassword, uint64_t generation = 0);
+
+        // Creates the socket (and its directory, private to the user). Throws std::runtime_error if it can't,
+        // or if another agent is listening on it already (a socket left behind by one that died is replaced)
+        void listen();
+
+        // Serves clients on the given number of threads (the calling one included) until stop() is called.
+        // Writes still waiting then are saved before it returns
+        void run(unsigned workers = std::thread::hardware_concurrency());
+
+        // Safe to call from another thread or from a signal handler
+        void stop();
+
+    private:
+        struct Loop;
+
+        // A write waiting for its group to be committed, and where its response goes
+        struct PendingWrite {
+            Opcode opcode;
+            std::string folder, entry;
+            std::unique_ptr<vault::Entry> value; // Null for DELETE_ENTRY
+            Loop* loop;
+            int fd;
+            uint64_t connectionId;
+        };
+
+        struct Resident {
+            std::atomic<std::shared_ptr<const vault::Vault>> current; // Replaced as a whole by every commit
+            Botan::secure_vector<char> masterPassword;
+            std::mutex writeMutex; // Held while the next version is made and saved, or loaded again
+            // Of the vault file current was loaded from or saved as. Written with writeMutex held
+            std::atomic<uint64_t> generation{0};
+
+            std::mutex queueMutex; // Guards queue, stale and stopping
+            std::condition_variable queued;
+            std::vector<PendingWrite> queue;
+            bool stale = false; // The vault file may have been changed by another process
+            bool stopping = false;
+            std::thread committer;
+        };
+
+        struct Connection {
+            uint64_t id = 0; // Tells a connection from a later one that got the same descriptor
+            cryptography::SecureBuffer in; // Received bytes not yet making up a whole frame
+            cryptography::SecureBuffer out; // Responses not yet sent, from outOffset on
+            size_t outOffset = 0;
+            bool waiting = false; // A write is being committed, the requests after it wait for its response
+        };
+
+        // Response of a committed write, handed to the worker serving the connection
+        struct Completion {
+            int fd;
+            uint64_t connectionId;
+            cryptography::SecureBuffer response;
+        };
+
+        // State of one worker thread. Only that thread touches it, apart from completions
+        struct Loop {
+            int epollFd = -1;
+            int wakeFd = -1; // eventfd written when completions are added
+            std::unordered_map<int, Connection> connections;
+            uint64_t nextConnectionId = 0;
+
+            std::mutex completionMutex; // Guards completions
+            std::vector<Completion> completions;
+
+            Loop() = default;
+            Loop(const Loop&) = delete;
+            Loop& operator=(const Loop&) = delete;
+            ~Loop();
+        };
+
+        std::string socketPath;
+        storage::Storage* storage;
+        GroupCommit groupCommit;
+        // Residents don't move, requests refer to them without holding anything
+        std::map<std::string, std::unique_ptr<Resident>, std::less<>> vaults;
+        int listenFd = -1;
+        int stopFd = -1; // eventfd written by stop(), never read so that every worker sees it
+        bool bound = false; // The socket file is ours to remove
+
+        Resident& findVault(std::string_view vaultName) const;
+        // Applies change to the next version of the vault, saves it and publishes it
+        void modifyVault(std::string_view vaultName, Resident& resident, const std::function<void(vault::Vault&)>& change);
+        // Loads the vault again if its file changed since it was loaded or saved
+        void refreshVault(const std::string& vaultName, Resident& resident);
+        // Runs on its own thread until stop(), marks the vaults whose files changed as stale
+        void watchVaults();
+
+        // Answers one request body of the connection with a complete response frame (errors become ERROR responses).
+        // Returns false for a write, which is queued instead and answered once committed
+        bool handleRequest(const uint8_t* body, size_t size, cryptography::SecureBuffer& response, Loop& loop, int fd, const Connection& connection);
+        // Runs on the vault's committer thread until the vault is stopping and its queue is empty
+        void commitWrites(const std::string& vaultName, Resident& resident);
+        void complete(const PendingWrite& write, cryptography::SecureBuffer response);
+
+        // The event loop of one worker, throws std::runtime_error if epoll fails
+        void serve(Loop& loop);
+        void acceptClients(Loop& loop);
+        void takeCompletions(Loop& loop);
+        // These return false if the connection has to be closed
+        bool receiveFrom(Loop& loop, int fd, Connection& connection);
+        bool processFrames(Loop& loop, int fd, Connection& connection);
+        bool sendTo(Loop& loop, int fd, Connection& connection);
+        // Waits for output space while responses are pending, and stops reading while too many are
+        void updateInterest(Loop& loop, int fd, const Connection& connection);
+        void closeConnection(Loop& loop, int fd);
+    };
+
+} // namespace agent
+
+#endif //AGENT_H
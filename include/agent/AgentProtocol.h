@@ -0,0 +1,103 @@
+/*
+The protocol spoken on the agent's Unix socket. Every message is a frame: the length of the body as 4 bytes
+(little-endian) followed by the body. A request body is an opcode byte followed by its fields, a response body
+is a status byte followed by its fields. A field is its length as 4 bytes followed by the bytes.
+Bodies may hold keys and secrets, so they are kept in SecureBuffers.
+*/
+
+// include/agent/AgentProtocol.h
+#ifndef AGENTPROTOCOL_H
+#define AGENTPROTOCOL_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include "crypto/SecureArena.h"
+
+namespace agent {
+
+    // Folder and entry arguments may be patterns (see vault/PathPattern.h), a name that is not a pattern
+    // has to exist. Response records are repeated until the end of the body
+    enum class Opcode : uint8_t {
+        GET_KEY = 1, // vault name -> master password of the vault
+        LIST = 2, // vault, folder, entry (empty for folders) -> records of folder, entry, type byte (no secrets).
+                  // An empty folder is listed as a record with an empty entry name
+        SHOW = 3, // vault, folder, entry -> records of folder, entry, type byte and the serialized entry object
+        // Writes take literal names. The entry is a type field (the type byte) and the serialized entry object
+        // with its metadata, the response has no fields. The change is saved before the response is sent
+        ADD_ENTRY = 4, // vault, folder, entry, type, object (the entry must not exist yet)
+        REPLACE_ENTRY = 5, // vault, folder, entry, type, object (the old value becomes a revision, tags are kept)
+        DELETE_ENTRY = 6 // vault, folder, entry
+    };
+
+    enum class Status : uint8_t {
+        OK = 0,
+        ERROR = 1 // Followed by the message
+    };
+
+    // Frames larger than this are rejected (no request or response comes close)
+    const size_t maxFrameSize = 16 * 1024 * 1024;
+    const size_t frameHeaderSize = 4;
+
+    // Socket path from MANPASS_AGENT_SOCKET, or $XDG_RUNTIME_DIR/manpass/agent.sock, or /tmp/manpass-<uid>/agent.sock
+    std::string defaultAgentSocketPath();
+
+    // Throws std::runtime_error unless the directory of the socket belongs to the user and only they can access it
+    // (mode 0700). Checked by the agent before listening and by clients before connecting, so that another user
+    // can't put a socket of their own in its place
+    void checkSocketDirectory(const std::string& socketPath);
+
+    // Starts a frame with the opcode or status byte (clearing frame first), the length is filled in by finishFrame
+    void beginFrame(cryptography::SecureBuffer& frame, uint8_t kind);
+    void appendByte(cryptography::SecureBuffer& frame, uint8_t byte);
+    void appendField(cryptography::SecureBuffer& frame, std::string_view field);
+    void finishFrame(cryptography::SecureBuffer& frame);
+
+    // Length of the body from the frame header, throws std::runtime_error if it is larger than maxFrameSize
+    uint32_t frameBodySize(const uint8_t* header);
+
+    // Reads the fields of a frame body, throws std::runtime_error if the body is cut short
+    class FieldReader {
+    public:
+        FieldReader(const uint8_t* data, size_t size);
+
+        uint8_t readByte();
+        // The view points into the body
+        std::string_view readField();
+        bool atEnd() const;
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t offset = 0;
+    };
+
+    // A connection to the agent, used by clients (blocking, with a timeout on responses)
+    class AgentClient {
+    public:
+        // Throws std::runtime_error if nothing is listening on socketPath, if its directory fails
+        // checkSocketDirectory or if the process listening is not the user's
+        explicit AgentClient(const std::string& socketPath);
+        ~AgentClient();
+        AgentClient(const AgentClient&) = delete;
+        AgentClient& operator=(const AgentClient&) = delete;
+
+        // Sends the request and waits for the response. The reader is positioned after the status byte and points
+        // into the client, it is valid until the next request. Throws std::runtime_error with the agent's message
+        // if the status is ERROR
+        FieldReader request(Opcode opcode, std::initializer_list<std::string_view> fields);
+
+    private:
+        int fd;
+        cryptography::SecureBuffer message;
+    };
+
+    // Blocking helpers used by clients. writeFrame throws std::runtime_error on errors, readFrame as well
+    // and returns false if the connection was closed before a frame started. body receives the body only
+    void writeFrame(int fd, const cryptography::SecureBuffer& frame);
+    bool readFrame(int fd, cryptography::SecureBuffer& body);
+
+} // namespace agent
+
+#endif //AGENTPROTOCOL_H
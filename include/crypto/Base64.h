@@ -0,0 +1,76 @@
+/*
+Base64 codec used for the vault file wrapper (ciphertext, salt and nonce).
+The whole ciphertext goes through it on every load and save, so besides the scalar implementation
+there are SSE4.1 and AVX2 ones, picked at runtime based on what the CPU supports.
+All implementations produce exactly the same output as Botan::base64_encode / base64_decode
+(standard alphabet, '=' padding, no line breaks; whitespace is ignored when decoding).
+*/
+
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include "ByteSink.h"
+
+namespace cryptography {
+
+    enum class Base64Isa { SCALAR, SSE41, AVX2 };
+
+    // Best implementation supported by this CPU (detected once)
+    Base64Isa detectBase64Isa();
+
+    // Whether the implementation can run on this CPU (SCALAR always can)
+    bool base64IsaSupported(Base64Isa isa);
+
+    size_t base64EncodedSize(size_t size);
+    size_t base64DecodedMaxSize(size_t size);
+
+    // Writes exactly base64EncodedSize(size) characters to out
+    void base64Encode(const uint8_t* data, size_t size, char* out, Base64Isa isa = detectBase64Isa());
+
+    std::string base64Encode(const uint8_t* data, size_t size);
+
+    template<typename Container>
+    std::string base64Encode(const Container& data) {
+        return base64Encode(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
+    // Decodes base64 into out, which must have room for base64DecodedMaxSize(base64.size()) bytes
+    // Returns the number of bytes written. Throws std::invalid_argument on malformed input
+    size_t base64Decode(std::string_view base64, uint8_t* out, Base64Isa isa = detectBase64Isa());
+
+    // Decodes base64 into a new container of bytes (e.g. Botan::secure_vector<uint8_t>)
+    template<typename Container>
+    Container base64Decode(std::string_view base64) {
+        Container out(base64DecodedMaxSize(base64.size()));
+        out.resize(base64Decode(base64, reinterpret_cast<uint8_t*>(out.data())));
+        return out;
+    }
+
+    // Encodes a stream of bytes that arrives in arbitrary pieces. The output (passed to sink) is the same
+    // as base64Encode of all the pieces concatenated
+    class Base64StreamEncoder {
+    public:
+        explicit Base64StreamEncoder(ByteSink sink);
+
+        void write(const uint8_t* data, size_t size);
+
+        // Encodes the remaining bytes (with padding)
+        void finish();
+
+    private:
+        ByteSink sink;
+        uint8_t carry[3]; // Bytes of an incomplete 3 byte group
+        size_t carrySize = 0;
+        std::string encoded;
+
+        void emit(const uint8_t* data, size_t size);
+    };
+
+} // namespace cryptography
+
+#endif //BASE64_H
@@ -0,0 +1,17 @@
+// include/crypto/ByteSink.h
+#ifndef BYTESINK_H
+#define BYTESINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace cryptography {
+
+    // Receives the output of a streaming stage (compression, encryption, base64) piece by piece.
+    // The data is only valid for the duration of the call
+    using ByteSink = std::function<void(const uint8_t* data, size_t size)>;
+
+} // namespace cryptography
+
+#endif //BYTESINK_H
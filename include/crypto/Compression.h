@@ -0,0 +1,67 @@
+/*
+Optional compression stage of the vault pipeline: serialize -> compress -> encrypt on save and the reverse on load.
+The serialized vault is very repetitive JSON, so it compresses well and the files (and all I/O on them) get much smaller.
+Codecs come from Botan's compression module. "none" disables the stage.
+*/
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include "SecureArena.h"
+#include "ByteSink.h"
+
+namespace Botan {
+    class Compression_Algorithm;
+    class Decompression_Algorithm;
+}
+
+namespace cryptography {
+    const std::vector<std::string> acceptedCompressions({"none", "zlib", "bzip2", "lzma"});
+
+    // Compression used for new vaults: zlib if Botan was built with it, "none" otherwise
+    std::string defaultCompression();
+
+    // Compresses buffer with the given codec, feeding it in fixed-size chunks. The result replaces the contents of buffer
+    void compress(const std::string& compression, SecureBuffer& buffer);
+
+    // Decompresses buffer in a streaming way (chunk by chunk). The result replaces the contents of buffer
+    // Throws std::runtime_error on corrupted input
+    void decompress(const std::string& compression, SecureBuffer& buffer);
+
+    // Streaming compression: input is fed with write() and compressed output is passed to sink as it is produced
+    // With "none" the input is passed through unchanged
+    class StreamCompressor {
+    public:
+        StreamCompressor(const std::string& compression, ByteSink sink);
+        ~StreamCompressor();
+
+        void write(const uint8_t* data, size_t size);
+
+        // Flushes the remaining output. No more writes are allowed afterwards
+        void finish();
+
+    private:
+        std::unique_ptr<Botan::Compression_Algorithm> compressor; // Null for "none"
+        ByteSink sink;
+    };
+
+    // Reverse of StreamCompressor. Throws std::runtime_error on corrupted or truncated input
+    class StreamDecompressor {
+    public:
+        StreamDecompressor(const std::string& compression, ByteSink sink);
+        ~StreamDecompressor();
+
+        void write(const uint8_t* data, size_t size);
+        void finish();
+
+    private:
+        std::unique_ptr<Botan::Decompression_Algorithm> decompressor; // Null for "none"
+        ByteSink sink;
+    };
+} // namespace cryptography
+
+#endif //COMPRESSION_H
@@ -4,7 +4,8 @@
 
 /*
 The Cryptography module provides the baseline needed for supporting multiple encryption algorithms and KDFs.
-Right now it only supports AES-256/GCM and PBKDF-2(AES-256), thus many things (which shouldn't be) are currently hard-coded.
+Vaults are encrypted with AES-256/GCM or ChaCha20Poly1305 (new vaults get the faster one on the host),
+with the key derived from the master password by PBKDF2(SHA-256). The KDF is not selectable yet.
 */
 
 #ifndef CRYPTOGRAPHY_H
@@ -18,6 +19,7 @@ Right now it only supports AES-256/GCM and PBKDF-2(AES-256), thus many things (w
 #include <botan/auto_rng.h>
 #include <botan/hex.h>
 #include <botan/cipher_mode.h>
+#include <botan/aead.h>
 #include <botan/pwdhash.h>
 #include <botan/exceptn.h>
 #include <botan/version.h>
@@ -25,15 +27,30 @@ Right now it only supports AES-256/GCM and PBKDF-2(AES-256), thus many things (w
 
 #include "json/json.hpp"
 #include "EncryptedBlob.h"
+#include "SecureArena.h"
+#include "Base64.h"
+#include "ByteSink.h"
 
 namespace cryptography {
-    const std::vector<std::string> acceptedAlgorithms({"AES-256/GCM"});
+    const std::vector<std::string> acceptedAlgorithms({"AES-256/GCM", "ChaCha20Poly1305"});
     const std::vector<std::string> acceptedKDFs({"PBKDF2(SHA-256)"});
 
     std::string generateBase64Salt(size_t saltLengthBytes = 16);
 
+    struct AlgorithmThroughput {
+        std::string algorithm;
+        double bytesPerSecond;
+    };
+
+    // Measures encryption throughput of every accepted algorithm on this machine (best of a few runs over sampleSize bytes)
+    std::vector<AlgorithmThroughput> measureAlgorithms(size_t sampleSize = 1024 * 1024);
+
+    // Algorithm for new vaults on this host. AES-256/GCM if the CPU has AES and carry-less multiply instructions,
+    // ChaCha20Poly1305 if it doesn't. If the CPU features can't be determined a short measurement decides (done once)
+    std::string preferredAlgorithm();
+
     EncryptedBlob encrypt(
-        const std::string& plaintext,
+        std::string_view plaintext,
         const Botan::secure_vector<char>& masterPassword,
         const std::string& algo,
         const std::string& kdf,
@@ -41,11 +58,106 @@ namespace cryptography {
         int kdfIterations = 500000
     );
 
+    // Encrypts buffer in place (on return it holds ciphertext and tag) and returns the blob describing it.
+    // The base64Ciphertext field is left empty, the caller encodes buffer however it needs to.
+    // compression only names the codec the caller already applied to buffer; it is recorded in the authenticated header
+    EncryptedBlob encryptInPlace(
+        SecureBuffer& buffer,
+        const Botan::secure_vector<char>& masterPassword,
+        const std::string& algo,
+        const std::string& kdf,
+        const std::string& base64Salt,
+        int kdfIterations = 500000,
+        const std::string& compression = ""
+    );
+
     // Throws Botan::Invalid_Authentication_Tag on decryption failure
     std::string decrypt(
         EncryptedBlob encrypted,
         const Botan::secure_vector<char>& masterPassword
     );
+
+    // Decrypts buffer in place: on input it holds the raw ciphertext (with tag), on return the plaintext.
+    // Only the parameters of encrypted are used, its base64Ciphertext field is ignored
+    void decryptInPlace(
+        const EncryptedBlob& encrypted,
+        const Botan::secure_vector<char>& masterPassword,
+        SecureBuffer& buffer
+    );
+
+    // Header fields authenticated together with the ciphertext (empty for legacy blobs without a compression field)
+    std::vector<uint8_t> associatedData(const EncryptedBlob& blob);
+
+    /*
+    Chunked (STREAM) encryption, so that neither side has to hold the whole ciphertext.
+    The plaintext is split into chunkSize pieces and every piece is sealed separately with the nonce
+    prefix (7 random bytes) || chunk counter (4 bytes, big endian) || last chunk flag (1 byte),
+    and the header as associated data. Reordering, dropping or appending chunks, or cutting the stream
+    at a chunk boundary, all make decryption fail. The prefix is too short to stay unique over many streams
+    under one key, so every stream gets a salt (and key) of its own (Storage::writeVault draws one per save).
+    */
+    const size_t defaultChunkSize = 256 * 1024;
+    const size_t maxChunkSize = 64 * 1024 * 1024; // Upper bound accepted from a file header
+
+    class StreamEncryptor {
+    public:
+        // Derives the key and draws the nonce prefix. Each sealed chunk (ciphertext and tag) is passed to sink
+        StreamEncryptor(
+            const Botan::secure_vector<char>& masterPassword,
+            const std::string& algo,
+            const std::string& kdf,
+            const std::string& base64Salt,
+            int kdfIterations,
+            const std::string& compression,
+            ByteSink sink,
+            size_t chunkSize = defaultChunkSize
+        );
+
+        // Parameters to store next to the ciphertext (base64Nonce holds the nonce prefix, base64Ciphertext is empty)
+        const EncryptedBlob& getBlob() const;
+
+        void write(const uint8_t* data, size_t size);
+
+        // Seals the last chunk (possibly empty). No more writes are allowed afterwards
+        void finish();
+
+    private:
+        EncryptedBlob blob;
+        std::unique_ptr<Botan::AEAD_Mode> mode;
+        std::vector<uint8_t> noncePrefix;
+        std::vector<uint8_t> associatedHeader;
+        uint32_t counter = 0;
+        SecureBuffer pending; // Plaintext of the chunk being filled
+        ByteSink sink;
+
+        void sealChunk(bool last);
+    };
+
+    class StreamDecryptor {
+    public:
+        // blob has to be a chunked one (chunkSize > 0). Each opened chunk of plaintext is passed to sink
+        StreamDecryptor(const EncryptedBlob& blob, const Botan::secure_vector<char>& masterPassword, ByteSink sink);
+
+        void write(const uint8_t* data, size_t size);
+
+        // Opens the last chunk. Throws std::runtime_error("Decryption failed") if any chunk fails to authenticate,
+        // which includes a truncated stream
+        void finish();
+
+    private:
+        std::unique_ptr<Botan::AEAD_Mode> mode;
+        std::vector<uint8_t> noncePrefix;
+        std::vector<uint8_t> associatedHeader;
+        size_t sealedChunkSize; // Chunk size plus tag
+        uint32_t counter = 0;
+        SecureBuffer pending; // Ciphertext of the chunk being filled
+        ByteSink sink;
+
+        void openChunk(bool last);
+    };
+
+    // Decodes base64 text straight into buffer (replacing its contents)
+    void base64DecodeInto(std::string_view base64, SecureBuffer& buffer);
 } // namespace cryptography
 
 #endif //CRYPTOGRAPHY_H
\ No newline at end of file
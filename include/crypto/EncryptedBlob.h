@@ -6,6 +6,7 @@
 #ifndef ENCRYPTEDBLOB_H
 #define ENCRYPTEDBLOB_H
 
+#include <cstddef>
 #include <string>
 
 namespace cryptography {
@@ -17,6 +18,11 @@ namespace cryptography {
         std::string base64Salt;
         std::string base64Nonce;
         std::string base64Ciphertext;
+        // Codec applied to the plaintext before encryption. Empty for vaults written before compression existed
+        // (their header is not authenticated), otherwise the header is bound to the ciphertext as associated data
+        std::string compression;
+        // Plaintext chunk size of the STREAM construction. 0 means the ciphertext was sealed as a whole
+        size_t chunkSize = 0;
     };
 
 } // namespace cryptography
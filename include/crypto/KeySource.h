@@ -0,0 +1,69 @@
+/*
+KeySource is where commands get master passwords from. The terminal prompt is the default, the other sources
+let scripts and scheduled jobs run without a terminal: a file descriptor the password is read from (one line
+per password asked for), a keyfile (alone, or combined with a password from another source) and the agent.
+None of them echo anything, and what they read stays in secure memory.
+*/
+
+// include/crypto/KeySource.h
+#ifndef KEYSOURCE_H
+#define KEYSOURCE_H
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <botan/secmem.h>
+
+namespace cryptography {
+
+    class KeySource {
+    public:
+        virtual ~KeySource() = default;
+
+        // Master password of the vault (for a vault being created or renamed, the one it is going to have).
+        // Throws std::runtime_error if the source can't provide one
+        virtual Botan::secure_vector<char> getPassword(const std::string& vaultName) = 0;
+    };
+
+    // Prompts on the terminal (getMasterPassword). With confirm the password is typed twice, for passwords being set:
+    // nothing else knows them yet, a typo would lock the vault for good
+    class TerminalKeySource : public KeySource {
+    public:
+        explicit TerminalKeySource(bool confirm = false);
+        Botan::secure_vector<char> getPassword(const std::string& vaultName) override;
+    private:
+        bool confirm;
+    };
+
+    // Reads a line from the descriptor for every password asked for (the descriptor is not closed)
+    class FdKeySource : public KeySource {
+    public:
+        explicit FdKeySource(int fd);
+        Botan::secure_vector<char> getPassword(const std::string& vaultName) override;
+    private:
+        int fd;
+    };
+
+    // The key is the hex SHA-256 of the file's contents, or if a password source is given,
+    // the hex SHA-256 of SHA-256(password) || SHA-256(file), so both are needed to open the vault
+    class KeyfileKeySource : public KeySource {
+    public:
+        explicit KeyfileKeySource(std::filesystem::path path, std::unique_ptr<KeySource> passwordSource = nullptr);
+        Botan::secure_vector<char> getPassword(const std::string& vaultName) override;
+    private:
+        std::filesystem::path path;
+        std::unique_ptr<KeySource> passwordSource;
+    };
+
+    // Asks the agent listening on the socket (one connection per password)
+    class AgentKeySource : public KeySource {
+    public:
+        explicit AgentKeySource(std::string socketPath);
+        Botan::secure_vector<char> getPassword(const std::string& vaultName) override;
+    private:
+        std::string socketPath;
+    };
+
+} // namespace cryptography
+
+#endif //KEYSOURCE_H
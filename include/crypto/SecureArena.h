@@ -0,0 +1,174 @@
+/*
+SecureArena is the allocator behind every secret-bearing string (passwords, note text, decrypted vault plaintext).
+Memory comes from mmap'ed regions that are mlock'ed (so they never reach swap) and excluded from core dumps.
+Small blocks are bump-allocated from shared chunks and recycled through per-size-class free lists,
+which means far fewer malloc calls and better locality than one heap allocation per string.
+Every block is wiped when it is freed and the whole arena is wiped on destruction (and on reset() of an arena
+that isn't the global one), so no plaintext is left behind in freed memory.
+Locking is best effort: if RLIMIT_MEMLOCK is exhausted the pages are still used (and still wiped), just not locked.
+*/
+
+#ifndef SECUREARENA_H
+#define SECUREARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cryptography {
+
+    class SecureArena {
+    public:
+        explicit SecureArena(size_t chunkSize = 256 * 1024);
+        ~SecureArena();
+
+        // Returns a block of at least size bytes aligned for any fundamental type
+        void* allocate(size_t size);
+
+        // Wipes the block and makes it available for reuse. size must match the allocate() call
+        void deallocate(void* ptr, size_t size);
+
+        // Wipes every block and rewinds the arena. All previously allocated blocks become invalid, so it is only for
+        // arenas whose owner knows nothing uses them anymore. Throws std::logic_error for global(), whose blocks back
+        // SecureStrings (and the string_views into them) all over the process
+        void reset();
+
+        size_t bytesInUse() const; // Bytes currently handed out (rounded up to block sizes)
+        size_t bytesLocked() const; // Bytes of arena memory that is successfully mlock'ed
+        bool contains(const void* ptr) const; // Whether ptr points into memory of this arena
+
+        // Process-wide arena used by SecureAllocator
+        static SecureArena& global();
+
+        SecureArena(const SecureArena&) = delete;
+        SecureArena& operator=(const SecureArena&) = delete;
+
+    private:
+        struct Region {
+            uint8_t* base;
+            size_t size;
+            size_t used;
+            bool locked;
+        };
+
+        static constexpr size_t minBlockSize = 16;
+
+        size_t chunkSize;
+        size_t maxPooledSize; // Larger blocks get a dedicated region
+        std::vector<Region> chunks;
+        std::unordered_map<void*, Region> largeRegions;
+        std::vector<std::vector<void*>> freeLists; // Indexed by size class
+        size_t inUse = 0;
+        size_t locked = 0;
+        mutable std::mutex mutex;
+
+        Region mapRegion(size_t size);
+        void unmapRegion(Region& region);
+        static size_t sizeClass(size_t size);
+    };
+
+    // Stateless STL allocator drawing from SecureArena::global()
+    template<typename T>
+    struct SecureAllocator {
+        using value_type = T;
+
+        SecureAllocator() noexcept = default;
+        template<typename U>
+        SecureAllocator(const SecureAllocator<U>&) noexcept {}
+
+        T* allocate(size_t n) {
+            return static_cast<T*>(SecureArena::global().allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T* ptr, size_t n) noexcept {
+            SecureArena::global().deallocate(ptr, n * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const SecureAllocator<U>&) const noexcept { return true; }
+    };
+
+    // String type for secrets. Its characters always live in the locked arena and are wiped when released:
+    // unlike std::basic_string it has no small-string buffer inside the object, which would keep short secrets
+    // (most passwords) wherever the object itself is (the ordinary heap or the stack) and leave copies on moves.
+    // Only the parts of the std::string interface the vault code needs are provided. Not null-terminated
+    class SecureString {
+    public:
+        using value_type = char;
+        using size_type = size_t;
+        using iterator = std::vector<char, SecureAllocator<char>>::iterator;
+        using const_iterator = std::vector<char, SecureAllocator<char>>::const_iterator;
+
+        SecureString() = default;
+        SecureString(const char* text) : SecureString(std::string_view(text)) {}
+        explicit SecureString(std::string_view text) : chars(text.begin(), text.end()) {}
+        SecureString(size_t count, char c) : chars(count, c) {}
+
+        size_t size() const noexcept { return chars.size(); }
+        size_t length() const noexcept { return chars.size(); }
+        bool empty() const noexcept { return chars.empty(); }
+        size_t capacity() const noexcept { return chars.capacity(); }
+        char* data() noexcept { return chars.data(); }
+        const char* data() const noexcept { return chars.data(); }
+
+        char& operator[](size_t i) { return chars[i]; }
+        const char& operator[](size_t i) const { return chars[i]; }
+        char& back() { return chars.back(); }
+        const char& back() const { return chars.back(); }
+        iterator begin() noexcept { return chars.begin(); }
+        iterator end() noexcept { return chars.end(); }
+        const_iterator begin() const noexcept { return chars.begin(); }
+        const_iterator end() const noexcept { return chars.end(); }
+
+        void reserve(size_t size) { chars.reserve(size); }
+        void resize(size_t size, char c = '\0') { chars.resize(size, c); }
+        void clear() noexcept { chars.clear(); }
+        void push_back(char c) { chars.push_back(c); }
+        void pop_back() { chars.pop_back(); }
+
+        template<typename InputIt>
+        iterator insert(const_iterator position, InputIt first, InputIt last) { return chars.insert(position, first, last); }
+
+        SecureString& append(const char* text, size_t size) {
+            chars.insert(chars.end(), text, text + size);
+            return *this;
+        }
+        SecureString& append(std::string_view text) { return append(text.data(), text.size()); }
+        SecureString& assign(const char* text, size_t size) {
+            chars.assign(text, text + size);
+            return *this;
+        }
+        void swap(SecureString& other) noexcept { chars.swap(other.chars); }
+
+        SecureString& operator+=(char c) {
+            chars.push_back(c);
+            return *this;
+        }
+        SecureString& operator+=(std::string_view text) { return append(text); }
+        SecureString& operator+=(const char* text) { return append(std::string_view(text)); }
+        SecureString& operator+=(const SecureString& text) { return append(text); }
+
+        operator std::string_view() const noexcept { return {chars.data(), chars.size()}; }
+
+        friend bool operator==(const SecureString& a, const SecureString& b) { return a.chars == b.chars; }
+        friend bool operator==(const SecureString& a, std::string_view b) { return std::string_view(a) == b; }
+        friend bool operator==(const SecureString& a, const char* b) { return std::string_view(a) == b; }
+
+    private:
+        std::vector<char, SecureAllocator<char>> chars;
+    };
+
+    // std::getline for SecureString: reads up to delim (dropped), straight into the arena
+    std::istream& getline(std::istream& in, SecureString& out, char delim = '\n');
+
+    // Byte buffer for bulk plaintext (serialized vaults). Ciphers can work on it in place
+    using SecureBuffer = std::vector<uint8_t, SecureAllocator<uint8_t>>;
+
+} // namespace cryptography
+
+#endif //SECUREARENA_H
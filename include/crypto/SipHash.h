@@ -0,0 +1,30 @@
+/*
+SipHash-2-4, a keyed 64-bit hash. Used where secrets have to be compared or grouped without keeping them:
+with a random key that never leaves the process the hashes say nothing about the inputs,
+and the key also keeps inputs crafted to collide from degrading hash tables.
+*/
+
+#ifndef SIPHASH_H
+#define SIPHASH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace cryptography {
+
+    using SipHashKey = std::array<uint8_t, 16>;
+
+    uint64_t sipHash24(const SipHashKey& key, const uint8_t* data, size_t size);
+
+    inline uint64_t sipHash24(const SipHashKey& key, std::string_view data) {
+        return sipHash24(key, reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
+    // Random key (generated per use, never stored)
+    SipHashKey generateSipHashKey();
+
+} // namespace cryptography
+
+#endif //SIPHASH_H
@@ -0,0 +1,200 @@
+/*
+JsonScanner is a minimal forward-only reader over serialized JSON text.
+It is used where building a full json DOM would be wasteful: callers walk the structure,
+remember byte offsets of the values they care about and skip everything else without allocating.
+Only the strings that are explicitly requested get decoded.
+*/
+
+// include/json/JsonScanner.h
+#ifndef JSONSCANNER_H
+#define JSONSCANNER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+namespace vault {
+
+class JsonScanner {
+public:
+    explicit JsonScanner(std::string_view text, size_t position = 0);
+
+    // Current offset into the text
+    size_t position() const;
+
+    void skipWhitespace();
+
+    // Skips whitespace and consumes c if it is the next character
+    bool consume(char c);
+
+    // Skips whitespace and returns the next character without consuming it ('\0' at the end of the text)
+    char peek();
+
+    // Same as consume(), but throws std::invalid_argument if c is not the next character
+    void expect(char c);
+
+    // Reads a string token and returns its raw contents (without quotes, escapes are left as they are)
+    std::string_view readRawString();
+
+    // Reads a string token and returns it decoded
+    std::string readString();
+
+    // Reads an integer number token
+    long long readInteger();
+
+    // Skips over a single value of any type (including nested objects and arrays)
+    void skipValue();
+
+    // Iterates over the members of an object. The callback receives the raw key and must consume the value
+    template<typename Callback>
+    void forEachMember(Callback&& callback) {
+        expect('{');
+        if (consume('}'))
+            return;
+        do {
+            std::string_view key = readRawString();
+            expect(':');
+            callback(key);
+        } while (consume(','));
+        expect('}');
+    }
+
+    // Iterates over the elements of an array. The callback must consume the element
+    template<typename Callback>
+    void forEachElement(Callback&& callback) {
+        expect('[');
+        if (consume(']'))
+            return;
+        do {
+            skipWhitespace();
+            callback();
+        } while (consume(','));
+        expect(']');
+    }
+
+private:
+    std::string_view text;
+    size_t pos;
+
+    [[noreturn]] void fail(const std::string& message) const;
+};
+
+namespace detail {
+    uint32_t parseHex4(std::string_view raw, size_t at);
+
+    // Appends code point cp to out as UTF-8
+    template<typename StringType>
+    void appendUtf8(StringType& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+} // namespace detail
+
+// Decodes the raw contents of a JSON string token (handles all escapes including surrogate pairs)
+// The output type is a template parameter so that secrets can be decoded straight into a SecureString
+template<typename StringType = std::string>
+StringType decodeJsonString(std::string_view raw) {
+    StringType out;
+    out.reserve(raw.size());
+
+    for (size_t i = 0; i < raw.size(); i++) {
+        char c = raw[i];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+
+        if (++i >= raw.size())
+            throw std::invalid_argument("Malformed JSON: dangling escape");
+
+        switch (raw[i]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp = detail::parseHex4(raw, i + 1);
+                i += 4;
+                // High surrogate has to be followed by a low surrogate
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    if (i + 2 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u')
+                        throw std::invalid_argument("Malformed JSON: unpaired surrogate");
+                    uint32_t low = detail::parseHex4(raw, i + 3);
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        throw std::invalid_argument("Malformed JSON: invalid low surrogate");
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                detail::appendUtf8(out, cp);
+                break;
+            }
+            default:
+                throw std::invalid_argument("Malformed JSON: invalid escape");
+        }
+    }
+
+    return out;
+}
+
+// Appends s to out as a quoted JSON string token (escaped the same way json::dump does it)
+// Works with any char or byte container supporting push_back and insert (std::string, SecureString, SecureBuffer)
+template<typename Container>
+void appendJsonString(Container& out, std::string_view s) {
+    static const char* hexDigits = "0123456789abcdef";
+    auto put = [&out](std::string_view text) { out.insert(out.end(), text.begin(), text.end()); };
+
+    out.push_back('"');
+    size_t plainStart = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (c != '"' && c != '\\' && static_cast<unsigned char>(c) >= 0x20)
+            continue;
+
+        // Copy the run of characters that need no escaping in one go
+        put(s.substr(plainStart, i - plainStart));
+        plainStart = i + 1;
+        switch (c) {
+            case '"': put("\\\""); break;
+            case '\\': put("\\\\"); break;
+            case '\b': put("\\b"); break;
+            case '\f': put("\\f"); break;
+            case '\n': put("\\n"); break;
+            case '\r': put("\\r"); break;
+            case '\t': put("\\t"); break;
+            default:
+                put("\\u00");
+                out.push_back(hexDigits[(c >> 4) & 0xF]);
+                out.push_back(hexDigits[c & 0xF]);
+        }
+    }
+    put(s.substr(plainStart));
+    out.push_back('"');
+}
+
+// Appends a plain (already valid JSON) fragment to out
+template<typename Container>
+void appendRaw(Container& out, std::string_view fragment) {
+    out.insert(out.end(), fragment.begin(), fragment.end());
+}
+
+} // namespace vault
+
+#endif //JSONSCANNER_H
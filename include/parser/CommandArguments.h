@@ -13,7 +13,11 @@ The type is then accessible with the getType() method.
 #ifndef COMMANDARGUMENTS_H
 #define COMMANDARGUMENTS_H
 
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace parser {
     enum class CommandType {
@@ -22,23 +26,47 @@ namespace parser {
         ADD_FOLDER,
         ADD_CREDENTIAL,
         ADD_NOTE,
+        ADD_ATTACHMENT,
         SHOW,
         SHOW_VAULT,
         SHOW_FOLDER,
         SHOW_ENTRY,
+        SHOW_MATCHES,
         UPDATE_VAULT,
         UPDATE_FOLDER,
         UPDATE_ENTRY,
+        UPDATE_MATCHES,
         DELETE_VAULT,
         DELETE_FOLDER,
         DELETE_ENTRY,
+        DELETE_MATCHES,
         GENERATE,
+        CALIBRATE,
+        HISTORY,
+        RESTORE_REVISION,
+        SET_HISTORY_RETENTION,
+        LIST,
+        AUDIT,
+        IMPORT,
+        EXPORT,
+        MOVE,
+        COPY,
+        AGENT,
+    };
+
+    // Where master passwords come from (options shared by every command), the terminal if nothing is set
+    struct KeySourceArgs {
+        std::optional<int> passwordFd; // Descriptor to read passwords from, a line each
+        std::string keyfile;
+        bool withPassword = false; // The keyfile is combined with a password from the terminal (or from passwordFd, always)
+        bool agent = false; // Ask the agent (its socket is at agent::defaultAgentSocketPath)
     };
 
     struct CommandArgs {
         CommandArgs(CommandType type_val = CommandType::UNKNOWN) : type(type_val) {}
         virtual ~CommandArgs() {}
         CommandType getType() const { return type; }
+        KeySourceArgs keySource;
     private:
         CommandType type;
     };
@@ -47,6 +75,8 @@ namespace parser {
     struct AddVaultCommandArgs : public CommandArgs {
         AddVaultCommandArgs() : CommandArgs(CommandType::ADD_VAULT) {}
         std::string vault;
+        std::string compression; // Empty means the default codec
+        std::string algorithm; // Empty means the fastest algorithm for this host
     };
 
     struct AddFolderCommandArgs : public CommandArgs {
@@ -60,6 +90,7 @@ namespace parser {
         std::string vault;
         std::string folder;
         std::string credential;
+        std::vector<std::string> tags;
     };
 
     struct AddNoteCommandArgs : public CommandArgs {
@@ -67,32 +98,59 @@ namespace parser {
         std::string vault;
         std::string folder;
         std::string note;
+        std::vector<std::string> tags;
+    };
+
+    struct AddAttachmentCommandArgs : public CommandArgs {
+        AddAttachmentCommandArgs() : CommandArgs(CommandType::ADD_ATTACHMENT) {}
+        std::string vault;
+        std::string folder;
+        std::string attachment;
+        std::string file; // Path of the file whose contents get attached
+        std::vector<std::string> tags;
     };
 
     // SHOW COMMANDS
     struct ShowCommandArgs : public CommandArgs {
         ShowCommandArgs() : CommandArgs(CommandType::SHOW) {}
+        std::string output = "text"; // text or json
     };
 
     struct ShowVaultCommandArgs : public CommandArgs {
         ShowVaultCommandArgs() : CommandArgs(CommandType::SHOW_VAULT) {}
         std::string vault;
+        std::string output = "text";
     };
 
     struct ShowFolderCommandArgs : public CommandArgs {
         ShowFolderCommandArgs() : CommandArgs(CommandType::SHOW_FOLDER) {}
         std::string vault, folder;
+        std::string output = "text";
     };
 
     struct ShowEntryCommandArgs : public CommandArgs {
         ShowEntryCommandArgs() : CommandArgs(CommandType::SHOW_ENTRY) {}
         std::string vault, folder, entry;
+        size_t revision = 0; // 0 is the current value, 1 the previous one and so on
+        std::string extract; // Where to write the contents of an attachment (empty means don't)
+        std::string output = "text";
+        bool recordUse = false; // Save the time the entry was shown (show is read-only otherwise)
+    };
+
+    // The *_MATCHES commands take glob patterns for the folder and entry (an empty entry means folders are matched)
+    struct ShowMatchesCommandArgs : public CommandArgs {
+        ShowMatchesCommandArgs() : CommandArgs(CommandType::SHOW_MATCHES) {}
+        std::string vault, folder, entry;
+        std::string output = "text";
+        bool recordUse = false;
     };
 
     // UPDATE COMMANDS
     struct UpdateVaultCommandArgs : public CommandArgs {
         UpdateVaultCommandArgs() : CommandArgs(CommandType::UPDATE_VAULT) {}
         std::string vault;
+        std::optional<int> newPasswordFd; // Descriptor to read the new master password from
+        std::string newKeyfile; // Keyfile of the new master password (combined with newPasswordFd if both are set)
     };
 
     struct UpdateFolderCommandArgs : public CommandArgs {
@@ -106,6 +164,13 @@ namespace parser {
         std::string vault;
         std::string folder;
         std::string entry;
+        std::vector<std::string> tag, untag; // If any are given only the tags change
+    };
+
+    struct UpdateMatchesCommandArgs : public CommandArgs {
+        UpdateMatchesCommandArgs() : CommandArgs(CommandType::UPDATE_MATCHES) {}
+        std::string vault, folder, entry;
+        std::vector<std::string> tag, untag;
     };
 
     // DELETE COMMANDS
@@ -126,6 +191,91 @@ namespace parser {
         std::string folder;
         std::string entry;
     };
+
+    struct DeleteMatchesCommandArgs : public CommandArgs {
+        DeleteMatchesCommandArgs() : CommandArgs(CommandType::DELETE_MATCHES) {}
+        std::string vault, folder, entry;
+    };
+
+    // HISTORY COMMANDS
+    struct HistoryCommandArgs : public CommandArgs {
+        HistoryCommandArgs() : CommandArgs(CommandType::HISTORY) {}
+        std::string vault, folder, entry;
+    };
+
+    struct RestoreRevisionCommandArgs : public CommandArgs {
+        RestoreRevisionCommandArgs() : CommandArgs(CommandType::RESTORE_REVISION) {}
+        std::string vault, folder, entry;
+        size_t revision = 0;
+    };
+
+    struct SetHistoryRetentionCommandArgs : public CommandArgs {
+        SetHistoryRetentionCommandArgs() : CommandArgs(CommandType::SET_HISTORY_RETENTION) {}
+        std::string vault;
+        size_t retention = 0;
+    };
+
+    // LIST COMMAND
+    struct ListCommandArgs : public CommandArgs {
+        ListCommandArgs() : CommandArgs(CommandType::LIST) {}
+        std::string vault, folder; // Empty folder means the whole vault
+        // Bounds in seconds since the Unix epoch ("before" is exclusive, "after" inclusive)
+        std::optional<int64_t> createdBefore, createdAfter;
+        std::optional<int64_t> modifiedBefore, modifiedAfter;
+        std::optional<int64_t> usedBefore, usedAfter;
+        std::vector<std::string> tags; // Entries have to have all of them
+    };
+
+    // AUDIT COMMAND
+    struct AuditCommandArgs : public CommandArgs {
+        AuditCommandArgs() : CommandArgs(CommandType::AUDIT) {}
+        std::vector<std::string> vaults; // Empty means all vaults
+        std::string breachDatabase; // Sorted hash corpus to check passwords against (none if empty)
+        std::string breachHash = "sha1"; // Hash of a raw digest corpus
+    };
+
+    // IMPORT COMMAND
+    struct ImportCommandArgs : public CommandArgs {
+        ImportCommandArgs() : CommandArgs(CommandType::IMPORT) {}
+        std::string vault;
+        std::string folder; // Everything goes to this folder if set
+        std::string file;
+        std::string format; // Told by the file extension if empty
+        std::string conflict = "skip";
+    };
+
+    // EXPORT COMMAND
+    struct ExportCommandArgs : public CommandArgs {
+        ExportCommandArgs() : CommandArgs(CommandType::EXPORT) {}
+        std::string vault;
+        std::string folder; // Only this folder is exported if set
+        std::string file; // Standard output if empty
+        std::string format = "jsonl";
+        std::string archive; // Directory of a re-encrypted archive, written instead of plaintext if set
+        std::optional<int> archivePasswordFd; // Descriptor to read the archive password from, the terminal if not set
+    };
+
+    // MOVE AND COPY COMMANDS
+    // The source folder and entry may be patterns, like for the *_MATCHES commands
+    struct TransferCommandArgs : public CommandArgs {
+        explicit TransferCommandArgs(CommandType type) : CommandArgs(type) {}
+        std::string vault, folder, entry;
+        std::string targetVault, targetFolder, targetEntry;
+        bool recover = false; // MOVE only: finish an interrupted move out of the vault and do nothing else
+    };
+
+    // AGENT COMMAND
+    struct AgentCommandArgs : public CommandArgs {
+        AgentCommandArgs() : CommandArgs(CommandType::AGENT) {}
+        std::vector<std::string> vaults; // Kept unlocked while the agent runs
+        size_t commitWindow = 50; // Milliseconds writes are gathered for before they are saved together
+        size_t commitBatch = 64; // Writes saved together at most
+    };
+
+    // OTHER COMMANDS
+    struct CalibrateCommandArgs : public CommandArgs {
+        CalibrateCommandArgs() : CommandArgs(CommandType::CALIBRATE) {}
+    };
 }
 
 #endif //COMMANDARGUMENTS_H
\ No newline at end of file
@@ -23,12 +23,18 @@ namespace parser {
         // Holder property used for holding the CommandArgs object to be returned by parse()
         std::optional<std::unique_ptr<CommandArgs>> returnCommandArgs;
 
+        // Converts a --*-before/--*-after value to seconds since the Unix epoch (nullopt if the option wasn't given)
+        static std::optional<int64_t> parseTimeOption(const std::string& value);
+
         void parsePath(const std::string& path, std::string &vault, std::string &folder, std::string &entry);
         // Methods used as callbacks in parse(). They set the returnCommandArgs property
-        void handleAddSubcommand(const std::string& path, bool credentialFlag, bool noteFlag);
-        void handleShowSubcommand(const std::string& path);
-        void handleUpdateSubcommand(const std::string& path);
+        void handleAddSubcommand(const std::string& path, bool credentialFlag, bool noteFlag, const std::string& attachmentFile, const std::string& compression, const std::string& algorithm, const std::vector<std::string>& tags);
+        void handleShowSubcommand(const std::string& path, size_t revision, const std::string& extract, const std::string& output, bool recordUse);
+        void handleUpdateSubcommand(const std::string& path, const std::vector<std::string>& tag, const std::vector<std::string>& untag,
+            std::optional<int> newPasswordFd, const std::string& newKeyfile);
         void handleDeleteSubcommand(const std::string& path);
+        void handleTransferSubcommand(CommandType type, const std::string& path, const std::string& targetPath, bool recover);
+        void handleHistorySubcommand(const std::string& path, std::optional<size_t> restore, std::optional<size_t> retention);
     };
 }
 
@@ -0,0 +1,82 @@
+/*
+BreachDatabase answers whether a password appears in an offline corpus of breached password hashes.
+The corpus is a file sorted by hash, either text (one "HASH" or "HASH:count" line per password, as in the
+downloadable Pwned Passwords lists) or raw digests back to back. SHA-1 and NTLM corpora are supported.
+The file is memory-mapped and never read as a whole, corpora of tens of gigabytes are expected: the first 16 bits of a
+digest select one of 65536 buckets, the bucket bounds are found once and cached, and inside a bucket the search
+interpolates on the digest value (hashes are uniformly distributed), so a lookup touches only a few pages.
+Nothing leaves the machine.
+*/
+
+// include/storage/BreachDatabase.h
+#ifndef BREACHDATABASE_H
+#define BREACHDATABASE_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "crypto/SecureArena.h"
+
+namespace storage {
+
+    enum class BreachHash {
+        SHA1,
+        NTLM
+    };
+
+    // "sha1" or "ntlm", throws std::invalid_argument otherwise
+    BreachHash parseBreachHash(std::string_view name);
+
+    class BreachDatabase {
+    public:
+        // Maps the corpus. The hash of a text corpus is told by its line length, hash only applies to raw digests.
+        // Throws std::runtime_error if the file can't be mapped or isn't a corpus
+        explicit BreachDatabase(const std::filesystem::path& path, BreachHash hash = BreachHash::SHA1);
+        ~BreachDatabase();
+
+        BreachDatabase(const BreachDatabase&) = delete;
+        BreachDatabase& operator=(const BreachDatabase&) = delete;
+
+        BreachHash getHash() const;
+        size_t getDigestSize() const;
+
+        // Hash of the password as the corpus stores it (SHA-1 of UTF-8 or MD4 of UTF-16LE)
+        cryptography::SecureBuffer digest(std::string_view password) const;
+
+        // How many times the corpus has seen the digest: 0 if it isn't there, 1 if the corpus has no counts.
+        // Lookups only read the mapping, so they can run on several threads at once
+        uint64_t lookup(const uint8_t* digest) const;
+
+        // Looks the digests up in sorted order, so neighbouring lookups share buckets and pages.
+        // Results are in the order of digests
+        std::vector<uint64_t> lookup(const std::vector<cryptography::SecureBuffer>& digests) const;
+
+    private:
+        struct Record {
+            size_t start, end;
+            uint8_t digest[20];
+        };
+
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        BreachHash hash;
+        size_t digestSize;
+        bool text;
+        // Offset of the first record of each bucket, unknown until first needed
+        std::unique_ptr<std::atomic<uint64_t>[]> bucketStarts;
+
+        Record recordAt(size_t offset) const;
+        uint64_t countAt(const Record& record) const;
+        size_t bucketStart(uint32_t bucket) const;
+        // Offset of the first record in [from, to) that isn't below target (to if there is none).
+        // The digests in the range start at least at keyLow and end at most at keyHigh (their first 8 bytes)
+        size_t lowerBound(const uint8_t* target, size_t from, size_t to, uint64_t keyLow, uint64_t keyHigh) const;
+    };
+
+} // namespace storage
+
+#endif //BREACHDATABASE_H
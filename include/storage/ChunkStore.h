@@ -0,0 +1,60 @@
+/*
+ChunkStore keeps the contents of attachment entries, outside of the vault files.
+Files are split into content-defined chunks (a gear rolling hash picks the boundaries, so inserting or removing
+bytes only changes the chunks around the edit) and every chunk is stored as a separate encrypted blob.
+Encryption is convergent: the key of a chunk is the hash of its plaintext and the blob name is the hash of the key.
+Identical chunks therefore end up in the same blob no matter which entry or vault they belong to, and are stored once.
+The keys are only kept inside the (encrypted) vaults, the store itself holds nothing that decrypts the chunks.
+As with any convergent scheme, someone with access to the store can check whether it contains a chunk they already know.
+*/
+
+// include/storage/ChunkStore.h
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "StorageBackend.h"
+#include "crypto/ByteSink.h"
+#include "vault/AttachmentEntry.h"
+
+namespace storage {
+
+    // Bounds of the content-defined chunk sizes (chunks average about 64 KiB)
+    const size_t minAttachmentChunkSize = 16 * 1024;
+    const size_t maxAttachmentChunkSize = 256 * 1024;
+
+    // Length of the chunk starting at data. Only the last chunk of a file may be cut short by the end of data,
+    // so unless data ends the file it has to hold at least maxAttachmentChunkSize bytes
+    size_t findChunkBoundary(const uint8_t* data, size_t size);
+
+    class ChunkStore {
+    public:
+        explicit ChunkStore(std::shared_ptr<StorageBackend> backend);
+
+        // Splits everything read from content into chunks, stores the ones that aren't in the store yet
+        // and returns the entry referencing them. Throws std::runtime_error on read or write errors
+        std::unique_ptr<vault::AttachmentEntry> storeAttachment(std::istream& content, std::string_view fileName);
+
+        // Passes the decrypted contents of the attachment to sink, chunk by chunk
+        // Throws std::runtime_error if a chunk is missing or fails to decrypt
+        void readAttachment(const vault::AttachmentEntry& attachment, const cryptography::ByteSink& sink) const;
+
+        // Copies the chunks of the attachment that target doesn't have yet, still encrypted (nothing is decrypted)
+        // Throws std::runtime_error if a chunk is missing
+        void copyAttachment(const vault::AttachmentEntry& attachment, ChunkStore& target) const;
+
+        StorageBackend& getBackend() const;
+
+    private:
+        std::shared_ptr<StorageBackend> backend;
+
+        // Encrypts and stores the chunk (unless it is already there), returns its base64 key
+        cryptography::SecureString storeChunk(const uint8_t* data, size_t size);
+    };
+
+} // namespace storage
+
+#endif //CHUNKSTORE_H
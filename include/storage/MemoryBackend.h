@@ -0,0 +1,41 @@
+// include/storage/MemoryBackend.h
+#ifndef MEMORYBACKEND_H
+#define MEMORYBACKEND_H
+
+#include <map>
+#include <mutex>
+#include "StorageBackend.h"
+
+namespace storage {
+
+// Keeps blobs in memory. Used by tests and benchmarks to take I/O out of the picture
+class MemoryBackend : public StorageBackend {
+public:
+    std::string readBlob(const std::string& name) const override;
+    std::unique_ptr<BlobWriter> openWriter(const std::string& name) override;
+    bool removeBlob(const std::string& name) override;
+    bool blobExists(const std::string& name) const override;
+    std::vector<std::string> listBlobs() const override;
+    std::unique_ptr<BlobLock> lock(const std::string& name) override;
+    std::shared_ptr<StorageBackend> openNamespace(const std::string& name) override;
+    // Exact, every change goes through this object
+    uint64_t generation(const std::string& name) const override;
+    uint64_t listingGeneration() const override;
+
+private:
+    class MemoryWriter;
+
+    std::map<std::string, std::string> blobs;
+    std::map<std::string, std::unique_ptr<std::mutex>> locks; // Entries are never removed so locks stay valid
+    std::map<std::string, std::shared_ptr<MemoryBackend>> namespaces;
+    std::map<std::string, uint64_t> generations; // Of the blobs written or removed at least once
+    uint64_t lastGeneration = 0;
+    uint64_t namesGeneration = 0;
+    mutable std::mutex mutex; // Guards all of the above
+
+    void store(const std::string& name, std::string& data); // Swaps data in
+};
+
+} // namespace storage
+
+#endif //MEMORYBACKEND_H
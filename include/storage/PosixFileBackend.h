@@ -0,0 +1,61 @@
+// include/storage/PosixFileBackend.h
+#ifndef POSIXFILEBACKEND_H
+#define POSIXFILEBACKEND_H
+
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include "StorageBackend.h"
+
+namespace storage {
+
+// Keeps every blob as <name><extension> (<name>.json for vaults) in a directory
+// Writes go to a temporary file which is fsync'ed and renamed over the old one, locks are flock()s on <name>.lock
+// Reads through mapBlob mmap the file, so loading a vault doesn't copy the file through stream buffers
+// Generations come from an inotify watch on the directory, set up the first time one is asked for
+class PosixFileBackend : public StorageBackend {
+public:
+    // Creates the directory if it does not exist
+    explicit PosixFileBackend(const std::filesystem::path& directory, std::string extension = ".json");
+    ~PosixFileBackend() override;
+    PosixFileBackend(const PosixFileBackend&) = delete;
+    PosixFileBackend& operator=(const PosixFileBackend&) = delete;
+
+    std::string readBlob(const std::string& name) const override;
+    std::unique_ptr<BlobMapping> mapBlob(const std::string& name) const override;
+    std::unique_ptr<BlobWriter> openWriter(const std::string& name) override;
+    bool removeBlob(const std::string& name) override;
+    bool blobExists(const std::string& name) const override;
+    std::vector<std::string> listBlobs() const override;
+    std::unique_ptr<BlobLock> lock(const std::string& name) override;
+    void removeLock(const std::string& name) override;
+    // Subdirectory of this one, holding blobs as <name>.blob
+    std::shared_ptr<StorageBackend> openNamespace(const std::string& name) override;
+    // Without a watch (inotify not available, or the directory went away) every generation is a new number
+    uint64_t generation(const std::string& name) const override;
+    uint64_t listingGeneration() const override;
+    int changeDescriptor() const override; // The inotify descriptor
+
+    const std::filesystem::path& getDirectory() const;
+
+private:
+    std::filesystem::path directory;
+    std::string extension;
+
+    mutable std::mutex watchMutex; // Guards the watch state below
+    mutable int watchFd = -1; // Kept open until destruction, even once the watch is lost
+    mutable bool watchFailed = false; // Couldn't be started, or lost
+    mutable std::unordered_map<std::string, uint64_t> generations; // Of the blobs changed since the watch started
+    mutable uint64_t lastGeneration = 0;
+    mutable uint64_t allGeneration = 0; // Every blob may have changed (events were lost)
+    mutable uint64_t namesGeneration = 0;
+
+    std::filesystem::path blobPath(const std::string& name) const;
+    // Both called with watchMutex held. watching starts the watch if needed and returns false if there is none
+    bool watching() const;
+    void readEvents() const;
+};
+
+} // namespace storage
+
+#endif //POSIXFILEBACKEND_H
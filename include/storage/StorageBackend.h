@@ -0,0 +1,95 @@
+/*
+StorageBackend is the medium vault files are kept on. Storage only deals with encryption and the file format
+and hands finished blobs (one per vault, addressed by vault name) to the backend.
+PosixFileBackend keeps them as files in a directory, MemoryBackend keeps them in memory,
+which lets tests and benchmarks run the whole pipeline without touching the disk.
+Attachment chunks are blobs too, kept in a namespace of the backend so they never mix with vaults.
+*/
+
+// include/storage/StorageBackend.h
+#ifndef STORAGEBACKEND_H
+#define STORAGEBACKEND_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace storage {
+
+// Held for as long as the lock on a blob is needed. Destroying it releases the lock
+class BlobLock {
+public:
+    virtual ~BlobLock() = default;
+};
+
+// Writes a blob piece by piece. Nothing is visible to readers until commit() atomically replaces the blob
+// Destroying the writer without committing discards what was written
+class BlobWriter {
+public:
+    virtual ~BlobWriter() = default;
+    virtual void write(std::string_view data) = 0;
+    virtual void commit() = 0;
+};
+
+// Read-only contents of a blob, valid for the lifetime of the object
+class BlobMapping {
+public:
+    virtual ~BlobMapping() = default;
+    virtual std::string_view data() const = 0;
+};
+
+class StorageBackend {
+public:
+    virtual ~StorageBackend() = default;
+
+    // Returns the contents of the blob. Throws std::runtime_error if it does not exist or can't be read
+    virtual std::string readBlob(const std::string& name) const = 0;
+
+    // Same as readBlob, but backends that can expose the stored bytes directly (e.g. by mmap) avoid the copy
+    // The default implementation wraps the result of readBlob
+    virtual std::unique_ptr<BlobMapping> mapBlob(const std::string& name) const;
+
+    // Replaces the blob atomically: readers see either the old or the new contents, never a partial write
+    // Throws std::runtime_error on failure. The default implementation goes through openWriter
+    virtual void writeBlob(const std::string& name, std::string_view data);
+
+    // Streaming version of writeBlob, for blobs that are produced in pieces (with the same atomicity)
+    virtual std::unique_ptr<BlobWriter> openWriter(const std::string& name) = 0;
+
+    // Returns false if there was no such blob
+    virtual bool removeBlob(const std::string& name) = 0;
+
+    virtual bool blobExists(const std::string& name) const = 0;
+
+    // Names of all stored blobs (in no particular order)
+    virtual std::vector<std::string> listBlobs() const = 0;
+
+    // Takes an exclusive lock on the blob (blocks until it is available). The blob does not have to exist
+    virtual std::unique_ptr<BlobLock> lock(const std::string& name) = 0;
+
+    // Removes what lock() keeps for the blob (e.g. a lock file), for a removed blob. Only call it while holding the lock,
+    // lock() calls waiting for it meanwhile still get a working lock. The default implementation keeps nothing
+    virtual void removeLock(const std::string& name);
+
+    // Separate set of blobs kept alongside these ones (e.g. in a subdirectory), used for the attachment chunk store
+    // Its blobs don't show up in listBlobs. Opening the same name again gives access to the same blobs
+    virtual std::shared_ptr<StorageBackend> openNamespace(const std::string& name) = 0;
+
+    // Number that changes whenever the blob is written or removed, through this object or by another process.
+    // Equal numbers mean the blob was not touched in between, so a copy of it read meanwhile is still current.
+    // The default implementation can't tell and returns a new number every time (the blob always looks changed)
+    virtual uint64_t generation(const std::string& name) const;
+
+    // Same as generation, for the set of names listBlobs returns
+    virtual uint64_t listingGeneration() const;
+
+    // Descriptor that becomes readable when generations may have changed because of another process,
+    // or -1 if the backend has none. Asking for a generation consumes what made it readable
+    virtual int changeDescriptor() const;
+};
+
+} // namespace storage
+
+#endif //STORAGEBACKEND_H
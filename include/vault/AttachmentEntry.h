@@ -0,0 +1,43 @@
+// Directory: include/vault/AttachmentEntry.h
+#ifndef VAULT_ATTACHMENTENTRY_H
+#define VAULT_ATTACHMENTENTRY_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Entry.h"
+#include "crypto/SecureArena.h"
+#include "json/json.hpp"
+
+using json = nlohmann::json;
+
+namespace vault {
+
+// Represents a file (SSH key, certificate, kubeconfig...) whose contents live in the chunk store next to the vault.
+// The vault only holds the file name, the size and the keys of the encrypted chunks, so it stays small
+// and rewriting it on every edit doesn't rewrite the attachment
+class AttachmentEntry : public Entry {
+public:
+    AttachmentEntry(std::string_view fileName, uint64_t size, std::vector<cryptography::SecureString> chunkKeys);
+
+    EntryType getType() const override;
+    std::unique_ptr<Entry> clone() const override;
+    const std::string& getFileName() const;
+    uint64_t getSize() const;
+    const std::vector<cryptography::SecureString>& getChunkKeys() const;
+
+    friend void to_json(json& j, const AttachmentEntry& entry);
+
+private:
+    std::string fileName;
+    uint64_t size;
+    // Base64 keys of the chunks in file order. Each one both locates and decrypts its chunk, so they are secrets
+    std::vector<cryptography::SecureString> chunkKeys;
+};
+
+void from_json(const json& j, AttachmentEntry& entry);
+
+} // vault
+
+#endif //VAULT_ATTACHMENTENTRY_H
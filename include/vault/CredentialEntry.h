@@ -6,7 +6,9 @@
 #ifndef VAULT_CREDENTIALENTRY_H
 #define VAULT_CREDENTIALENTRY_H
 
+#include <string_view>
 #include "Entry.h"
+#include "crypto/SecureArena.h"
 #include "json/json.hpp"
 
 using json = nlohmann::json;
@@ -16,17 +18,19 @@ namespace vault {
 // Represents a credential entry with username and password
 class CredentialEntry : public Entry {
 public:
-    CredentialEntry(const std::string& username, const std::string& password);
+    CredentialEntry(std::string_view username, std::string_view password);
 
     EntryType getType() const override;
-    const std::string& getUsername() const;
-    const std::string& getPassword() const;
+    std::unique_ptr<Entry> clone() const override;
+    std::string_view getUsername() const;
+    std::string_view getPassword() const;
 
     friend void to_json(json& j, const CredentialEntry& entry);
 
 private:
-    std::string username;
-    std::string password;
+    // Secrets live in the locked, zeroizing arena instead of the regular heap
+    cryptography::SecureString username;
+    cryptography::SecureString password;
 };
 
 void from_json(const json& j, CredentialEntry& entry);
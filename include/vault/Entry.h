@@ -6,8 +6,12 @@
 #ifndef VAULT_ENTRY_H
 #define VAULT_ENTRY_H
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <json/json.hpp>
+#include "EntryHistory.h"
+#include "EntryMetadata.h"
 
 using json = nlohmann::json;
 
@@ -17,6 +21,7 @@ namespace vault {
 enum class EntryType {
     CREDENTIAL,
     NOTE,
+    ATTACHMENT,
 };
 
 // Abstrac base class representing a generic entry
@@ -25,12 +30,39 @@ public:
     virtual ~Entry() = default;
     virtual EntryType getType() const = 0; // Must be implemented by derived classes
 
+    // Deep copy (history included), used when an entry shared with a vault snapshot is about to be modified
+    virtual std::unique_ptr<Entry> clone() const = 0;
+
+    // Previous values of the entry
+    EntryHistory& getHistory();
+    const EntryHistory& getHistory() const;
+
+    // Timestamps and tags, maintained by the commands (a plain copy of an entry keeps them)
+    EntryMetadata& getMetadata();
+    const EntryMetadata& getMetadata() const;
+
     friend void to_json(json& j, const Entry& entry);
 
+private:
+    EntryHistory history;
+    EntryMetadata metadata;
 };
 
 std::unique_ptr<Entry> parseEntry(const json &j);
 
+// Counterpart of parseEntry working directly on the serialized entry object (without a json DOM)
+std::unique_ptr<Entry> materializeEntry(std::string_view text, EntryType type);
+
+// Maps the serialized "type" value to EntryType (throws std::invalid_argument for unknown types)
+EntryType parseEntryType(std::string_view type);
+
+// Appends the members of the serialized entry object (without the braces)
+// name, metadata and history are left out if null/empty (revisions are stored without them)
+// Instantiated for SecureBuffer and SecureString
+template<typename Container>
+void appendEntryMembers(Container& out, const Entry& entry, const std::string* name, const EntryMetadata* metadata,
+                        std::string_view history);
+
 
 } // vault
 
@@ -0,0 +1,59 @@
+/*
+EntryHistory keeps the previous values of an entry (newest first), so a failed password rotation can be rolled back.
+Revisions are stored as a JSON array inside the entry's object in the vault. A note revision only holds a delta
+against the next newer value (copies of ranges of it plus inserted text), so small edits of large notes stay cheap.
+Other entry types are small and are stored in full.
+The array is kept exactly as it was read: loading a vault only copies it, it is decoded when revisions are requested.
+*/
+
+// Directory: include/vault/EntryHistory.h
+#ifndef VAULT_ENTRYHISTORY_H
+#define VAULT_ENTRYHISTORY_H
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "crypto/SecureArena.h"
+
+namespace vault {
+
+class Entry;
+
+// Number of revisions kept for each entry unless the vault says otherwise
+const size_t defaultHistoryRetention = 10;
+
+struct Revision {
+    int64_t time; // When this value was replaced (seconds since the Unix epoch)
+    std::unique_ptr<Entry> entry;
+};
+
+class EntryHistory {
+public:
+    bool empty() const;
+
+    // Number of revisions (scans the array without decoding it)
+    size_t size() const;
+
+    // Serialized history (JSON array), empty if there are no revisions
+    std::string_view raw() const;
+    void setRaw(std::string_view raw);
+
+    // Decodes all revisions, newest first. current has to be the entry the history belongs to (deltas are based on it)
+    // Throws std::invalid_argument on malformed history
+    std::vector<Revision> getRevisions(const Entry& current) const;
+
+    // Records previous as the newest revision, at the moment current replaced it, and keeps at most retention revisions
+    void record(const Entry& previous, const Entry& current, size_t retention, int64_t time = std::time(nullptr));
+
+    // Drops the oldest revisions beyond retention
+    void truncate(size_t retention);
+
+private:
+    cryptography::SecureString serialized;
+};
+
+} // vault
+
+#endif //VAULT_ENTRYHISTORY_H
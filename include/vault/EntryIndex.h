@@ -0,0 +1,93 @@
+/*
+EntryIndex keeps the entries of a vault ordered by each timestamp and grouped by tag, so questions like
+"credentials not modified in the last 90 days" are answered in O(log n + k) instead of by visiting every entry,
+for the whole vault or within one folder (the folder is part of the keys, so it is a range scan too).
+It is built once per unlocked vault (from a VaultView it only reads the metadata, the secrets stay encoded)
+and can be kept up to date with add and remove while the vault is being modified.
+*/
+
+// Directory: include/vault/EntryIndex.h
+#ifndef VAULT_ENTRYINDEX_H
+#define VAULT_ENTRYINDEX_H
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "EntryMetadata.h"
+#include "Vault.h"
+#include "VaultView.h"
+
+namespace vault {
+
+enum class TimeField {
+    CREATED,
+    MODIFIED,
+    LAST_USED,
+};
+
+struct EntryPath {
+    std::string folder;
+    std::string entry;
+
+    auto operator<=>(const EntryPath&) const = default;
+};
+
+// Times in [from, to). Unknown timestamps are 0, so they fall into every range starting before the epoch
+struct TimeRange {
+    TimeField field;
+    int64_t from = std::numeric_limits<int64_t>::min();
+    int64_t to = std::numeric_limits<int64_t>::max();
+};
+
+// Entries matching all ranges and having all tags (an empty filter matches everything)
+struct EntryFilter {
+    std::vector<TimeRange> ranges;
+    std::vector<std::string> tags;
+    std::string folder; // Only entries of this folder (empty means all)
+};
+
+class EntryIndex {
+public:
+    EntryIndex() = default;
+    explicit EntryIndex(const Vault& vault);
+    explicit EntryIndex(const VaultView& vault);
+
+    // Replaces whatever was indexed for path
+    void add(const EntryPath& path, const EntryMetadata& metadata);
+    void remove(const EntryPath& path);
+
+    size_t size() const;
+
+    // Entries with the field in range, ordered by its value. With a folder, only that folder's entries
+    std::vector<EntryPath> inRange(const TimeRange& range, const std::string& folder = "") const;
+
+    // Entries having the tag, ordered by path. With a folder, only that folder's entries
+    std::vector<EntryPath> withTag(const std::string& tag, const std::string& folder = "") const;
+
+    // Entries matching the filter, ordered by path. The most selective tag (or else the first range)
+    // is looked up in the index, within the folder if the filter has one, and only its results are checked
+    // against the rest of the filter
+    std::vector<EntryPath> query(const EntryFilter& filter) const;
+
+    // Metadata the entry was indexed with (throws std::out_of_range if it isn't indexed)
+    const EntryMetadata& getMetadata(const EntryPath& path) const;
+
+private:
+    std::map<EntryPath, EntryMetadata> entries;
+    std::array<std::set<std::pair<int64_t, EntryPath>>, 3> byTime; // Indexed by TimeField
+    std::array<std::set<std::tuple<std::string, int64_t, std::string>>, 3> byFolderTime; // (folder, time, entry)
+    std::map<std::string, std::set<EntryPath>, std::less<>> byTag; // Ordered by path, so a folder's entries are together
+
+    static int64_t timeOf(const EntryMetadata& metadata, TimeField field);
+};
+
+} // vault
+
+#endif //VAULT_ENTRYINDEX_H
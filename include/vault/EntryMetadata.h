@@ -0,0 +1,41 @@
+// Directory: include/vault/EntryMetadata.h
+#ifndef VAULT_ENTRYMETADATA_H
+#define VAULT_ENTRYMETADATA_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vault {
+
+class JsonScanner;
+
+// lastUsed is rounded down to this, so show --record-use rewrites the vault at most once per period
+// (it also keeps the vault from recording exactly when a secret was read)
+const int64_t lastUsedGranularity = 3600;
+
+// Timestamps are seconds since the Unix epoch, 0 when unknown (entries saved before they were recorded)
+struct EntryMetadata {
+    int64_t created = 0;
+    int64_t modified = 0; // Last time the value of the entry changed
+    int64_t lastUsed = 0; // Last time the entry was shown with --record-use, rounded down to lastUsedGranularity
+    std::vector<std::string> tags; // Sorted, without duplicates
+
+    bool empty() const;
+    bool hasTag(std::string_view tag) const;
+    void addTag(std::string_view tag);
+    void removeTag(std::string_view tag);
+
+    // Sets lastUsed from time, returns false if the rounded value didn't change (nothing needs to be saved)
+    bool markUsed(int64_t time = std::time(nullptr));
+};
+
+// Reads the value of an entry member if key is one of the metadata members ("created", "modified", "lastUsed", "tags")
+// Returns false (reading nothing) for other keys
+bool readMetadataMember(JsonScanner& scanner, std::string_view key, EntryMetadata& metadata);
+
+} // vault
+
+#endif //VAULT_ENTRYMETADATA_H
@@ -0,0 +1,51 @@
+/*
+Export writes the entries of a vault as plaintext JSON lines or CSV, the formats Import reads back.
+Every row has the folder, the name, the type ("credential" or "note"), the username, the password and the notes
+(the text of a note). Attachments have no plaintext form that fits a row and are left out.
+Rows go through an OutputWriter, which holds them in the secure arena and hands them to the stream in blocks.
+Nothing but one block is held, so exporting a large vault takes as much memory as exporting a small one.
+*/
+
+// Directory: include/vault/Export.h
+#ifndef VAULT_EXPORT_H
+#define VAULT_EXPORT_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "Entry.h"
+#include "OutputWriter.h"
+
+namespace vault {
+
+enum class ExportFormat {
+    JSONL,
+    CSV
+};
+
+// "jsonl" or "csv", throws std::invalid_argument otherwise
+ExportFormat parseExportFormat(std::string_view name);
+
+class ExportWriter {
+public:
+    // Writes the CSV header right away
+    ExportWriter(ExportFormat format, std::ostream& output);
+
+    // Writes one row, returns false (writing nothing) for attachments
+    // Throws std::runtime_error if the stream fails
+    bool write(const std::string& folderName, const std::string& entryName, const Entry& entry);
+
+    // Writes out what is still buffered and flushes the stream
+    void finish();
+
+    uint64_t getBytesWritten() const;
+
+private:
+    ExportFormat format;
+    OutputWriter output;
+};
+
+} // vault
+
+#endif //VAULT_EXPORT_H
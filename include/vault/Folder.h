@@ -6,28 +6,45 @@
 #ifndef VAULT_FOLDER_H
 #define VAULT_FOLDER_H
 
+#include <ctime>
 #include <string>
 #include <vector>
+#include <functional>
 #include <memory>
-#include <unordered_map>
 #include <stdexcept>
 #include "Entry.h"
+#include "PersistentMap.h"
+#include "crypto/SecureArena.h"
 
 using json = nlohmann::json;
 
 namespace vault {
 
+class Vault;
+struct VaultChange;
+
 class Folder {
 public:
     explicit Folder(const std::string& folderName);
 
     // Adds an entry to the folder by name (throws if entry already exists)
-    // Entries are uniquely owned by a Folder, so we use unique_ptr
+    // The folder takes ownership of the entry, so we use unique_ptr
     void addEntry(std::unique_ptr<Entry> entry, const std::string& entryName);
 
     void deleteEntry(const std::string& entryName);
 
+    // Puts the entry into target (a folder of this or another vault) under newName without copying it,
+    // both folders share it until either of them modifies it (throws if newName already exists in target)
+    void shareEntry(const std::string& entryName, Folder& target, const std::string& newName) const;
+
+    // Replaces the entry with newEntry (possibly under a new name). The old value becomes the newest revision
+    // (at most retention are kept), creation time and tags carry over and the modification time is set to modified
+    void replaceEntry(const std::string& entryName, const std::string& newEntryName, std::unique_ptr<Entry> newEntry, size_t retention,
+                      int64_t modified = std::time(nullptr));
+
     // Retrieves an entry by name (mutable and immutable versions)
+    // The mutable version copies the entry first if it is shared with a copy of the folder. The reference must not
+    // be used to modify the entry after the folder has been copied again (it may belong to the copy too by then)
     Entry& getEntry(const std::string& entryName);
     const Entry& getEntry(const std::string& entryName) const;
 
@@ -40,22 +57,24 @@ public:
     // Helper to check if entry exists
     bool entryExists(const std::string& entryName) const;
 
-    // Explicit disallowance of copy operations and allowance for moving operations is required due to unique_ptr use
-    // Delete copy operations
-    Folder(const Folder&) = delete;
-    Folder& operator=(const Folder&) = delete;
-    // Enable move operations
-    Folder(Folder&&) noexcept;
-    Folder& operator=(Folder&&) noexcept;
+    // Copies are O(1) snapshots: the entries are shared until one of the copies modifies them
+    Folder(const Folder&) = default;
+    Folder& operator=(const Folder&) = default;
+    Folder(Folder&&) noexcept = default;
+    Folder& operator=(Folder&&) noexcept = default;
 
     friend void to_json(json& j, const Folder& folder);
+    friend std::vector<VaultChange> diff(const Vault& before, const Vault& after);
+    friend void serializeVault(const Vault& vault, cryptography::SecureBuffer& out);
+    friend void serializeVault(const Vault& vault, cryptography::SecureBuffer& out, size_t flushThreshold,
+                               const std::function<void(cryptography::SecureBuffer&)>& flush);
 
 private:
     std::string folderName;
 
-    // We use unique_ptr to enforce exclusive ownership of each entry by the folder.
-    // It also helps store entries of different kinds and improves memory management.
-    std::unordered_map<std::string, std::unique_ptr<Entry>> entries; // Map of entry name to Entry object
+    // Entries are shared with copies of the folder (snapshots), an entry is copied before it is modified
+    // if anything else still refers to it. Pointers store entries of different kinds
+    PersistentMap<std::shared_ptr<Entry>> entries; // Map of entry name to Entry object
 };
 
 void from_json(const json& j, Folder& folder);
@@ -0,0 +1,97 @@
+/*
+Import reads exports of browsers and other password managers into a vault: CSV (with a header row naming the columns,
+as Chrome, Firefox, Bitwarden and LastPass write them), JSON (an array or one object per line), Bitwarden JSON and
+KeePass 2 XML. The input is streamed, only the record being read (a CSV row, a JSON element or a KeePass entry) is
+held in memory, in the secure arena like every other secret.
+Every record becomes a credential, or a note if it has neither a username nor a password. Notes of a credential,
+and its URL unless the entry is named after the host, go to a companion note named "<entry> (notes)", the vault
+has no other place for them.
+Nested folders are flattened by joining their names with '.', and '/' in names becomes '.' as paths use it.
+*/
+
+// Directory: include/vault/Import.h
+#ifndef VAULT_IMPORT_H
+#define VAULT_IMPORT_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+#include "Vault.h"
+#include "crypto/SecureArena.h"
+
+namespace vault {
+
+// Folder getting the records the export doesn't put in a folder
+const std::string defaultImportFolder = "Imported";
+
+enum class ImportFormat {
+    CSV,
+    JSON,
+    BITWARDEN,
+    KEEPASS_XML
+};
+
+// "csv", "json", "bitwarden" or "keepass-xml", throws std::invalid_argument otherwise
+ImportFormat parseImportFormat(std::string_view name);
+
+// Format implied by the extension of the file (.csv, .json, .jsonl or .xml), throws std::invalid_argument otherwise
+ImportFormat guessImportFormat(std::string_view fileName);
+
+// What happens to a record whose entry already exists
+enum class ConflictPolicy {
+    SKIP,
+    OVERWRITE, // The existing value becomes the newest revision of the entry
+    RENAME // The record is added as "<entry> (2)", "<entry> (3)", ...
+};
+
+// "skip", "overwrite" or "rename", throws std::invalid_argument otherwise
+ConflictPolicy parseConflictPolicy(std::string_view name);
+
+struct ImportedRecord {
+    std::string folder; // Empty if the export doesn't place the record in a folder
+    std::string name;
+    cryptography::SecureString username, password, url, notes;
+    bool note = false; // The export says it is a note
+};
+
+using ImportedRecordSink = std::function<void(ImportedRecord&)>;
+
+// Parses input and passes the records to sink one at a time, returns the number of bytes read
+// Throws std::runtime_error if the input is malformed or can't be read
+uint64_t readImportRecords(std::istream& input, ImportFormat format, const ImportedRecordSink& sink);
+
+// Entries, not records (a companion note counts separately)
+struct ImportStats {
+    size_t added = 0;
+    size_t overwritten = 0;
+    size_t renamed = 0;
+    size_t skipped = 0;
+};
+
+class VaultImporter {
+public:
+    // Records go to their own folder, or to folder if they don't have one (or if intoFolder is set).
+    // Missing folders are created
+    VaultImporter(Vault& vault, ConflictPolicy policy, std::string folder = defaultImportFolder, bool intoFolder = false);
+
+    void add(ImportedRecord& record);
+
+    const ImportStats& getStats() const;
+
+private:
+    Vault& vault;
+    ConflictPolicy policy;
+    std::string folder;
+    bool intoFolder;
+    int64_t time; // Creation time of everything imported
+    ImportStats stats;
+
+    // Adds the entry under the name or as the policy says, returns the name it ended up under (empty if skipped)
+    std::string place(const std::string& folderName, const std::string& name, std::unique_ptr<Entry> entry);
+};
+
+} // vault
+
+#endif //VAULT_IMPORT_H
@@ -6,7 +6,9 @@
 #ifndef VAULT_NOTEENTRY_H
 #define VAULT_NOTEENTRY_H
 
+#include <string_view>
 #include "Entry.h"
+#include "crypto/SecureArena.h"
 #include "json/json.hpp"
 
 using json = nlohmann::json;
@@ -16,15 +18,16 @@ namespace vault {
 // Reperesents a simple note entry
 class NoteEntry : public Entry {
 public:
-    NoteEntry(const std::string& noteText);
+    NoteEntry(std::string_view noteText);
 
     EntryType getType() const override;
-    const std::string& getNoteText() const;
+    std::unique_ptr<Entry> clone() const override;
+    std::string_view getNoteText() const;
 
     friend void to_json(json& j, const NoteEntry& entry);
 
 private:
-    std::string noteText;
+    cryptography::SecureString noteText; // Allocated in the locked, zeroizing arena
 };
 
 void from_json(const json& j, NoteEntry& entry);
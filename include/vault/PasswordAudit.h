@@ -0,0 +1,100 @@
+/*
+PasswordAudit finds reused and weak passwords across any number of vaults without keeping the passwords.
+Each password is reduced to two SipHash values under random keys that only live as long as the audit:
+the first one places it in an open addressing table (one pass finds every reuse), the second one confirms
+a match, so two different passwords are only mistaken for each other with probability around 2^-128.
+Strength is estimated from the password's structure (character classes, repeats, sequences, keyboard runs and a list
+of the most common passwords). Breaches are looked up by the caller (see storage::BreachDatabase) and only their
+count is kept. Results only name the credentials, never anything derived from the passwords.
+*/
+
+// Directory: include/vault/PasswordAudit.h
+#ifndef VAULT_PASSWORDAUDIT_H
+#define VAULT_PASSWORDAUDIT_H
+
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "crypto/SipHash.h"
+
+namespace vault {
+
+// Passwords estimated below this many bits of entropy are reported as weak
+const double weakPasswordBits = 50.0;
+
+struct PasswordStrength {
+    double bits;
+    std::string weakness; // Main reason the estimate is low (empty if nothing stands out)
+};
+
+PasswordStrength estimatePasswordStrength(std::string_view password);
+
+struct CredentialPath {
+    std::string vault, folder, entry;
+
+    auto operator<=>(const CredentialPath&) const = default;
+};
+
+// What the audit keeps of a password
+struct PasswordReport {
+    uint64_t hash;
+    uint64_t fingerprint;
+    PasswordStrength strength;
+    uint64_t breaches = 0; // Times the password was seen in a breach corpus (set by the caller, inspect has no corpus)
+};
+
+struct WeakPassword {
+    CredentialPath credential;
+    PasswordStrength strength;
+};
+
+struct BreachedPassword {
+    CredentialPath credential;
+    uint64_t breaches;
+};
+
+class PasswordAudit {
+public:
+    PasswordAudit();
+
+    // Hashes and rates the password. Only reads the keys, so vaults can be inspected on several threads at once
+    PasswordReport inspect(std::string_view password) const;
+
+    // Records an inspected credential (not thread-safe)
+    void add(CredentialPath credential, const PasswordReport& report);
+
+    size_t size() const;
+
+    // Groups of credentials sharing a password (largest groups first, each group sorted)
+    std::vector<std::vector<CredentialPath>> reusedPasswords() const;
+
+    // Credentials whose password is estimated below minimumBits (weakest first)
+    std::vector<WeakPassword> weakPasswords(double minimumBits = weakPasswordBits) const;
+
+    // Credentials whose password was seen in a breach (most often seen first)
+    std::vector<BreachedPassword> breachedPasswords() const;
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint64_t fingerprint = 0;
+        uint32_t group = 0; // Index into groupSizes + 1, 0 marks an empty slot
+    };
+
+    cryptography::SipHashKey hashKey, fingerprintKey;
+    std::vector<CredentialPath> credentials;
+    std::vector<PasswordStrength> strengths; // Per credential
+    std::vector<uint64_t> breaches; // Per credential
+    std::vector<uint32_t> groupOf; // Per credential: which distinct password it has
+    std::vector<uint32_t> groupSizes;
+    std::vector<Slot> slots; // Power of two sized, at most half full
+
+    void grow();
+    uint32_t findOrInsert(uint64_t hash, uint64_t fingerprint);
+};
+
+} // vault
+
+#endif //VAULT_PASSWORDAUDIT_H
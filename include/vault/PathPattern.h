@@ -0,0 +1,36 @@
+/*
+Glob patterns in the folder and entry components of a path (e.g. folder "prod-*", entry "db-?"), matched with fnmatch rules:
+'*' and '?' match any characters (or one), "[...]" a set, and '\' makes the next character literal.
+Components are matched separately, '/' can't be part of a name anyway.
+Matching goes through the names of the unlocked vault, so a pattern costs one unlock however many entries it hits.
+*/
+
+// Directory: include/vault/PathPattern.h
+#ifndef VAULT_PATHPATTERN_H
+#define VAULT_PATHPATTERN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "EntryIndex.h"
+#include "Vault.h"
+#include "VaultView.h"
+
+namespace vault {
+
+// True if the path component holds any of '*', '?' or '['
+bool isPathPattern(std::string_view component);
+
+bool matchesPathPattern(const std::string& pattern, const std::string& name);
+
+// Names of the matching folders, sorted
+std::vector<std::string> matchFolders(const Vault& vault, const std::string& folderPattern);
+std::vector<std::string> matchFolders(const VaultView& vault, const std::string& folderPattern);
+
+// Matching entries of the matching folders, sorted by folder and entry name
+std::vector<EntryPath> matchEntries(const Vault& vault, const std::string& folderPattern, const std::string& entryPattern);
+std::vector<EntryPath> matchEntries(const VaultView& vault, const std::string& folderPattern, const std::string& entryPattern);
+
+} // vault
+
+#endif //VAULT_PATHPATTERN_H
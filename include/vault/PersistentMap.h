@@ -0,0 +1,454 @@
+/*
+PersistentMap is a string-keyed hash array mapped trie with structural sharing.
+Copying a map is O(1): both copies share the same immutable nodes. A modification copies only the nodes on the path
+to the changed key (O(log n), 32-way branching), so the other copies never see it.
+Nodes created by a map since it was last copied are owned by it and are modified in place instead of copied again,
+which keeps a series of edits between two snapshots as cheap as edits of an ordinary map.
+Copying a map makes all its nodes shared (the source gets a new owner as well), so for thread safety
+a copy counts as a modification of the source. Readers working on their own copy need no locking.
+*/
+
+// Directory: include/vault/PersistentMap.h
+#ifndef VAULT_PERSISTENTMAP_H
+#define VAULT_PERSISTENTMAP_H
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vault {
+
+template<typename Value>
+class PersistentMap {
+public:
+    using value_type = std::pair<const std::string, Value>;
+
+    PersistentMap() : owner(nextOwner()) {}
+
+    // O(1), the nodes become shared by both maps
+    PersistentMap(const PersistentMap& other) : root(other.root), count(other.count), owner(nextOwner()) {
+        other.owner = nextOwner();
+    }
+
+    PersistentMap& operator=(const PersistentMap& other) {
+        if (this != &other) {
+            root = other.root;
+            count = other.count;
+            owner = nextOwner();
+            other.owner = nextOwner();
+        }
+        return *this;
+    }
+
+    PersistentMap(PersistentMap&& other) noexcept : root(std::move(other.root)), count(other.count), owner(other.owner) {
+        other.count = 0;
+        other.owner = nextOwner();
+    }
+
+    PersistentMap& operator=(PersistentMap&& other) noexcept {
+        if (this != &other) {
+            root = std::move(other.root);
+            count = other.count;
+            owner = other.owner;
+            other.count = 0;
+            other.owner = nextOwner();
+        }
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Returns nullptr if the key is not present
+    const Value* find(const std::string& key) const {
+        const Node* node = root.get();
+        size_t hash = std::hash<std::string>{}(key);
+        for (unsigned shift = 0; node; shift += bitsPerLevel) {
+            if (shift >= hashBits) {
+                for (const Slot& slot : node->slots) {
+                    if (slot.leaf->item.first == key)
+                        return &slot.leaf->item.second;
+                }
+                return nullptr;
+            }
+            uint32_t bit = bitFor(hash, shift);
+            if (!(node->bitmap & bit))
+                return nullptr;
+            const Slot& slot = node->slots[slotIndex(node->bitmap, bit)];
+            if (slot.leaf)
+                return slot.leaf->item.first == key ? &slot.leaf->item.second : nullptr;
+            node = slot.node.get();
+        }
+        return nullptr;
+    }
+
+    bool contains(const std::string& key) const { return find(key) != nullptr; }
+
+    // Inserts or replaces the value
+    void set(const std::string& key, Value value) {
+        bool added = false;
+        root = insert(root, std::make_shared<Leaf>(std::hash<std::string>{}(key), value_type(key, std::move(value))), 0, added);
+        if (added)
+            count++;
+    }
+
+    // Returns false if the key was not present
+    bool erase(const std::string& key) {
+        bool removed = false;
+        root = remove(root, std::hash<std::string>{}(key), key, 0, removed);
+        if (removed)
+            count--;
+        return removed;
+    }
+
+    // Returns the stored value for modification (the key must be present). Nodes on the path are copied unless
+    // this map owns them, so the returned slot is referenced by this map only. The value itself may still be
+    // shared with copies of the map (e.g. a shared_ptr), the caller decides whether to copy it
+    Value& edit(const std::string& key) {
+        size_t hash = std::hash<std::string>{}(key);
+        root = own(root);
+        Node* node = root.get();
+        for (unsigned shift = 0;; shift += bitsPerLevel) {
+            if (shift >= hashBits) {
+                for (Slot& slot : node->slots) {
+                    if (slot.leaf->item.first == key)
+                        return ownLeaf(slot);
+                }
+                break;
+            }
+            uint32_t bit = bitFor(hash, shift);
+            if (!(node->bitmap & bit))
+                break;
+            Slot& slot = node->slots[slotIndex(node->bitmap, bit)];
+            if (slot.leaf) {
+                if (slot.leaf->item.first != key)
+                    break;
+                return ownLeaf(slot);
+            }
+            slot.node = own(slot.node);
+            node = slot.node.get();
+        }
+        throw std::out_of_range("Key is not present: " + key);
+    }
+
+    // Calls callback(key, before, after) for every key whose value differs between the maps (values compared with ==)
+    // before or after is nullptr if the key is missing from that map. Subtrees both maps share are skipped,
+    // so comparing a map with an edited copy of it takes time proportional to the edits
+    template<typename Callback>
+    static void diff(const PersistentMap& before, const PersistentMap& after, Callback&& callback) {
+        diffNodes(before.root, after.root, 0, callback);
+    }
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PersistentMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return *current; }
+        pointer operator->() const { return current; }
+
+        const_iterator& operator++() {
+            advance();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            advance();
+            return previous;
+        }
+
+        bool operator==(const const_iterator& other) const { return current == other.current; }
+        bool operator!=(const const_iterator& other) const { return current != other.current; }
+
+    private:
+        friend class PersistentMap;
+
+        std::vector<std::pair<const void*, size_t>> stack; // Node and index of the next slot to visit
+        const value_type* current = nullptr;
+
+        explicit const_iterator(const void* root) {
+            if (root) {
+                stack.emplace_back(root, 0);
+                advance();
+            }
+        }
+
+        void advance() {
+            while (!stack.empty()) {
+                const Node* node = static_cast<const Node*>(stack.back().first);
+                size_t& index = stack.back().second;
+                if (index == node->slots.size()) {
+                    stack.pop_back();
+                    continue;
+                }
+                const Slot& slot = node->slots[index++];
+                if (slot.leaf) {
+                    current = &slot.leaf->item;
+                    return;
+                }
+                stack.emplace_back(slot.node.get(), 0);
+            }
+            current = nullptr;
+        }
+    };
+
+    // Iteration order is unspecified (it follows the key hashes)
+    const_iterator begin() const { return const_iterator(root.get()); }
+    const_iterator end() const { return const_iterator(); }
+
+private:
+    static constexpr unsigned bitsPerLevel = 5;
+    static constexpr unsigned hashBits = sizeof(size_t) * 8;
+
+    struct Node;
+
+    struct Leaf {
+        Leaf(size_t hash, value_type item) : hash(hash), item(std::move(item)) {}
+        size_t hash;
+        value_type item;
+    };
+
+    // Either a key/value pair or a subtree
+    struct Slot {
+        std::shared_ptr<Leaf> leaf;
+        std::shared_ptr<Node> node;
+    };
+
+    // Slots are stored compactly in bit order. Below the last hash bits a node is a plain list of colliding leaves
+    struct Node {
+        uint64_t owner = 0;
+        uint32_t bitmap = 0;
+        std::vector<Slot> slots;
+    };
+
+    std::shared_ptr<Node> root;
+    size_t count = 0;
+    mutable uint64_t owner;
+
+    static uint64_t nextOwner() {
+        static std::atomic<uint64_t> counter{1};
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static uint32_t bitFor(size_t hash, unsigned shift) {
+        return uint32_t(1) << ((hash >> shift) & 31);
+    }
+
+    static size_t slotIndex(uint32_t bitmap, uint32_t bit) {
+        return static_cast<size_t>(std::popcount(bitmap & (bit - 1)));
+    }
+
+    // Node that may be modified in place: node itself if this map owns it, otherwise a copy owned by this map
+    std::shared_ptr<Node> own(const std::shared_ptr<Node>& node) const {
+        if (!node) {
+            auto created = std::make_shared<Node>();
+            created->owner = owner;
+            return created;
+        }
+        if (node->owner == owner)
+            return node;
+        auto copy = std::make_shared<Node>(*node);
+        copy->owner = owner;
+        return copy;
+    }
+
+    // Leaves are never shared between an owned node and other maps after this, so the value can be handed out
+    static Value& ownLeaf(Slot& slot) {
+        if (slot.leaf.use_count() != 1)
+            slot.leaf = std::make_shared<Leaf>(*slot.leaf);
+        return slot.leaf->item.second;
+    }
+
+    std::shared_ptr<Node> insert(const std::shared_ptr<Node>& node, std::shared_ptr<Leaf> leaf, unsigned shift, bool& added) {
+        std::shared_ptr<Node> result = own(node);
+
+        if (shift >= hashBits) {
+            for (Slot& slot : result->slots) {
+                if (slot.leaf->item.first == leaf->item.first) {
+                    slot.leaf = std::move(leaf);
+                    return result;
+                }
+            }
+            result->slots.push_back(Slot{std::move(leaf), nullptr});
+            added = true;
+            return result;
+        }
+
+        uint32_t bit = bitFor(leaf->hash, shift);
+        size_t index = slotIndex(result->bitmap, bit);
+        if (!(result->bitmap & bit)) {
+            result->slots.insert(result->slots.begin() + static_cast<std::ptrdiff_t>(index), Slot{std::move(leaf), nullptr});
+            result->bitmap |= bit;
+            added = true;
+            return result;
+        }
+
+        Slot& slot = result->slots[index];
+        if (slot.leaf) {
+            if (slot.leaf->item.first == leaf->item.first) {
+                slot.leaf = std::move(leaf);
+                return result;
+            }
+            // Two keys share this slot now, push both one level down
+            bool ignored = false;
+            std::shared_ptr<Node> child = insert(nullptr, std::move(slot.leaf), shift + bitsPerLevel, ignored);
+            slot.node = insert(child, std::move(leaf), shift + bitsPerLevel, added);
+            return result;
+        }
+        slot.node = insert(slot.node, std::move(leaf), shift + bitsPerLevel, added);
+        return result;
+    }
+
+    std::shared_ptr<Node> remove(const std::shared_ptr<Node>& node, size_t hash, const std::string& key, unsigned shift, bool& removed) {
+        if (!node)
+            return node;
+
+        if (shift >= hashBits) {
+            for (size_t i = 0; i < node->slots.size(); i++) {
+                if (node->slots[i].leaf->item.first == key) {
+                    removed = true;
+                    if (node->slots.size() == 1)
+                        return nullptr;
+                    std::shared_ptr<Node> result = own(node);
+                    result->slots.erase(result->slots.begin() + static_cast<std::ptrdiff_t>(i));
+                    return result;
+                }
+            }
+            return node;
+        }
+
+        uint32_t bit = bitFor(hash, shift);
+        if (!(node->bitmap & bit))
+            return node;
+        size_t index = slotIndex(node->bitmap, bit);
+        const Slot& slot = node->slots[index];
+
+        std::shared_ptr<Node> child;
+        if (slot.leaf) {
+            if (slot.leaf->item.first != key)
+                return node;
+            removed = true;
+        } else {
+            child = remove(slot.node, hash, key, shift + bitsPerLevel, removed);
+            if (child == slot.node)
+                return node;
+        }
+
+        std::shared_ptr<Node> result = own(node);
+        if (!child) {
+            result->slots.erase(result->slots.begin() + static_cast<std::ptrdiff_t>(index));
+            result->bitmap &= ~bit;
+            if (result->slots.empty())
+                return nullptr;
+        } else if (child->slots.size() == 1 && child->slots[0].leaf) {
+            // A subtree with a single key collapses back into its parent
+            result->slots[index] = Slot{child->slots[0].leaf, nullptr};
+        } else {
+            result->slots[index].node = std::move(child);
+        }
+        return result;
+    }
+
+    template<typename Callback>
+    static void forEachLeaf(const Node* node, Callback&& callback) {
+        if (!node)
+            return;
+        for (const Slot& slot : node->slots) {
+            if (slot.leaf)
+                callback(*slot.leaf);
+            else
+                forEachLeaf(slot.node.get(), callback);
+        }
+    }
+
+    // Subtree at shift holding just leaf (used to compare a leaf against a subtree)
+    static std::shared_ptr<Node> singleton(const std::shared_ptr<Leaf>& leaf, unsigned shift) {
+        auto node = std::make_shared<Node>();
+        node->slots.push_back(Slot{leaf, nullptr});
+        if (shift < hashBits)
+            node->bitmap = bitFor(leaf->hash, shift);
+        return node;
+    }
+
+    template<typename Callback>
+    static void diffNodes(const std::shared_ptr<Node>& before, const std::shared_ptr<Node>& after, unsigned shift, Callback& callback) {
+        if (before == after)
+            return;
+        if (!before || !after) {
+            forEachLeaf(before.get(), [&](const Leaf& leaf) { callback(leaf.item.first, &leaf.item.second, nullptr); });
+            forEachLeaf(after.get(), [&](const Leaf& leaf) { callback(leaf.item.first, nullptr, &leaf.item.second); });
+            return;
+        }
+
+        if (shift >= hashBits) {
+            for (const Slot& slot : before->slots) {
+                const Slot* match = nullptr;
+                for (const Slot& other : after->slots) {
+                    if (other.leaf->item.first == slot.leaf->item.first)
+                        match = &other;
+                }
+                if (!match)
+                    callback(slot.leaf->item.first, &slot.leaf->item.second, nullptr);
+                else if (!(match->leaf->item.second == slot.leaf->item.second))
+                    callback(slot.leaf->item.first, &slot.leaf->item.second, &match->leaf->item.second);
+            }
+            for (const Slot& slot : after->slots) {
+                bool found = false;
+                for (const Slot& other : before->slots) {
+                    found = found || other.leaf->item.first == slot.leaf->item.first;
+                }
+                if (!found)
+                    callback(slot.leaf->item.first, nullptr, &slot.leaf->item.second);
+            }
+            return;
+        }
+
+        for (unsigned position = 0; position < 32; position++) {
+            uint32_t bit = uint32_t(1) << position;
+            const Slot* beforeSlot = (before->bitmap & bit) ? &before->slots[slotIndex(before->bitmap, bit)] : nullptr;
+            const Slot* afterSlot = (after->bitmap & bit) ? &after->slots[slotIndex(after->bitmap, bit)] : nullptr;
+            if (!beforeSlot && !afterSlot)
+                continue;
+
+            if (beforeSlot && afterSlot && beforeSlot->leaf && afterSlot->leaf) {
+                const Leaf& b = *beforeSlot->leaf;
+                const Leaf& a = *afterSlot->leaf;
+                if (&a == &b)
+                    continue;
+                if (a.item.first == b.item.first) {
+                    if (!(a.item.second == b.item.second))
+                        callback(b.item.first, &b.item.second, &a.item.second);
+                } else {
+                    callback(b.item.first, &b.item.second, nullptr);
+                    callback(a.item.first, nullptr, &a.item.second);
+                }
+                continue;
+            }
+
+            // At least one side is a subtree (or missing), compare them as subtrees one level down
+            auto asNode = [shift](const Slot* slot) -> std::shared_ptr<Node> {
+                if (!slot)
+                    return nullptr;
+                return slot->leaf ? singleton(slot->leaf, shift + bitsPerLevel) : slot->node;
+            };
+            diffNodes(asNode(beforeSlot), asNode(afterSlot), shift + bitsPerLevel, callback);
+        }
+    }
+};
+
+} // vault
+
+#endif //VAULT_PERSISTENTMAP_H
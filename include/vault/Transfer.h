@@ -0,0 +1,59 @@
+/*
+Moving and copying folders and entries, within a vault or between two unlocked vaults.
+Nothing is copied: folders and entries are shared between the source and the destination (the same way
+snapshots share them) until either side modifies them, so secrets never leave the vault objects.
+A move between two vaults writes two files. It is made safe by ordered writes: a marker naming the moved paths is
+written first, then the destination vault, then the source vault, and only then is the marker removed.
+If the process dies in between, applying the marker again finishes the move (applyTransfer skips what is done).
+Until then the source vault refuses any other write (see Storage::saveVault).
+*/
+
+// Directory: include/vault/Transfer.h
+#ifndef VAULT_TRANSFER_H
+#define VAULT_TRANSFER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <botan/secmem.h>
+#include "EntryIndex.h"
+#include "Vault.h"
+
+namespace vault {
+
+// A folder (empty entry) or an entry, and where it goes
+struct TransferPath {
+    EntryPath from, to;
+};
+
+// Works out where the folders (empty entryPattern) or entries matching the source patterns go.
+// Entries go into targetFolder (renamed to targetEntry if it is given, which takes a single entry),
+// folders into the target vault (renamed to targetFolder if it is given, which takes a single folder).
+// target may be source itself. Throws std::runtime_error if nothing matches or a destination already exists
+std::vector<TransferPath> planTransfer(const Vault& source, const std::string& folderPattern, const std::string& entryPattern,
+                                       const Vault& target, const std::string& targetFolder, const std::string& targetEntry);
+
+// Adds the paths to target (missing folders are created) and, if move is set, removes them from source.
+// Paths gone from source are skipped and paths already at their destination are only removed from source,
+// so applying the same paths again finishes an interrupted move. target may be source itself.
+// A path whose destination differs from it is left in both vaults and returned
+std::vector<TransferPath> applyTransfer(Vault& source, Vault& target, const std::vector<TransferPath>& paths, bool move);
+
+// The paths of a move between vaults, kept in the marker encrypted with the source vault's key
+// (the names are as private as the rest of the vault). The target vault name is stored in the clear
+struct TransferMarker {
+    std::string targetVault;
+    std::vector<TransferPath> paths;
+};
+
+std::string encodeTransferMarker(const Vault& source, const TransferMarker& marker, const Botan::secure_vector<char>& masterPassword);
+
+// Throws std::runtime_error if the marker is damaged or the password doesn't decrypt it
+TransferMarker decodeTransferMarker(std::string_view encoded, const Botan::secure_vector<char>& masterPassword);
+
+// Only the target vault name, which tells whose password decodeTransferMarker's caller needs
+std::string transferMarkerTarget(std::string_view encoded);
+
+} // vault
+
+#endif //VAULT_TRANSFER_H
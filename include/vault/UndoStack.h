@@ -0,0 +1,42 @@
+/*
+UndoStack keeps previous states of a vault during an unlocked session.
+States are vault snapshots (copies), which share everything that wasn't modified with the current vault,
+so recording a state before every modification costs O(1) time and memory proportional to the edits.
+*/
+
+// Directory: include/vault/UndoStack.h
+#ifndef VAULT_UNDOSTACK_H
+#define VAULT_UNDOSTACK_H
+
+#include <deque>
+#include "Vault.h"
+
+namespace vault {
+
+const size_t defaultUndoLimit = 100;
+
+class UndoStack {
+public:
+    explicit UndoStack(size_t limit = defaultUndoLimit);
+
+    // Remembers vault as it is before a modification. Clears the redo states, the oldest state is dropped past the limit
+    void record(const Vault& vault);
+
+    bool canUndo() const;
+    bool canRedo() const;
+
+    // Replaces vault with the state before the last recorded modification (throws std::out_of_range if there is none)
+    void undo(Vault& vault);
+
+    // Reverts the last undo (throws std::out_of_range if there is none)
+    void redo(Vault& vault);
+
+private:
+    size_t limit;
+    std::deque<Vault> undoStates;
+    std::deque<Vault> redoStates;
+};
+
+} // vault
+
+#endif //VAULT_UNDOSTACK_H
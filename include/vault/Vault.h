@@ -7,12 +7,13 @@
 #define VAULT_H
 
 #include <string>
+#include <functional>
 #include <memory>
-#include <unordered_map>
 #include <vector>
 #include <stdexcept>
 #include "Folder.h"
 #include "Entry.h"
+#include "PersistentMap.h"
 
 namespace vault {
 
@@ -22,7 +23,10 @@ public:
     std::string cryptoAlgorithm;
     std::string cryptoKDF;
     int cryptoKDFIterations;
-    std::string cryptoBase64Salt;
+    std::string cryptoBase64Salt; // Salt of the last save (every save draws a new one)
+    std::string cryptoCompression; // Codec applied before encryption ("none" disables compression)
+
+    size_t historyRetention = defaultHistoryRetention; // Revisions kept per entry (0 disables history)
 
     explicit Vault(const std::string& vaultName);
 
@@ -35,6 +39,7 @@ public:
     void addEntry(const std::string& folderName, const std::string& entryName, std::unique_ptr<Entry> entry);
 
     // Retrieves a folder by name (mutable and immutable versions)
+    // Like Folder::getEntry, the mutable version copies a folder shared with a snapshot of the vault first
     Folder& getFolder(const std::string& folderName);
     const Folder& getFolder(const std::string& folderName) const;
 
@@ -57,24 +62,53 @@ public:
     // This has to be done in the Vault object because in addition to just updating the Folder's property, we also need to update the 'folders' unordered map
     void changeFolderName(const std::string& oldName, const std::string& newName);
 
-    // Explicit disallowance of copy operations and allowance for moving operations is required due to unique_ptr use
-    // Disable copy operations to enforce unique ownership
-    Vault(const Vault&) = delete;
-    Vault& operator=(const Vault&) = delete;
-    // Enable move operations
-    Vault(Vault&&) noexcept;
-    Vault& operator=(Vault&&) noexcept;
+    // Copies are O(1) snapshots sharing folders and entries with the original until either of them modifies them.
+    // References from the mutable getters must not be used for modifications after a snapshot is taken
+    Vault(const Vault&) = default;
+    Vault& operator=(const Vault&) = default;
+    Vault(Vault&&) noexcept = default;
+    Vault& operator=(Vault&&) noexcept = default;
 
     friend void to_json(json& j, const Vault& vault);
+    friend std::vector<VaultChange> diff(const Vault& before, const Vault& after);
+    friend void serializeVault(const Vault& vault, cryptography::SecureBuffer& out);
+    friend void serializeVault(const Vault& vault, cryptography::SecureBuffer& out, size_t flushThreshold,
+                               const std::function<void(cryptography::SecureBuffer&)>& flush);
 
 private:
     std::string vaultName; // Name of the vault
-    std::unordered_map<std::string, std::unique_ptr<Folder>> folders; // Map of folder name to Folder objects
+    PersistentMap<std::shared_ptr<Folder>> folders; // Map of folder name to Folder objects (shared with snapshots)
 
 };
 
 void from_json(const json& j, Vault& vault);
 
+// Difference between two states of a vault. entry is empty when a whole folder was added or removed
+struct VaultChange {
+    enum class Kind {
+        ADDED,
+        REMOVED,
+        MODIFIED,
+    };
+
+    Kind kind;
+    std::string folder;
+    std::string entry;
+};
+
+// Lists what changed from before to after, sorted by folder and entry name. Entries are compared by identity,
+// so an entry counts as modified once it was accessed through a mutable getter of after (or before).
+// Meant for snapshots of one vault: whatever they still share is skipped, which makes the cost proportional to the edits
+std::vector<VaultChange> diff(const Vault& before, const Vault& after);
+
+// Serializes the vault into a secure buffer (used instead of a json DOM when saving)
+void serializeVault(const Vault& vault, cryptography::SecureBuffer& out);
+
+// Streaming variant: whenever out grows past flushThreshold (checked between entries) it is passed to flush,
+// which consumes and clears it. Whatever is left in out on return is the end of the document
+void serializeVault(const Vault& vault, cryptography::SecureBuffer& out, size_t flushThreshold,
+                    const std::function<void(cryptography::SecureBuffer&)>& flush);
+
 
 } // vault
 
@@ -0,0 +1,94 @@
+// Directory: include/vault/VaultView.h
+#ifndef VAULT_VAULTVIEW_H
+#define VAULT_VAULTVIEW_H
+
+#include <functional>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <stdexcept>
+#include "Entry.h"
+#include "Vault.h"
+#include "crypto/SecureArena.h"
+
+namespace vault {
+
+// Read-only view over a decrypted (serialized) vault.
+// Unlike from_json, which builds every Folder and Entry up front, the view keeps the plaintext buffer
+// and only indexes where folders and entries are located in it. Folder contents are indexed the first time
+// the folder is accessed and Entry objects are materialized only when they are requested,
+// so read-only commands do work proportional to what they print instead of to the size of the vault.
+class VaultView {
+public:
+    // Takes ownership of the serialized vault and indexes its folders (throws std::invalid_argument on malformed input)
+    // The buffer is the one the vault was decrypted into, so the plaintext is never copied as a whole
+    explicit VaultView(cryptography::SecureBuffer plaintext);
+
+    const std::string& getName() const; // Returns vault name
+    size_t getHistoryRetention() const; // Revisions kept per entry
+
+    std::vector<std::string> getFolderNames() const; // Gets names of all folders
+    bool folderExists(const std::string& folderName) const;
+
+    std::vector<std::string> getEntryNames(const std::string& folderName) const; // Gets names of all entries in a folder
+    bool entryExists(const std::string& folderName, const std::string& entryName) const;
+
+    // Type of the entry, known from the index without materializing the entry
+    EntryType getEntryType(const std::string& folderName, const std::string& entryName) const;
+
+    // Timestamps and tags of the entry, read without materializing it (no secrets are decoded)
+    EntryMetadata getEntryMetadata(const std::string& folderName, const std::string& entryName) const;
+
+    // Materializes the entry on first access (the object is cached for subsequent calls)
+    const Entry& getEntry(const std::string& folderName, const std::string& entryName) const;
+
+    using EntryCallback = std::function<void(const std::string& folderName, const std::string& entryName, const Entry& entry)>;
+
+    // Calls callback for every entry (of the given type or in the given folder), ordered by folder and entry name.
+    // Entries that weren't materialized yet are only materialized for the duration of the call and not cached,
+    // so going through a large vault doesn't keep all of it decoded
+    void forEachEntry(const EntryCallback& callback) const;
+    void forEachEntry(EntryType type, const EntryCallback& callback) const;
+    void forEachEntry(const std::string& folderName, const EntryCallback& callback) const;
+
+    // Builds the full Vault (used by commands that modify it). Entries already materialized are moved out of the view
+    Vault materialize();
+
+    // Same as Vault, the view is not copyable (materialized entries are uniquely owned)
+    VaultView(const VaultView&) = delete;
+    VaultView& operator=(const VaultView&) = delete;
+    VaultView(VaultView&&) noexcept = default;
+    VaultView& operator=(VaultView&&) noexcept = default;
+
+private:
+    // Location of a single entry object inside the buffer
+    struct EntryRef {
+        size_t begin, end;
+        EntryType type;
+        mutable std::unique_ptr<Entry> materialized;
+    };
+
+    // Location of a folder's entries array inside the buffer. Entries are indexed lazily
+    struct FolderRef {
+        size_t entriesBegin;
+        mutable bool indexed = false;
+        mutable std::unordered_map<std::string, EntryRef> entries;
+    };
+
+    // Positions below are offsets into buffer, nothing points into it, so moving the view needs no fixing up
+    cryptography::SecureBuffer buffer;
+    std::string vaultName;
+    size_t historyRetention = defaultHistoryRetention;
+    std::unordered_map<std::string, FolderRef> folders;
+
+    std::string_view text() const; // buffer viewed as characters
+    const FolderRef& getFolder(const std::string& folderName) const;
+    const FolderRef& getIndexedFolder(const std::string& folderName) const;
+    const EntryRef& getEntryRef(const std::string& folderName, const std::string& entryName) const;
+    void visitEntries(const std::string* folderName, const EntryType* type, const EntryCallback& callback) const;
+};
+
+} // namespace vault
+
+#endif //VAULT_VAULTVIEW_H
@@ -3,11 +3,28 @@
 //
 
 #include "Command.h"
+#include "PrivateFile.h"
 
 #include <iostream>
-#include "crypto/GetMasterPassword.h"
+#include "crypto/Compression.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <future>
+#include <optional>
 #include "vault/CredentialEntry.h"
 #include "vault/NoteEntry.h"
+#include "vault/AttachmentEntry.h"
+#include "vault/PasswordAudit.h"
+#include "vault/Import.h"
+#include "vault/Export.h"
+#include "vault/PathPattern.h"
+#include "vault/Transfer.h"
+#include "agent/Agent.h"
+#include "agent/AgentProtocol.h"
+#include <csignal>
+#include <sys/prctl.h>
 
 using namespace cryptography;
 using namespace vault;
@@ -45,29 +62,286 @@ bool askForConfirmation(const std::string& prompt_message) {
     }
 }
 
+// Helper function for opening the file an attachment is created from
+std::ifstream openAttachmentFile(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open file: " + filePath);
+    return file;
+}
+
+// Helper function writing the contents of an attachment to a new file that only the owner can read
+void extractAttachment(const AttachmentEntry& attachment, const std::string& filePath, Storage& storage) {
+    PrivateFile file(filePath);
+    std::ostream& output = file.stream();
+    storage.getChunkStore().readAttachment(attachment, [&output](const uint8_t* data, size_t size) {
+        output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    });
+    file.close();
+}
+
+// Helper function naming entry types in listings
+std::string entryTypeName(EntryType type) {
+    switch (type) {
+        case EntryType::CREDENTIAL:
+            return "credential";
+        case EntryType::NOTE:
+            return "note";
+        case EntryType::ATTACHMENT:
+            return "attachment";
+    }
+    return "unknown";
+}
+
+// Helper function formatting revision times (local time)
+std::string formatTime(int64_t time) {
+    std::time_t t = static_cast<std::time_t>(time);
+    std::tm local{};
+    localtime_r(&t, &local);
+    char formatted[32];
+    std::strftime(formatted, sizeof(formatted), "%Y-%m-%d %H:%M:%S", &local);
+    return formatted;
+}
+
+// Helper function formatting entry timestamps (0 means not recorded)
+std::string formatTimestamp(int64_t time, const std::string& unknown) {
+    return time == 0 ? unknown : formatTime(time);
+}
+
+// Helper function setting the metadata of a newly added entry
+void stampNewEntry(Entry& entry, const std::vector<std::string>& tags) {
+    EntryMetadata& metadata = entry.getMetadata();
+    metadata.created = metadata.modified = std::time(nullptr);
+    for (const std::string& tag : tags) {
+        metadata.addTag(tag);
+    }
+}
+
+// Helper function asking for the value of a new credential or note
+std::unique_ptr<Entry> readEntryValue(EntryType type) {
+    if (type == EntryType::CREDENTIAL) {
+        SecureString username;
+        std::cout << "Username: ";
+        getline(std::cin, username);
+
+        SecureString password;
+        std::cout << "Password: ";
+        getline(std::cin, password);
+
+        return std::make_unique<CredentialEntry>(username, password);
+    }
+    SecureString text;
+    std::cout << "Note contents: ";
+    getline(std::cin, text);
+
+    return std::make_unique<NoteEntry>(text);
+}
+
+// Helper function asking for the new value of an entry of the given type
+std::unique_ptr<Entry> readNewValue(EntryType type, Storage& storage) {
+    switch (type) {
+        case EntryType::CREDENTIAL: {
+            SecureString username;
+            std::cout << "New username: ";
+            getline(std::cin, username);
+
+            SecureString password;
+            std::cout << "New password: ";
+            getline(std::cin, password);
+
+            return std::make_unique<CredentialEntry>(username, password);
+        }
+        case EntryType::NOTE: {
+            SecureString text;
+            std::cout << "New note contents: ";
+            getline(std::cin, text);
+
+            return std::make_unique<NoteEntry>(text);
+        }
+        case EntryType::ATTACHMENT: {
+            std::string filePath;
+            std::cout << "New file: ";
+            std::getline(std::cin, filePath);
+
+            std::ifstream file = openAttachmentFile(filePath);
+            return storage.getChunkStore().storeAttachment(file, fs::path(filePath).filename().string());
+        }
+    }
+    throw std::runtime_error("Unknown entry type");
+}
+
+// Helper function printing the value of an entry: a few lines of text, or the JSON members from "type" on
+void printEntryValue(OutputWriter& out, const Entry& entry, OutputFormat format) {
+    bool asJson = format == OutputFormat::JSON;
+    if (asJson) {
+        out << "\"type\":";
+        out.json(entryTypeName(entry.getType()));
+    }
+
+    switch (entry.getType()) {
+        case EntryType::CREDENTIAL: {
+            const auto& credential = dynamic_cast<const CredentialEntry&>(entry);
+            if (asJson) {
+                out << ",\"username\":";
+                out.json(credential.getUsername()) << ",\"password\":";
+                out.json(credential.getPassword());
+            } else {
+                out << "Username: " << credential.getUsername() << '\n';
+                out << "Password: " << credential.getPassword() << '\n';
+            }
+            break;
+        }
+        case EntryType::NOTE: {
+            const auto& note = dynamic_cast<const NoteEntry&>(entry);
+            if (asJson) {
+                out << ",\"text\":";
+                out.json(note.getNoteText());
+            } else {
+                out << note.getNoteText() << '\n';
+            }
+            break;
+        }
+        case EntryType::ATTACHMENT: {
+            const auto& attachment = dynamic_cast<const AttachmentEntry&>(entry);
+            if (asJson) {
+                out << ",\"file\":";
+                out.json(attachment.getFileName()) << ",\"size\":" << attachment.getSize();
+            } else {
+                out << "File: " << attachment.getFileName() << '\n';
+                out << "Size: " << attachment.getSize() << " bytes\n";
+            }
+            break;
+        }
+    }
+}
+
+// Helper function listing what a pattern matched, so the confirmation asked for next is an informed one
+void previewMatches(const std::vector<EntryPath>& matches) {
+    for (const EntryPath& path : matches) {
+        std::cout << "  " << path.folder << '/' << path.entry << '\n';
+    }
+}
+
+// Helper function locking two vaults in name order, so that two commands locking the same pair can't deadlock
+std::vector<std::unique_ptr<BlobLock>> lockVaults(Storage& storage, const std::string& first, const std::string& second) {
+    std::vector<std::unique_ptr<BlobLock>> locks;
+    locks.push_back(storage.lockVault(std::min(first, second)));
+    if (first != second)
+        locks.push_back(storage.lockVault(std::max(first, second)));
+    return locks;
+}
+
+// Helper function printing a folder with the names of its entries (and their types in JSON, a line per folder)
+void printFolderListing(OutputWriter& out, const std::string& folderName, const std::vector<std::pair<std::string, EntryType>>& entries, OutputFormat format) {
+    if (format == OutputFormat::JSON) {
+        out << "{\"folder\":";
+        out.json(folderName) << ",\"entries\":[";
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i > 0)
+                out << ',';
+            out << "{\"name\":";
+            out.json(entries[i].first) << ",\"type\":";
+            out.json(entryTypeName(entries[i].second)) << '}';
+        }
+        out << "]}\n";
+        return;
+    }
+
+    out << "/" << folderName << '\n';
+    for (const auto& [entryName, entryType] : entries) {
+        out << "  " << entryName << '\n';
+    }
+}
+
+// Helper function collecting the names and types of the entries of a folder (from the index, nothing is materialized)
+std::vector<std::pair<std::string, EntryType>> folderEntries(const VaultView& vault, const std::string& folderName) {
+    std::vector<std::pair<std::string, EntryType>> entries;
+    for (std::string& entryName : vault.getEntryNames(folderName)) {
+        EntryType entryType = vault.getEntryType(folderName, entryName);
+        entries.emplace_back(std::move(entryName), entryType);
+    }
+    return entries;
+}
+
+// Helper function printing the name and type of an entry of a folder
+void printEntryLine(OutputWriter& out, const std::string& entryName, EntryType entryType, OutputFormat format) {
+    if (format == OutputFormat::JSON) {
+        out << "{\"name\":";
+        out.json(entryName) << ",\"type\":";
+        out.json(entryTypeName(entryType)) << "}\n";
+    } else {
+        out << entryName << " (" << entryTypeName(entryType) << ")\n";
+    }
+}
+
+// Helper function printing an entry matched by a pattern: an object per line in JSON,
+// a "folder/entry:" header before the value in text
+void printMatchedEntry(OutputWriter& out, const EntryPath& path, const Entry& entry, OutputFormat format) {
+    if (format == OutputFormat::JSON) {
+        out << "{\"folder\":";
+        out.json(path.folder) << ",\"name\":";
+        out.json(path.entry) << ',';
+        printEntryValue(out, entry, format);
+        out << "}\n";
+    } else {
+        out << path.folder << '/' << path.entry << ":\n";
+        printEntryValue(out, entry, format);
+    }
+}
+
+// Helper function recording that the entries were shown (show --record-use). Saving the vault is only worth it when the rounded
+// time changes (at most once per lastUsedGranularity), so only the entries whose markUsed returned true are passed.
+// The vault is loaded again under the lock, it may have changed since it was read
+void saveLastUsed(Storage& storage, const std::string& vaultName, const Botan::secure_vector<char>& masterPassword,
+               const std::vector<std::pair<EntryPath, int64_t>>& used) {
+    if (used.empty())
+        return;
+    auto vaultLock = storage.lockVault(vaultName);
+    Vault current = storage.loadVault(vaultName, masterPassword);
+    bool changed = false;
+    for (const auto& [path, lastUsed] : used) {
+        if (current.entryExists(path.folder, path.entry)) {
+            current.getEntry(path.folder, path.entry).getMetadata().lastUsed = lastUsed;
+            changed = true;
+        }
+    }
+    if (changed)
+        storage.saveVault(current, masterPassword);
+}
+
 
 Command::~Command() = default;
 
 
 // --- ADD VAULT ---
-AddVaultCommand::AddVaultCommand(std::string vaultName, Storage& storage) : vaultName(vaultName), storage(storage) {}
+AddVaultCommand::AddVaultCommand(std::string vaultName, std::string compression, std::string algorithm, KeySource& keySource, Storage& storage) :
+    vaultName(vaultName), compression(compression), algorithm(algorithm), keySource(keySource), storage(storage) {}
 
 void AddVaultCommand::execute() {
+    auto vaultLock = storage.lockVault(vaultName);
     if (storage.vaultExists(vaultName))
         throw std::runtime_error("Vault already exists");
+    if (!compression.empty() && std::find(acceptedCompressions.begin(), acceptedCompressions.end(), compression) == acceptedCompressions.end())
+        throw std::runtime_error("Unsupported compression: " + compression);
+    if (!algorithm.empty() && std::find(acceptedAlgorithms.begin(), acceptedAlgorithms.end(), algorithm) == acceptedAlgorithms.end())
+        throw std::runtime_error("Unsupported algorithm: " + algorithm);
     std::cout << "Adding vault \"" << vaultName << "\"" << std::endl;
     Vault vault(vaultName);
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    if (!compression.empty())
+        vault.cryptoCompression = compression;
+    vault.cryptoAlgorithm = algorithm.empty() ? preferredAlgorithm() : algorithm;
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
     storage.saveVault(vault, masterPassword);
 }
 
 
 // --- ADD FOLDER ---
-AddFolderCommand::AddFolderCommand(std::string vaultName, std::string folderName, Storage &storage) : vaultName(vaultName), folderName(folderName), storage(storage) {}
+AddFolderCommand::AddFolderCommand(std::string vaultName, std::string folderName, KeySource &keySource, Storage &storage) : vaultName(vaultName), folderName(folderName), keySource(keySource), storage(storage) {}
 
 void AddFolderCommand::execute() {
     std::cout << "Adding folder \"" << folderName << "\"" << std::endl;
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
     Vault vault = storage.loadVault(vaultName, masterPassword);
 
     if (vault.folderExists(folderName))
@@ -80,26 +354,20 @@ void AddFolderCommand::execute() {
 
 
 // --- ADD CREDENTIAL ---
-AddCredentialCommand::AddCredentialCommand(std::string vault, std::string folder, std::string credential, Storage& storage) :
-    vaultName(vault), folderName(folder), credentialName(credential), storage(storage) {}
+AddCredentialCommand::AddCredentialCommand(std::string vault, std::string folder, std::string credential, std::vector<std::string> tags, KeySource& keySource, Storage& storage) :
+    vaultName(vault), folderName(folder), credentialName(credential), tags(tags), keySource(keySource), storage(storage) {}
 
 void AddCredentialCommand::execute() {
     std::cout << "Adding credential \"" << credentialName << "\"" << std::endl;
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
     Vault vault = storage.loadVault(vaultName, masterPassword);
 
     if (vault.entryExists(folderName, credentialName))
         throw std::runtime_error("An entry with this name already exists");
 
-    std::string username;
-    std::cout << "Username: ";
-    std::getline(std::cin, username);
-
-    std::string password;
-    std::cout << "Password: ";
-    std::getline(std::cin, password);
-
-    auto entry = std::make_unique<CredentialEntry>(username, password);
+    std::unique_ptr<Entry> entry = readEntryValue(EntryType::CREDENTIAL);
+    stampNewEntry(*entry, tags);
     vault.addEntry(folderName, credentialName, std::move(entry));
 
     storage.saveVault(vault, masterPassword);
@@ -107,149 +375,239 @@ void AddCredentialCommand::execute() {
 
 
 // --- ADD NOTE ---
-AddNoteCommand::AddNoteCommand(std::string vaultName, std::string folderName, std::string noteName, Storage &storage) :
-    vaultName(vaultName), folderName(folderName), noteName(noteName), storage(storage) {}
+AddNoteCommand::AddNoteCommand(std::string vaultName, std::string folderName, std::string noteName, std::vector<std::string> tags, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), noteName(noteName), tags(tags), keySource(keySource), storage(storage) {}
 
 void AddNoteCommand::execute() {
     std::cout << "Adding note \"" << noteName << "\"" << std::endl;
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
     Vault vault = storage.loadVault(vaultName, masterPassword);
 
     if (vault.entryExists(folderName, noteName))
         throw std::runtime_error("An entry with this name already exists");
 
-    std::string text;
-    std::cout << "Note contents: ";
-    std::getline(std::cin, text);
-
-    auto entry = std::make_unique<NoteEntry>(text);
+    std::unique_ptr<Entry> entry = readEntryValue(EntryType::NOTE);
+    stampNewEntry(*entry, tags);
     vault.addEntry(folderName, noteName, std::move(entry));
 
     storage.saveVault(vault, masterPassword);
 }
 
 
+// --- ADD ATTACHMENT ---
+AddAttachmentCommand::AddAttachmentCommand(std::string vaultName, std::string folderName, std::string attachmentName, std::string filePath, std::vector<std::string> tags, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), attachmentName(attachmentName), filePath(filePath), tags(tags), keySource(keySource), storage(storage) {}
+
+void AddAttachmentCommand::execute() {
+    std::ifstream file = openAttachmentFile(filePath);
+
+    std::cout << "Adding attachment \"" << attachmentName << "\"" << std::endl;
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
+    Vault vault = storage.loadVault(vaultName, masterPassword);
+
+    if (vault.entryExists(folderName, attachmentName))
+        throw std::runtime_error("An entry with this name already exists");
+
+    // The contents go to the chunk store, the vault only gets the references
+    auto entry = storage.getChunkStore().storeAttachment(file, fs::path(filePath).filename().string());
+    stampNewEntry(*entry, tags);
+    vault.addEntry(folderName, attachmentName, std::move(entry));
+
+    storage.saveVault(vault, masterPassword);
+}
+
+
 // --- SHOW (ALL VAULTS) ---
-ShowCommand::ShowCommand(Storage &storage) : storage(storage) {}
+ShowCommand::ShowCommand(OutputFormat format, Storage &storage) : format(format), storage(storage) {}
 
 void ShowCommand::execute() {
     std::vector<std::string> vaultNames = storage.getAllVaultNames();
+    OutputWriter out(std::cout);
 
-    if (vaultNames.empty()) {
-        std::cout << "No vaults found" << std::endl;
-        return;
-    }
+    if (vaultNames.empty() && format == OutputFormat::TEXT)
+        out << "No vaults found\n";
 
     for (const std::string& name : vaultNames) {
-        std::cout << name << std::endl;
+        if (format == OutputFormat::JSON) {
+            out << "{\"vault\":";
+            out.json(name) << "}\n";
+        } else {
+            out << name << '\n';
+        }
     }
+    out.finish();
 }
 
 
 // --- SHOW VAULT ---
-ShowVaultCommand::ShowVaultCommand(std::string vaultName, Storage &storage) : vaultName(vaultName), storage(storage) {}
+ShowVaultCommand::ShowVaultCommand(std::string vaultName, OutputFormat format, KeySource &keySource, Storage &storage) : vaultName(vaultName), format(format), keySource(keySource), storage(storage) {}
 
 void ShowVaultCommand::execute() {
     if (!storage.vaultExists(vaultName))
         throw std::runtime_error("Vault doesn't exist");
 
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
-    Vault vault = storage.loadVault(vaultName, masterPassword);
-
-    std::vector<const Folder*> folders = vault.getAllFolders();
-    for (int i = 0; i < folders.size(); i++) {
-        const Folder* folder = folders.at(i);
-        std::cout << "/" << folder->getName() << std::endl;
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    VaultView vault = storage.loadVaultView(vaultName, masterPassword);
+    OutputWriter out(std::cout);
 
-        std::vector<std::string> entriesNames = folder->getEntryNames();
-        for (int j = 0; j < entriesNames.size(); j++) {
-            std::cout << "  " << entriesNames.at(j) << std::endl;
-        }
+    for (const std::string& folderName : vault.getFolderNames()) {
+        printFolderListing(out, folderName, folderEntries(vault, folderName), format);
     }
+    out.finish();
 }
 
 
 // --- SHOW FOLDER ---
-ShowFolderCommand::ShowFolderCommand(std::string vaultName, std::string folderName, Storage &storage) : vaultName(vaultName), folderName(folderName), storage(storage) {}
+ShowFolderCommand::ShowFolderCommand(std::string vaultName, std::string folderName, OutputFormat format, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), format(format), keySource(keySource), storage(storage) {}
 
 void ShowFolderCommand::execute() {
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
-    Vault vault = storage.loadVault(vaultName, masterPassword);
-    const Folder& folder = vault.getFolder(folderName);
-    std::vector<std::string> entriesNames = folder.getEntryNames();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    VaultView vault = storage.loadVaultView(vaultName, masterPassword);
+    std::vector<std::string> entriesNames = vault.getEntryNames(folderName);
+    OutputWriter out(std::cout);
 
-    for (int i = 0; i < entriesNames.size(); i++) {
+    for (size_t i = 0; i < entriesNames.size(); i++) {
         std::string entryName = entriesNames.at(i);
-        EntryType entryType = folder.getEntry(entryName).getType();
-
-        std::string type;
-        switch (entryType) {
-            case EntryType::CREDENTIAL: {
-                type = "credential";
-                break;
-            }
-            case EntryType::NOTE: {
-                type = "note";
-                break;
-            }
-        }
-
-        std::cout << entryName << " (" << type << ")" << std::endl;
+        // The type is known from the index, so no entry has to be materialized here
+        printEntryLine(out, entryName, vault.getEntryType(folderName, entryName), format);
     }
+    out.finish();
 }
 
 
 // --- SHOW ENTRY ---
-ShowEntryCommand::ShowEntryCommand(std::string vaultName, std::string folderName, std::string entryName, Storage &storage) :
-    vaultName(vaultName), folderName(folderName), entryName(entryName), storage(storage) {}
+ShowEntryCommand::ShowEntryCommand(std::string vaultName, std::string folderName, std::string entryName, size_t revision, std::string extractPath, OutputFormat format,
+                                   bool recordUse, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), revision(revision), extractPath(extractPath), format(format), recordUse(recordUse),
+    keySource(keySource), storage(storage) {}
 
 void ShowEntryCommand::execute() {
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
-    Vault vault = storage.loadVault(vaultName, masterPassword);
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    VaultView vault = storage.loadVaultView(vaultName, masterPassword);
+
+    // Only this entry gets materialized (and its history decoded only if a revision is requested)
+    const Entry* shown = &vault.getEntry(folderName, entryName);
+    std::vector<Revision> revisions;
+    if (revision > 0) {
+        revisions = shown->getHistory().getRevisions(*shown);
+        if (revision > revisions.size())
+            throw std::runtime_error("Entry has no revision " + std::to_string(revision));
+        shown = revisions.at(revision - 1).entry.get();
+    }
 
-    Entry& entry = vault.getEntry(folderName, entryName);
-    switch (entry.getType()) {
-        case EntryType::CREDENTIAL: {
-            auto credential = dynamic_cast<CredentialEntry&>(entry);
-            std::cout << "Username: " << credential.getUsername() << std::endl;
-            std::cout << "Password: " << credential.getPassword() << std::endl;
-            break;
+    const Entry& entry = *shown;
+    if (!extractPath.empty() && entry.getType() != EntryType::ATTACHMENT)
+        throw std::runtime_error("Only attachments can be extracted");
+
+    OutputWriter out(std::cout);
+    bool asJson = format == OutputFormat::JSON;
+    if (asJson)
+        out << '{';
+    printEntryValue(out, entry, format);
+    if (!extractPath.empty()) {
+        extractAttachment(dynamic_cast<const AttachmentEntry&>(entry), extractPath, storage);
+        if (asJson) {
+            out << ",\"extracted\":";
+            out.json(extractPath);
+        } else {
+            out << "Written to " << extractPath << '\n';
         }
-        case EntryType::NOTE: {
-            auto note = dynamic_cast<NoteEntry&>(entry);
-            std::cout << note.getNoteText() << std::endl;
-            break;
+    }
+    if (asJson)
+        out << "}\n";
+    out.finish();
+
+    if (!recordUse)
+        return;
+    EntryMetadata metadata = vault.getEntryMetadata(folderName, entryName);
+    if (revision == 0 && metadata.markUsed())
+        saveLastUsed(storage, vaultName, masterPassword, {{{folderName, entryName}, metadata.lastUsed}});
+}
+
+
+// --- SHOW MATCHES ---
+ShowMatchesCommand::ShowMatchesCommand(std::string vaultName, std::string folderPattern, std::string entryPattern, OutputFormat format, bool recordUse,
+                                       KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderPattern(folderPattern), entryPattern(entryPattern), format(format), recordUse(recordUse), keySource(keySource), storage(storage) {}
+
+void ShowMatchesCommand::execute() {
+    if (!storage.vaultExists(vaultName))
+        throw std::runtime_error("Vault doesn't exist");
+
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    VaultView vault = storage.loadVaultView(vaultName, masterPassword);
+    OutputWriter out(std::cout);
+
+    if (entryPattern.empty()) {
+        std::vector<std::string> folderNames = matchFolders(vault, folderPattern);
+        if (folderNames.empty())
+            throw std::runtime_error("No folder matches " + folderPattern);
+
+        // Same lines as ShowVaultCommand, only for the matching folders
+        for (const std::string& folderName : folderNames) {
+            printFolderListing(out, folderName, folderEntries(vault, folderName), format);
         }
+        out.finish();
+        return;
+    }
+
+    std::vector<EntryPath> matches = matchEntries(vault, folderPattern, entryPattern);
+    if (matches.empty())
+        throw std::runtime_error("No entry matches " + folderPattern + "/" + entryPattern);
+
+    std::vector<std::pair<EntryPath, int64_t>> used;
+    for (const EntryPath& path : matches) {
+        printMatchedEntry(out, path, vault.getEntry(path.folder, path.entry), format);
+
+        EntryMetadata metadata = vault.getEntryMetadata(path.folder, path.entry);
+        if (recordUse && metadata.markUsed())
+            used.emplace_back(path, metadata.lastUsed);
     }
+    out.finish();
+
+    // One save for all the shown entries
+    saveLastUsed(storage, vaultName, masterPassword, used);
 }
 
 
 // --- UPDATE VAULT ---
-UpdateVaultCommand::UpdateVaultCommand(std::string vaultName, Storage &storage) : vaultName(vaultName), storage(storage) {}
+UpdateVaultCommand::UpdateVaultCommand(std::string vaultName, KeySource &newPasswordSource, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), newPasswordSource(newPasswordSource), keySource(keySource), storage(storage) {}
 
 void UpdateVaultCommand::execute() {
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
-    Vault vault = storage.loadVault(vaultName, masterPassword);
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
 
     std::string newVaultName;
     std::cout << "New vault name: ";
     std::getline(std::cin, newVaultName);
-    vault.setName(newVaultName);
 
     std::cout << "New ";
-    Botan::secure_vector<char> newMasterPassword = getMasterPassword();
+    Botan::secure_vector<char> newMasterPassword = newPasswordSource.getPassword(newVaultName);
+
+    // Both names, so nothing else can create the new one meanwhile
+    auto vaultLocks = lockVaults(storage, vaultName, newVaultName);
+    storage.checkNoPendingMove(vaultName);
+    if (newVaultName != vaultName && storage.vaultExists(newVaultName))
+        throw std::runtime_error("Vault " + newVaultName + " already exists");
+    Vault vault = storage.loadVault(vaultName, masterPassword);
+    vault.setName(newVaultName);
 
     storage.saveVault(vault, newMasterPassword);
-    storage.deleteVault(vaultName);
+    if (newVaultName != vaultName)
+        storage.deleteVault(vaultName);
 }
 
 
 // --- UPDATE FOLDER ---
-UpdateFolderCommand::UpdateFolderCommand(std::string vaultName, std::string folderName, Storage &storage) :
-    vaultName(vaultName), folderName(folderName), storage(storage) {}
+UpdateFolderCommand::UpdateFolderCommand(std::string vaultName, std::string folderName, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), keySource(keySource), storage(storage) {}
 
 void UpdateFolderCommand::execute() {
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
     Vault vault = storage.loadVault(vaultName, masterPassword);
 
     if (!vault.folderExists(folderName))
@@ -269,16 +627,30 @@ void UpdateFolderCommand::execute() {
 
 
 // --- UPDATE ENTRY ---
-UpdateEntryCommand::UpdateEntryCommand(std::string vaultName, std::string folderName, std::string entryName, Storage &storage) :
-    vaultName(vaultName), folderName(folderName), entryName(entryName), storage(storage) {}
+UpdateEntryCommand::UpdateEntryCommand(std::string vaultName, std::string folderName, std::string entryName, std::vector<std::string> addTags, std::vector<std::string> removeTags, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), addTags(addTags), removeTags(removeTags), keySource(keySource), storage(storage) {}
 
 void UpdateEntryCommand::execute() {
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
     Vault vault = storage.loadVault(vaultName, masterPassword);
 
     if (!vault.entryExists(folderName, entryName))
         throw std::runtime_error("Entry does not exist");
 
+    // Tags are not part of the value, changing them doesn't make a revision or count as a modification
+    if (!addTags.empty() || !removeTags.empty()) {
+        EntryMetadata& metadata = vault.getEntry(folderName, entryName).getMetadata();
+        for (const std::string& tag : removeTags) {
+            metadata.removeTag(tag);
+        }
+        for (const std::string& tag : addTags) {
+            metadata.addTag(tag);
+        }
+        storage.saveVault(vault, masterPassword);
+        return;
+    }
+
     std::string newEntryName;
     std::cout << "New entry name: ";
     std::getline(std::cin, newEntryName);
@@ -288,45 +660,61 @@ void UpdateEntryCommand::execute() {
     }
 
     Folder& folder = vault.getFolder(folderName);
-    Entry& entry = folder.getEntry(entryName);
+    std::unique_ptr<Entry> newEntry = readNewValue(folder.getEntry(entryName).getType(), storage);
+    folder.replaceEntry(entryName, newEntryName, std::move(newEntry), vault.historyRetention);
+    storage.saveVault(vault, masterPassword);
+}
 
-    switch (entry.getType()) {
-        case EntryType::CREDENTIAL: {
-            std::string username;
-            std::cout << "New username: ";
-            std::getline(std::cin, username);
 
-            std::string password;
-            std::cout << "New password: ";
-            std::getline(std::cin, password);
+// --- UPDATE MATCHES ---
+UpdateMatchesCommand::UpdateMatchesCommand(std::string vaultName, std::string folderPattern, std::string entryPattern, std::vector<std::string> addTags, std::vector<std::string> removeTags, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderPattern(folderPattern), entryPattern(entryPattern), addTags(addTags), removeTags(removeTags), keySource(keySource), storage(storage) {}
 
-            auto entry = std::make_unique<CredentialEntry>(username, password);
-            folder.addEntry(std::move(entry), newEntryName);
-            folder.deleteEntry(entryName);
-            break;
-        }
-        case EntryType::NOTE: {
-            std::string text;
-            std::cout << "New note contents: ";
-            std::getline(std::cin, text);
+void UpdateMatchesCommand::execute() {
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
+    Vault vault = storage.loadVault(vaultName, masterPassword);
 
-            auto entry = std::make_unique<NoteEntry>(text);
-            folder.addEntry(std::move(entry), newEntryName);
-            folder.deleteEntry(entryName);
-            break;
+    std::vector<EntryPath> matches = matchEntries(vault, folderPattern, entryPattern);
+    if (matches.empty())
+        throw std::runtime_error("No entry matches " + folderPattern + "/" + entryPattern);
+
+    bool tagsOnly = !addTags.empty() || !removeTags.empty();
+    std::cout << "Matching entries:\n";
+    previewMatches(matches);
+    std::string question = tagsOnly ? "Change the tags of " : "Enter new values for ";
+    bool confirmed = askForConfirmation(question + std::to_string(matches.size()) + " entries?");
+    if (!confirmed) return;
+
+    for (const EntryPath& path : matches) {
+        if (tagsOnly) {
+            EntryMetadata& metadata = vault.getEntry(path.folder, path.entry).getMetadata();
+            for (const std::string& tag : removeTags) {
+                metadata.removeTag(tag);
+            }
+            for (const std::string& tag : addTags) {
+                metadata.addTag(tag);
+            }
+            continue;
         }
-    }
 
+        // Entries keep their names, renaming many entries at once has no sensible prompt
+        std::cout << path.folder << '/' << path.entry << ":\n";
+        Folder& folder = vault.getFolder(path.folder);
+        std::unique_ptr<Entry> newEntry = readNewValue(folder.getEntry(path.entry).getType(), storage);
+        folder.replaceEntry(path.entry, path.entry, std::move(newEntry), vault.historyRetention);
+    }
     storage.saveVault(vault, masterPassword);
 }
 
 
 // --- DELETE VAULT ---
-DeleteVaultCommand::DeleteVaultCommand(std::string vaultName, Storage &storage) : vaultName(vaultName), storage(storage) {}
+DeleteVaultCommand::DeleteVaultCommand(std::string vaultName, KeySource &keySource, Storage &storage) : vaultName(vaultName), keySource(keySource), storage(storage) {}
 
 void DeleteVaultCommand::execute() {
     // Let's pretend that only an authenticated user can delete the vault (even though the vaults are just JSON files stored on disk)
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
     Vault vault = storage.loadVault(vaultName, masterPassword);
 
     bool confirmed = askForConfirmation("Are you sure you want to delete vault '" + vaultName + "' and all of its content?");
@@ -337,11 +725,12 @@ void DeleteVaultCommand::execute() {
 
 
 // --- DELETE FOLDER ---
-DeleteFolderCommand::DeleteFolderCommand(std::string vaultName, std::string folderName, Storage &storage) :
-    vaultName(vaultName), folderName(folderName), storage(storage) {}
+DeleteFolderCommand::DeleteFolderCommand(std::string vaultName, std::string folderName, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), keySource(keySource), storage(storage) {}
 
 void DeleteFolderCommand::execute() {
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
     Vault vault = storage.loadVault(vaultName, masterPassword);
 
     if (!vault.folderExists(folderName))
@@ -356,11 +745,12 @@ void DeleteFolderCommand::execute() {
 
 
 // --- DELETE ENTRY ---
-DeleteEntryCommand::DeleteEntryCommand(std::string vaultName, std::string folderName, std::string entryName, Storage &storage) :
-    vaultName(vaultName), folderName(folderName), entryName(entryName), storage(storage) {}
+DeleteEntryCommand::DeleteEntryCommand(std::string vaultName, std::string folderName, std::string entryName, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), keySource(keySource), storage(storage) {}
 
 void DeleteEntryCommand::execute() {
-    Botan::secure_vector<char> masterPassword = getMasterPassword();
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
     Vault vault = storage.loadVault(vaultName, masterPassword);
 
     Folder& folder = vault.getFolder(folderName);
@@ -372,4 +762,627 @@ void DeleteEntryCommand::execute() {
 
     folder.deleteEntry(entryName);
     storage.saveVault(vault, masterPassword);
-}
\ No newline at end of file
+}
+
+// --- DELETE MATCHES ---
+DeleteMatchesCommand::DeleteMatchesCommand(std::string vaultName, std::string folderPattern, std::string entryPattern, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderPattern(folderPattern), entryPattern(entryPattern), keySource(keySource), storage(storage) {}
+
+void DeleteMatchesCommand::execute() {
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
+    Vault vault = storage.loadVault(vaultName, masterPassword);
+
+    if (entryPattern.empty()) {
+        std::vector<std::string> folderNames = matchFolders(vault, folderPattern);
+        if (folderNames.empty())
+            throw std::runtime_error("No folder matches " + folderPattern);
+
+        std::cout << "Matching folders:\n";
+        for (const std::string& folderName : folderNames) {
+            std::cout << "  " << folderName << " (" << vault.getFolder(folderName).getEntryNames().size() << " entries)\n";
+        }
+        bool confirmed = askForConfirmation("Are you sure you want to delete " + std::to_string(folderNames.size()) + " folders and all of their content?");
+        if (!confirmed) return;
+
+        for (const std::string& folderName : folderNames) {
+            vault.deleteFolder(folderName);
+        }
+        storage.saveVault(vault, masterPassword);
+        return;
+    }
+
+    std::vector<EntryPath> matches = matchEntries(vault, folderPattern, entryPattern);
+    if (matches.empty())
+        throw std::runtime_error("No entry matches " + folderPattern + "/" + entryPattern);
+
+    std::cout << "Matching entries:\n";
+    previewMatches(matches);
+    bool confirmed = askForConfirmation("Are you sure you want to delete " + std::to_string(matches.size()) + " entries?");
+    if (!confirmed) return;
+
+    for (const EntryPath& path : matches) {
+        vault.getFolder(path.folder).deleteEntry(path.entry);
+    }
+    storage.saveVault(vault, masterPassword);
+}
+
+// --- HISTORY ---
+HistoryCommand::HistoryCommand(std::string vaultName, std::string folderName, std::string entryName, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), keySource(keySource), storage(storage) {}
+
+void HistoryCommand::execute() {
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    VaultView vault = storage.loadVaultView(vaultName, masterPassword);
+
+    const Entry& entry = vault.getEntry(folderName, entryName);
+    std::vector<Revision> revisions = entry.getHistory().getRevisions(entry);
+    if (revisions.empty()) {
+        std::cout << "No previous revisions" << std::endl;
+        return;
+    }
+
+    // Only when each value was replaced is listed, use show --revision to see one
+    for (size_t i = 0; i < revisions.size(); i++) {
+        std::cout << i + 1 << "  " << formatTime(revisions[i].time) << "  " << entryTypeName(revisions[i].entry->getType()) << std::endl;
+    }
+}
+
+
+// --- RESTORE REVISION ---
+RestoreRevisionCommand::RestoreRevisionCommand(std::string vaultName, std::string folderName, std::string entryName, size_t revision, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), revision(revision), keySource(keySource), storage(storage) {}
+
+void RestoreRevisionCommand::execute() {
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
+    Vault vault = storage.loadVault(vaultName, masterPassword);
+
+    if (!vault.entryExists(folderName, entryName))
+        throw std::runtime_error("Entry does not exist");
+
+    Folder& folder = vault.getFolder(folderName);
+    const Entry& entry = folder.getEntry(entryName);
+    std::vector<Revision> revisions = entry.getHistory().getRevisions(entry);
+    if (revision == 0 || revision > revisions.size())
+        throw std::runtime_error("Entry has no revision " + std::to_string(revision));
+
+    // The current value is kept as a revision as well, so restoring can be undone the same way
+    folder.replaceEntry(entryName, entryName, std::move(revisions.at(revision - 1).entry), vault.historyRetention);
+    storage.saveVault(vault, masterPassword);
+    std::cout << "Restored revision " << revision << " of \"" << entryName << "\"" << std::endl;
+}
+
+
+// --- SET HISTORY RETENTION ---
+SetHistoryRetentionCommand::SetHistoryRetentionCommand(std::string vaultName, size_t retention, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), retention(retention), keySource(keySource), storage(storage) {}
+
+void SetHistoryRetentionCommand::execute() {
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
+    Vault vault = storage.loadVault(vaultName, masterPassword);
+
+    vault.historyRetention = retention;
+    for (const std::string& folderName : vault.getFolderNames()) {
+        Folder& folder = vault.getFolder(folderName);
+        for (const std::string& entryName : folder.getEntryNames()) {
+            folder.getEntry(entryName).getHistory().truncate(retention);
+        }
+    }
+
+    storage.saveVault(vault, masterPassword);
+    std::cout << "Keeping " << retention << " revisions per entry in \"" << vaultName << "\"" << std::endl;
+}
+
+
+// --- CALIBRATE ---
+void CalibrateCommand::execute() {
+    std::cout << "Measuring encryption throughput..." << std::endl;
+    for (const AlgorithmThroughput& result : measureAlgorithms(16 * 1024 * 1024)) {
+        std::cout << result.algorithm << ": " << static_cast<long long>(result.bytesPerSecond / 1e6) << " MB/s" << std::endl;
+    }
+    std::cout << "New vaults use " << preferredAlgorithm() << std::endl;
+}
+
+
+// --- LIST ---
+ListCommand::ListCommand(std::string vaultName, std::string folderName, EntryFilter filter, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), filter(std::move(filter)), keySource(keySource), storage(storage) {
+    this->filter.folder = folderName;
+}
+
+void ListCommand::execute() {
+    if (!storage.vaultExists(vaultName))
+        throw std::runtime_error("Vault doesn't exist");
+
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    VaultView vault = storage.loadVaultView(vaultName, masterPassword);
+    if (!folderName.empty() && !vault.folderExists(folderName))
+        throw std::runtime_error("Folder doesn't exist");
+
+    EntryIndex index(vault);
+    std::vector<EntryPath> matches = index.query(filter);
+    if (matches.empty()) {
+        std::cout << "No matching entries" << std::endl;
+        return;
+    }
+
+    for (const EntryPath& path : matches) {
+        const EntryMetadata& metadata = index.getMetadata(path);
+        std::cout << path.folder << "/" << path.entry
+                  << "  " << entryTypeName(vault.getEntryType(path.folder, path.entry))
+                  << "  modified " << formatTimestamp(metadata.modified, "unknown")
+                  << "  used " << formatTimestamp(metadata.lastUsed, "never");
+        for (const std::string& tag : metadata.tags) {
+            std::cout << "  #" << tag;
+        }
+        std::cout << std::endl;
+    }
+}
+
+
+// --- AUDIT ---
+AuditCommand::AuditCommand(std::vector<std::string> vaultNames, std::string breachDatabasePath, storage::BreachHash breachHash, KeySource &keySource, Storage &storage)
+    : vaultNames(vaultNames), breachDatabasePath(breachDatabasePath), breachHash(breachHash), keySource(keySource), storage(storage) {}
+
+void AuditCommand::execute() {
+    if (vaultNames.empty())
+        vaultNames = storage.getAllVaultNames();
+    if (vaultNames.empty()) {
+        std::cout << "No vaults found" << std::endl;
+        return;
+    }
+
+    // The corpus is opened first, a wrong path shouldn't cost any master passwords
+    std::unique_ptr<storage::BreachDatabase> breachDatabase;
+    if (!breachDatabasePath.empty())
+        breachDatabase = std::make_unique<storage::BreachDatabase>(breachDatabasePath, breachHash);
+
+    // Passwords are asked for up front, then the vaults are decrypted (and key derivation run) concurrently
+    std::vector<Botan::secure_vector<char>> masterPasswords;
+    for (const std::string& vaultName : vaultNames) {
+        if (!storage.vaultExists(vaultName))
+            throw std::runtime_error("Vault doesn't exist: " + vaultName);
+        std::cout << "Vault \"" << vaultName << "\"" << std::endl;
+        masterPasswords.push_back(keySource.getPassword(vaultName));
+    }
+
+    PasswordAudit audit;
+    using Inspected = std::vector<std::pair<CredentialPath, PasswordReport>>;
+    std::vector<std::future<Inspected>> results;
+    for (size_t i = 0; i < vaultNames.size(); i++) {
+        results.push_back(std::async(std::launch::async, [&, i]() {
+            VaultView vault = storage.loadVaultView(vaultNames[i], masterPasswords[i]);
+            Inspected inspected;
+            std::vector<SecureBuffer> digests;
+            vault.forEachEntry(EntryType::CREDENTIAL, [&](const std::string& folderName, const std::string& entryName, const Entry& entry) {
+                const auto& credential = dynamic_cast<const CredentialEntry&>(entry);
+                inspected.emplace_back(CredentialPath{vaultNames[i], folderName, entryName}, audit.inspect(credential.getPassword()));
+                if (breachDatabase)
+                    digests.push_back(breachDatabase->digest(credential.getPassword()));
+            });
+            // One batch per vault, looked up in hash order
+            if (breachDatabase) {
+                std::vector<uint64_t> breaches = breachDatabase->lookup(digests);
+                for (size_t j = 0; j < inspected.size(); j++) {
+                    inspected[j].second.breaches = breaches[j];
+                }
+            }
+            return inspected;
+        }));
+    }
+
+    size_t audited = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        try {
+            for (auto& [credential, report] : results[i].get()) {
+                audit.add(std::move(credential), report);
+            }
+            audited++;
+        } catch (const std::exception& e) {
+            std::cerr << "Vault \"" << vaultNames[i] << "\" was not audited: " << e.what() << std::endl;
+        }
+    }
+
+    auto formatPath = [](const CredentialPath& path) {
+        return path.vault + "/" + path.folder + "/" + path.entry;
+    };
+
+    std::cout << "Audited " << audit.size() << " credentials in " << audited << " vaults" << std::endl;
+
+    std::vector<std::vector<CredentialPath>> reused = audit.reusedPasswords();
+    std::cout << "Reused passwords: " << reused.size() << std::endl;
+    for (const auto& group : reused) {
+        std::cout << "  shared by " << group.size() << " entries:";
+        for (const CredentialPath& path : group) {
+            std::cout << " " << formatPath(path);
+        }
+        std::cout << std::endl;
+    }
+
+    std::vector<WeakPassword> weak = audit.weakPasswords();
+    std::cout << "Weak passwords: " << weak.size() << std::endl;
+    for (const WeakPassword& password : weak) {
+        std::cout << "  " << formatPath(password.credential) << "  ~" << static_cast<int>(password.strength.bits)
+                  << " bits (" << password.strength.weakness << ")" << std::endl;
+    }
+
+    if (breachDatabase) {
+        std::vector<BreachedPassword> breached = audit.breachedPasswords();
+        std::cout << "Breached passwords: " << breached.size() << std::endl;
+        for (const BreachedPassword& password : breached) {
+            std::cout << "  " << formatPath(password.credential) << "  seen " << password.breaches
+                      << (password.breaches == 1 ? " time" : " times") << std::endl;
+        }
+    }
+}
+
+
+// --- IMPORT ---
+ImportCommand::ImportCommand(std::string vaultName, std::string folderName, std::string filePath, std::string format, std::string conflictPolicy, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), filePath(filePath), format(format), conflictPolicy(conflictPolicy), keySource(keySource), storage(storage) {}
+
+void ImportCommand::execute() {
+    // Arguments are checked before asking for the master password
+    ImportFormat importFormat = format.empty() ? guessImportFormat(filePath) : parseImportFormat(format);
+    ConflictPolicy policy = parseConflictPolicy(conflictPolicy);
+    std::ifstream input(filePath, std::ios::binary);
+    if (!input)
+        throw std::runtime_error("Failed to open file: " + filePath);
+    if (!storage.vaultExists(vaultName))
+        throw std::runtime_error("Vault doesn't exist");
+
+    std::cout << "Importing \"" << filePath << "\" into \"" << vaultName << "\"" << std::endl;
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    auto vaultLock = storage.lockVault(vaultName);
+    Vault vault = storage.loadVault(vaultName, masterPassword);
+
+    // Nothing is saved unless the whole file imports
+    auto started = std::chrono::steady_clock::now();
+    VaultImporter importer(vault, policy, folderName.empty() ? defaultImportFolder : folderName, !folderName.empty());
+    uint64_t bytes = readImportRecords(input, importFormat, [&importer](ImportedRecord& record) {
+        importer.add(record);
+    });
+    auto imported = std::chrono::steady_clock::now();
+    storage.saveVault(vault, masterPassword);
+    auto saved = std::chrono::steady_clock::now();
+
+    const ImportStats& stats = importer.getStats();
+    size_t entries = stats.added + stats.overwritten + stats.renamed;
+    double readSeconds = std::chrono::duration<double>(imported - started).count();
+    double saveSeconds = std::chrono::duration<double>(saved - imported).count();
+    std::cout << "Imported " << entries << " entries (" << stats.added << " added, " << stats.overwritten << " overwritten, "
+              << stats.renamed << " renamed, " << stats.skipped << " skipped)" << std::endl;
+    std::cout << "Read " << bytes / 1024 << " KiB in " << static_cast<long long>(readSeconds * 1000) << " ms ("
+              << static_cast<long long>((entries + stats.skipped) / std::max(readSeconds, 1e-6)) << " entries/s), saved in "
+              << static_cast<long long>(saveSeconds * 1000) << " ms" << std::endl;
+}
+
+
+// --- AGENT ---
+namespace {
+    // The agent the signal handler stops (only async-signal-safe work is done there)
+    agent::Agent* runningAgent = nullptr;
+
+    void stopRunningAgent(int) {
+        if (runningAgent)
+            runningAgent->stop();
+    }
+}
+
+AgentCommand::AgentCommand(std::vector<std::string> vaultNames, agent::GroupCommit groupCommit, KeySource &keySource, Storage &storage) :
+    vaultNames(vaultNames), groupCommit(groupCommit), keySource(keySource), storage(storage) {}
+
+void AgentCommand::execute() {
+    agent::Agent server(agent::defaultAgentSocketPath(), &storage, groupCommit);
+    for (const std::string& vaultName : vaultNames) {
+        if (!storage.vaultExists(vaultName))
+            throw std::runtime_error("Vault " + vaultName + " doesn't exist");
+        if (vaultNames.size() > 1)
+            std::cerr << "Unlocking vault " << vaultName << std::endl;
+        Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+        // Taken before loading, a change made meanwhile is loaded again once the agent runs
+        uint64_t generation = storage.vaultGeneration(vaultName);
+        Vault vault = storage.loadVault(vaultName, masterPassword);
+        server.addVault(std::move(vault), std::move(masterPassword), generation);
+    }
+    server.listen();
+
+    // The agent holds every secret of its vaults: no core dumps, and no debugger attaching as the same user
+    prctl(PR_SET_DUMPABLE, 0);
+
+    struct sigaction action{};
+    action.sa_handler = stopRunningAgent;
+    sigemptyset(&action.sa_mask);
+    runningAgent = &server;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cerr << "Agent listening on " << agent::defaultAgentSocketPath() << " (stop it with Ctrl+C or SIGTERM)" << std::endl;
+    server.run();
+    runningAgent = nullptr;
+}
+
+
+// --- AGENT SHOW ---
+AgentShowCommand::AgentShowCommand(std::string vaultName, std::string folderName, std::string entryName, OutputFormat format, std::string socketPath) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), format(format), socketPath(socketPath) {}
+
+void AgentShowCommand::execute() {
+    agent::AgentClient client(socketPath);
+    bool pattern = isPathPattern(folderName) || isPathPattern(entryName);
+    OutputWriter out(std::cout);
+
+    if (entryName.empty()) {
+        // Records come sorted by folder, an empty folder as a record without an entry
+        std::vector<std::pair<std::string, std::vector<std::pair<std::string, EntryType>>>> folders;
+        agent::FieldReader reader = client.request(agent::Opcode::LIST, {vaultName, folderName.empty() ? "*" : folderName, ""});
+        while (!reader.atEnd()) {
+            std::string_view folder = reader.readField();
+            std::string_view entry = reader.readField();
+            auto type = static_cast<EntryType>(reader.readByte());
+            if (folders.empty() || folders.back().first != folder)
+                folders.emplace_back(std::string(folder), std::vector<std::pair<std::string, EntryType>>{});
+            if (!entry.empty())
+                folders.back().second.emplace_back(std::string(entry), type);
+        }
+
+        if (!folderName.empty() && !pattern) {
+            // Like ShowFolderCommand
+            for (const auto& [entry, type] : folders.at(0).second) {
+                printEntryLine(out, entry, type, format);
+            }
+        } else {
+            if (pattern && folders.empty())
+                throw std::runtime_error("No folder matches " + folderName);
+            for (const auto& [folder, entries] : folders) {
+                printFolderListing(out, folder, entries, format);
+            }
+        }
+        out.finish();
+        return;
+    }
+
+    agent::FieldReader reader = client.request(agent::Opcode::SHOW, {vaultName, folderName, entryName});
+    if (pattern && reader.atEnd())
+        throw std::runtime_error("No entry matches " + folderName + "/" + entryName);
+    while (!reader.atEnd()) {
+        EntryPath path{std::string(reader.readField()), std::string(reader.readField())};
+        auto type = static_cast<EntryType>(reader.readByte());
+        std::unique_ptr<Entry> entry = materializeEntry(reader.readField(), type);
+
+        if (pattern) {
+            printMatchedEntry(out, path, *entry, format);
+        } else if (format == OutputFormat::JSON) {
+            // Like ShowEntryCommand
+            out << '{';
+            printEntryValue(out, *entry, format);
+            out << "}\n";
+        } else {
+            printEntryValue(out, *entry, format);
+        }
+    }
+    out.finish();
+}
+
+
+// --- AGENT ADD ENTRY ---
+AgentAddEntryCommand::AgentAddEntryCommand(std::string vaultName, std::string folderName, std::string entryName, EntryType type, std::vector<std::string> tags, std::string socketPath) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), type(type), tags(tags), socketPath(socketPath) {}
+
+void AgentAddEntryCommand::execute() {
+    std::cout << "Adding " << (type == EntryType::CREDENTIAL ? "credential" : "note") << " \"" << entryName << "\"" << std::endl;
+    agent::AgentClient client(socketPath);
+
+    std::unique_ptr<Entry> entry = readEntryValue(type);
+    stampNewEntry(*entry, tags);
+
+    // The object the vault file stores, with the metadata
+    SecureBuffer object(1, '{');
+    appendEntryMembers(object, *entry, nullptr, &entry->getMetadata(), {});
+    object.push_back('}');
+    char typeByte = static_cast<char>(type);
+    client.request(agent::Opcode::ADD_ENTRY, {vaultName, folderName, entryName, {&typeByte, 1},
+        {reinterpret_cast<const char*>(object.data()), object.size()}});
+}
+
+
+// --- AGENT DELETE ENTRY ---
+AgentDeleteEntryCommand::AgentDeleteEntryCommand(std::string vaultName, std::string folderName, std::string entryName, std::string socketPath) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), socketPath(socketPath) {}
+
+void AgentDeleteEntryCommand::execute() {
+    agent::AgentClient client(socketPath);
+    // Throws if the entry doesn't exist, before anything is asked
+    client.request(agent::Opcode::LIST, {vaultName, folderName, entryName});
+
+    bool confirmed = askForConfirmation("Are you sure you want to delete entry '" + entryName + "'?");
+    if (!confirmed) return;
+
+    client.request(agent::Opcode::DELETE_ENTRY, {vaultName, folderName, entryName});
+}
+
+
+// --- TRANSFER ---
+TransferCommand::TransferCommand(std::string vaultName, std::string folderName, std::string entryName, std::string targetVaultName,
+                                 std::string targetFolderName, std::string targetEntryName, bool move, bool recoverOnly, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), entryName(entryName), targetVaultName(targetVaultName), targetFolderName(targetFolderName),
+    targetEntryName(targetEntryName), move(move), recoverOnly(recoverOnly), keySource(keySource), storage(storage) {}
+
+void TransferCommand::execute() {
+    if (!storage.vaultExists(vaultName))
+        throw std::runtime_error("Vault doesn't exist");
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+
+    if (recoverOnly) {
+        if (!finishInterruptedMove(masterPassword, nullptr))
+            std::cout << "No interrupted move out of vault " << vaultName << std::endl;
+        return;
+    }
+
+    if (!storage.vaultExists(targetVaultName))
+        throw std::runtime_error("Vault " + targetVaultName + " doesn't exist");
+    bool sameVault = targetVaultName == vaultName;
+    Botan::secure_vector<char> targetPassword;
+    if (!sameVault) {
+        // Tells the two password prompts apart (on stderr, the output stays clean for scripts)
+        std::cerr << "Unlocking vault " << targetVaultName << std::endl;
+        targetPassword = keySource.getPassword(targetVaultName);
+    }
+    if (move)
+        finishInterruptedMove(masterPassword, sameVault ? nullptr : &targetPassword);
+
+    auto vaultLocks = lockVaults(storage, vaultName, targetVaultName);
+    // Before the marker is written, a move can't be left half done because the target refuses the write
+    storage.checkNoPendingMove(targetVaultName);
+    Vault source = storage.loadVault(vaultName, masterPassword);
+    Vault target = sameVault ? Vault("") : storage.loadVault(targetVaultName, targetPassword);
+    Vault& destination = sameVault ? source : target;
+
+    std::vector<TransferPath> paths = planTransfer(source, folderName, entryName, destination, targetFolderName, targetEntryName);
+    applyTransfer(source, destination, paths, move);
+
+    if (sameVault) {
+        // One file, replaced atomically
+        storage.saveVault(source, masterPassword);
+    } else if (!move) {
+        storage.saveVault(target, targetPassword);
+    } else {
+        // Ordered writes: until the marker is removed, the moved paths may be in both vaults but never in neither
+        storage.writeMoveMarker(vaultName, encodeTransferMarker(source, {targetVaultName, paths}, masterPassword));
+        storage.saveVault(target, targetPassword);
+        storage.saveMovingVault(source, masterPassword);
+        storage.removeMoveMarker(vaultName);
+    }
+
+    for (const TransferPath& path : paths) {
+        std::cout << vaultName << '/' << path.from.folder << (path.from.entry.empty() ? "" : "/" + path.from.entry) << " -> "
+                  << targetVaultName << '/' << path.to.folder << (path.to.entry.empty() ? "" : "/" + path.to.entry) << '\n';
+    }
+    std::cout << (move ? "Moved " : "Copied ") << paths.size() << (entryName.empty() ? " folders" : " entries") << std::endl;
+}
+
+bool TransferCommand::finishInterruptedMove(const Botan::secure_vector<char>& masterPassword, const Botan::secure_vector<char>* targetPassword) {
+    std::optional<std::string> marker = storage.readMoveMarker(vaultName);
+    if (!marker)
+        return false;
+
+    // The marker may name another vault than the one this command moves to
+    std::string markerTarget = transferMarkerTarget(*marker);
+    Botan::secure_vector<char> markerTargetPassword;
+    if (targetPassword && markerTarget == targetVaultName) {
+        markerTargetPassword = *targetPassword;
+    } else {
+        std::cout << "Finishing an interrupted move from " << vaultName << " to " << markerTarget << std::endl;
+        std::cerr << "Unlocking vault " << markerTarget << std::endl;
+        markerTargetPassword = keySource.getPassword(markerTarget);
+    }
+
+    auto vaultLocks = lockVaults(storage, vaultName, markerTarget);
+    // Read again under the locks, another process may have finished it meanwhile
+    marker = storage.readMoveMarker(vaultName);
+    if (!marker)
+        return true;
+    TransferMarker decoded = decodeTransferMarker(*marker, masterPassword);
+    if (!storage.vaultExists(markerTarget))
+        throw std::runtime_error("Vault " + markerTarget + " of an interrupted move doesn't exist anymore");
+
+    Vault source = storage.loadVault(vaultName, masterPassword);
+    Vault target = storage.loadVault(markerTarget, markerTargetPassword);
+    // Paths changed in either vault since the copy can't be told apart from the moved ones, they stay in both
+    for (const TransferPath& path : applyTransfer(source, target, decoded.paths, true)) {
+        std::cerr << vaultName << '/' << path.from.folder << (path.from.entry.empty() ? "" : "/" + path.from.entry)
+                  << " differs from " << markerTarget << '/' << path.to.folder << (path.to.entry.empty() ? "" : "/" + path.to.entry)
+                  << ", kept in both vaults" << std::endl;
+    }
+    storage.saveVault(target, markerTargetPassword);
+    storage.saveMovingVault(source, masterPassword);
+    storage.removeMoveMarker(vaultName);
+    std::cout << "Finished the interrupted move of " << decoded.paths.size() << " paths from " << vaultName << " to " << markerTarget << std::endl;
+    return true;
+}
+
+
+// --- EXPORT ---
+ExportCommand::ExportCommand(std::string vaultName, std::string folderName, std::string filePath, std::string format, std::string archivePath,
+    KeySource* archivePasswordSource, KeySource &keySource, Storage &storage) :
+    vaultName(vaultName), folderName(folderName), filePath(filePath), format(format), archivePath(archivePath),
+    archivePasswordSource(archivePasswordSource), keySource(keySource), storage(storage) {}
+
+void ExportCommand::execute() {
+    if (!storage.vaultExists(vaultName))
+        throw std::runtime_error("Vault doesn't exist");
+    if (!archivePath.empty()) {
+        exportArchive();
+        return;
+    }
+    ExportFormat exportFormat = parseExportFormat(format);
+
+    // With the entries going to stdout, everything else goes to stderr
+    std::ostream& status = filePath.empty() ? std::cerr : std::cout;
+    status << "Exporting \"" << vaultName << "\" as plaintext" << std::endl;
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    VaultView vault = storage.loadVaultView(vaultName, masterPassword);
+    if (!folderName.empty() && !vault.folderExists(folderName))
+        throw std::runtime_error("Folder doesn't exist");
+
+    // A partial export is removed if anything below throws
+    std::optional<PrivateFile> file;
+    if (!filePath.empty())
+        file.emplace(filePath);
+    std::ostream& output = file ? file->stream() : std::cout;
+
+    // Entries are materialized one at a time and written out in blocks
+    auto started = std::chrono::steady_clock::now();
+    ExportWriter writer(exportFormat, output);
+    size_t exported = 0, attachments = 0;
+    auto exportEntry = [&](const std::string& folder, const std::string& entryName, const Entry& entry) {
+        if (writer.write(folder, entryName, entry))
+            exported++;
+        else
+            attachments++;
+    };
+    if (folderName.empty())
+        vault.forEachEntry(exportEntry);
+    else
+        vault.forEachEntry(folderName, exportEntry);
+    writer.finish();
+    if (file)
+        file->close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    status << "Exported " << exported << " entries (" << writer.getBytesWritten() / 1024 << " KiB in "
+           << static_cast<long long>(seconds * 1000) << " ms)" << std::endl;
+    if (attachments > 0)
+        status << "Skipped " << attachments << " attachment(s), use --archive to export them" << std::endl;
+}
+
+void ExportCommand::exportArchive() {
+    if (!archivePasswordSource)
+        throw std::runtime_error("No source for the archive password");
+    // The archive has the layout of a vaults directory, a vault copied out of it is restored by copying it back
+    Storage archive(archivePath);
+    if (archive.vaultExists(vaultName))
+        throw std::runtime_error("The archive already holds a vault named \"" + vaultName + "\"");
+
+    std::cout << "Exporting \"" << vaultName << "\" to the archive \"" << archivePath << "\"" << std::endl;
+    Botan::secure_vector<char> masterPassword = keySource.getPassword(vaultName);
+    Vault vault = storage.loadVault(vaultName, masterPassword);
+    std::cout << "Archive password" << std::endl;
+    Botan::secure_vector<char> archivePassword = archivePasswordSource->getPassword(vaultName);
+
+    // Attachment chunks are copied still encrypted, their keys travel inside the re-encrypted vault
+    size_t attachments = 0;
+    for (const Folder* folder : vault.getAllFolders()) {
+        for (const Entry* entry : folder->getAllEntries()) {
+            if (entry->getType() != EntryType::ATTACHMENT)
+                continue;
+            storage.getChunkStore().copyAttachment(dynamic_cast<const AttachmentEntry&>(*entry), archive.getChunkStore());
+            attachments++;
+        }
+    }
+
+    archive.saveVault(vault, archivePassword);
+    std::cout << "Exported the vault with " << attachments << " attachment(s)" << std::endl;
+}
@@ -4,6 +4,8 @@
 
 #include "Controller.h"
 
+#include "agent/AgentProtocol.h"
+
 // Helper function for casting CommandArgs to concrete types
 template<typename Derived, typename Base>
 std::unique_ptr<Derived> unique_cast(std::unique_ptr<Base>&& base) {
@@ -14,76 +16,236 @@ std::unique_ptr<Derived> unique_cast(std::unique_ptr<Base>&& base) {
     throw std::runtime_error("Could not cast args");
 }
 
+// Helper function building the key source the options ask for
+std::unique_ptr<KeySource> makeKeySource(const KeySourceArgs& args) {
+    if (args.agent)
+        return std::make_unique<AgentKeySource>(agent::defaultAgentSocketPath());
+
+    std::unique_ptr<KeySource> passwordSource;
+    if (args.passwordFd)
+        passwordSource = std::make_unique<FdKeySource>(*args.passwordFd);
+    else if (args.keyfile.empty() || args.withPassword)
+        passwordSource = std::make_unique<TerminalKeySource>();
+
+    if (args.keyfile.empty())
+        return passwordSource;
+    return std::make_unique<KeyfileKeySource>(args.keyfile, std::move(passwordSource));
+}
+
+// Helper function building the source of a password the command sets (an archive's, a vault's new one).
+// It can't be the vault's own key source: a keyfile or the agent would hand out the vault's key again,
+// so only the terminal or a descriptor and keyfile of its own will do
+std::unique_ptr<KeySource> makeNewPasswordSource(const KeySourceArgs& args, std::optional<int> fd, const std::string& keyfile, const std::string& options) {
+    std::unique_ptr<KeySource> passwordSource;
+    if (fd)
+        passwordSource = std::make_unique<FdKeySource>(*fd);
+    if (!keyfile.empty())
+        return std::make_unique<KeyfileKeySource>(keyfile, std::move(passwordSource));
+    if (passwordSource)
+        return passwordSource;
+    if (args.agent || args.passwordFd || !args.keyfile.empty())
+        throw std::runtime_error("The new password can't come from --password-fd, --keyfile or --agent (they give the vault's key), use " + options);
+    return std::make_unique<TerminalKeySource>(true);
+}
+
 Controller::Controller(std::unique_ptr<CommandArgs> args, Storage& storageModule) : storage{storageModule} {
+    keySource = makeKeySource(args->keySource);
+    // With --agent, reads the agent can answer itself skip the master password and the decryption altogether,
+    // and so do the writes it makes itself (adding credentials and notes, deleting entries)
+    bool viaAgent = args->keySource.agent;
     switch (args->getType()) {
         case CommandType::ADD_VAULT: {
             auto addVaultArgs = unique_cast<AddVaultCommandArgs>(std::move(args));
-            command = std::make_unique<AddVaultCommand>(addVaultArgs->vault, storage);
+            command = std::make_unique<AddVaultCommand>(addVaultArgs->vault, addVaultArgs->compression, addVaultArgs->algorithm, *keySource, storage);
             break;
         }
         case CommandType::ADD_FOLDER: {
             auto addFolderArgs = unique_cast<AddFolderCommandArgs>(std::move(args));
-            command = std::make_unique<AddFolderCommand>(addFolderArgs->vault, addFolderArgs->folder, storage);
+            command = std::make_unique<AddFolderCommand>(addFolderArgs->vault, addFolderArgs->folder, *keySource, storage);
             break;
         }
         case CommandType::ADD_CREDENTIAL: {
             auto addCredArgs = unique_cast<AddCredentialCommandArgs>(std::move(args));
-            command = std::make_unique<AddCredentialCommand>(addCredArgs->vault, addCredArgs->folder, addCredArgs->credential, storage);
+            if (viaAgent)
+                command = std::make_unique<AgentAddEntryCommand>(addCredArgs->vault, addCredArgs->folder, addCredArgs->credential, EntryType::CREDENTIAL,
+                    addCredArgs->tags, agent::defaultAgentSocketPath());
+            else
+                command = std::make_unique<AddCredentialCommand>(addCredArgs->vault, addCredArgs->folder, addCredArgs->credential, addCredArgs->tags, *keySource, storage);
             break;
         }
         case CommandType::ADD_NOTE: {
             auto addNoteArgs = unique_cast<AddNoteCommandArgs>(std::move(args));
-            command = std::make_unique<AddNoteCommand>(addNoteArgs->vault, addNoteArgs->folder, addNoteArgs->note, storage);
+            if (viaAgent)
+                command = std::make_unique<AgentAddEntryCommand>(addNoteArgs->vault, addNoteArgs->folder, addNoteArgs->note, EntryType::NOTE,
+                    addNoteArgs->tags, agent::defaultAgentSocketPath());
+            else
+                command = std::make_unique<AddNoteCommand>(addNoteArgs->vault, addNoteArgs->folder, addNoteArgs->note, addNoteArgs->tags, *keySource, storage);
+            break;
+        }
+        case CommandType::ADD_ATTACHMENT: {
+            auto addAttachmentArgs = unique_cast<AddAttachmentCommandArgs>(std::move(args));
+            command = std::make_unique<AddAttachmentCommand>(addAttachmentArgs->vault, addAttachmentArgs->folder, addAttachmentArgs->attachment, addAttachmentArgs->file, addAttachmentArgs->tags, *keySource, storage);
             break;
         }
         case CommandType::SHOW: {
-            auto showVaultArgs = unique_cast<ShowCommandArgs>(std::move(args));
-            command = std::make_unique<ShowCommand>(storage);
+            auto showArgs = unique_cast<ShowCommandArgs>(std::move(args));
+            command = std::make_unique<ShowCommand>(parseOutputFormat(showArgs->output), storage);
             break;
         }
         case CommandType::SHOW_VAULT: {
             auto showVaultArgs = unique_cast<ShowVaultCommandArgs>(std::move(args));
-            command = std::make_unique<ShowVaultCommand>(showVaultArgs->vault, storage);
+            if (viaAgent)
+                command = std::make_unique<AgentShowCommand>(showVaultArgs->vault, "", "", parseOutputFormat(showVaultArgs->output), agent::defaultAgentSocketPath());
+            else
+                command = std::make_unique<ShowVaultCommand>(showVaultArgs->vault, parseOutputFormat(showVaultArgs->output), *keySource, storage);
             break;
         }
         case CommandType::SHOW_FOLDER: {
             auto showFolderArgs = unique_cast<ShowFolderCommandArgs>(std::move(args));
-            command = std::make_unique<ShowFolderCommand>(showFolderArgs->vault, showFolderArgs->folder, storage);
+            if (viaAgent)
+                command = std::make_unique<AgentShowCommand>(showFolderArgs->vault, showFolderArgs->folder, "", parseOutputFormat(showFolderArgs->output), agent::defaultAgentSocketPath());
+            else
+                command = std::make_unique<ShowFolderCommand>(showFolderArgs->vault, showFolderArgs->folder, parseOutputFormat(showFolderArgs->output), *keySource, storage);
             break;
         }
         case CommandType::SHOW_ENTRY: {
             auto showEntryArgs = unique_cast<ShowEntryCommandArgs>(std::move(args));
-            command = std::make_unique<ShowEntryCommand>(showEntryArgs->vault, showEntryArgs->folder, showEntryArgs->entry, storage);
+            // Revisions and attachment contents are not served by the agent, it only hands out the master password for them
+            // (nor does it record use, it only reads)
+            if (viaAgent && showEntryArgs->revision == 0 && showEntryArgs->extract.empty() && !showEntryArgs->recordUse) {
+                command = std::make_unique<AgentShowCommand>(showEntryArgs->vault, showEntryArgs->folder, showEntryArgs->entry,
+                    parseOutputFormat(showEntryArgs->output), agent::defaultAgentSocketPath());
+                break;
+            }
+            command = std::make_unique<ShowEntryCommand>(showEntryArgs->vault, showEntryArgs->folder, showEntryArgs->entry, showEntryArgs->revision, showEntryArgs->extract,
+                parseOutputFormat(showEntryArgs->output), showEntryArgs->recordUse, *keySource, storage);
+            break;
+        }
+        case CommandType::SHOW_MATCHES: {
+            auto showMatchesArgs = unique_cast<ShowMatchesCommandArgs>(std::move(args));
+            if (viaAgent && !showMatchesArgs->recordUse)
+                command = std::make_unique<AgentShowCommand>(showMatchesArgs->vault, showMatchesArgs->folder, showMatchesArgs->entry,
+                    parseOutputFormat(showMatchesArgs->output), agent::defaultAgentSocketPath());
+            else
+                command = std::make_unique<ShowMatchesCommand>(showMatchesArgs->vault, showMatchesArgs->folder, showMatchesArgs->entry,
+                    parseOutputFormat(showMatchesArgs->output), showMatchesArgs->recordUse, *keySource, storage);
             break;
         }
         case CommandType::UPDATE_VAULT: {
             auto updateVaultArgs = unique_cast<UpdateVaultCommandArgs>(std::move(args));
-            command = std::make_unique<UpdateVaultCommand>(updateVaultArgs->vault, storage);
+            newPasswordSource = makeNewPasswordSource(updateVaultArgs->keySource, updateVaultArgs->newPasswordFd, updateVaultArgs->newKeyfile,
+                "--new-password-fd or --new-keyfile");
+            command = std::make_unique<UpdateVaultCommand>(updateVaultArgs->vault, *newPasswordSource, *keySource, storage);
             break;
         }
         case CommandType::UPDATE_FOLDER: {
             auto updateFolderArgs = unique_cast<UpdateFolderCommandArgs>(std::move(args));
-            command = std::make_unique<UpdateFolderCommand>(updateFolderArgs->vault, updateFolderArgs->folder, storage);
+            command = std::make_unique<UpdateFolderCommand>(updateFolderArgs->vault, updateFolderArgs->folder, *keySource, storage);
             break;
         }
         case CommandType::UPDATE_ENTRY: {
             auto updateEntryArgs = unique_cast<UpdateEntryCommandArgs>(std::move(args));
-            command = std::make_unique<UpdateEntryCommand>(updateEntryArgs->vault, updateEntryArgs->folder, updateEntryArgs->entry, storage);
+            command = std::make_unique<UpdateEntryCommand>(updateEntryArgs->vault, updateEntryArgs->folder, updateEntryArgs->entry, updateEntryArgs->tag, updateEntryArgs->untag, *keySource, storage);
+            break;
+        }
+        case CommandType::UPDATE_MATCHES: {
+            auto updateMatchesArgs = unique_cast<UpdateMatchesCommandArgs>(std::move(args));
+            command = std::make_unique<UpdateMatchesCommand>(updateMatchesArgs->vault, updateMatchesArgs->folder, updateMatchesArgs->entry, updateMatchesArgs->tag, updateMatchesArgs->untag, *keySource, storage);
             break;
         }
         case CommandType::DELETE_VAULT: {
             auto deleteVaultArgs = unique_cast<DeleteVaultCommandArgs>(std::move(args));
-            command = std::make_unique<DeleteVaultCommand>(deleteVaultArgs->vault, storage);
+            command = std::make_unique<DeleteVaultCommand>(deleteVaultArgs->vault, *keySource, storage);
             break;
         }
         case CommandType::DELETE_FOLDER: {
             auto deleteFolderArgs = unique_cast<DeleteFolderCommandArgs>(std::move(args));
-            command = std::make_unique<DeleteFolderCommand>(deleteFolderArgs->vault, deleteFolderArgs->folder, storage);
+            command = std::make_unique<DeleteFolderCommand>(deleteFolderArgs->vault, deleteFolderArgs->folder, *keySource, storage);
             break;
         }
         case CommandType::DELETE_ENTRY: {
             auto deleteEntryArgs = unique_cast<DeleteEntryCommandArgs>(std::move(args));
-            command = std::make_unique<DeleteEntryCommand>(deleteEntryArgs->vault, deleteEntryArgs->folder, deleteEntryArgs->entry, storage);
+            if (viaAgent)
+                command = std::make_unique<AgentDeleteEntryCommand>(deleteEntryArgs->vault, deleteEntryArgs->folder, deleteEntryArgs->entry, agent::defaultAgentSocketPath());
+            else
+                command = std::make_unique<DeleteEntryCommand>(deleteEntryArgs->vault, deleteEntryArgs->folder, deleteEntryArgs->entry, *keySource, storage);
+            break;
+        }
+        case CommandType::DELETE_MATCHES: {
+            auto deleteMatchesArgs = unique_cast<DeleteMatchesCommandArgs>(std::move(args));
+            command = std::make_unique<DeleteMatchesCommand>(deleteMatchesArgs->vault, deleteMatchesArgs->folder, deleteMatchesArgs->entry, *keySource, storage);
+            break;
+        }
+        case CommandType::AGENT: {
+            auto agentArgs = unique_cast<AgentCommandArgs>(std::move(args));
+            command = std::make_unique<AgentCommand>(agentArgs->vaults, agent::GroupCommit{std::chrono::milliseconds(agentArgs->commitWindow), agentArgs->commitBatch},
+                *keySource, storage);
+            break;
+        }
+        case CommandType::MOVE:
+        case CommandType::COPY: {
+            auto transferArgs = unique_cast<TransferCommandArgs>(std::move(args));
+            command = std::make_unique<TransferCommand>(transferArgs->vault, transferArgs->folder, transferArgs->entry, transferArgs->targetVault,
+                transferArgs->targetFolder, transferArgs->targetEntry, transferArgs->getType() == CommandType::MOVE, transferArgs->recover, *keySource, storage);
+            break;
+        }
+        case CommandType::HISTORY: {
+            auto historyArgs = unique_cast<HistoryCommandArgs>(std::move(args));
+            command = std::make_unique<HistoryCommand>(historyArgs->vault, historyArgs->folder, historyArgs->entry, *keySource, storage);
+            break;
+        }
+        case CommandType::RESTORE_REVISION: {
+            auto restoreArgs = unique_cast<RestoreRevisionCommandArgs>(std::move(args));
+            command = std::make_unique<RestoreRevisionCommand>(restoreArgs->vault, restoreArgs->folder, restoreArgs->entry, restoreArgs->revision, *keySource, storage);
+            break;
+        }
+        case CommandType::SET_HISTORY_RETENTION: {
+            auto retentionArgs = unique_cast<SetHistoryRetentionCommandArgs>(std::move(args));
+            command = std::make_unique<SetHistoryRetentionCommand>(retentionArgs->vault, retentionArgs->retention, *keySource, storage);
+            break;
+        }
+        case CommandType::LIST: {
+            auto listArgs = unique_cast<ListCommandArgs>(std::move(args));
+            vault::EntryFilter filter;
+            filter.tags = listArgs->tags;
+            auto addRange = [&](vault::TimeField field, const std::optional<int64_t>& after, const std::optional<int64_t>& before) {
+                if (!after && !before)
+                    return;
+                vault::TimeRange range{field};
+                if (after)
+                    range.from = *after;
+                if (before)
+                    range.to = *before;
+                filter.ranges.push_back(range);
+            };
+            addRange(vault::TimeField::CREATED, listArgs->createdAfter, listArgs->createdBefore);
+            addRange(vault::TimeField::MODIFIED, listArgs->modifiedAfter, listArgs->modifiedBefore);
+            addRange(vault::TimeField::LAST_USED, listArgs->usedAfter, listArgs->usedBefore);
+            command = std::make_unique<ListCommand>(listArgs->vault, listArgs->folder, std::move(filter), *keySource, storage);
+            break;
+        }
+        case CommandType::AUDIT: {
+            auto auditArgs = unique_cast<AuditCommandArgs>(std::move(args));
+            command = std::make_unique<AuditCommand>(auditArgs->vaults, auditArgs->breachDatabase,
+                storage::parseBreachHash(auditArgs->breachHash), *keySource, storage);
+            break;
+        }
+        case CommandType::IMPORT: {
+            auto importArgs = unique_cast<ImportCommandArgs>(std::move(args));
+            command = std::make_unique<ImportCommand>(importArgs->vault, importArgs->folder, importArgs->file, importArgs->format,
+                importArgs->conflict, *keySource, storage);
+            break;
+        }
+        case CommandType::EXPORT: {
+            auto exportArgs = unique_cast<ExportCommandArgs>(std::move(args));
+            if (!exportArgs->archive.empty())
+                newPasswordSource = makeNewPasswordSource(exportArgs->keySource, exportArgs->archivePasswordFd, "", "--archive-password-fd");
+            command = std::make_unique<ExportCommand>(exportArgs->vault, exportArgs->folder, exportArgs->file, exportArgs->format,
+                exportArgs->archive, newPasswordSource.get(), *keySource, storage);
+            break;
+        }
+        case CommandType::CALIBRATE: {
+            command = std::make_unique<CalibrateCommand>();
             break;
         }
         default:
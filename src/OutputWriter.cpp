@@ -0,0 +1,68 @@
+#include "OutputWriter.h"
+
+#include <stdexcept>
+#include <string>
+#include "json/JsonScanner.h"
+
+namespace {
+    // The buffer goes to the stream when it grows past this, a listing of any size takes a few large writes
+    constexpr size_t writeThreshold = 64 * 1024;
+}
+
+OutputFormat parseOutputFormat(std::string_view name) {
+    if (name == "text")
+        return OutputFormat::TEXT;
+    if (name == "json")
+        return OutputFormat::JSON;
+    throw std::invalid_argument("Unknown output format: " + std::string(name));
+}
+
+OutputWriter::OutputWriter(std::ostream& output) : output(output) {}
+
+OutputWriter& OutputWriter::operator<<(std::string_view text) {
+    buffer.append(text.data(), text.size());
+    writeIfFull();
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(char c) {
+    buffer += c;
+    writeIfFull();
+    return *this;
+}
+
+OutputWriter& OutputWriter::operator<<(uint64_t number) {
+    buffer += std::to_string(number);
+    writeIfFull();
+    return *this;
+}
+
+OutputWriter& OutputWriter::json(std::string_view text) {
+    vault::appendJsonString(buffer, text);
+    writeIfFull();
+    return *this;
+}
+
+void OutputWriter::finish() {
+    output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    bytesWritten += buffer.size();
+    buffer.clear();
+    output.flush();
+    if (!output)
+        throw std::runtime_error("Failed to write the output");
+}
+
+uint64_t OutputWriter::getBytesWritten() const {
+    return bytesWritten + buffer.size();
+}
+
+void OutputWriter::writeIfFull() {
+    if (buffer.size() < writeThreshold)
+        return;
+    output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    bytesWritten += buffer.size();
+    // clear keeps the capacity, what was written is overwritten by what comes next
+    buffer.clear();
+    if (!output)
+        throw std::runtime_error("Failed to write the output");
+}
@@ -0,0 +1,60 @@
+#include "PrivateFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+PrivateFile::PrivateFile(std::string path) : path(std::move(path)), output(this) {
+    fd = open(this->path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+        throw std::runtime_error("Failed to create file: " + this->path + ": " + std::strerror(errno));
+}
+
+PrivateFile::~PrivateFile() {
+    if (fd >= 0) {
+        ::close(fd);
+        unlink(path.c_str());
+    }
+}
+
+std::ostream& PrivateFile::stream() {
+    return output;
+}
+
+void PrivateFile::close() {
+    int result = failed ? -1 : fsync(fd);
+    std::string message = failed ? "write failed" : std::strerror(errno);
+    if (::close(fd) != 0 && result == 0) {
+        result = -1;
+        message = std::strerror(errno);
+    }
+    fd = -1;
+    if (result != 0) {
+        unlink(path.c_str());
+        throw std::runtime_error("Failed to write file: " + path + ": " + message);
+    }
+}
+
+std::streamsize PrivateFile::xsputn(const char* data, std::streamsize size) {
+    std::streamsize written = 0;
+    while (written < size && !failed) {
+        ssize_t result = ::write(fd, data + written, static_cast<size_t>(size - written));
+        if (result < 0) {
+            if (errno != EINTR)
+                failed = true;
+            continue;
+        }
+        written += result;
+    }
+    return written;
+}
+
+PrivateFile::int_type PrivateFile::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+    char byte = traits_type::to_char_type(c);
+    return xsputn(&byte, 1) == 1 ? c : traits_type::eof();
+}
@@ -9,109 +9,239 @@
 
 namespace storage {
 
-    Storage::Storage(const std::filesystem::path& directory) : vaultsDir(directory) {
-        std::error_code ec;
-        if (!std::filesystem::exists(vaultsDir, ec)) {
-            if (!std::filesystem::create_directories(vaultsDir, ec) && ec) {
-                throw std::runtime_error("Failed to create vaults directory: " + ec.message());
-            }
-        }
+    Storage::Storage(const std::filesystem::path& directory) : Storage(std::make_unique<PosixFileBackend>(directory)) {}
+
+    Storage::Storage(std::unique_ptr<StorageBackend> backend_val) : backend(std::move(backend_val)) {
+        if (!backend)
+            throw std::invalid_argument("Storage backend must not be null");
+        chunkStore = std::make_unique<ChunkStore>(backend->openNamespace("attachments"));
+        moveMarkers = backend->openNamespace("moves");
     }
 
     void Storage::saveVault(const vault::Vault& vault, const Botan::secure_vector<char>& masterPassword) const {
-        // Encrypt vault data
-        json serializedVault = vault;
-        cryptography::EncryptedBlob blob = cryptography::encrypt(
-            serializedVault.dump(),
+        checkNoPendingMove(vault.getName());
+        writeVault(vault, masterPassword);
+    }
+
+    void Storage::saveMovingVault(const vault::Vault& vault, const Botan::secure_vector<char>& masterPassword) const {
+        writeVault(vault, masterPassword);
+    }
+
+    void Storage::writeVault(const vault::Vault& vault, const Botan::secure_vector<char>& masterPassword) const {
+        // The vault is streamed end to end: serialize -> compress -> encrypt chunk by chunk -> base64 -> write.
+        // Every stage only holds about a chunk of data, so saving doesn't need memory proportional to the vault size
+        // (apart from the vault itself) and the serialized plaintext is never held as a whole
+        std::unique_ptr<BlobWriter> writer = backend->openWriter(vault.getName());
+        cryptography::Base64StreamEncoder base64([&writer](const uint8_t* data, size_t size) {
+            writer->write({reinterpret_cast<const char*>(data), size});
+        });
+        // A new salt on every save gives every save its own key, so the random nonce prefix only has to be unique
+        // within one save and not across all the saves of the vault (the agent rewrites its vaults all the time)
+        cryptography::StreamEncryptor encryptor(
             masterPassword,
             vault.cryptoAlgorithm,
             vault.cryptoKDF,
-            vault.cryptoBase64Salt,
-            vault.cryptoKDFIterations
+            cryptography::generateBase64Salt(),
+            vault.cryptoKDFIterations,
+            vault.cryptoCompression,
+            [&base64](const uint8_t* data, size_t size) { base64.write(data, size); }
         );
+        cryptography::StreamCompressor compressor(vault.cryptoCompression, [&encryptor](const uint8_t* data, size_t size) {
+            encryptor.write(data, size);
+        });
 
-        // Build JSON wrapper
-        json j;
-        j["Algorithm"]     = blob.algorithm;
-        j["KDF"]           = blob.kdf;
-        j["KDFIterations"] = blob.kdfIterations;
-        j["Salt"]          = blob.base64Salt;
-        j["Nonce"]         = blob.base64Nonce;
-        j["Data"]          = blob.base64Ciphertext;
+        // The JSON wrapper is written field by field (keys in the same order json::dump uses)
+        const cryptography::EncryptedBlob& blob = encryptor.getBlob();
+        writer->write("{\n"
+            "    \"Algorithm\": " + json(blob.algorithm).dump() + ",\n"
+            "    \"ChunkSize\": " + std::to_string(blob.chunkSize) + ",\n"
+            "    \"Compression\": " + json(blob.compression).dump() + ",\n"
+            "    \"Data\": \"");
 
-        // Write to file
-        std::filesystem::path filePath = vaultsDir / (vault.getName() + ".json");
-        std::ofstream ofs(filePath);
-        if (!ofs)
-            throw std::runtime_error("Failed to open file for writing: " + filePath.string());
-        ofs << j.dump(4);
+        cryptography::SecureBuffer buffer;
+        vault::serializeVault(vault, buffer, cryptography::defaultChunkSize, [&compressor](cryptography::SecureBuffer& serialized) {
+            compressor.write(serialized.data(), serialized.size());
+            serialized.clear();
+        });
+        compressor.write(buffer.data(), buffer.size());
+        compressor.finish();
+        encryptor.finish();
+        base64.finish();
+
+        writer->write("\",\n"
+            "    \"KDF\": " + json(blob.kdf).dump() + ",\n"
+            "    \"KDFIterations\": " + std::to_string(blob.kdfIterations) + ",\n"
+            "    \"Nonce\": \"" + blob.base64Nonce + "\",\n"
+            "    \"Salt\": \"" + blob.base64Salt + "\"\n"
+            "}");
+        writer->commit();
     }
 
     vault::Vault Storage::loadVault(const std::string& vaultName, const Botan::secure_vector<char>& masterPassword) const {
+        cryptography::EncryptedBlob blob;
+        vault::VaultView view(readAndDecrypt(vaultName, masterPassword, blob));
+        vault::Vault vault = view.materialize();
+
+        vault.cryptoAlgorithm = blob.algorithm;
+        vault.cryptoKDF = blob.kdf;
+        vault.cryptoKDFIterations = blob.kdfIterations;
+        vault.cryptoBase64Salt = blob.base64Salt;
+        // Legacy vaults (no compression field) get upgraded to the default codec and an authenticated header on the next save
+        if (!blob.compression.empty())
+            vault.cryptoCompression = blob.compression;
+
+        return vault;
+    }
+
+    vault::VaultView Storage::loadVaultView(const std::string& vaultName, const Botan::secure_vector<char>& masterPassword) const {
+        cryptography::EncryptedBlob blob;
+        return vault::VaultView(readAndDecrypt(vaultName, masterPassword, blob));
+    }
+
+    cryptography::SecureBuffer Storage::readAndDecrypt(const std::string& vaultName, const Botan::secure_vector<char>& masterPassword, cryptography::EncryptedBlob& blob) const {
         if (!vaultExists(vaultName))
             throw std::runtime_error("Vault does not exist");
 
-        // Read file
-        std::filesystem::path filePath = vaultsDir / (vaultName + ".json");
-        std::ifstream ifs(filePath);
-        if (!ifs)
-            throw std::runtime_error("Failed to open file for reading: " + filePath.string());
+        // Map the file (no copy through stream buffers). Everything below reads straight from the mapping
+        std::unique_ptr<BlobMapping> mapping = backend->mapBlob(vaultName);
+        std::string_view fileContents = mapping->data();
 
-        json j;
-        ifs >> j;
+        // Extract EncryptedBlob. The ciphertext is only referenced, not copied out of the mapping
+        std::string_view base64Ciphertext;
+        bool hasAlgorithm = false, hasKDF = false, hasIterations = false, hasSalt = false, hasNonce = false, hasData = false;
 
-        // Extract EncryptedBlob
-        cryptography::EncryptedBlob blob;
-        blob.algorithm = j["Algorithm"].get<std::string>();
-        blob.kdf = j["KDF"].get<std::string>();
-        blob.kdfIterations = j["KDFIterations"].get<int>();
-        blob.base64Salt = j["Salt"].get<std::string>();
-        blob.base64Nonce = j["Nonce"].get<std::string>();
-        blob.base64Ciphertext = j["Data"].get<std::string>();
+        vault::JsonScanner scanner(fileContents);
+        scanner.forEachMember([&](std::string_view key) {
+            if (key == "Algorithm") {
+                blob.algorithm = scanner.readString();
+                hasAlgorithm = true;
+            } else if (key == "KDF") {
+                blob.kdf = scanner.readString();
+                hasKDF = true;
+            } else if (key == "KDFIterations") {
+                blob.kdfIterations = static_cast<int>(scanner.readInteger());
+                hasIterations = true;
+            } else if (key == "Salt") {
+                blob.base64Salt = scanner.readString();
+                hasSalt = true;
+            } else if (key == "Nonce") {
+                blob.base64Nonce = scanner.readString();
+                hasNonce = true;
+            } else if (key == "Compression") {
+                blob.compression = scanner.readString();
+            } else if (key == "ChunkSize") {
+                long long chunkSize = scanner.readInteger();
+                if (chunkSize <= 0 || static_cast<unsigned long long>(chunkSize) > cryptography::maxChunkSize)
+                    throw std::runtime_error("Invalid chunk size in vault file: " + vaultName);
+                blob.chunkSize = static_cast<size_t>(chunkSize);
+            } else if (key == "Data") {
+                base64Ciphertext = scanner.readRawString(); // base64 never contains escapes
+                hasData = true;
+            } else {
+                scanner.skipValue();
+            }
+        });
 
-        // Decrypt and return
-        std::string stringSerializedVault = cryptography::decrypt(blob, masterPassword);
-        json serializedVault = json::parse(stringSerializedVault);
+        // Chunked vaults always record their compression (it is part of the authenticated header)
+        if (!hasAlgorithm || !hasKDF || !hasIterations || !hasSalt || !hasNonce || !hasData || (blob.chunkSize > 0 && blob.compression.empty()))
+            throw std::runtime_error("Vault file is missing encryption parameters: " + vaultName);
 
-        vault::Vault vault("");
-        from_json(serializedVault, vault);
+        if (blob.chunkSize > 0)
+            return decryptChunked(base64Ciphertext, masterPassword, blob);
 
-        vault.cryptoAlgorithm = blob.algorithm;
-        vault.cryptoKDF = blob.kdf;
-        vault.cryptoKDFIterations = blob.kdfIterations;
-        vault.cryptoBase64Salt = blob.base64Salt;
+        // Vault written before chunked encryption: decode the ciphertext from the mapped pages into the buffer
+        // that will hold the plaintext, decrypt it there and decompress it
+        cryptography::SecureBuffer buffer;
+        cryptography::base64DecodeInto(base64Ciphertext, buffer);
+        mapping.reset(); // The file is no longer needed, unmap it before the (memory hungry) decryption and decompression
+        cryptography::decryptInPlace(blob, masterPassword, buffer);
+        if (!blob.compression.empty())
+            cryptography::decompress(blob.compression, buffer);
+        return buffer;
+    }
 
-        return vault;
+    cryptography::SecureBuffer Storage::decryptChunked(std::string_view base64Ciphertext, const Botan::secure_vector<char>& masterPassword, const cryptography::EncryptedBlob& blob) {
+        // Reverse of saveVault: base64 -> decrypt chunk by chunk -> decompress, a window of the mapped file at a time
+        // Only the plaintext grows with the size of the vault
+        cryptography::SecureBuffer plaintext;
+        cryptography::StreamDecompressor decompressor(blob.compression, [&plaintext](const uint8_t* data, size_t size) {
+            plaintext.insert(plaintext.end(), data, data + size);
+        });
+        cryptography::StreamDecryptor decryptor(blob, masterPassword, [&decompressor](const uint8_t* data, size_t size) {
+            decompressor.write(data, size);
+        });
+
+        const size_t windowSize = 4 * 64 * 1024; // Characters (a multiple of 4, so that windows split the text between quanta)
+        cryptography::SecureBuffer window(cryptography::base64DecodedMaxSize(windowSize));
+        for (size_t offset = 0; offset < base64Ciphertext.size(); offset += windowSize) {
+            size_t decoded = cryptography::base64Decode(base64Ciphertext.substr(offset, windowSize), window.data());
+            decryptor.write(window.data(), decoded);
+        }
+        decryptor.finish();
+        decompressor.finish();
+        return plaintext;
     }
 
     bool Storage::deleteVault(const std::string& vaultName) {
-        std::filesystem::path filePath = vaultsDir / (vaultName + ".json");
-        return std::filesystem::remove(filePath);
+        checkNoPendingMove(vaultName);
+        bool removed = backend->removeBlob(vaultName);
+        backend->removeLock(vaultName);
+        return removed;
     }
 
     bool Storage::vaultExists(const std::string& vaultName) const {
-        std::filesystem::path filePath = vaultsDir / (vaultName + ".json");
-        return std::filesystem::exists(filePath);
+        return backend->blobExists(vaultName);
     }
 
     std::vector<std::string> Storage::getAllVaultNames() const {
-        std::vector<std::string> vaultNames;
+        // Taken before listing, a change made meanwhile makes the next call list again
+        uint64_t generation = backend->listingGeneration();
+        std::lock_guard<std::mutex> guard(namesMutex);
+        if (!cachedNames || cachedNamesGeneration != generation) {
+            cachedNames = backend->listBlobs();
+            cachedNamesGeneration = generation;
+        }
+        return *cachedNames;
+    }
 
-        for (const auto& entry : std::filesystem::directory_iterator(vaultsDir)) {
-            if (!entry.is_regular_file())
-                continue;
+    uint64_t Storage::vaultGeneration(const std::string& vaultName) const {
+        return backend->generation(vaultName);
+    }
 
-            const std::filesystem::path& filePath = entry.path();
-            if (!filePath.has_extension() || filePath.extension() != ".json")
-                continue;
+    int Storage::changeDescriptor() const {
+        return backend->changeDescriptor();
+    }
 
-            std::string vaultName = filePath.stem().string(); // .stem() gets filename without extension
-            if (!vaultName.empty()) {
-                vaultNames.push_back(vaultName);
-            }
-        }
+    std::unique_ptr<BlobLock> Storage::lockVault(const std::string& vaultName) {
+        return backend->lock(vaultName);
+    }
+
+    StorageBackend& Storage::getBackend() const {
+        return *backend;
+    }
+
+    ChunkStore& Storage::getChunkStore() const {
+        return *chunkStore;
+    }
+
+    void Storage::writeMoveMarker(const std::string& sourceVault, std::string_view marker) {
+        moveMarkers->writeBlob(sourceVault, marker);
+    }
+
+    std::optional<std::string> Storage::readMoveMarker(const std::string& sourceVault) const {
+        if (!moveMarkers->blobExists(sourceVault))
+            return std::nullopt;
+        return moveMarkers->readBlob(sourceVault);
+    }
+
+    void Storage::removeMoveMarker(const std::string& sourceVault) {
+        moveMarkers->removeBlob(sourceVault);
+    }
 
-        return vaultNames;
+    void Storage::checkNoPendingMove(const std::string& vaultName) const {
+        if (moveMarkers->blobExists(vaultName))
+            throw std::runtime_error("A move out of vault " + vaultName + " was interrupted, finish it first with: manpass mv "
+                                     + vaultName + " --recover");
     }
 
 
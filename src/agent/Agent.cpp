@@ -0,0 +1,627 @@
+#include "agent/Agent.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <optional>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Storage.h"
+#include "agent/AgentProtocol.h"
+#include "vault/EntryIndex.h"
+#include "vault/PathPattern.h"
+
+namespace agent {
+
+    using cryptography::SecureBuffer;
+    using vault::Folder;
+    using vault::EntryPath;
+    using vault::Vault;
+
+    namespace {
+        // Bytes read from a client at a time (requests are small, a few fit)
+        constexpr size_t readSize = 16 * 1024;
+        // A client with this much output not yet taken is not read from until it takes it
+        constexpr size_t maxPendingOutput = 4 * 1024 * 1024;
+        constexpr int maxEvents = 64;
+
+        std::runtime_error systemError(const std::string& what) {
+            return std::runtime_error(what + ": " + strerror(errno));
+        }
+
+        // A name that is not a pattern has to exist, a pattern may match nothing
+        std::vector<std::string> resolveFolders(const Vault& vault, const std::string& folder) {
+            if (vault::isPathPattern(folder))
+                return vault::matchFolders(vault, folder);
+            if (!vault.folderExists(folder))
+                throw std::runtime_error("Folder " + folder + " doesn't exist");
+            return {folder};
+        }
+
+        std::vector<EntryPath> resolveEntries(const Vault& vault, const std::string& folder, const std::string& entry) {
+            if (vault::isPathPattern(folder) || vault::isPathPattern(entry)) {
+                resolveFolders(vault, folder);
+                return vault::matchEntries(vault, folder, entry);
+            }
+            if (!vault.folderExists(folder) || !vault.entryExists(folder, entry))
+                throw std::runtime_error("Entry " + folder + "/" + entry + " doesn't exist");
+            return {{folder, entry}};
+        }
+
+        // Entry of an ADD_ENTRY or REPLACE_ENTRY request
+        std::unique_ptr<vault::Entry> readEntry(FieldReader& reader) {
+            std::string_view type = reader.readField();
+            std::string_view object = reader.readField();
+            if (type.size() != 1)
+                throw std::runtime_error("Malformed request");
+            return vault::materializeEntry(object, static_cast<vault::EntryType>(type[0]));
+        }
+
+        // Applies a write of a group, throws if it can't be applied (the vault is left as it was)
+        void applyWrite(Vault& vault, Opcode opcode, const std::string& folder, const std::string& entry, std::unique_ptr<vault::Entry> value) {
+            if (!vault.folderExists(folder))
+                throw std::runtime_error("Folder " + folder + " doesn't exist");
+            Folder& target = vault.getFolder(folder);
+            if (opcode == Opcode::ADD_ENTRY) {
+                target.addEntry(std::move(value), entry);
+                return;
+            }
+            if (!target.entryExists(entry))
+                throw std::runtime_error("Entry " + folder + "/" + entry + " doesn't exist");
+            if (opcode == Opcode::REPLACE_ENTRY)
+                target.replaceEntry(entry, entry, std::move(value), vault.historyRetention);
+            else
+                target.deleteEntry(entry);
+        }
+
+        void appendRecord(SecureBuffer& response, const std::string& folder, const std::string& entry, uint8_t type) {
+            appendField(response, folder);
+            appendField(response, entry);
+            appendByte(response, type);
+        }
+    }
+
+    Agent::Loop::~Loop() {
+        for (const auto& [fd, connection] : connections) {
+            close(fd);
+        }
+        if (epollFd >= 0)
+            close(epollFd);
+        if (wakeFd >= 0)
+            close(wakeFd);
+    }
+
+    Agent::Agent(std::string socketPath, storage::Storage* storage, GroupCommit groupCommit) :
+        socketPath(std::move(socketPath)), storage(storage), groupCommit(groupCommit) {
+        if (this->groupCommit.maxWrites == 0)
+            this->groupCommit.maxWrites = 1;
+        stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (stopFd < 0)
+            throw systemError("Failed to create an eventfd");
+    }
+
+    Agent::~Agent() {
+        if (listenFd >= 0)
+            close(listenFd);
+        close(stopFd);
+        if (bound)
+            unlink(socketPath.c_str());
+    }
+
+    void Agent::addVault(Vault vault, Botan::secure_vector<char> masterPassword, uint64_t generation) {
+        auto resident = std::make_unique<Resident>();
+        std::string name = vault.getName();
+        resident->current.store(std::make_shared<const Vault>(std::move(vault)));
+        resident->masterPassword = std::move(masterPassword);
+        resident->generation = generation;
+        vaults.insert_or_assign(std::move(name), std::move(resident));
+    }
+
+    void Agent::listen() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Agent socket path is too long: " + socketPath);
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        // The directory keeps other users away from the socket whatever its permissions are
+        std::filesystem::path directory = std::filesystem::path(socketPath).parent_path();
+        if (!directory.empty() && mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST)
+            throw systemError("Failed to create " + directory.string());
+        checkSocketDirectory(socketPath);
+
+        // A socket nobody answers on was left behind by an agent that died
+        if (access(socketPath.c_str(), F_OK) == 0) {
+            bool answered = false;
+            try {
+                AgentClient probe(socketPath);
+                answered = true;
+            } catch (const std::runtime_error&) {}
+            if (answered)
+                throw std::runtime_error("An agent is already listening on " + socketPath);
+            unlink(socketPath.c_str());
+        }
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+            throw systemError("Failed to create a socket");
+        if (bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+            throw systemError("Failed to bind " + socketPath);
+        bound = true;
+        chmod(socketPath.c_str(), 0600);
+        if (::listen(listenFd, SOMAXCONN) != 0)
+            throw systemError("Failed to listen on " + socketPath);
+    }
+
+    void Agent::run(unsigned workers) {
+        if (listenFd < 0)
+            listen();
+
+        // The loops outlive the committers, which hand them responses
+        std::vector<std::unique_ptr<Loop>> loops;
+        for (unsigned i = 0; i < std::max(workers, 1u); i++) {
+            loops.push_back(std::make_unique<Loop>());
+        }
+        for (auto& [name, resident] : vaults) {
+            resident->stopping = false;
+            resident->committer = std::thread(&Agent::commitWrites, this, std::cref(name), std::ref(*resident));
+        }
+        std::thread watcher;
+        if (storage && !vaults.empty() && storage->changeDescriptor() >= 0)
+            watcher = std::thread(&Agent::watchVaults, this);
+
+        // A worker that fails stops the others, its error is rethrown once they are all done
+        std::exception_ptr failure;
+        std::mutex failureMutex;
+        auto work = [&](Loop& loop) {
+            try {
+                serve(loop);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(failureMutex);
+                if (!failure)
+                    failure = std::current_exception();
+                stop();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < loops.size(); i++) {
+            threads.emplace_back(work, std::ref(*loops[i]));
+        }
+        work(*loops[0]);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        if (watcher.joinable())
+            watcher.join();
+
+        for (auto& [name, resident] : vaults) {
+            {
+                std::lock_guard<std::mutex> guard(resident->queueMutex);
+                resident->stopping = true;
+            }
+            resident->queued.notify_one();
+            resident->committer.join();
+        }
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+
+    void Agent::serve(Loop& loop) {
+        loop.epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop.epollFd < 0)
+            throw systemError("Failed to create an epoll instance");
+        loop.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop.wakeFd < 0)
+            throw systemError("Failed to create an eventfd");
+        // Every worker watches the listening socket, EPOLLEXCLUSIVE wakes only one of them per new client
+        for (auto [fd, flags] : {std::pair<int, uint32_t>{listenFd, EPOLLEXCLUSIVE}, {stopFd, 0}, {loop.wakeFd, 0}}) {
+            epoll_event event{};
+            event.events = EPOLLIN | flags;
+            event.data.fd = fd;
+            if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+                throw systemError("Failed to watch a descriptor");
+        }
+
+        epoll_event events[maxEvents];
+        while (true) {
+            int count = epoll_wait(loop.epollFd, events, maxEvents, -1);
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw systemError("epoll_wait failed");
+            }
+
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd == stopFd)
+                    return;
+                if (fd == listenFd) {
+                    acceptClients(loop);
+                    continue;
+                }
+                if (fd == loop.wakeFd) {
+                    takeCompletions(loop);
+                    continue;
+                }
+
+                // The connection may have been closed by an earlier event of this batch
+                auto it = loop.connections.find(fd);
+                if (it == loop.connections.end())
+                    continue;
+                bool keep = true;
+                if (events[i].events & EPOLLIN)
+                    keep = receiveFrom(loop, fd, it->second);
+                if (keep && (events[i].events & EPOLLOUT))
+                    keep = sendTo(loop, fd, it->second);
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    keep = false;
+                if (!keep)
+                    closeConnection(loop, fd);
+            }
+        }
+    }
+
+    void Agent::stop() {
+        uint64_t one = 1;
+        // Only async-signal-safe calls here
+        ssize_t written = write(stopFd, &one, sizeof(one));
+        (void) written;
+    }
+
+    Agent::Resident& Agent::findVault(std::string_view vaultName) const {
+        auto it = vaults.find(vaultName);
+        if (it == vaults.end())
+            throw std::runtime_error("Vault " + std::string(vaultName) + " is not unlocked in the agent");
+        return *it->second;
+    }
+
+    void Agent::modifyVault(std::string_view vaultName, Resident& resident, const std::function<void(Vault&)>& change) {
+        std::lock_guard<std::mutex> writer(resident.writeMutex);
+        std::shared_ptr<Vault> next;
+        if (storage) {
+            std::string name(vaultName);
+            auto vaultLock = storage->lockVault(name);
+            // Loaded again only if the file was changed without the agent, so that the change is not overwritten.
+            // Otherwise copying the snapshot is O(1), only what change touches is copied
+            if (storage->vaultGeneration(name) != resident.generation)
+                next = std::make_shared<Vault>(storage->loadVault(name, resident.masterPassword));
+            else
+                next = std::make_shared<Vault>(*resident.current.load(std::memory_order_acquire));
+            change(*next);
+            storage->saveVault(*next, resident.masterPassword);
+            // Nobody else writes the file while it is locked, this is the generation of the save
+            resident.generation = storage->vaultGeneration(name);
+        } else {
+            next = std::make_shared<Vault>(*resident.current.load(std::memory_order_acquire));
+            change(*next);
+        }
+        // Requests already reading the old version keep it alive until they are done
+        resident.current.store(std::move(next), std::memory_order_release);
+    }
+
+    void Agent::refreshVault(const std::string& vaultName, Resident& resident) {
+        std::lock_guard<std::mutex> writer(resident.writeMutex);
+        try {
+            auto vaultLock = storage->lockVault(vaultName);
+            uint64_t generation = storage->vaultGeneration(vaultName);
+            if (generation == resident.generation)
+                return;
+            // Recorded first: a file that can't be loaded is not tried again until it changes again
+            resident.generation = generation;
+            if (!storage->vaultExists(vaultName))
+                throw std::runtime_error("the file was removed");
+            resident.current.store(std::make_shared<const Vault>(storage->loadVault(vaultName, resident.masterPassword)), std::memory_order_release);
+        } catch (const std::exception& e) {
+            // The last version loaded is still served (e.g. the master password of the vault was changed)
+            std::cerr << "Vault " << vaultName << " changed but could not be loaded again: " << e.what() << std::endl;
+        }
+    }
+
+    void Agent::watchVaults() {
+        pollfd descriptors[2] = {{storage->changeDescriptor(), POLLIN, 0}, {stopFd, POLLIN, 0}};
+        while (true) {
+            if (poll(descriptors, 2, -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            if (descriptors[1].revents)
+                return;
+            if (!descriptors[0].revents)
+                continue;
+
+            // Asking for the generations consumes the events. The agent's own saves show up here as well,
+            // their vaults already have the new generation
+            for (auto& [name, resident] : vaults) {
+                if (storage->vaultGeneration(name) == resident->generation)
+                    continue;
+                {
+                    std::lock_guard<std::mutex> guard(resident->queueMutex);
+                    resident->stale = true;
+                }
+                resident->queued.notify_one();
+            }
+        }
+    }
+
+    bool Agent::handleRequest(const uint8_t* body, size_t size, SecureBuffer& response, Loop& loop, int fd, const Connection& connection) {
+        try {
+            FieldReader reader(body, size);
+            auto opcode = static_cast<Opcode>(reader.readByte());
+            std::string_view vaultName = reader.readField();
+            Resident& resident = findVault(vaultName);
+
+            if (opcode == Opcode::GET_KEY) {
+                if (!reader.atEnd())
+                    throw std::runtime_error("Malformed request");
+                beginFrame(response, static_cast<uint8_t>(Status::OK));
+                appendField(response, {resident.masterPassword.data(), resident.masterPassword.size()});
+                finishFrame(response);
+                return true;
+            }
+
+            std::string folder(reader.readField());
+            std::string entry(reader.readField());
+            if (opcode == Opcode::ADD_ENTRY || opcode == Opcode::REPLACE_ENTRY || opcode == Opcode::DELETE_ENTRY) {
+                std::unique_ptr<vault::Entry> value;
+                if (opcode != Opcode::DELETE_ENTRY)
+                    value = readEntry(reader);
+                if (!reader.atEnd() || folder.empty() || entry.empty())
+                    throw std::runtime_error("Malformed request");
+
+                {
+                    std::lock_guard<std::mutex> guard(resident.queueMutex);
+                    resident.queue.push_back({opcode, std::move(folder), std::move(entry), std::move(value), &loop, fd, connection.id});
+                }
+                resident.queued.notify_one();
+                return false;
+            }
+            if (opcode != Opcode::LIST && opcode != Opcode::SHOW)
+                throw std::runtime_error("Unknown request");
+            if (!reader.atEnd() || folder.empty() || (opcode == Opcode::SHOW && entry.empty()))
+                throw std::runtime_error("Malformed request");
+
+            // The whole request is answered from one version of the vault, however many writes happen meanwhile
+            std::shared_ptr<const Vault> snapshot = resident.current.load(std::memory_order_acquire);
+            const Vault& vault = *snapshot;
+            beginFrame(response, static_cast<uint8_t>(Status::OK));
+            if (opcode == Opcode::LIST && entry.empty()) {
+                for (const std::string& folderName : resolveFolders(vault, folder)) {
+                    std::vector<std::string> entryNames = vault.getFolder(folderName).getEntryNames();
+                    std::sort(entryNames.begin(), entryNames.end());
+                    if (entryNames.empty())
+                        appendRecord(response, folderName, "", 0);
+                    for (const std::string& entryName : entryNames) {
+                        appendRecord(response, folderName, entryName, static_cast<uint8_t>(vault.getEntry(folderName, entryName).getType()));
+                    }
+                }
+            } else {
+                SecureBuffer object;
+                for (const EntryPath& path : resolveEntries(vault, folder, entry)) {
+                    const vault::Entry& found = vault.getEntry(path.folder, path.entry);
+                    appendRecord(response, path.folder, path.entry, static_cast<uint8_t>(found.getType()));
+                    if (opcode == Opcode::SHOW) {
+                        // The same object the vault file stores, without the history and metadata
+                        object.assign(1, '{');
+                        vault::appendEntryMembers(object, found, nullptr, nullptr, {});
+                        object.push_back('}');
+                        appendField(response, {reinterpret_cast<const char*>(object.data()), object.size()});
+                    }
+                }
+            }
+            finishFrame(response);
+        } catch (const std::exception& e) {
+            beginFrame(response, static_cast<uint8_t>(Status::ERROR));
+            appendField(response, e.what());
+            finishFrame(response);
+        }
+        return true;
+    }
+
+    void Agent::commitWrites(const std::string& vaultName, Resident& resident) {
+        while (true) {
+            std::vector<PendingWrite> group;
+            {
+                std::unique_lock<std::mutex> lock(resident.queueMutex);
+                resident.queued.wait(lock, [&]() { return resident.stopping || resident.stale || !resident.queue.empty(); });
+                // Writes load a changed vault again themselves
+                bool stale = std::exchange(resident.stale, false);
+                if (resident.queue.empty()) {
+                    if (!stale)
+                        return;
+                    lock.unlock();
+                    refreshVault(vaultName, resident);
+                    continue;
+                }
+                // The window opens with the first write waiting, those arriving meanwhile join it
+                auto deadline = std::chrono::steady_clock::now() + groupCommit.window;
+                resident.queued.wait_until(lock, deadline, [&]() {
+                    return resident.stopping || resident.queue.size() >= groupCommit.maxWrites;
+                });
+                auto end = resident.queue.begin() + static_cast<std::ptrdiff_t>(std::min(resident.queue.size(), groupCommit.maxWrites));
+                group.assign(std::make_move_iterator(resident.queue.begin()), std::make_move_iterator(end));
+                resident.queue.erase(resident.queue.begin(), end);
+            }
+
+            // A write that can't be applied fails alone, the group fails as a whole only if it can't be saved
+            std::vector<std::optional<std::string>> errors(group.size());
+            try {
+                modifyVault(vaultName, resident, [&](Vault& vault) {
+                    for (size_t i = 0; i < group.size(); i++) {
+                        try {
+                            applyWrite(vault, group[i].opcode, group[i].folder, group[i].entry, std::move(group[i].value));
+                        } catch (const std::exception& e) {
+                            errors[i] = e.what();
+                        }
+                    }
+                });
+            } catch (const std::exception& e) {
+                for (std::optional<std::string>& error : errors) {
+                    error = e.what();
+                }
+            }
+
+            for (size_t i = 0; i < group.size(); i++) {
+                SecureBuffer response;
+                beginFrame(response, static_cast<uint8_t>(errors[i] ? Status::ERROR : Status::OK));
+                if (errors[i])
+                    appendField(response, *errors[i]);
+                finishFrame(response);
+                complete(group[i], std::move(response));
+            }
+        }
+    }
+
+    void Agent::complete(const PendingWrite& write, SecureBuffer response) {
+        Loop& loop = *write.loop;
+        {
+            std::lock_guard<std::mutex> guard(loop.completionMutex);
+            loop.completions.push_back({write.fd, write.connectionId, std::move(response)});
+        }
+        uint64_t one = 1;
+        ssize_t written = ::write(loop.wakeFd, &one, sizeof(one));
+        (void) written;
+    }
+
+    void Agent::takeCompletions(Loop& loop) {
+        uint64_t value;
+        ssize_t got = read(loop.wakeFd, &value, sizeof(value));
+        (void) got;
+        std::vector<Completion> completions;
+        {
+            std::lock_guard<std::mutex> guard(loop.completionMutex);
+            completions.swap(loop.completions);
+        }
+
+        for (Completion& completion : completions) {
+            // The client may have gone away meanwhile, and its descriptor may have been reused
+            auto it = loop.connections.find(completion.fd);
+            if (it == loop.connections.end() || it->second.id != completion.connectionId)
+                continue;
+            Connection& connection = it->second;
+            connection.out.insert(connection.out.end(), completion.response.begin(), completion.response.end());
+            connection.waiting = false;
+            if (!processFrames(loop, completion.fd, connection))
+                closeConnection(loop, completion.fd);
+        }
+    }
+
+    void Agent::acceptClients(Loop& loop) {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                // EAGAIN when every pending client is taken. On other errors (e.g. out of descriptors)
+                // the rest stay queued until the next wakeup
+                return;
+            }
+
+            // Checked once, the credentials are those of the process that connected
+            ucred credentials{};
+            socklen_t length = sizeof(credentials);
+            if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0 || credentials.uid != getuid()) {
+                close(fd);
+                continue;
+            }
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                close(fd);
+                continue;
+            }
+            Connection connection;
+            connection.id = loop.nextConnectionId++;
+            loop.connections.emplace(fd, std::move(connection));
+        }
+    }
+
+    bool Agent::receiveFrom(Loop& loop, int fd, Connection& connection) {
+        // One read per wakeup, so that a busy client can't keep the others waiting (epoll reports the rest again)
+        SecureBuffer& in = connection.in;
+        size_t previous = in.size();
+        in.resize(previous + readSize);
+        ssize_t got = read(fd, in.data() + previous, readSize);
+        if (got <= 0) {
+            in.resize(previous);
+            return got < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        in.resize(previous + static_cast<size_t>(got));
+        return processFrames(loop, fd, connection);
+    }
+
+    bool Agent::processFrames(Loop& loop, int fd, Connection& connection) {
+        SecureBuffer& in = connection.in;
+        SecureBuffer response;
+        size_t offset = 0;
+        while (!connection.waiting && in.size() - offset >= frameHeaderSize) {
+            uint32_t bodySize;
+            try {
+                bodySize = frameBodySize(in.data() + offset);
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+            if (in.size() - offset - frameHeaderSize < bodySize)
+                break;
+            if (handleRequest(in.data() + offset + frameHeaderSize, bodySize, response, loop, fd, connection))
+                connection.out.insert(connection.out.end(), response.begin(), response.end());
+            else
+                connection.waiting = true;
+            offset += frameHeaderSize + bodySize;
+        }
+        in.erase(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(offset));
+        return sendTo(loop, fd, connection);
+    }
+
+    bool Agent::sendTo(Loop& loop, int fd, Connection& connection) {
+        SecureBuffer& out = connection.out;
+        while (connection.outOffset < out.size()) {
+            ssize_t sent = ::send(fd, out.data() + connection.outOffset, out.size() - connection.outOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                return false;
+            }
+            connection.outOffset += static_cast<size_t>(sent);
+        }
+        if (connection.outOffset == out.size()) {
+            out.clear();
+            connection.outOffset = 0;
+        }
+        updateInterest(loop, fd, connection);
+        return true;
+    }
+
+    void Agent::updateInterest(Loop& loop, int fd, const Connection& connection) {
+        size_t pending = connection.out.size() - connection.outOffset;
+        epoll_event event{};
+        event.events = (pending < maxPendingOutput && !connection.waiting ? static_cast<uint32_t>(EPOLLIN) : uint32_t{0})
+                     | (pending > 0 ? static_cast<uint32_t>(EPOLLOUT) : uint32_t{0});
+        event.data.fd = fd;
+        epoll_ctl(loop.epollFd, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    void Agent::closeConnection(Loop& loop, int fd) {
+        epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        loop.connections.erase(fd);
+    }
+
+} // namespace agent
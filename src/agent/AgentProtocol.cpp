@@ -0,0 +1,200 @@
+#include "agent/AgentProtocol.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace agent {
+
+    using cryptography::SecureBuffer;
+
+    namespace {
+        // How long the agent gets to answer
+        constexpr time_t responseTimeoutSeconds = 10;
+
+        void putU32(uint8_t* out, uint32_t value) {
+            for (int i = 0; i < 4; i++) {
+                out[i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        uint32_t getU32(const uint8_t* in) {
+            uint32_t value = 0;
+            for (int i = 0; i < 4; i++) {
+                value |= static_cast<uint32_t>(in[i]) << (8 * i);
+            }
+            return value;
+        }
+
+        // Reads exactly size bytes, returns false if the connection is closed before the first one
+        bool readExactly(int fd, uint8_t* out, size_t size) {
+            size_t done = 0;
+            while (done < size) {
+                ssize_t got = read(fd, out + done, size - done);
+                if (got < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error("Failed to read from the agent: " + std::string(strerror(errno)));
+                }
+                if (got == 0) {
+                    if (done == 0)
+                        return false;
+                    throw std::runtime_error("The agent closed the connection in the middle of a message");
+                }
+                done += static_cast<size_t>(got);
+            }
+            return true;
+        }
+    }
+
+    std::string defaultAgentSocketPath() {
+        if (const char* path = std::getenv("MANPASS_AGENT_SOCKET"); path && *path)
+            return path;
+        if (const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR"); runtimeDir && *runtimeDir)
+            return std::string(runtimeDir) + "/manpass/agent.sock";
+        return "/tmp/manpass-" + std::to_string(getuid()) + "/agent.sock";
+    }
+
+    void checkSocketDirectory(const std::string& socketPath) {
+        std::filesystem::path directory = std::filesystem::path(socketPath).parent_path();
+        if (directory.empty())
+            directory = ".";
+        struct stat info{};
+        if (lstat(directory.c_str(), &info) != 0)
+            throw std::runtime_error("Failed to inspect " + directory.string() + ": " + strerror(errno));
+        if (!S_ISDIR(info.st_mode) || info.st_uid != getuid() || (info.st_mode & 0777) != 0700)
+            throw std::runtime_error(directory.string() + " has to be a directory only its owner (you) can access (mode 0700)");
+    }
+
+    void beginFrame(SecureBuffer& frame, uint8_t kind) {
+        frame.assign(frameHeaderSize, 0);
+        frame.push_back(kind);
+    }
+
+    void appendByte(SecureBuffer& frame, uint8_t byte) {
+        frame.push_back(byte);
+    }
+
+    void appendField(SecureBuffer& frame, std::string_view field) {
+        size_t offset = frame.size();
+        frame.resize(offset + 4);
+        putU32(frame.data() + offset, static_cast<uint32_t>(field.size()));
+        frame.insert(frame.end(), field.begin(), field.end());
+    }
+
+    void finishFrame(SecureBuffer& frame) {
+        if (frame.size() - frameHeaderSize > maxFrameSize)
+            throw std::runtime_error("Agent message is too large");
+        putU32(frame.data(), static_cast<uint32_t>(frame.size() - frameHeaderSize));
+    }
+
+    uint32_t frameBodySize(const uint8_t* header) {
+        uint32_t size = getU32(header);
+        if (size > maxFrameSize)
+            throw std::runtime_error("Agent message is too large");
+        return size;
+    }
+
+    FieldReader::FieldReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint8_t FieldReader::readByte() {
+        if (offset >= size)
+            throw std::runtime_error("Agent message is cut short");
+        return data[offset++];
+    }
+
+    std::string_view FieldReader::readField() {
+        if (size - offset < 4)
+            throw std::runtime_error("Agent message is cut short");
+        uint32_t length = getU32(data + offset);
+        offset += 4;
+        if (size - offset < length)
+            throw std::runtime_error("Agent message is cut short");
+        std::string_view field(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+        return field;
+    }
+
+    bool FieldReader::atEnd() const {
+        return offset == size;
+    }
+
+    AgentClient::AgentClient(const std::string& socketPath) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Agent socket path is too long: " + socketPath);
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        checkSocketDirectory(socketPath);
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            throw std::runtime_error("Failed to create a socket: " + std::string(strerror(errno)));
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("Failed to reach the agent at " + socketPath + ": " + strerror(error));
+        }
+        // Secrets are sent to it and keys taken from it, it has to be an agent of this user
+        ucred credentials{};
+        socklen_t length = sizeof(credentials);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0 || credentials.uid != getuid()) {
+            close(fd);
+            throw std::runtime_error("The process listening on " + socketPath + " does not belong to you");
+        }
+        timeval timeout{responseTimeoutSeconds, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    AgentClient::~AgentClient() {
+        close(fd);
+    }
+
+    FieldReader AgentClient::request(Opcode opcode, std::initializer_list<std::string_view> fields) {
+        beginFrame(message, static_cast<uint8_t>(opcode));
+        for (std::string_view field : fields) {
+            appendField(message, field);
+        }
+        finishFrame(message);
+        writeFrame(fd, message);
+
+        if (!readFrame(fd, message))
+            throw std::runtime_error("The agent closed the connection without answering");
+        FieldReader reader(message.data(), message.size());
+        if (static_cast<Status>(reader.readByte()) != Status::OK)
+            throw std::runtime_error("Agent: " + std::string(reader.readField()));
+        return reader;
+    }
+
+    void writeFrame(int fd, const SecureBuffer& frame) {
+        size_t done = 0;
+        while (done < frame.size()) {
+            // A peer that went away is an error here, not a SIGPIPE
+            ssize_t written = send(fd, frame.data() + done, frame.size() - done, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Failed to write to the agent: " + std::string(strerror(errno)));
+            }
+            done += static_cast<size_t>(written);
+        }
+    }
+
+    bool readFrame(int fd, SecureBuffer& body) {
+        uint8_t header[frameHeaderSize];
+        if (!readExactly(fd, header, frameHeaderSize))
+            return false;
+        body.resize(frameBodySize(header));
+        if (!body.empty() && !readExactly(fd, body.data(), body.size()))
+            throw std::runtime_error("The agent closed the connection in the middle of a message");
+        return true;
+    }
+
+} // namespace agent
@@ -0,0 +1,371 @@
+#include "crypto/Base64.h"
+
+#include <array>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MANPASS_BASE64_X86
+#include <immintrin.h>
+#endif
+
+namespace cryptography {
+
+    namespace {
+        const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        // Values for the decoding table besides 0-63
+        constexpr uint8_t whitespace = 0x80;
+        constexpr uint8_t padding = 0x81;
+        constexpr uint8_t invalid = 0xFF;
+
+        constexpr std::array<uint8_t, 256> makeDecodingTable() {
+            std::array<uint8_t, 256> table{};
+            for (auto& value : table)
+                value = invalid;
+            for (uint8_t i = 0; i < 64; i++)
+                table[static_cast<uint8_t>(alphabet[i])] = i;
+            table[static_cast<uint8_t>(' ')] = whitespace;
+            table[static_cast<uint8_t>('\t')] = whitespace;
+            table[static_cast<uint8_t>('\n')] = whitespace;
+            table[static_cast<uint8_t>('\r')] = whitespace;
+            table[static_cast<uint8_t>('=')] = padding;
+            return table;
+        }
+
+        constexpr std::array<uint8_t, 256> decodingTable = makeDecodingTable();
+
+        [[noreturn]] void malformed() {
+            throw std::invalid_argument("Malformed base64 input");
+        }
+
+        // Encodes whole 3 byte groups and the padded tail
+        void encodeScalar(const uint8_t* in, size_t size, char* out) {
+            size_t i = 0;
+            for (; i + 3 <= size; i += 3) {
+                uint32_t group = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8) | in[i + 2];
+                *out++ = alphabet[group >> 18];
+                *out++ = alphabet[(group >> 12) & 0x3F];
+                *out++ = alphabet[(group >> 6) & 0x3F];
+                *out++ = alphabet[group & 0x3F];
+            }
+
+            size_t left = size - i;
+            if (left == 0)
+                return;
+            uint32_t group = uint32_t(in[i]) << 16;
+            if (left == 2)
+                group |= uint32_t(in[i + 1]) << 8;
+            *out++ = alphabet[group >> 18];
+            *out++ = alphabet[(group >> 12) & 0x3F];
+            *out++ = left == 2 ? alphabet[(group >> 6) & 0x3F] : '=';
+            *out++ = '=';
+        }
+
+        // Handles everything the vectorized loops don't: whitespace, padding and the tail
+        // in has to start at a quantum boundary
+        size_t decodeScalar(const char* in, size_t size, uint8_t* out) {
+            uint32_t quantum = 0;
+            int count = 0; // Characters in the current quantum
+            int paddingCount = 0;
+            size_t written = 0;
+
+            for (size_t i = 0; i < size; i++) {
+                uint8_t value = decodingTable[static_cast<uint8_t>(in[i])];
+                if (value < 64) {
+                    if (paddingCount > 0)
+                        malformed(); // Data after padding
+                    quantum = (quantum << 6) | value;
+                    if (++count == 4) {
+                        out[written++] = static_cast<uint8_t>(quantum >> 16);
+                        out[written++] = static_cast<uint8_t>(quantum >> 8);
+                        out[written++] = static_cast<uint8_t>(quantum);
+                        quantum = 0;
+                        count = 0;
+                    }
+                } else if (value == whitespace) {
+                    continue;
+                } else if (value == padding) {
+                    paddingCount++;
+                    if (count < 2 || count + paddingCount > 4)
+                        malformed();
+                } else {
+                    malformed();
+                }
+            }
+
+            // Final partial quantum (padded or not)
+            if (count == 1 || (paddingCount > 0 && count + paddingCount != 4))
+                malformed();
+            if (count == 2) {
+                out[written++] = static_cast<uint8_t>(quantum >> 4);
+            } else if (count == 3) {
+                out[written++] = static_cast<uint8_t>(quantum >> 10);
+                out[written++] = static_cast<uint8_t>(quantum >> 2);
+            }
+            return written;
+        }
+
+#ifdef MANPASS_BASE64_X86
+        // Vectorized codec based on the approach of W. Mula and D. Lemire ("Faster Base64 Encoding and Decoding Using AVX2 Instructions")
+        // Encoding: bytes are shuffled so that every 32 bit lane holds one 3 byte group, split into four 6 bit indices
+        // with multiplies and translated to ASCII by adding per-range offsets looked up with pshufb.
+        // Decoding: the same lookups classify characters by nibble (rejecting anything outside the alphabet)
+        // and the 6 bit values are packed back with multiply-add instructions.
+
+        __attribute__((target("sse4.1")))
+        inline __m128i encodeReshuffle(__m128i in) {
+            in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+            const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+            const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+            const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+            const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+            return _mm_or_si128(t1, t3);
+        }
+
+        __attribute__((target("sse4.1")))
+        inline __m128i encodeTranslate(__m128i indices) {
+            const __m128i offsets = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+            __m128i ranges = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+            ranges = _mm_sub_epi8(ranges, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+            return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, ranges));
+        }
+
+        // Returns false if the block contains anything but alphabet characters
+        __attribute__((target("sse4.1")))
+        inline bool decodeBlock(__m128i in, __m128i& values) {
+            const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+            const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+            const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m128i mask2F = _mm_set1_epi8(0x2F);
+
+            const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask2F);
+            const __m128i loNibbles = _mm_and_si128(in, mask2F);
+            const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+            const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+            if (!_mm_testz_si128(lo, hi))
+                return false;
+
+            const __m128i eq2F = _mm_cmpeq_epi8(in, mask2F);
+            const __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+            values = _mm_add_epi8(in, roll);
+            return true;
+        }
+
+        __attribute__((target("sse4.1")))
+        inline __m128i decodePack(__m128i values) {
+            const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+            const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+            return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        }
+
+        // 12 input bytes per iteration (16 are loaded)
+        __attribute__((target("sse4.1")))
+        size_t encodeSse41(const uint8_t* in, size_t size, char* out) {
+            size_t i = 0;
+            for (; i + 16 <= size; i += 12) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                block = encodeTranslate(encodeReshuffle(block));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), block);
+                out += 16;
+            }
+            return i;
+        }
+
+        // 16 characters per iteration. Stops at the first block that needs the scalar path
+        __attribute__((target("sse4.1")))
+        size_t decodeSse41(const char* in, size_t size, uint8_t* out, size_t& written) {
+            size_t i = 0;
+            alignas(16) uint8_t packed[16];
+            for (; i + 16 <= size; i += 16) {
+                __m128i values;
+                if (!decodeBlock(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), values))
+                    break;
+                _mm_store_si128(reinterpret_cast<__m128i*>(packed), decodePack(values));
+                std::memcpy(out + written, packed, 12);
+                written += 12;
+            }
+            return i;
+        }
+
+        // 24 input bytes per iteration: each 128 bit lane gets its own 12 byte group (28 bytes are loaded)
+        __attribute__((target("avx2")))
+        size_t encodeAvx2(const uint8_t* in, size_t size, char* out) {
+            const __m256i shuffle = _mm256_setr_epi8(
+                1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+            const __m256i offsets = _mm256_setr_epi8(
+                65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+            size_t i = 0;
+            for (; i + 28 <= size; i += 24) {
+                __m256i block = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12)), 1);
+                block = _mm256_shuffle_epi8(block, shuffle);
+                const __m256i t0 = _mm256_and_si256(block, _mm256_set1_epi32(0x0fc0fc00));
+                const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+                const __m256i t2 = _mm256_and_si256(block, _mm256_set1_epi32(0x003f03f0));
+                const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+                const __m256i indices = _mm256_or_si256(t1, t3);
+
+                __m256i ranges = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+                ranges = _mm256_sub_epi8(ranges, _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25)));
+                const __m256i ascii = _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, ranges));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), ascii);
+                out += 32;
+            }
+            return i;
+        }
+
+        // 32 characters per iteration. Stops at the first block that needs the scalar path
+        __attribute__((target("avx2")))
+        size_t decodeAvx2(const char* in, size_t size, uint8_t* out, size_t& written) {
+            const __m256i lutLo = _mm256_setr_epi8(
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+            const __m256i lutHi = _mm256_setr_epi8(
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+            const __m256i lutRoll = _mm256_setr_epi8(
+                0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m256i mask2F = _mm256_set1_epi8(0x2F);
+            const __m256i packShuffle = _mm256_setr_epi8(
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+            size_t i = 0;
+            alignas(32) uint8_t packed[32];
+            for (; i + 32 <= size; i += 32) {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(block, 4), mask2F);
+                const __m256i loNibbles = _mm256_and_si256(block, mask2F);
+                const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+                const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+                if (!_mm256_testz_si256(lo, hi))
+                    break;
+
+                const __m256i eq2F = _mm256_cmpeq_epi8(block, mask2F);
+                const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+                const __m256i values = _mm256_add_epi8(block, roll);
+
+                const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+                __m256i bytes = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+                bytes = _mm256_shuffle_epi8(bytes, packShuffle);
+                // Move the 12 bytes of each lane next to each other
+                bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+                _mm256_store_si256(reinterpret_cast<__m256i*>(packed), bytes);
+                std::memcpy(out + written, packed, 24);
+                written += 24;
+            }
+            return i;
+        }
+#endif
+    }
+
+    bool base64IsaSupported(Base64Isa isa) {
+        switch (isa) {
+            case Base64Isa::SCALAR:
+                return true;
+#ifdef MANPASS_BASE64_X86
+            case Base64Isa::SSE41:
+                return __builtin_cpu_supports("sse4.1");
+            case Base64Isa::AVX2:
+                return __builtin_cpu_supports("avx2");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    Base64Isa detectBase64Isa() {
+        static const Base64Isa isa = [] {
+            if (base64IsaSupported(Base64Isa::AVX2))
+                return Base64Isa::AVX2;
+            if (base64IsaSupported(Base64Isa::SSE41))
+                return Base64Isa::SSE41;
+            return Base64Isa::SCALAR;
+        }();
+        return isa;
+    }
+
+    size_t base64EncodedSize(size_t size) {
+        return (size + 2) / 3 * 4;
+    }
+
+    size_t base64DecodedMaxSize(size_t size) {
+        return (size + 3) / 4 * 3;
+    }
+
+    void base64Encode(const uint8_t* data, size_t size, char* out, Base64Isa isa) {
+        if (!base64IsaSupported(isa))
+            throw std::invalid_argument("Base64 implementation not supported on this CPU");
+
+        size_t done = 0;
+#ifdef MANPASS_BASE64_X86
+        if (isa == Base64Isa::AVX2)
+            done = encodeAvx2(data, size, out);
+        if (isa != Base64Isa::SCALAR)
+            done += encodeSse41(data + done, size - done, out + done / 3 * 4);
+#endif
+        encodeScalar(data + done, size - done, out + done / 3 * 4);
+    }
+
+    std::string base64Encode(const uint8_t* data, size_t size) {
+        std::string out(base64EncodedSize(size), '\0');
+        base64Encode(data, size, out.data());
+        return out;
+    }
+
+    size_t base64Decode(std::string_view base64, uint8_t* out, Base64Isa isa) {
+        if (!base64IsaSupported(isa))
+            throw std::invalid_argument("Base64 implementation not supported on this CPU");
+
+        size_t consumed = 0;
+        size_t written = 0;
+#ifdef MANPASS_BASE64_X86
+        // The vector loops stop at the first block with padding, whitespace or an invalid character,
+        // everything from there on is left to the scalar decoder (blocks are whole quanta, so it starts on a boundary)
+        if (isa == Base64Isa::AVX2)
+            consumed = decodeAvx2(base64.data(), base64.size(), out, written);
+        if (isa != Base64Isa::SCALAR)
+            consumed += decodeSse41(base64.data() + consumed, base64.size() - consumed, out, written);
+#endif
+        return written + decodeScalar(base64.data() + consumed, base64.size() - consumed, out + written);
+    }
+
+    Base64StreamEncoder::Base64StreamEncoder(ByteSink sink_val) : sink(std::move(sink_val)) {}
+
+    void Base64StreamEncoder::write(const uint8_t* data, size_t size) {
+        // Complete the group left over from the previous call
+        while (carrySize > 0 && carrySize < 3 && size > 0) {
+            carry[carrySize++] = *data++;
+            size--;
+        }
+        if (carrySize == 3) {
+            emit(carry, 3);
+            carrySize = 0;
+        }
+
+        size_t whole = size / 3 * 3;
+        if (whole > 0)
+            emit(data, whole);
+        for (size_t i = whole; i < size; i++) {
+            carry[carrySize++] = data[i];
+        }
+    }
+
+    void Base64StreamEncoder::finish() {
+        if (carrySize > 0)
+            emit(carry, carrySize);
+        carrySize = 0;
+    }
+
+    void Base64StreamEncoder::emit(const uint8_t* data, size_t size) {
+        encoded.resize(base64EncodedSize(size));
+        base64Encode(data, size, encoded.data());
+        sink(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+    }
+
+} // namespace cryptography
@@ -0,0 +1,140 @@
+#include "crypto/Compression.h"
+
+#include <algorithm>
+#include <botan/compression.h>
+
+namespace cryptography {
+
+    // Amount of input handed to the codec at once. Bounds the size of the intermediate buffers
+    static const size_t compressionChunkSize = 64 * 1024;
+
+    static void validateCompression(const std::string& compression) {
+        if (std::find(acceptedCompressions.begin(), acceptedCompressions.end(), compression) == acceptedCompressions.end()) {
+            throw std::invalid_argument("Unsupported compression");
+        }
+    }
+
+    std::string defaultCompression() {
+        static const std::string compression = Botan::Compression_Algorithm::create("zlib") ? "zlib" : "none";
+        return compression;
+    }
+
+    void compress(const std::string& compression, SecureBuffer& buffer) {
+        validateCompression(compression);
+        if (compression == "none")
+            return;
+
+        SecureBuffer output;
+        StreamCompressor compressor(compression, [&output](const uint8_t* data, size_t size) {
+            output.insert(output.end(), data, data + size);
+        });
+        compressor.write(buffer.data(), buffer.size());
+        compressor.finish();
+        buffer.swap(output);
+    }
+
+    void decompress(const std::string& compression, SecureBuffer& buffer) {
+        validateCompression(compression);
+        if (compression == "none")
+            return;
+
+        SecureBuffer output;
+        StreamDecompressor decompressor(compression, [&output](const uint8_t* data, size_t size) {
+            output.insert(output.end(), data, data + size);
+        });
+        decompressor.write(buffer.data(), buffer.size());
+        decompressor.finish();
+        buffer.swap(output);
+    }
+
+    StreamCompressor::StreamCompressor(const std::string& compression, ByteSink sink_val) : sink(std::move(sink_val)) {
+        validateCompression(compression);
+        if (compression == "none")
+            return;
+
+        compressor = Botan::Compression_Algorithm::create(compression);
+        if (!compressor)
+            throw std::runtime_error("Compression algorithm not available: " + compression);
+        compressor->start();
+    }
+
+    StreamCompressor::~StreamCompressor() = default;
+
+    void StreamCompressor::write(const uint8_t* data, size_t size) {
+        if (!compressor) {
+            sink(data, size);
+            return;
+        }
+
+        Botan::secure_vector<uint8_t> chunk;
+        while (size > 0) {
+            size_t length = std::min(compressionChunkSize, size);
+            chunk.assign(data, data + length);
+            data += length;
+            size -= length;
+
+            compressor->update(chunk);
+            if (!chunk.empty())
+                sink(chunk.data(), chunk.size());
+        }
+    }
+
+    void StreamCompressor::finish() {
+        if (!compressor)
+            return;
+
+        Botan::secure_vector<uint8_t> chunk;
+        compressor->finish(chunk);
+        sink(chunk.data(), chunk.size());
+    }
+
+    StreamDecompressor::StreamDecompressor(const std::string& compression, ByteSink sink_val) : sink(std::move(sink_val)) {
+        validateCompression(compression);
+        if (compression == "none")
+            return;
+
+        decompressor = Botan::Decompression_Algorithm::create(compression);
+        if (!decompressor)
+            throw std::runtime_error("Decompression algorithm not available: " + compression);
+        decompressor->start();
+    }
+
+    StreamDecompressor::~StreamDecompressor() = default;
+
+    void StreamDecompressor::write(const uint8_t* data, size_t size) {
+        if (!decompressor) {
+            sink(data, size);
+            return;
+        }
+
+        Botan::secure_vector<uint8_t> chunk;
+        while (size > 0) {
+            size_t length = std::min(compressionChunkSize, size);
+            chunk.assign(data, data + length);
+            data += length;
+            size -= length;
+
+            try {
+                decompressor->update(chunk);
+            } catch (std::exception& e) {
+                throw std::runtime_error("Decompression failed");
+            }
+            if (!chunk.empty())
+                sink(chunk.data(), chunk.size());
+        }
+    }
+
+    void StreamDecompressor::finish() {
+        if (!decompressor)
+            return;
+
+        Botan::secure_vector<uint8_t> chunk;
+        try {
+            decompressor->finish(chunk);
+        } catch (std::exception& e) {
+            throw std::runtime_error("Decompression failed");
+        }
+        sink(chunk.data(), chunk.size());
+    }
+
+} // namespace cryptography
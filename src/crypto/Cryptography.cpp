@@ -4,39 +4,97 @@
 
 #include "crypto/Cryptography.h"
 
+#include <chrono>
+#include <optional>
+
+#if defined(__linux__) && defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
 namespace cryptography {
 
     std::string generateBase64Salt(size_t saltLengthBytes) {
         Botan::AutoSeeded_RNG rng;
-        return Botan::base64_encode(rng.random_vec(saltLengthBytes));
+        return base64Encode(rng.random_vec(saltLengthBytes));
     };
 
-    EncryptedBlob encrypt(
-        const std::string &plaintext,
-        const Botan::secure_vector<char>& masterPassword,
-        const std::string &algo,
-        const std::string &kdf,
-        const std::string &base64Salt,
-        int kdfIterations
-    ) {
-        // throw if passed algorithm isn't supported
+    // Whether the CPU accelerates AES-GCM (nullopt if that can't be told on this platform)
+    static std::optional<bool> hasHardwareAesGcm() {
+    #if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+        return __builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul");
+    #elif defined(__linux__) && defined(__aarch64__)
+        unsigned long hwcap = getauxval(AT_HWCAP);
+        return (hwcap & HWCAP_AES) && (hwcap & HWCAP_PMULL);
+    #else
+        return std::nullopt;
+    #endif
+    }
+
+    std::vector<AlgorithmThroughput> measureAlgorithms(size_t sampleSize) {
+        std::vector<AlgorithmThroughput> results;
+        const Botan::secure_vector<uint8_t> key(32);
+        const std::vector<uint8_t> nonce(12);
+
+        for (const std::string& algorithm : acceptedAlgorithms) {
+            const auto enc = Botan::AEAD_Mode::create(algorithm, Botan::Cipher_Dir::Encryption);
+            if (!enc)
+                continue;
+            enc->set_key(key);
+
+            double best = 0;
+            for (int run = 0; run < 3; run++) {
+                Botan::secure_vector<uint8_t> buffer(sampleSize);
+                const auto start = std::chrono::steady_clock::now();
+                enc->start(nonce);
+                enc->finish(buffer);
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (run == 0 || seconds < best)
+                    best = seconds;
+            }
+            results.push_back({algorithm, best > 0 ? sampleSize / best : 0});
+        }
+        return results;
+    }
+
+    std::string preferredAlgorithm() {
+        static const std::string preferred = [] {
+            std::optional<bool> hardwareAes = hasHardwareAesGcm();
+            if (hardwareAes.has_value())
+                return std::string(*hardwareAes ? "AES-256/GCM" : "ChaCha20Poly1305");
+
+            // Unknown platform: a quick probe (well below a millisecond per algorithm on anything recent)
+            std::vector<AlgorithmThroughput> results = measureAlgorithms(64 * 1024);
+            std::string fastest = acceptedAlgorithms.front();
+            double fastestThroughput = 0;
+            for (const AlgorithmThroughput& result : results) {
+                if (result.bytesPerSecond > fastestThroughput) {
+                    fastest = result.algorithm;
+                    fastestThroughput = result.bytesPerSecond;
+                }
+            }
+            return fastest;
+        }();
+        return preferred;
+    }
+
+    // throw if passed algorithm or KDF isn't supported
+    static void validateParameters(const std::string& algo, const std::string& kdf) {
         if (std::find(acceptedAlgorithms.begin(), acceptedAlgorithms.end(), algo) == acceptedAlgorithms.end()) {
             throw std::invalid_argument("Unsupported algorithm");
         }
 
-        // throw if passed KDF isn't supported
         if (std::find(acceptedKDFs.begin(), acceptedKDFs.end(), kdf) == acceptedKDFs.end()) {
             throw std::invalid_argument("Unsupported KDF");
         }
+    }
 
-        // Generate nonce
-        Botan::AutoSeeded_RNG rng;
-        Botan::secure_vector<uint8_t> nonce = rng.random_vec(12);
-
-        // Decode salt
-        Botan::secure_vector<uint8_t> salt = Botan::base64_decode(base64Salt);
-
-        // Derive key
+    static Botan::secure_vector<uint8_t> deriveKey(
+        const std::string& kdf,
+        int kdfIterations,
+        const Botan::secure_vector<char>& masterPassword,
+        const Botan::secure_vector<uint8_t>& salt
+    ) {
         std::unique_ptr<Botan::PasswordHashFamily> pbkdfFamily = Botan::PasswordHashFamily::create(kdf);
         if (!pbkdfFamily)
             throw std::runtime_error("Provided KDF algorithm not available");
@@ -48,26 +106,64 @@ namespace cryptography {
         const size_t keyLength = 32;
         Botan::secure_vector<uint8_t> key(keyLength);
         pbkdf->derive_key(key.data(), keyLength, masterPassword.data(), masterPassword.size(), salt.data(), salt.size());
+        return key;
+    }
+
+    EncryptedBlob encrypt(
+        std::string_view plaintext,
+        const Botan::secure_vector<char>& masterPassword,
+        const std::string &algo,
+        const std::string &kdf,
+        const std::string &base64Salt,
+        int kdfIterations
+    ) {
+        SecureBuffer buffer(plaintext.begin(), plaintext.end());
+        EncryptedBlob blob = encryptInPlace(buffer, masterPassword, algo, kdf, base64Salt, kdfIterations);
+        blob.base64Ciphertext = base64Encode(buffer.data(), buffer.size());
+        return blob;
+    }
+
+    EncryptedBlob encryptInPlace(
+        SecureBuffer& buffer,
+        const Botan::secure_vector<char>& masterPassword,
+        const std::string &algo,
+        const std::string &kdf,
+        const std::string &base64Salt,
+        int kdfIterations,
+        const std::string &compression
+    ) {
+        validateParameters(algo, kdf);
+
+        // Generate nonce
+        Botan::AutoSeeded_RNG rng;
+        Botan::secure_vector<uint8_t> nonce = rng.random_vec(12);
+
+        // Decode salt
+        Botan::secure_vector<uint8_t> salt = base64Decode<Botan::secure_vector<uint8_t>>(base64Salt);
+
+        // Derive key
+        Botan::secure_vector<uint8_t> key = deriveKey(kdf, kdfIterations, masterPassword, salt);
+
+        EncryptedBlob blob;
+        blob.algorithm = algo;
+        blob.kdf = kdf;
+        blob.kdfIterations = kdfIterations;
+        blob.base64Salt = base64Encode(salt);
+        blob.base64Nonce = base64Encode(nonce);
+        blob.compression = compression;
 
         // Encrypt
-        const auto enc = Botan::Cipher_Mode::create(algo, Botan::Cipher_Dir::Encryption);
+        const auto enc = Botan::AEAD_Mode::create(algo, Botan::Cipher_Dir::Encryption);
         if (!enc)
             throw std::runtime_error("AEAD algorithm not available");
 
         enc->set_key(key);
+        enc->set_associated_data(associatedData(blob));
         enc->start(nonce);
 
-        Botan::secure_vector<uint8_t> buffer(plaintext.begin(), plaintext.end());
+        // The tag gets appended to the buffer
         enc->finish(buffer);
 
-        EncryptedBlob blob;
-        blob.algorithm = algo;
-        blob.kdf = kdf;
-        blob.kdfIterations = kdfIterations;
-        blob.base64Salt = Botan::base64_encode(salt);
-        blob.base64Nonce = Botan::base64_encode(nonce);
-        blob.base64Ciphertext = Botan::base64_encode(buffer);
-
         return blob;
     }
 
@@ -75,52 +171,210 @@ namespace cryptography {
         EncryptedBlob encrypted,
         const Botan::secure_vector<char>& masterPassword
     ) {
-        // Validate algorithm and KDF
-        if (std::find(acceptedAlgorithms.begin(), acceptedAlgorithms.end(), encrypted.algorithm) == acceptedAlgorithms.end()) {
-            throw std::invalid_argument("Unsupported algorithm");
-        }
+        // Validate before touching the ciphertext
+        validateParameters(encrypted.algorithm, encrypted.kdf);
 
-        if (std::find(acceptedKDFs.begin(), acceptedKDFs.end(), encrypted.kdf) == acceptedKDFs.end()) {
-            throw std::invalid_argument("Unsupported KDF");
-        }
+        SecureBuffer buffer;
+        base64DecodeInto(encrypted.base64Ciphertext, buffer);
+        decryptInPlace(encrypted, masterPassword, buffer);
 
-        // Decode base64 data
-        Botan::secure_vector<uint8_t> salt = Botan::base64_decode(encrypted.base64Salt);
-        Botan::secure_vector<uint8_t> nonce = Botan::base64_decode(encrypted.base64Nonce);
-        Botan::secure_vector<uint8_t> ciphertext = Botan::base64_decode(encrypted.base64Ciphertext);
+        // Convert decrypted data back to string
+        return std::string(buffer.begin(), buffer.end());
+    }
 
-        // Derive key using same parameters
-        std::unique_ptr<Botan::PasswordHashFamily> pbkdfFamily = Botan::PasswordHashFamily::create(encrypted.kdf);
-        if (!pbkdfFamily)
-            throw std::runtime_error("Provided KDF algorithm not available");
+    void decryptInPlace(
+        const EncryptedBlob& encrypted,
+        const Botan::secure_vector<char>& masterPassword,
+        SecureBuffer& buffer
+    ) {
+        // Validate algorithm and KDF
+        validateParameters(encrypted.algorithm, encrypted.kdf);
 
-        std::unique_ptr<Botan::PasswordHash> pbkdf = pbkdfFamily->from_params(encrypted.kdfIterations);
-        if (!pbkdf)
-            throw std::runtime_error("Error instantiating pbkdf");
+        // Decode base64 data
+        Botan::secure_vector<uint8_t> salt = base64Decode<Botan::secure_vector<uint8_t>>(encrypted.base64Salt);
+        Botan::secure_vector<uint8_t> nonce = base64Decode<Botan::secure_vector<uint8_t>>(encrypted.base64Nonce);
 
-        const size_t keyLength = 32;
-        Botan::secure_vector<uint8_t> key(keyLength);
-        pbkdf->derive_key(key.data(), keyLength, masterPassword.data(), masterPassword.size(), salt.data(), salt.size());
+        // Derive key using same parameters
+        Botan::secure_vector<uint8_t> key = deriveKey(encrypted.kdf, encrypted.kdfIterations, masterPassword, salt);
 
         // Decrypt
-        const auto dec = Botan::Cipher_Mode::create(encrypted.algorithm, Botan::Cipher_Dir::Decryption);
+        const auto dec = Botan::AEAD_Mode::create(encrypted.algorithm, Botan::Cipher_Dir::Decryption);
         if (!dec)
             throw std::runtime_error("AEAD algorithm not available");
 
-        Botan::secure_vector<uint8_t> buffer;
         try {
             dec->set_key(key);
+            dec->set_associated_data(associatedData(encrypted));
             dec->start(nonce);
 
-            // For GCM, ciphertext already contains the authentication tag
-            buffer = ciphertext;
+            // The ciphertext already contains the authentication tag (GCM and Poly1305 both append it). finish() verifies it and shrinks the buffer to the plaintext
             dec->finish(buffer);
         } catch (std::exception& e) {
             throw std::runtime_error("Decryption failed");
         }
+    }
 
-        // Convert decrypted data back to string
-        return std::string(buffer.begin(), buffer.end());
+    std::vector<uint8_t> associatedData(const EncryptedBlob& blob) {
+        if (blob.compression.empty())
+            return {};
+
+        // Every field is length-prefixed so that the encoding is unambiguous
+        std::vector<uint8_t> ad;
+        auto append = [&ad](const std::string& field) {
+            uint32_t length = static_cast<uint32_t>(field.size());
+            for (int shift = 24; shift >= 0; shift -= 8)
+                ad.push_back(static_cast<uint8_t>(length >> shift));
+            ad.insert(ad.end(), field.begin(), field.end());
+        };
+        append("manpass-vault-header");
+        append(blob.algorithm);
+        append(blob.kdf);
+        append(std::to_string(blob.kdfIterations));
+        append(blob.base64Salt);
+        append(blob.compression);
+        if (blob.chunkSize > 0)
+            append(std::to_string(blob.chunkSize));
+        return ad;
+    }
+
+    void base64DecodeInto(std::string_view base64, SecureBuffer& buffer) {
+        buffer.resize(base64DecodedMaxSize(base64.size()));
+        size_t written = base64Decode(base64, buffer.data());
+        buffer.resize(written);
+    }
+
+    static const size_t noncePrefixSize = 7;
+
+    // prefix || counter (big endian) || last chunk flag
+    static std::vector<uint8_t> chunkNonce(const std::vector<uint8_t>& prefix, uint32_t counter, bool last) {
+        std::vector<uint8_t> nonce(prefix);
+        for (int shift = 24; shift >= 0; shift -= 8)
+            nonce.push_back(static_cast<uint8_t>(counter >> shift));
+        nonce.push_back(last ? 1 : 0);
+        return nonce;
+    }
+
+    StreamEncryptor::StreamEncryptor(
+        const Botan::secure_vector<char>& masterPassword,
+        const std::string& algo,
+        const std::string& kdf,
+        const std::string& base64Salt,
+        int kdfIterations,
+        const std::string& compression,
+        ByteSink sink_val,
+        size_t chunkSize
+    ) : sink(std::move(sink_val)) {
+        validateParameters(algo, kdf);
+        if (chunkSize == 0 || chunkSize > maxChunkSize)
+            throw std::invalid_argument("Invalid chunk size");
+
+        Botan::AutoSeeded_RNG rng;
+        Botan::secure_vector<uint8_t> prefix = rng.random_vec(noncePrefixSize);
+        noncePrefix.assign(prefix.begin(), prefix.end());
+
+        Botan::secure_vector<uint8_t> salt = base64Decode<Botan::secure_vector<uint8_t>>(base64Salt);
+        Botan::secure_vector<uint8_t> key = deriveKey(kdf, kdfIterations, masterPassword, salt);
+
+        blob.algorithm = algo;
+        blob.kdf = kdf;
+        blob.kdfIterations = kdfIterations;
+        blob.base64Salt = base64Encode(salt);
+        blob.base64Nonce = base64Encode(noncePrefix);
+        blob.compression = compression;
+        blob.chunkSize = chunkSize;
+
+        mode = Botan::AEAD_Mode::create(algo, Botan::Cipher_Dir::Encryption);
+        if (!mode)
+            throw std::runtime_error("AEAD algorithm not available");
+        mode->set_key(key);
+        associatedHeader = associatedData(blob);
+        pending.reserve(chunkSize + mode->tag_size());
+    }
+
+    const EncryptedBlob& StreamEncryptor::getBlob() const {
+        return blob;
+    }
+
+    void StreamEncryptor::write(const uint8_t* data, size_t size) {
+        while (size > 0) {
+            // A full chunk is only sealed once more data arrives, because until then it could be the last one
+            if (pending.size() == blob.chunkSize)
+                sealChunk(false);
+
+            size_t length = std::min(size, blob.chunkSize - pending.size());
+            pending.insert(pending.end(), data, data + length);
+            data += length;
+            size -= length;
+        }
+    }
+
+    void StreamEncryptor::finish() {
+        sealChunk(true);
+    }
+
+    void StreamEncryptor::sealChunk(bool last) {
+        if (counter == UINT32_MAX)
+            throw std::runtime_error("Too many chunks");
+
+        // Set for every chunk, not every mode keeps associated data across messages
+        mode->set_associated_data(associatedHeader);
+        mode->start(chunkNonce(noncePrefix, counter++, last));
+        mode->finish(pending);
+        sink(pending.data(), pending.size());
+        pending.clear();
+    }
+
+    StreamDecryptor::StreamDecryptor(const EncryptedBlob& blob, const Botan::secure_vector<char>& masterPassword, ByteSink sink_val) :
+        sink(std::move(sink_val)) {
+        validateParameters(blob.algorithm, blob.kdf);
+        if (blob.chunkSize == 0 || blob.chunkSize > maxChunkSize)
+            throw std::invalid_argument("Invalid chunk size");
+
+        Botan::secure_vector<uint8_t> salt = base64Decode<Botan::secure_vector<uint8_t>>(blob.base64Salt);
+        Botan::secure_vector<uint8_t> prefix = base64Decode<Botan::secure_vector<uint8_t>>(blob.base64Nonce);
+        if (prefix.size() != noncePrefixSize)
+            throw std::runtime_error("Decryption failed");
+        noncePrefix.assign(prefix.begin(), prefix.end());
+
+        Botan::secure_vector<uint8_t> key = deriveKey(blob.kdf, blob.kdfIterations, masterPassword, salt);
+
+        mode = Botan::AEAD_Mode::create(blob.algorithm, Botan::Cipher_Dir::Decryption);
+        if (!mode)
+            throw std::runtime_error("AEAD algorithm not available");
+        mode->set_key(key);
+        associatedHeader = associatedData(blob);
+        sealedChunkSize = blob.chunkSize + mode->tag_size();
+        pending.reserve(sealedChunkSize);
+    }
+
+    void StreamDecryptor::write(const uint8_t* data, size_t size) {
+        while (size > 0) {
+            if (pending.size() == sealedChunkSize)
+                openChunk(false);
+
+            size_t length = std::min(size, sealedChunkSize - pending.size());
+            pending.insert(pending.end(), data, data + length);
+            data += length;
+            size -= length;
+        }
+    }
+
+    void StreamDecryptor::finish() {
+        openChunk(true);
+    }
+
+    void StreamDecryptor::openChunk(bool last) {
+        try {
+            if (counter == UINT32_MAX)
+                throw std::runtime_error("Too many chunks");
+            mode->set_associated_data(associatedHeader);
+            mode->start(chunkNonce(noncePrefix, counter++, last));
+            mode->finish(pending);
+        } catch (std::exception& e) {
+            throw std::runtime_error("Decryption failed");
+        }
+        sink(pending.data(), pending.size());
+        pending.clear();
     }
 
-} // namespace cryptography
\ No newline at end of file
+} // namespace cryptography
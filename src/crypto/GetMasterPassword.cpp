@@ -46,14 +46,14 @@ namespace cryptography {
         return true;
     }
 
-    void interruptSignalHandler(int signalNumber) {
+    void interruptSignalHandler(int) {
         gInterruptedFlag = 1;
     }
 
     Botan::secure_vector<char> getMasterPassword() {
         // Using non-interactive input methods (e.g. piping from a file) is usually insecure
         if (!isatty(STDIN_FILENO)) {
-            throw std::runtime_error("Reading password from non-interactive input is not allowed.");
+            throw std::runtime_error("Reading password from non-interactive input is not allowed. Use --password-fd, --keyfile or --agent");
         }
 
         TerminalSettingsManager termManager(STDIN_FILENO);
@@ -70,7 +70,12 @@ namespace cryptography {
             perror("sigaction (set SIGINT handler)");
         }
 
-        std::cout << "Master password: " << std::flush;
+        // Stdout may be redirected (e.g. export writes the entries to it), the prompt goes to the terminal then
+        bool promptToStdout = isatty(STDOUT_FILENO);
+        std::ostream& prompt = promptToStdout ? std::cout : std::cerr;
+        int echoFd = promptToStdout ? STDOUT_FILENO : STDERR_FILENO;
+
+        prompt << "Master password: " << std::flush;
         Botan::secure_vector<char> password;
 
         char ch;
@@ -90,22 +95,22 @@ namespace cryptography {
 
             // EOF
             if (bytesRead == 0) {
-                std::cout << std::endl;
+                prompt << std::endl;
                 break;
             }
 
             if (ch == '\n' || ch == '\r') { // Enter key
-                std::cout << std::endl;
+                prompt << std::endl;
                 break;
             } else if (ch == 127 || ch == '\b') { // Backspace key
                 if (!password.empty()) {
                     password.pop_back();
                     // Visual feedback for backspace: move cursor left, print space, move cursor left again
-                    write(STDOUT_FILENO, "\b \b", 3);
+                    write(echoFd, "\b \b", 3);
                 }
             } else if (isprint(static_cast<unsigned char>(ch))) { // Printable character
                 password.push_back(ch);
-                write(STDOUT_FILENO, "*", 1);
+                write(echoFd, "*", 1);
             }
         }
 
@@ -0,0 +1,113 @@
+#include "crypto/KeySource.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <botan/hash.h>
+#include <unistd.h>
+#include "agent/AgentProtocol.h"
+#include "crypto/GetMasterPassword.h"
+
+namespace cryptography {
+
+    namespace {
+        // Longest password read from a descriptor (a line that long is not a password)
+        constexpr size_t maxPasswordLength = 64 * 1024;
+
+        Botan::secure_vector<char> toHex(const Botan::secure_vector<uint8_t>& digest) {
+            static const char* hexDigits = "0123456789abcdef";
+            Botan::secure_vector<char> hex;
+            hex.reserve(digest.size() * 2);
+            for (uint8_t byte : digest) {
+                hex.push_back(hexDigits[byte >> 4]);
+                hex.push_back(hexDigits[byte & 0x0F]);
+            }
+            return hex;
+        }
+    }
+
+    TerminalKeySource::TerminalKeySource(bool confirm) : confirm(confirm) {}
+
+    Botan::secure_vector<char> TerminalKeySource::getPassword(const std::string&) {
+        Botan::secure_vector<char> password = getMasterPassword();
+        if (confirm) {
+            std::cout << "Repeat the password" << std::endl;
+            if (getMasterPassword() != password)
+                throw std::runtime_error("The passwords don't match");
+        }
+        return password;
+    }
+
+    FdKeySource::FdKeySource(int fd) : fd(fd) {
+        if (fd < 0)
+            throw std::invalid_argument("Password file descriptor must not be negative");
+    }
+
+    Botan::secure_vector<char> FdKeySource::getPassword(const std::string&) {
+        // A byte at a time, so nothing after the line is consumed (the descriptor may be stdin, read again later)
+        Botan::secure_vector<char> password;
+        char c;
+        while (true) {
+            ssize_t got = read(fd, &c, 1);
+            if (got < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Failed to read the password from descriptor " + std::to_string(fd) + ": " + strerror(errno));
+            }
+            // The last line may end without a line break, a descriptor with nothing left is an error
+            if (got == 0) {
+                if (password.empty())
+                    throw std::runtime_error("No password left to read from descriptor " + std::to_string(fd));
+                break;
+            }
+            if (c == '\n')
+                break;
+            if (password.size() == maxPasswordLength)
+                throw std::runtime_error("Password read from descriptor " + std::to_string(fd) + " is too long");
+            password.push_back(c);
+        }
+        if (!password.empty() && password.back() == '\r')
+            password.pop_back();
+        return password;
+    }
+
+    KeyfileKeySource::KeyfileKeySource(std::filesystem::path path, std::unique_ptr<KeySource> passwordSource) :
+        path(std::move(path)), passwordSource(std::move(passwordSource)) {}
+
+    Botan::secure_vector<char> KeyfileKeySource::getPassword(const std::string& vaultName) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Failed to open keyfile: " + path.string());
+
+        auto hash = Botan::HashFunction::create_or_throw("SHA-256");
+        Botan::secure_vector<uint8_t> block(64 * 1024);
+        while (file) {
+            file.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(block.size()));
+            hash->update(block.data(), static_cast<size_t>(file.gcount()));
+        }
+        if (file.bad())
+            throw std::runtime_error("Failed to read keyfile: " + path.string());
+        Botan::secure_vector<uint8_t> keyfileDigest = hash->final();
+
+        if (!passwordSource)
+            return toHex(keyfileDigest);
+
+        Botan::secure_vector<char> password = passwordSource->getPassword(vaultName);
+        hash->update(reinterpret_cast<const uint8_t*>(password.data()), password.size());
+        Botan::secure_vector<uint8_t> passwordDigest = hash->final();
+        hash->update(passwordDigest.data(), passwordDigest.size());
+        hash->update(keyfileDigest.data(), keyfileDigest.size());
+        return toHex(hash->final());
+    }
+
+    AgentKeySource::AgentKeySource(std::string socketPath) : socketPath(std::move(socketPath)) {}
+
+    Botan::secure_vector<char> AgentKeySource::getPassword(const std::string& vaultName) {
+        agent::AgentClient client(socketPath);
+        std::string_view password = client.request(agent::Opcode::GET_KEY, {vaultName}).readField();
+        return Botan::secure_vector<char>(password.begin(), password.end());
+    }
+
+} // namespace cryptography
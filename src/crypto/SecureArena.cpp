@@ -0,0 +1,198 @@
+#include "crypto/SecureArena.h"
+
+#include <botan/mem_ops.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <istream>
+#include <new>
+#include <stdexcept>
+
+namespace cryptography {
+
+    static size_t pageSize() {
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    static size_t roundUp(size_t value, size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    SecureArena::SecureArena(size_t chunkSize_val) : chunkSize(roundUp(chunkSize_val, pageSize())) {
+        maxPooledSize = chunkSize / 4;
+        freeLists.resize(sizeClass(maxPooledSize) + 1);
+    }
+
+    SecureArena::~SecureArena() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Region& chunk : chunks) {
+            unmapRegion(chunk);
+        }
+        for (auto& [ptr, region] : largeRegions) {
+            unmapRegion(region);
+        }
+    }
+
+    SecureArena& SecureArena::global() {
+        static SecureArena arena;
+        return arena;
+    }
+
+    // Size classes are powers of two starting at minBlockSize
+    size_t SecureArena::sizeClass(size_t size) {
+        size_t index = 0;
+        size_t blockSize = minBlockSize;
+        while (blockSize < size) {
+            blockSize <<= 1;
+            index++;
+        }
+        return index;
+    }
+
+    void* SecureArena::allocate(size_t size) {
+        if (size == 0)
+            size = 1;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (size > maxPooledSize) {
+            Region region = mapRegion(roundUp(size, pageSize()));
+            region.used = region.size;
+            largeRegions.emplace(region.base, region);
+            inUse += region.size;
+            return region.base;
+        }
+
+        size_t index = sizeClass(size);
+        size_t blockSize = minBlockSize << index;
+        inUse += blockSize;
+
+        // Recycle a previously freed (already wiped) block of the same class
+        std::vector<void*>& freeList = freeLists[index];
+        if (!freeList.empty()) {
+            void* block = freeList.back();
+            freeList.pop_back();
+            return block;
+        }
+
+        // Otherwise bump-allocate from the newest chunk (block sizes keep every block 16-byte aligned)
+        if (chunks.empty() || chunks.back().size - chunks.back().used < blockSize) {
+            chunks.push_back(mapRegion(chunkSize));
+        }
+        Region& chunk = chunks.back();
+        void* block = chunk.base + chunk.used;
+        chunk.used += blockSize;
+        return block;
+    }
+
+    void SecureArena::deallocate(void* ptr, size_t size) {
+        if (ptr == nullptr)
+            return;
+        if (size == 0)
+            size = 1;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (size > maxPooledSize) {
+            auto it = largeRegions.find(ptr);
+            if (it == largeRegions.end())
+                return;
+            inUse -= it->second.size;
+            unmapRegion(it->second);
+            largeRegions.erase(it);
+            return;
+        }
+
+        size_t index = sizeClass(size);
+        size_t blockSize = minBlockSize << index;
+        Botan::secure_scrub_memory(ptr, blockSize);
+        inUse -= blockSize;
+        freeLists[index].push_back(ptr);
+    }
+
+    void SecureArena::reset() {
+        if (this == &global())
+            throw std::logic_error("The global secure arena can't be reset");
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (Region& chunk : chunks) {
+            Botan::secure_scrub_memory(chunk.base, chunk.used);
+            chunk.used = 0;
+        }
+        // Keep only the first chunk around for reuse
+        while (chunks.size() > 1) {
+            unmapRegion(chunks.back());
+            chunks.pop_back();
+        }
+        for (auto& [ptr, region] : largeRegions) {
+            unmapRegion(region);
+        }
+        largeRegions.clear();
+        for (std::vector<void*>& freeList : freeLists) {
+            freeList.clear();
+        }
+        inUse = 0;
+    }
+
+    size_t SecureArena::bytesInUse() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return inUse;
+    }
+
+    size_t SecureArena::bytesLocked() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return locked;
+    }
+
+    bool SecureArena::contains(const void* ptr) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto inside = [ptr](const Region& region) {
+            auto address = reinterpret_cast<uintptr_t>(ptr), base = reinterpret_cast<uintptr_t>(region.base);
+            return address >= base && address < base + region.size;
+        };
+        return std::any_of(chunks.begin(), chunks.end(), inside)
+            || std::any_of(largeRegions.begin(), largeRegions.end(), [&](const auto& large) { return inside(large.second); });
+    }
+
+    SecureArena::Region SecureArena::mapRegion(size_t size) {
+        void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            throw std::bad_alloc();
+
+    #ifdef MADV_DONTDUMP
+        madvise(base, size, MADV_DONTDUMP);
+    #endif
+
+        Region region{static_cast<uint8_t*>(base), size, 0, mlock(base, size) == 0};
+        if (region.locked)
+            locked += size;
+        return region;
+    }
+
+    void SecureArena::unmapRegion(Region& region) {
+        Botan::secure_scrub_memory(region.base, region.size);
+        if (region.locked) {
+            munlock(region.base, region.size);
+            locked -= region.size;
+        }
+        munmap(region.base, region.size);
+    }
+
+    std::istream& getline(std::istream& in, SecureString& out, char delim) {
+        out.clear();
+        std::istream::sentry sentry(in, true);
+        if (!sentry)
+            return in;
+        bool extracted = false;
+        for (int c; (c = in.rdbuf()->sbumpc()) != std::char_traits<char>::eof();) {
+            extracted = true;
+            if (static_cast<char>(c) == delim)
+                return in;
+            out.push_back(static_cast<char>(c));
+        }
+        in.setstate(extracted ? std::ios::eofbit : std::ios::eofbit | std::ios::failbit);
+        return in;
+    }
+
+} // namespace cryptography
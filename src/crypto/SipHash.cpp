@@ -0,0 +1,71 @@
+#include "crypto/SipHash.h"
+
+#include <cstring>
+#include <botan/auto_rng.h>
+
+namespace cryptography {
+
+    namespace {
+        uint64_t rotl(uint64_t x, int b) {
+            return (x << b) | (x >> (64 - b));
+        }
+
+        uint64_t load64le(const uint8_t* p) {
+            uint64_t value = 0;
+            for (int i = 7; i >= 0; i--) {
+                value = (value << 8) | p[i];
+            }
+            return value;
+        }
+
+        struct SipState {
+            uint64_t v0, v1, v2, v3;
+
+            void round() {
+                v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+                v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+                v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+                v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+            }
+
+            void compress(uint64_t m) {
+                v3 ^= m;
+                round();
+                round();
+                v0 ^= m;
+            }
+        };
+    }
+
+    uint64_t sipHash24(const SipHashKey& key, const uint8_t* data, size_t size) {
+        uint64_t k0 = load64le(key.data());
+        uint64_t k1 = load64le(key.data() + 8);
+        SipState state{k0 ^ 0x736f6d6570736575ULL, k1 ^ 0x646f72616e646f6dULL,
+                       k0 ^ 0x6c7967656e657261ULL, k1 ^ 0x7465646279746573ULL};
+
+        size_t blocks = size / 8;
+        for (size_t i = 0; i < blocks; i++) {
+            state.compress(load64le(data + i * 8));
+        }
+
+        // Last block: remaining bytes and the length in the top byte
+        uint8_t tail[8] = {};
+        std::memcpy(tail, data + blocks * 8, size % 8);
+        tail[7] = static_cast<uint8_t>(size);
+        state.compress(load64le(tail));
+
+        state.v2 ^= 0xff;
+        for (int i = 0; i < 4; i++) {
+            state.round();
+        }
+        return state.v0 ^ state.v1 ^ state.v2 ^ state.v3;
+    }
+
+    SipHashKey generateSipHashKey() {
+        SipHashKey key;
+        Botan::AutoSeeded_RNG rng;
+        rng.randomize(key.data(), key.size());
+        return key;
+    }
+
+} // namespace cryptography
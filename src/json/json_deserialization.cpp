@@ -6,6 +6,7 @@
 #include "vault/Entry.h"
 #include "vault/CredentialEntry.h"
 #include "vault/NoteEntry.h"
+#include "vault/AttachmentEntry.h"
 #include "json/json.hpp"
 
 using json = nlohmann::json;
@@ -19,7 +20,7 @@ void from_json(const json& j, CredentialEntry& entry) {
     if (!j.contains("password") || !j["password"].is_string())
         throw std::invalid_argument("Password is missing or is not a string");
 
-    entry = CredentialEntry{j["username"], j["password"]};
+    entry = CredentialEntry{j["username"].get_ref<const std::string&>(), j["password"].get_ref<const std::string&>()};
 }
 
 // deserialize NoteEntry
@@ -27,9 +28,26 @@ void from_json(const json& j, NoteEntry& entry) {
     if (!j.contains("text") || !j["text"].is_string())
         throw std::invalid_argument("Note text is missing or is not a string");
 
-    entry = NoteEntry{j["text"]};
+    entry = NoteEntry{j["text"].get_ref<const std::string&>()};
 }
 
+// deserialize AttachmentEntry
+void from_json(const json& j, AttachmentEntry& entry) {
+    if (!j.contains("fileName") || !j["fileName"].is_string())
+        throw std::invalid_argument("Attachment file name is missing or is not a string");
+    if (!j.contains("size") || !j["size"].is_number_unsigned())
+        throw std::invalid_argument("Attachment size is missing or is not a number");
+    if (!j.contains("chunks") || !j["chunks"].is_array())
+        throw std::invalid_argument("Attachment chunks is missing or is not an array");
+
+    std::vector<cryptography::SecureString> chunkKeys;
+    for (const auto& key : j["chunks"]) {
+        if (!key.is_string())
+            throw std::invalid_argument("Attachment chunk key is not a string");
+        chunkKeys.emplace_back(key.get_ref<const std::string&>());
+    }
+    entry = AttachmentEntry{j["fileName"].get_ref<const std::string&>(), j["size"].get<uint64_t>(), std::move(chunkKeys)};
+}
 
 // template to prevent code duplication in the following parseEntry function
 template<typename T, typename... Args>
@@ -43,13 +61,41 @@ std::unique_ptr<Entry> make_and_load(const json& j, Args&&... args) {
 std::unique_ptr<Entry> parseEntry(const json& j) {
     std::string type = j["type"];
 
+    std::unique_ptr<Entry> entry;
     if (type == "CREDENTIAL") {
-        return make_and_load<CredentialEntry>(j, "", "");
+        entry = make_and_load<CredentialEntry>(j, "", "");
     } else if (type == "NOTE") {
-        return make_and_load<NoteEntry>(j, "");
+        entry = make_and_load<NoteEntry>(j, "");
+    } else if (type == "ATTACHMENT") {
+        entry = make_and_load<AttachmentEntry>(j, "", 0, std::vector<cryptography::SecureString>{});
     } else {
         throw std::invalid_argument("Unknown entry type");
     }
+
+    if (j.contains("history")) {
+        if (!j["history"].is_array())
+            throw std::invalid_argument("Entry history is not an array");
+        entry->getHistory().setRaw(j["history"].dump());
+    }
+
+    EntryMetadata& metadata = entry->getMetadata();
+    for (auto [key, field] : {std::pair{"created", &metadata.created}, {"modified", &metadata.modified}, {"lastUsed", &metadata.lastUsed}}) {
+        if (!j.contains(key))
+            continue;
+        if (!j[key].is_number_integer())
+            throw std::invalid_argument(std::string("Entry ") + key + " is not a number");
+        *field = j[key].get<int64_t>();
+    }
+    if (j.contains("tags")) {
+        if (!j["tags"].is_array())
+            throw std::invalid_argument("Entry tags is not an array");
+        for (const auto& tag : j["tags"]) {
+            if (!tag.is_string())
+                throw std::invalid_argument("Entry tag is not a string");
+            metadata.addTag(tag.get_ref<const std::string&>());
+        }
+    }
+    return entry;
 }
 
 // deserialize Folder
@@ -77,6 +123,11 @@ void from_json(const json& j, Vault& vault) {
         throw std::invalid_argument("Vault folders is missing or is not an array");
 
     vault = Vault(j["name"]);
+    if (j.contains("historyRetention")) {
+        if (!j["historyRetention"].is_number_unsigned())
+            throw std::invalid_argument("History retention is not a non-negative number");
+        vault.historyRetention = j["historyRetention"].get<size_t>();
+    }
 
     for (const auto& folder_json : j["folders"]) {
         if (!folder_json.contains("name") || !folder_json["name"].is_string())
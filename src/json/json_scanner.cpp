@@ -0,0 +1,113 @@
+#include "json/JsonScanner.h"
+
+namespace vault {
+
+    JsonScanner::JsonScanner(std::string_view text_val, size_t position) : text(text_val), pos(position) {}
+
+    size_t JsonScanner::position() const {
+        return pos;
+    }
+
+    void JsonScanner::skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t'))
+            pos++;
+    }
+
+    bool JsonScanner::consume(char c) {
+        skipWhitespace();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    char JsonScanner::peek() {
+        skipWhitespace();
+        return pos < text.size() ? text[pos] : '\0';
+    }
+
+    void JsonScanner::expect(char c) {
+        if (!consume(c))
+            fail(std::string("expected '") + c + "'");
+    }
+
+    std::string_view JsonScanner::readRawString() {
+        expect('"');
+        size_t start = pos;
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (c == '"') {
+                std::string_view raw = text.substr(start, pos - start);
+                pos++;
+                return raw;
+            }
+            // Skip the escaped character so that \" doesn't end the string
+            pos += (c == '\\') ? 2 : 1;
+        }
+        fail("unterminated string");
+    }
+
+    std::string JsonScanner::readString() {
+        return decodeJsonString<std::string>(readRawString());
+    }
+
+    long long JsonScanner::readInteger() {
+        skipWhitespace();
+        size_t start = pos;
+        if (pos < text.size() && text[pos] == '-')
+            pos++;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+            pos++;
+        if (pos == start || (pos == start + 1 && text[start] == '-'))
+            fail("expected an integer");
+        return std::stoll(std::string(text.substr(start, pos - start)));
+    }
+
+    void JsonScanner::skipValue() {
+        skipWhitespace();
+        if (pos >= text.size())
+            fail("unexpected end of input");
+
+        switch (text[pos]) {
+            case '"':
+                readRawString();
+                return;
+            case '{':
+                forEachMember([this](std::string_view) { skipValue(); });
+                return;
+            case '[':
+                forEachElement([this]() { skipValue(); });
+                return;
+            default: {
+                // Numbers, true, false and null. The grammar is validated when the value is actually parsed
+                size_t start = pos;
+                while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']' &&
+                       text[pos] != ' ' && text[pos] != '\n' && text[pos] != '\r' && text[pos] != '\t')
+                    pos++;
+                if (pos == start)
+                    fail("unexpected character");
+            }
+        }
+    }
+
+    void JsonScanner::fail(const std::string& message) const {
+        throw std::invalid_argument("Malformed JSON at offset " + std::to_string(pos) + ": " + message);
+    }
+
+    uint32_t detail::parseHex4(std::string_view raw, size_t at) {
+        if (at + 4 > raw.size())
+            throw std::invalid_argument("Malformed JSON: truncated \\u escape");
+        uint32_t value = 0;
+        for (size_t i = at; i < at + 4; i++) {
+            char c = raw[i];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else throw std::invalid_argument("Malformed JSON: invalid \\u escape");
+        }
+        return value;
+    }
+
+} // namespace vault
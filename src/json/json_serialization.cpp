@@ -6,7 +6,9 @@
 #include "vault/Entry.h"
 #include "vault/CredentialEntry.h"
 #include "vault/NoteEntry.h"
+#include "vault/AttachmentEntry.h"
 #include "json/json.hpp"
+#include "json/JsonScanner.h"
 
 using json = nlohmann::json;
 
@@ -16,8 +18,8 @@ namespace vault {
 void to_json(json& j, const CredentialEntry& entry) {
     j = json{
         {"type", "CREDENTIAL"},
-        {"username", entry.username},
-        {"password", entry.password}
+        {"username", entry.getUsername()},
+        {"password", entry.getPassword()}
     };
 }
 
@@ -25,7 +27,21 @@ void to_json(json& j, const CredentialEntry& entry) {
 void to_json(json& j, const NoteEntry& entry) {
     j = json {
         {"type", "NOTE"},
-        {"text", entry.noteText}
+        {"text", entry.getNoteText()}
+    };
+}
+
+// serialize AttachmentEntry
+void to_json(json& j, const AttachmentEntry& entry) {
+    json chunks = json::array();
+    for (const auto& key : entry.getChunkKeys()) {
+        chunks.push_back(std::string_view(key));
+    }
+    j = json {
+        {"type", "ATTACHMENT"},
+        {"fileName", entry.getFileName()},
+        {"size", entry.getSize()},
+        {"chunks", chunks}
     };
 }
 
@@ -38,7 +54,22 @@ void to_json(json& j, const Entry& entry) {
         case EntryType::NOTE:
             to_json(j, dynamic_cast<const NoteEntry&>(entry));
             break;
+        case EntryType::ATTACHMENT:
+            to_json(j, dynamic_cast<const AttachmentEntry&>(entry));
+            break;
     }
+    if (!entry.getHistory().empty())
+        j["history"] = json::parse(entry.getHistory().raw());
+
+    const EntryMetadata& metadata = entry.getMetadata();
+    if (metadata.created != 0)
+        j["created"] = metadata.created;
+    if (metadata.modified != 0)
+        j["modified"] = metadata.modified;
+    if (metadata.lastUsed != 0)
+        j["lastUsed"] = metadata.lastUsed;
+    if (!metadata.tags.empty())
+        j["tags"] = metadata.tags;
 }
 
 // serialize Folder
@@ -55,6 +86,7 @@ void to_json(json& j, const Folder& folder) {
 // serialize Vault
 void to_json(json& j, const Vault& vault) {
     j["name"] = vault.vaultName;
+    j["historyRetention"] = vault.historyRetention;
     j["folders"] = json::array();
     for (const auto& [name, folder] : vault.folders) {
         json folderJson = *folder;
@@ -63,5 +95,150 @@ void to_json(json& j, const Vault& vault) {
     }
 }
 
+// Shared by serializeVault and EntryHistory (revisions are stored in the same form as entries)
+// Members are written in the order json::dump uses, so the common ones go in between the type specific ones
+template<typename Container>
+void appendEntryMembers(Container& out, const Entry& entry, const std::string* name, const EntryMetadata* metadata,
+                        std::string_view history) {
+    bool first = true;
+    auto member = [&](std::string_view key) {
+        if (!first)
+            out.push_back(',');
+        first = false;
+        appendJsonString(out, key);
+        out.push_back(':');
+    };
+    auto timestamp = [&](std::string_view key, int64_t value) {
+        if (value != 0) {
+            member(key);
+            appendRaw(out, std::to_string(value));
+        }
+    };
+    auto created = [&]() {
+        if (metadata)
+            timestamp("created", metadata->created);
+    };
+    // "history", "lastUsed", "modified" and "name" are next to each other in every entry type
+    auto historyToName = [&]() {
+        if (!history.empty()) {
+            member("history");
+            appendRaw(out, history);
+        }
+        if (metadata) {
+            timestamp("lastUsed", metadata->lastUsed);
+            timestamp("modified", metadata->modified);
+        }
+        if (name) {
+            member("name");
+            appendJsonString(out, *name);
+        }
+    };
+    auto tags = [&]() {
+        if (!metadata || metadata->tags.empty())
+            return;
+        member("tags");
+        out.push_back('[');
+        for (size_t i = 0; i < metadata->tags.size(); i++) {
+            if (i > 0)
+                out.push_back(',');
+            appendJsonString(out, metadata->tags[i]);
+        }
+        out.push_back(']');
+    };
+
+    switch (entry.getType()) {
+        case EntryType::CREDENTIAL: {
+            const auto& credential = dynamic_cast<const CredentialEntry&>(entry);
+            created();
+            historyToName();
+            member("password");
+            appendJsonString(out, credential.getPassword());
+            tags();
+            member("type");
+            appendRaw(out, "\"CREDENTIAL\"");
+            member("username");
+            appendJsonString(out, credential.getUsername());
+            break;
+        }
+        case EntryType::NOTE: {
+            const auto& note = dynamic_cast<const NoteEntry&>(entry);
+            created();
+            historyToName();
+            tags();
+            member("text");
+            appendJsonString(out, note.getNoteText());
+            member("type");
+            appendRaw(out, "\"NOTE\"");
+            break;
+        }
+        case EntryType::ATTACHMENT: {
+            const auto& attachment = dynamic_cast<const AttachmentEntry&>(entry);
+            member("chunks");
+            out.push_back('[');
+            bool firstChunk = true;
+            for (const auto& key : attachment.getChunkKeys()) {
+                if (!firstChunk)
+                    out.push_back(',');
+                firstChunk = false;
+                appendJsonString(out, key);
+            }
+            out.push_back(']');
+            created();
+            member("fileName");
+            appendJsonString(out, attachment.getFileName());
+            historyToName();
+            member("size");
+            appendRaw(out, std::to_string(attachment.getSize()));
+            tags();
+            member("type");
+            appendRaw(out, "\"ATTACHMENT\"");
+            break;
+        }
+    }
+}
+
+template void appendEntryMembers(cryptography::SecureBuffer& out, const Entry& entry, const std::string* name,
+                                 const EntryMetadata* metadata, std::string_view history);
+template void appendEntryMembers(cryptography::SecureString& out, const Entry& entry, const std::string* name,
+                                 const EntryMetadata* metadata, std::string_view history);
+
+// Writes the serialized vault straight into a secure buffer.
+// Produces the same document as to_json, but without a json DOM holding copies of every secret on the regular heap
+void serializeVault(const Vault& vault, cryptography::SecureBuffer& out) {
+    serializeVault(vault, out, SIZE_MAX, [](cryptography::SecureBuffer&) {});
+}
+
+void serializeVault(const Vault& vault, cryptography::SecureBuffer& out, size_t flushThreshold,
+                    const std::function<void(cryptography::SecureBuffer&)>& flush) {
+    appendRaw(out, "{\"folders\":[");
+    bool firstFolder = true;
+    for (const auto& [folderName, folder] : vault.folders) {
+        if (!firstFolder)
+            out.push_back(',');
+        firstFolder = false;
+
+        appendRaw(out, "{\"entries\":[");
+        bool firstEntry = true;
+        for (const auto& [entryName, entry] : folder->entries) {
+            if (!firstEntry)
+                out.push_back(',');
+            firstEntry = false;
+
+            out.push_back('{');
+            appendEntryMembers(out, *entry, &entryName, &entry->getMetadata(), entry->getHistory().raw());
+            out.push_back('}');
+            if (out.size() >= flushThreshold)
+                flush(out);
+        }
+        appendRaw(out, "],\"name\":");
+        appendJsonString(out, folderName);
+        out.push_back('}');
+    }
+    appendRaw(out, "],\"historyRetention\":");
+    appendRaw(out, std::to_string(vault.historyRetention));
+    appendRaw(out, ",\"name\":");
+    appendJsonString(out, vault.vaultName);
+    out.push_back('}');
+}
 
 } // namespace vault
\ No newline at end of file
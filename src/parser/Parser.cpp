@@ -4,6 +4,11 @@
 
 #include "parser/Parser.h"
 
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include "vault/PathPattern.h"
+
 namespace parser {
     Parser::Parser(int argc_val, char** argv_val): argc(argc_val), argv(argv_val) {}
 
@@ -13,34 +18,74 @@ namespace parser {
 
         CLI::App app;
         app.require_subcommand(1);
+        // The key source options can also follow the subcommand
+        app.fallthrough();
+
+        // Options for key sources (all commands)
+        KeySourceArgs keySource;
+        int passwordFd = -1;
+        CLI::Option* passwordFdOption = app.add_option("--password-fd", passwordFd, "Read master passwords from this file descriptor, one line each (no terminal needed)");
+        app.add_option("--keyfile", keySource.keyfile, "Use a hash of this file as the master password");
+        app.add_flag("--with-password", keySource.withPassword, "Combine the keyfile with the master password typed on the terminal (a --password-fd password is always combined)");
+        app.add_flag("--agent", keySource.agent, "Get master passwords from the agent (socket in MANPASS_AGENT_SOCKET or the runtime directory)");
 
         std::string path;
 
         // Options for add
-        CLI::App* addSubcommand = app.add_subcommand("add", "Add vault, folder, credential, or note");
+        CLI::App* addSubcommand = app.add_subcommand("add", "Add vault, folder, credential, note, or attachment");
         addSubcommand->add_option("path", path, "Path in vault/folder/entry format")->required();
 
         bool credentialFlag = false;
         addSubcommand->add_flag("-c,--credential", credentialFlag, "Entry type being added is credential");
         bool noteFlag = false;
         addSubcommand->add_flag("-n,--note", noteFlag, "Entry type being added is note");
+        std::string attachmentFile;
+        addSubcommand->add_option("-a,--attachment", attachmentFile, "Entry type being added is attachment, with the contents of the given file");
+        std::string compression;
+        addSubcommand->add_option("--compression", compression, "Compression applied before encryption when adding a vault (none, zlib, bzip2, lzma)");
+        std::string algorithm;
+        addSubcommand->add_option("--algorithm", algorithm, "Encryption algorithm when adding a vault (AES-256/GCM, ChaCha20Poly1305). Defaults to the fastest one on this machine");
+        std::vector<std::string> addTags;
+        addSubcommand->add_option("--tag", addTags, "Tag the added entry (can be repeated)");
 
         addSubcommand->callback([&]() {
-            this->handleAddSubcommand(path, credentialFlag, noteFlag);
+            this->handleAddSubcommand(path, credentialFlag, noteFlag, attachmentFile, compression, algorithm, addTags);
         });
 
         // Options for show
         CLI::App* showSubcommand = app.add_subcommand("show", "Show vault, folder, or entry");
         showSubcommand->add_option("path", path, "Path in vault/folder/entry format");
+        size_t revision = 0;
+        showSubcommand->add_option("--revision", revision, "Show a previous value of the entry (1 is the most recent one)");
+        std::string extract;
+        showSubcommand->add_option("--extract", extract, "Write the contents of an attachment to the given new file");
+        std::string output = "text";
+        showSubcommand->add_option("--output", output, "text (default) or json (one object per line)");
+        bool recordUse = false;
+        showSubcommand->add_flag("--record-use", recordUse, "Record the time the entries were shown (saves the vault)");
         showSubcommand->callback([&]() {
-            this->handleShowSubcommand(path);
+            this->handleShowSubcommand(path, revision, extract, output, recordUse);
         });
 
         // Options for update
         CLI::App* updateSubcommand = app.add_subcommand("update", "Update vault, folder, or entry");
         updateSubcommand->add_option("path", path, "Path in vault/folder/entry format")->required();
+        std::vector<std::string> tag, untag;
+        updateSubcommand->add_option("--tag", tag, "Add a tag to the entry instead of changing its value (can be repeated)");
+        updateSubcommand->add_option("--untag", untag, "Remove a tag from the entry instead of changing its value (can be repeated)");
+        int newPasswordFd = -1;
+        CLI::Option* newPasswordFdOption = updateSubcommand->add_option("--new-password-fd", newPasswordFd,
+            "Read the vault's new master password from this file descriptor (otherwise it is typed twice on the terminal)");
+        std::string newKeyfile;
+        updateSubcommand->add_option("--new-keyfile", newKeyfile, "Use a hash of this file as the vault's new master password (combined with --new-password-fd if given)");
         updateSubcommand->callback([&]() {
-            this->handleUpdateSubcommand(path);
+            std::optional<int> newPasswordFdValue;
+            if (newPasswordFdOption->count()) {
+                if (newPasswordFd < 0)
+                    throw std::runtime_error("--new-password-fd takes a file descriptor number");
+                newPasswordFdValue = newPasswordFd;
+            }
+            this->handleUpdateSubcommand(path, tag, untag, newPasswordFdValue, newKeyfile);
         });
 
         // Options for delete
@@ -50,11 +95,197 @@ namespace parser {
             this->handleDeleteSubcommand(path);
         });
 
+        // Options for history
+        CLI::App* historySubcommand = app.add_subcommand("history", "List previous values of an entry, restore one, or set how many a vault keeps");
+        historySubcommand->add_option("path", path, "Path in vault/folder/entry format")->required();
+        size_t restore = 0;
+        CLI::Option* restoreOption = historySubcommand->add_option("--restore", restore, "Make the given revision the current value of the entry");
+        size_t retention = 0;
+        CLI::Option* retentionOption = historySubcommand->add_option("--retention", retention, "Number of revisions the vault keeps per entry (0 disables history)");
+        historySubcommand->callback([&]() {
+            this->handleHistorySubcommand(path,
+                restoreOption->count() ? std::optional<size_t>(restore) : std::nullopt,
+                retentionOption->count() ? std::optional<size_t>(retention) : std::nullopt);
+        });
+
+        // Options for list
+        CLI::App* listSubcommand = app.add_subcommand("list", "List entries of a vault or folder by their timestamps and tags");
+        listSubcommand->add_option("path", path, "Path in vault or vault/folder format")->required();
+        // Times are YYYY-MM-DD, "YYYY-MM-DD HH:MM[:SS]" (local time) or Nd for N days ago
+        std::string createdBefore, createdAfter, modifiedBefore, modifiedAfter, usedBefore, usedAfter;
+        listSubcommand->add_option("--created-before", createdBefore, "Entries created before the time (YYYY-MM-DD[ HH:MM[:SS]] or Nd for N days ago)");
+        listSubcommand->add_option("--created-after", createdAfter, "Entries created at or after the time");
+        listSubcommand->add_option("--modified-before", modifiedBefore, "Entries whose value last changed before the time");
+        listSubcommand->add_option("--modified-after", modifiedAfter, "Entries whose value last changed at or after the time");
+        listSubcommand->add_option("--used-before", usedBefore, "Entries last shown before the time (or never)");
+        listSubcommand->add_option("--used-after", usedAfter, "Entries last shown at or after the time");
+        std::vector<std::string> listTags;
+        listSubcommand->add_option("--tag", listTags, "Entries having the tag (can be repeated, all have to match)");
+        listSubcommand->callback([&]() {
+            auto args = std::make_unique<ListCommandArgs>();
+            std::string entry;
+            this->parsePath(path, args->vault, args->folder, entry);
+            if (args->vault.empty() || !entry.empty())
+                throw std::runtime_error("List takes a vault or a vault/folder path");
+            args->createdBefore = parseTimeOption(createdBefore);
+            args->createdAfter = parseTimeOption(createdAfter);
+            args->modifiedBefore = parseTimeOption(modifiedBefore);
+            args->modifiedAfter = parseTimeOption(modifiedAfter);
+            args->usedBefore = parseTimeOption(usedBefore);
+            args->usedAfter = parseTimeOption(usedAfter);
+            args->tags = listTags;
+            this->returnCommandArgs = std::move(args);
+        });
+
+        // Options for audit
+        CLI::App* auditSubcommand = app.add_subcommand("audit", "Find reused and weak passwords (without showing them)");
+        std::vector<std::string> auditVaults;
+        std::string auditBreachDatabase;
+        std::string auditBreachHash = "sha1";
+        auditSubcommand->add_option("vaults", auditVaults, "Vaults to audit (all of them if none are given)");
+        auditSubcommand->add_option("--breach-db", auditBreachDatabase, "Sorted file of breached password hashes (SHA-1 or NTLM) to check against, offline");
+        auditSubcommand->add_option("--breach-hash", auditBreachHash, "Hash of a breach file of raw digests: sha1 (default) or ntlm");
+        auditSubcommand->callback([&]() {
+            auto args = std::make_unique<AuditCommandArgs>();
+            args->vaults = auditVaults;
+            args->breachDatabase = auditBreachDatabase;
+            args->breachHash = auditBreachHash;
+            this->returnCommandArgs = std::move(args);
+        });
+
+        // Options for import
+        CLI::App* importSubcommand = app.add_subcommand("import", "Import entries exported from a browser or another password manager");
+        importSubcommand->add_option("path", path, "Vault (or vault/folder to put everything in one folder)")->required();
+        std::string importFile, importFormat, importConflict = "skip";
+        importSubcommand->add_option("file", importFile, "Exported file")->required();
+        importSubcommand->add_option("--format", importFormat, "csv, json (array or one object per line), bitwarden or keepass-xml (told by the file extension if not given)");
+        importSubcommand->add_option("--on-conflict", importConflict, "What to do with entries that already exist: skip (default), overwrite or rename");
+        importSubcommand->callback([&]() {
+            auto args = std::make_unique<ImportCommandArgs>();
+            std::string entry;
+            this->parsePath(path, args->vault, args->folder, entry);
+            if (args->vault.empty() || !entry.empty())
+                throw std::runtime_error("Import takes a vault or a vault/folder path");
+            args->file = importFile;
+            args->format = importFormat;
+            args->conflict = importConflict;
+            this->returnCommandArgs = std::move(args);
+        });
+
+        // Options for export
+        CLI::App* exportSubcommand = app.add_subcommand("export", "Export a vault as plaintext JSON lines or CSV, or as a re-encrypted archive");
+        exportSubcommand->add_option("path", path, "Vault (or vault/folder to export one folder)")->required();
+        std::string exportFile, exportFormat = "jsonl", exportArchive;
+        exportSubcommand->add_option("file", exportFile, "Output file (standard output if not given)");
+        exportSubcommand->add_option("--format", exportFormat, "jsonl (default) or csv");
+        exportSubcommand->add_option("--archive", exportArchive, "Write the vault and its attachments to this directory, encrypted with a new password");
+        int archivePasswordFd = -1;
+        CLI::Option* archivePasswordFdOption = exportSubcommand->add_option("--archive-password-fd", archivePasswordFd,
+            "Read the archive password from this file descriptor (otherwise it is typed twice on the terminal)");
+        exportSubcommand->callback([&]() {
+            auto args = std::make_unique<ExportCommandArgs>();
+            std::string entry;
+            this->parsePath(path, args->vault, args->folder, entry);
+            if (args->vault.empty() || !entry.empty())
+                throw std::runtime_error("Export takes a vault or a vault/folder path");
+            if (!exportArchive.empty() && (!exportFile.empty() || !args->folder.empty()))
+                throw std::runtime_error("An archive holds the whole vault and goes to the --archive directory");
+            args->file = exportFile;
+            args->format = exportFormat;
+            args->archive = exportArchive;
+            if (archivePasswordFdOption->count()) {
+                if (exportArchive.empty())
+                    throw std::runtime_error("--archive-password-fd sets the password of an --archive");
+                if (archivePasswordFd < 0)
+                    throw std::runtime_error("--archive-password-fd takes a file descriptor number");
+                args->archivePasswordFd = archivePasswordFd;
+            }
+            this->returnCommandArgs = std::move(args);
+        });
+
+        // Options for mv and cp
+        std::string targetPath;
+        bool recover = false;
+        CLI::App* moveSubcommand = app.add_subcommand("mv", "Move folders or entries within a vault or into another vault");
+        moveSubcommand->add_option("path", path, "Folder or entry to move (may be a pattern)")->required();
+        moveSubcommand->add_option("destination", targetPath, "vault (for folders), vault/folder, or a new vault/folder/entry name");
+        moveSubcommand->add_flag("--recover", recover, "Only finish an interrupted move out of the vault");
+        moveSubcommand->callback([&]() {
+            this->handleTransferSubcommand(CommandType::MOVE, path, targetPath, recover);
+        });
+        CLI::App* copySubcommand = app.add_subcommand("cp", "Copy folders or entries within a vault or into another vault");
+        copySubcommand->add_option("path", path, "Folder or entry to copy (may be a pattern)")->required();
+        copySubcommand->add_option("destination", targetPath, "vault (for folders), vault/folder, or a new vault/folder/entry name")->required();
+        copySubcommand->callback([&]() {
+            this->handleTransferSubcommand(CommandType::COPY, path, targetPath, false);
+        });
+
+        // Options for agent
+        CLI::App* agentSubcommand = app.add_subcommand("agent", "Keep vaults unlocked and serve them to --agent commands, until stopped");
+        std::vector<std::string> agentVaults;
+        agentSubcommand->add_option("vaults", agentVaults, "Vaults to keep unlocked")->required();
+        size_t commitWindow = 50, commitBatch = 64;
+        agentSubcommand->add_option("--commit-window", commitWindow, "Milliseconds writes are gathered for and saved together (default 50)");
+        agentSubcommand->add_option("--commit-batch", commitBatch, "Most writes saved together (default 64)")->check(CLI::PositiveNumber);
+        agentSubcommand->callback([&]() {
+            auto args = std::make_unique<AgentCommandArgs>();
+            args->vaults = agentVaults;
+            args->commitWindow = commitWindow;
+            args->commitBatch = commitBatch;
+            this->returnCommandArgs = std::move(args);
+        });
+
+        // Options for calibrate
+        CLI::App* calibrateSubcommand = app.add_subcommand("calibrate", "Measure encryption algorithms on this machine");
+        calibrateSubcommand->callback([&]() {
+            this->returnCommandArgs = std::make_unique<CalibrateCommandArgs>();
+        });
+
         app.parse(argc, argv);
 
+        if (passwordFdOption->count()) {
+            if (passwordFd < 0)
+                throw std::runtime_error("--password-fd takes a file descriptor number");
+            keySource.passwordFd = passwordFd;
+        }
+        if (keySource.withPassword && keySource.keyfile.empty())
+            throw std::runtime_error("--with-password combines the master password with --keyfile");
+        if (keySource.agent && (keySource.passwordFd || !keySource.keyfile.empty()))
+            throw std::runtime_error("--agent can't be combined with other key sources");
+        if (returnCommandArgs.has_value() && returnCommandArgs.value())
+            returnCommandArgs.value()->keySource = keySource;
+
         return std::move(returnCommandArgs);
     }
 
+    void Parser::handleTransferSubcommand(CommandType type, const std::string& path, const std::string& targetPath, bool recover) {
+        auto args = std::make_unique<TransferCommandArgs>(type);
+        this->parsePath(path, args->vault, args->folder, args->entry);
+        if (args->vault.empty() || vault::isPathPattern(args->vault))
+            throw std::runtime_error("The source has to start with a vault name (vaults can't be patterns)");
+
+        args->recover = recover;
+        if (recover) {
+            if (!args->folder.empty() || !targetPath.empty())
+                throw std::runtime_error("--recover takes only the vault the interrupted move was out of");
+            this->returnCommandArgs = std::move(args);
+            return;
+        }
+
+        if (args->folder.empty())
+            throw std::runtime_error("Whole vaults can't be moved or copied, only folders and entries");
+        if (targetPath.empty())
+            throw std::runtime_error("Missing destination");
+        this->parsePath(targetPath, args->targetVault, args->targetFolder, args->targetEntry);
+        if (args->targetVault.empty() || vault::isPathPattern(args->targetVault) || vault::isPathPattern(args->targetFolder) || vault::isPathPattern(args->targetEntry))
+            throw std::runtime_error("The destination can't be a pattern");
+        if (args->entry.empty() && !args->targetEntry.empty())
+            throw std::runtime_error("A folder can only go into a vault (vault, or vault/name to rename it)");
+        if (!args->entry.empty() && args->targetFolder.empty())
+            throw std::runtime_error("Entries can only go into a folder (vault/folder, or vault/folder/name to rename)");
+        this->returnCommandArgs = std::move(args);
+    }
+
     void Parser::parsePath(const std::string &path, std::string &vault, std::string &folder, std::string &entry) {
         std::stringstream stream(path);
         std::string segment;
@@ -76,14 +307,38 @@ namespace parser {
         }
     }
 
-    void Parser::handleAddSubcommand(const std::string &path, bool credentialFlag, bool noteFlag) {
+    std::optional<int64_t> Parser::parseTimeOption(const std::string& value) {
+        if (value.empty())
+            return std::nullopt;
+
+        // Relative: number of days before now
+        if (value.back() == 'd' && value.size() > 1 && std::all_of(value.begin(), value.end() - 1, ::isdigit))
+            return static_cast<int64_t>(std::time(nullptr)) - std::stoll(value.substr(0, value.size() - 1)) * 86400;
+
+        for (const char* format : {"%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M", "%Y-%m-%d"}) {
+            std::tm local{};
+            const char* end = strptime(value.c_str(), format, &local);
+            if (end && *end == '\0') {
+                local.tm_isdst = -1;
+                return static_cast<int64_t>(std::mktime(&local));
+            }
+        }
+        throw std::runtime_error("Invalid time: " + value + " (use YYYY-MM-DD, \"YYYY-MM-DD HH:MM[:SS]\" or Nd for N days ago)");
+    }
+
+    void Parser::handleAddSubcommand(const std::string &path, bool credentialFlag, bool noteFlag, const std::string& attachmentFile, const std::string& compression, const std::string& algorithm, const std::vector<std::string>& tags) {
         std::string vault, folder, entry;
         this->parsePath(path, vault, folder, entry);
+        bool addingVault = !vault.empty() && folder.empty() && entry.empty();
+        if (!addingVault && (!compression.empty() || !algorithm.empty()))
+            throw std::runtime_error("--compression and --algorithm only apply to adding a vault");
 
         // Adding a vault
-        if (!vault.empty() && folder.empty() && entry.empty()) {
+        if (addingVault) {
             auto args = std::make_unique<AddVaultCommandArgs>();
             args->vault = vault;
+            args->compression = compression;
+            args->algorithm = algorithm;
             this->returnCommandArgs = std::move(args);
         }
 
@@ -97,14 +352,15 @@ namespace parser {
 
         // Adding an entry
         if (!vault.empty() && !folder.empty() && !entry.empty()) {
-            if (!credentialFlag && !noteFlag)
-                throw std::runtime_error("No entry type provided (use flags -c for credential or -n for note)");
+            if (!credentialFlag && !noteFlag && attachmentFile.empty())
+                throw std::runtime_error("No entry type provided (use flags -c for credential, -n for note or -a <file> for attachment)");
 
             if (credentialFlag) {
                 auto args = std::make_unique<AddCredentialCommandArgs>();
                 args->vault = vault;
                 args->folder = folder;
                 args->credential = entry;
+                args->tags = tags;
                 this->returnCommandArgs = std::move(args);
             }
 
@@ -113,18 +369,46 @@ namespace parser {
                 args->vault = vault;
                 args->folder = folder;
                 args->note = entry;
+                args->tags = tags;
+                this->returnCommandArgs = std::move(args);
+            }
+
+            if (!attachmentFile.empty()) {
+                auto args = std::make_unique<AddAttachmentCommandArgs>();
+                args->vault = vault;
+                args->folder = folder;
+                args->attachment = entry;
+                args->file = attachmentFile;
+                args->tags = tags;
                 this->returnCommandArgs = std::move(args);
             }
         }
     }
 
-    void Parser::handleShowSubcommand(const std::string &path) {
+    void Parser::handleShowSubcommand(const std::string &path, size_t revision, const std::string& extract, const std::string& output, bool recordUse) {
         std::string vault, folder, entry;
         this->parsePath(path, vault, folder, entry);
+        if (recordUse && (entry.empty() || revision > 0))
+            throw std::runtime_error("--record-use takes entries, not a vault, folder or revision");
+
+        // Showing everything matching a pattern
+        if (vault::isPathPattern(folder) || vault::isPathPattern(entry)) {
+            if (revision > 0 || !extract.empty())
+                throw std::runtime_error("--revision and --extract take a single entry, not a pattern");
+            auto args = std::make_unique<ShowMatchesCommandArgs>();
+            args->vault = vault;
+            args->folder = folder;
+            args->entry = entry;
+            args->output = output;
+            args->recordUse = recordUse;
+            this->returnCommandArgs = std::move(args);
+            return;
+        }
 
         // Showing all vaults
         if (vault.empty() && folder.empty() && entry.empty()) {
             auto args = std::make_unique<ShowCommandArgs>();
+            args->output = output;
             this->returnCommandArgs = std::move(args);
         }
 
@@ -132,6 +416,7 @@ namespace parser {
         if (!vault.empty() && folder.empty() && entry.empty()) {
             auto args = std::make_unique<ShowVaultCommandArgs>();
             args->vault = vault;
+            args->output = output;
             this->returnCommandArgs = std::move(args);
         }
 
@@ -140,6 +425,7 @@ namespace parser {
             auto args = std::make_unique<ShowFolderCommandArgs>();
             args->vault = vault;
             args->folder = folder;
+            args->output = output;
             this->returnCommandArgs = std::move(args);
         }
 
@@ -149,18 +435,41 @@ namespace parser {
             args->vault = vault;
             args->folder = folder;
             args->entry = entry;
+            args->revision = revision;
+            args->extract = extract;
+            args->output = output;
+            args->recordUse = recordUse;
             this->returnCommandArgs = std::move(args);
         }
     }
 
-    void Parser::handleUpdateSubcommand(const std::string &path) {
+    void Parser::handleUpdateSubcommand(const std::string &path, const std::vector<std::string>& tag, const std::vector<std::string>& untag,
+        std::optional<int> newPasswordFd, const std::string& newKeyfile) {
         std::string vault, folder, entry;
         this->parsePath(path, vault, folder, entry);
+        if ((newPasswordFd || !newKeyfile.empty()) && (vault.empty() || !folder.empty() || !entry.empty()))
+            throw std::runtime_error("--new-password-fd and --new-keyfile set the master password of a vault");
+
+        // Updating every entry matching a pattern (folders are only renamed one at a time)
+        if (vault::isPathPattern(folder) || vault::isPathPattern(entry)) {
+            if (entry.empty())
+                throw std::runtime_error("Only entries can be updated by pattern, e.g. vault/folder-*/*");
+            auto args = std::make_unique<UpdateMatchesCommandArgs>();
+            args->vault = vault;
+            args->folder = folder;
+            args->entry = entry;
+            args->tag = tag;
+            args->untag = untag;
+            this->returnCommandArgs = std::move(args);
+            return;
+        }
 
         // Updating vault
         if (!vault.empty() && folder.empty() && entry.empty()) {
             auto args = std::make_unique<UpdateVaultCommandArgs>();
             args->vault = vault;
+            args->newPasswordFd = newPasswordFd;
+            args->newKeyfile = newKeyfile;
             this->returnCommandArgs = std::move(args);
         }
 
@@ -178,6 +487,8 @@ namespace parser {
             args->vault = vault;
             args->folder = folder;
             args->entry = entry;
+            args->tag = tag;
+            args->untag = untag;
             this->returnCommandArgs = std::move(args);
         }
     }
@@ -186,6 +497,16 @@ namespace parser {
         std::string vault, folder, entry;
         this->parsePath(path, vault, folder, entry);
 
+        // Deleting every folder or entry matching a pattern
+        if (vault::isPathPattern(folder) || vault::isPathPattern(entry)) {
+            auto args = std::make_unique<DeleteMatchesCommandArgs>();
+            args->vault = vault;
+            args->folder = folder;
+            args->entry = entry;
+            this->returnCommandArgs = std::move(args);
+            return;
+        }
+
         // Deleting vault
         if (!vault.empty() && folder.empty() && entry.empty()) {
             auto args = std::make_unique<DeleteVaultCommandArgs>();
@@ -210,4 +531,37 @@ namespace parser {
             this->returnCommandArgs = std::move(args);
         }
     }
+
+    void Parser::handleHistorySubcommand(const std::string &path, std::optional<size_t> restore, std::optional<size_t> retention) {
+        std::string vault, folder, entry;
+        this->parsePath(path, vault, folder, entry);
+
+        // Setting the retention of a vault
+        if (!vault.empty() && folder.empty() && entry.empty()) {
+            if (!retention)
+                throw std::runtime_error("History is kept per entry (use --retention <n> to set how many revisions the vault keeps)");
+            auto args = std::make_unique<SetHistoryRetentionCommandArgs>();
+            args->vault = vault;
+            args->retention = *retention;
+            this->returnCommandArgs = std::move(args);
+        }
+
+        // Listing or restoring revisions of an entry
+        if (!vault.empty() && !folder.empty() && !entry.empty()) {
+            if (restore) {
+                auto args = std::make_unique<RestoreRevisionCommandArgs>();
+                args->vault = vault;
+                args->folder = folder;
+                args->entry = entry;
+                args->revision = *restore;
+                this->returnCommandArgs = std::move(args);
+            } else {
+                auto args = std::make_unique<HistoryCommandArgs>();
+                args->vault = vault;
+                args->folder = folder;
+                args->entry = entry;
+                this->returnCommandArgs = std::move(args);
+            }
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "storage/BreachDatabase.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <botan/hash.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+
+    namespace {
+        constexpr uint32_t bucketBits = 16;
+        constexpr uint32_t bucketCount = 1u << bucketBits;
+        constexpr uint64_t unknownOffset = std::numeric_limits<uint64_t>::max();
+
+        // Ranges this small are scanned record by record, they span a page or two
+        constexpr size_t scanBytes = 4096;
+        constexpr size_t maxLineLength = 256;
+
+        int hexValue(uint8_t c) {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            return -1;
+        }
+
+        bool isLineEnd(const uint8_t* data, size_t size, size_t offset) {
+            return offset == size || data[offset] == ':' || data[offset] == '\r' || data[offset] == '\n';
+        }
+
+        // First 8 bytes of a digest as a number, digests compare the same way as their keys (up to ties)
+        uint64_t digestKey(const uint8_t* digest) {
+            uint64_t key = 0;
+            for (size_t i = 0; i < 8; i++) {
+                key = (key << 8) | digest[i];
+            }
+            return key;
+        }
+
+        void appendUtf16(cryptography::SecureBuffer& out, uint32_t unit) {
+            out.push_back(static_cast<uint8_t>(unit & 0xFF));
+            out.push_back(static_cast<uint8_t>(unit >> 8));
+        }
+
+        // NTLM hashes UTF-16LE, malformed UTF-8 becomes U+FFFD
+        cryptography::SecureBuffer toUtf16(std::string_view text) {
+            cryptography::SecureBuffer out;
+            out.reserve(text.size() * 2);
+            for (size_t i = 0; i < text.size();) {
+                auto byte = static_cast<uint8_t>(text[i]);
+                size_t length = byte < 0x80 ? 1 : (byte >> 5) == 0x6 ? 2 : (byte >> 4) == 0xE ? 3 : (byte >> 3) == 0x1E ? 4 : 0;
+                uint32_t codePoint = length == 1 ? byte : length == 2 ? byte & 0x1F : length == 3 ? byte & 0x0F : byte & 0x07;
+                bool valid = length != 0 && i + length <= text.size();
+                for (size_t j = 1; valid && j < length; j++) {
+                    auto continuation = static_cast<uint8_t>(text[i + j]);
+                    valid = (continuation & 0xC0) == 0x80;
+                    codePoint = (codePoint << 6) | (continuation & 0x3F);
+                }
+                if (!valid) {
+                    appendUtf16(out, 0xFFFD);
+                    i++;
+                    continue;
+                }
+                if (codePoint >= 0x10000) {
+                    codePoint -= 0x10000;
+                    appendUtf16(out, 0xD800 | (codePoint >> 10));
+                    appendUtf16(out, 0xDC00 | (codePoint & 0x3FF));
+                } else {
+                    appendUtf16(out, codePoint);
+                }
+                i += length;
+            }
+            return out;
+        }
+    }
+
+    BreachHash parseBreachHash(std::string_view name) {
+        if (name == "sha1")
+            return BreachHash::SHA1;
+        if (name == "ntlm")
+            return BreachHash::NTLM;
+        throw std::invalid_argument("Unknown breach corpus hash: " + std::string(name));
+    }
+
+    BreachDatabase::BreachDatabase(const std::filesystem::path& path, BreachHash hash_val) : hash(hash_val) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::runtime_error("Failed to open breach corpus: " + path.string());
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            std::string message = std::strerror(errno);
+            close(fd);
+            throw std::runtime_error("Failed to read breach corpus: " + path.string() + ": " + message);
+        }
+
+        // An empty corpus is valid, it just has no breaches (and mmap can't map zero bytes)
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            std::string message = std::strerror(errno);
+            close(fd);
+            if (address == MAP_FAILED)
+                throw std::runtime_error("Failed to map breach corpus: " + path.string() + ": " + message);
+            data = static_cast<const uint8_t*>(address);
+            // Lookups jump around, reading ahead would only pull in pages nobody asks for
+            madvise(address, size, MADV_RANDOM);
+        } else {
+            close(fd);
+        }
+
+        size_t hexDigits = 0;
+        while (hexDigits < size && hexDigits <= 40 && hexValue(data[hexDigits]) >= 0) {
+            hexDigits++;
+        }
+        text = (hexDigits == 40 || hexDigits == 32) && isLineEnd(data, size, hexDigits);
+        if (text)
+            hash = hexDigits == 40 ? BreachHash::SHA1 : BreachHash::NTLM;
+        digestSize = hash == BreachHash::SHA1 ? 20 : 16;
+
+        if (!text && size % digestSize != 0) {
+            if (data)
+                munmap(const_cast<uint8_t*>(data), size);
+            throw std::runtime_error("Not a sorted hash corpus: " + path.string());
+        }
+
+        bucketStarts = std::make_unique<std::atomic<uint64_t>[]>(bucketCount);
+        for (uint32_t i = 1; i < bucketCount; i++) {
+            bucketStarts[i].store(unknownOffset, std::memory_order_relaxed);
+        }
+        bucketStarts[0].store(0, std::memory_order_relaxed);
+    }
+
+    BreachDatabase::~BreachDatabase() {
+        if (data)
+            munmap(const_cast<uint8_t*>(data), size);
+    }
+
+    BreachHash BreachDatabase::getHash() const {
+        return hash;
+    }
+
+    size_t BreachDatabase::getDigestSize() const {
+        return digestSize;
+    }
+
+    cryptography::SecureBuffer BreachDatabase::digest(std::string_view password) const {
+        cryptography::SecureBuffer digest(digestSize);
+        if (hash == BreachHash::SHA1) {
+            auto function = Botan::HashFunction::create_or_throw("SHA-1");
+            function->update(reinterpret_cast<const uint8_t*>(password.data()), password.size());
+            function->final(digest.data());
+        } else {
+            auto function = Botan::HashFunction::create_or_throw("MD4");
+            cryptography::SecureBuffer utf16 = toUtf16(password);
+            function->update(utf16.data(), utf16.size());
+            function->final(digest.data());
+        }
+        return digest;
+    }
+
+    BreachDatabase::Record BreachDatabase::recordAt(size_t offset) const {
+        Record record{};
+        if (!text) {
+            record.start = offset - offset % digestSize;
+            record.end = record.start + digestSize;
+            std::memcpy(record.digest, data + record.start, digestSize);
+            return record;
+        }
+
+        // Lines are short, a corpus without line breaks is rejected instead of scanned end to end
+        record.start = offset;
+        while (record.start > 0 && data[record.start - 1] != '\n') {
+            if (offset - record.start == maxLineLength)
+                throw std::runtime_error("Breach corpus is malformed at offset " + std::to_string(offset));
+            record.start--;
+        }
+        size_t searched = std::min(size - offset, maxLineLength);
+        auto newline = static_cast<const uint8_t*>(std::memchr(data + offset, '\n', searched));
+        if (!newline && searched == maxLineLength)
+            throw std::runtime_error("Breach corpus is malformed at offset " + std::to_string(offset));
+        record.end = newline ? static_cast<size_t>(newline - data) + 1 : size;
+
+        size_t hexEnd = record.start + digestSize * 2;
+        if (hexEnd > record.end || !isLineEnd(data, size, hexEnd))
+            throw std::runtime_error("Breach corpus is malformed at offset " + std::to_string(record.start));
+        for (size_t i = 0; i < digestSize; i++) {
+            int high = hexValue(data[record.start + 2 * i]);
+            int low = hexValue(data[record.start + 2 * i + 1]);
+            if (high < 0 || low < 0)
+                throw std::runtime_error("Breach corpus is malformed at offset " + std::to_string(record.start));
+            record.digest[i] = static_cast<uint8_t>(high << 4 | low);
+        }
+        return record;
+    }
+
+    uint64_t BreachDatabase::countAt(const Record& record) const {
+        size_t offset = record.start + digestSize * 2;
+        if (!text || offset >= record.end || data[offset] != ':')
+            return 1;
+
+        uint64_t count = 0;
+        for (offset++; offset < record.end && data[offset] >= '0' && data[offset] <= '9'; offset++) {
+            count = count * 10 + (data[offset] - '0');
+        }
+        return std::max<uint64_t>(count, 1);
+    }
+
+    size_t BreachDatabase::lowerBound(const uint8_t* target, size_t from, size_t to, uint64_t keyLow, uint64_t keyHigh) const {
+        uint64_t key = digestKey(target);
+        // Interpolation finds uniformly distributed hashes in a handful of steps. A step that doesn't halve the range
+        // is followed by a bisection, so a corpus that isn't uniform costs at most twice as many steps as binary search
+        bool bisect = false;
+        while (to - from > scanBytes) {
+            size_t range = to - from;
+            size_t offset;
+            if (bisect || keyHigh <= keyLow) {
+                offset = from + range / 2;
+            } else {
+                long double fraction = static_cast<long double>(std::clamp(key, keyLow, keyHigh) - keyLow) / (keyHigh - keyLow);
+                offset = from + std::min(static_cast<size_t>(fraction * range), range - 1);
+            }
+
+            Record record = recordAt(offset);
+            if (std::memcmp(record.digest, target, digestSize) < 0) {
+                from = record.end;
+                keyLow = digestKey(record.digest);
+            } else {
+                to = record.start;
+                keyHigh = digestKey(record.digest);
+            }
+            bisect = !bisect && (to - from) * 2 > range;
+        }
+
+        while (from < to) {
+            Record record = recordAt(from);
+            if (std::memcmp(record.digest, target, digestSize) >= 0)
+                return from;
+            from = record.end;
+        }
+        return to;
+    }
+
+    size_t BreachDatabase::bucketStart(uint32_t bucket) const {
+        uint64_t offset = bucketStarts[bucket].load(std::memory_order_relaxed);
+        if (offset != unknownOffset)
+            return offset;
+
+        // Threads racing on the same bucket find the same offset
+        uint8_t first[20] = {};
+        first[0] = static_cast<uint8_t>(bucket >> 8);
+        first[1] = static_cast<uint8_t>(bucket);
+        offset = lowerBound(first, 0, size, 0, std::numeric_limits<uint64_t>::max());
+        bucketStarts[bucket].store(offset, std::memory_order_relaxed);
+        return offset;
+    }
+
+    uint64_t BreachDatabase::lookup(const uint8_t* digest) const {
+        std::vector<cryptography::SecureBuffer> digests(1, cryptography::SecureBuffer(digest, digest + digestSize));
+        return lookup(digests).front();
+    }
+
+    std::vector<uint64_t> BreachDatabase::lookup(const std::vector<cryptography::SecureBuffer>& digests) const {
+        for (const auto& digest : digests) {
+            if (digest.size() != digestSize)
+                throw std::invalid_argument("Digest size doesn't match the breach corpus");
+        }
+
+        std::vector<size_t> order(digests.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return std::memcmp(digests[a].data(), digests[b].data(), digestSize) < 0;
+        });
+
+        std::vector<uint64_t> counts(digests.size(), 0);
+        // Sorted lookups only move forward: everything before the previous result is below the next digest
+        uint32_t previousBucket = bucketCount;
+        size_t previous = 0;
+        uint64_t previousKey = 0;
+        for (size_t index : order) {
+            const uint8_t* target = digests[index].data();
+            uint32_t bucket = static_cast<uint32_t>(target[0]) << 8 | target[1];
+            uint64_t keyLow = static_cast<uint64_t>(bucket) << (64 - bucketBits);
+            uint64_t keyHigh = keyLow | (std::numeric_limits<uint64_t>::max() >> bucketBits);
+
+            size_t from = bucketStart(bucket);
+            size_t to = bucket + 1 < bucketCount ? bucketStart(bucket + 1) : size;
+            if (bucket == previousBucket) {
+                from = std::max(from, previous);
+                keyLow = previousKey;
+            }
+
+            size_t offset = lowerBound(target, from, to, keyLow, keyHigh);
+            previousBucket = bucket;
+            previous = offset;
+            previousKey = digestKey(target);
+            if (offset == to)
+                continue;
+
+            Record record = recordAt(offset);
+            if (std::memcmp(record.digest, target, digestSize) == 0)
+                counts[index] = countAt(record);
+        }
+        return counts;
+    }
+
+} // namespace storage
@@ -0,0 +1,203 @@
+#include "storage/ChunkStore.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <botan/aead.h>
+#include <botan/exceptn.h>
+#include <botan/hash.h>
+#include <botan/hex.h>
+#include "crypto/Base64.h"
+#include "crypto/Cryptography.h"
+
+namespace storage {
+
+    namespace {
+        // Random 64-bit value per byte value for the gear hash (fixed, boundaries must be the same on every host)
+        constexpr std::array<uint64_t, 256> makeGearTable() {
+            std::array<uint64_t, 256> table{};
+            uint64_t state = 0x6d616e7061737321ULL;
+            for (auto& value : table) {
+                // splitmix64
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                value = z ^ (z >> 31);
+            }
+            return table;
+        }
+
+        constexpr std::array<uint64_t, 256> gearTable = makeGearTable();
+
+        // 16 bits have to be zero, so a boundary is found every 64 KiB on average. The top bits are used because
+        // they depend on the last 64 bytes, the low ones only on the last few
+        constexpr uint64_t boundaryMask = 0xFFFFULL << 48;
+
+        constexpr size_t keySize = 32;
+        constexpr size_t readSize = 1024 * 1024;
+
+        // Each chunk has its own key, so a fixed nonce is never reused with a different plaintext
+        const std::vector<uint8_t> chunkNonce(12, 0);
+        const std::string_view keyDomain = "manpass-attachment-chunk";
+
+        std::string chunkName(const uint8_t* key) {
+            auto hash = Botan::HashFunction::create_or_throw("SHA-256");
+            hash->update(key, keySize);
+            return Botan::hex_encode(hash->final(), false);
+        }
+
+        // Decodes the base64 key of a chunk into key and returns the name of the chunk's blob
+        std::string decodeChunkKey(const cryptography::SecureString& base64Key, cryptography::SecureBuffer& key) {
+            try {
+                key.resize(cryptography::base64DecodedMaxSize(base64Key.size()));
+                key.resize(cryptography::base64Decode(base64Key, key.data()));
+                if (key.size() != keySize)
+                    throw std::invalid_argument("Wrong key size");
+            } catch (const std::invalid_argument&) {
+                throw std::runtime_error("Malformed attachment chunk key");
+            }
+            return chunkName(key.data());
+        }
+    }
+
+    size_t findChunkBoundary(const uint8_t* data, size_t size) {
+        if (size <= minAttachmentChunkSize)
+            return size;
+
+        size_t end = std::min(size, maxAttachmentChunkSize);
+        uint64_t hash = 0;
+        for (size_t i = minAttachmentChunkSize; i < end; i++) {
+            hash = (hash << 1) + gearTable[data[i]];
+            if ((hash & boundaryMask) == 0)
+                return i + 1;
+        }
+        return end;
+    }
+
+    ChunkStore::ChunkStore(std::shared_ptr<StorageBackend> backend_val) : backend(std::move(backend_val)) {
+        if (!backend)
+            throw std::invalid_argument("Chunk store backend must not be null");
+    }
+
+    StorageBackend& ChunkStore::getBackend() const {
+        return *backend;
+    }
+
+    cryptography::SecureString ChunkStore::storeChunk(const uint8_t* data, size_t size) {
+        cryptography::SecureBuffer key(keySize);
+        auto hash = Botan::HashFunction::create_or_throw("SHA-256");
+        hash->update(reinterpret_cast<const uint8_t*>(keyDomain.data()), keyDomain.size());
+        hash->update(data, size);
+        hash->final(key.data());
+
+        std::string name = chunkName(key.data());
+        if (!backend->blobExists(name)) {
+            // The algorithm is recorded per chunk, readers don't depend on what the writing host preferred
+            std::string algorithm = cryptography::preferredAlgorithm();
+            auto algorithmIndex = std::find(cryptography::acceptedAlgorithms.begin(), cryptography::acceptedAlgorithms.end(), algorithm)
+                - cryptography::acceptedAlgorithms.begin();
+
+            auto mode = Botan::AEAD_Mode::create_or_throw(algorithm, Botan::Cipher_Dir::Encryption);
+            mode->set_key(key);
+            mode->start(chunkNonce);
+            cryptography::SecureBuffer sealed(data, data + size);
+            mode->finish(sealed);
+
+            std::unique_ptr<BlobWriter> writer = backend->openWriter(name);
+            char header = static_cast<char>(algorithmIndex);
+            writer->write({&header, 1});
+            writer->write({reinterpret_cast<const char*>(sealed.data()), sealed.size()});
+            writer->commit();
+        }
+
+        cryptography::SecureString base64Key(cryptography::base64EncodedSize(keySize), '\0');
+        cryptography::base64Encode(key.data(), key.size(), base64Key.data());
+        return base64Key;
+    }
+
+    std::unique_ptr<vault::AttachmentEntry> ChunkStore::storeAttachment(std::istream& content, std::string_view fileName) {
+        std::vector<cryptography::SecureString> chunkKeys;
+        uint64_t totalSize = 0;
+
+        // Chunks are cut from a window that always holds at least a maximum sized chunk until the input ends
+        cryptography::SecureBuffer window;
+        window.reserve(readSize + maxAttachmentChunkSize);
+        bool ended = false;
+        while (true) {
+            if (!ended && window.size() < maxAttachmentChunkSize) {
+                size_t filled = window.size();
+                window.resize(filled + readSize);
+                content.read(reinterpret_cast<char*>(window.data() + filled), readSize);
+                window.resize(filled + static_cast<size_t>(content.gcount()));
+                if (!content) {
+                    if (content.bad())
+                        throw std::runtime_error("Failed to read attachment");
+                    ended = true;
+                }
+                continue;
+            }
+            if (window.empty())
+                break;
+
+            size_t offset = 0;
+            while (offset < window.size() && (ended || window.size() - offset >= maxAttachmentChunkSize)) {
+                size_t length = findChunkBoundary(window.data() + offset, window.size() - offset);
+                chunkKeys.push_back(storeChunk(window.data() + offset, length));
+                offset += length;
+            }
+            totalSize += offset;
+            window.erase(window.begin(), window.begin() + static_cast<std::ptrdiff_t>(offset));
+        }
+
+        return std::make_unique<vault::AttachmentEntry>(fileName, totalSize, std::move(chunkKeys));
+    }
+
+    void ChunkStore::readAttachment(const vault::AttachmentEntry& attachment, const cryptography::ByteSink& sink) const {
+        uint64_t totalSize = 0;
+        cryptography::SecureBuffer key;
+        cryptography::SecureBuffer plaintext;
+
+        for (const auto& base64Key : attachment.getChunkKeys()) {
+            std::string name = decodeChunkKey(base64Key, key);
+            if (!backend->blobExists(name))
+                throw std::runtime_error("Attachment chunk is missing: " + name);
+            std::unique_ptr<BlobMapping> mapping = backend->mapBlob(name);
+            std::string_view sealed = mapping->data();
+
+            try {
+                if (sealed.empty() || static_cast<uint8_t>(sealed[0]) >= cryptography::acceptedAlgorithms.size())
+                    throw std::invalid_argument("Unknown chunk algorithm");
+                const std::string& algorithm = cryptography::acceptedAlgorithms[static_cast<uint8_t>(sealed[0])];
+
+                auto mode = Botan::AEAD_Mode::create_or_throw(algorithm, Botan::Cipher_Dir::Decryption);
+                mode->set_key(key);
+                mode->start(chunkNonce);
+                plaintext.assign(sealed.begin() + 1, sealed.end());
+                mode->finish(plaintext);
+            } catch (const std::exception&) {
+                throw std::runtime_error("Attachment chunk failed to decrypt: " + name);
+            }
+
+            totalSize += plaintext.size();
+            sink(plaintext.data(), plaintext.size());
+        }
+
+        if (totalSize != attachment.getSize())
+            throw std::runtime_error("Attachment size does not match its chunks");
+    }
+
+    void ChunkStore::copyAttachment(const vault::AttachmentEntry& attachment, ChunkStore& target) const {
+        cryptography::SecureBuffer key;
+        for (const auto& base64Key : attachment.getChunkKeys()) {
+            std::string name = decodeChunkKey(base64Key, key);
+            if (target.backend->blobExists(name))
+                continue;
+            if (!backend->blobExists(name))
+                throw std::runtime_error("Attachment chunk is missing: " + name);
+            std::unique_ptr<BlobMapping> mapping = backend->mapBlob(name);
+            target.backend->writeBlob(name, mapping->data());
+        }
+    }
+
+} // namespace storage
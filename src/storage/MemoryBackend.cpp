@@ -0,0 +1,110 @@
+#include "storage/MemoryBackend.h"
+
+#include <stdexcept>
+
+namespace storage {
+
+    namespace {
+        class MutexLock : public BlobLock {
+        public:
+            explicit MutexLock(std::mutex& mutex) : guard(mutex) {}
+        private:
+            std::unique_lock<std::mutex> guard;
+        };
+    }
+
+    // Collects the data and swaps it in on commit
+    class MemoryBackend::MemoryWriter : public BlobWriter {
+    public:
+        MemoryWriter(MemoryBackend& backend, std::string name) : backend(backend), name(std::move(name)) {}
+
+        void write(std::string_view data) override {
+            contents.append(data);
+        }
+
+        void commit() override {
+            backend.store(name, contents);
+        }
+
+    private:
+        MemoryBackend& backend;
+        std::string name;
+        std::string contents;
+    };
+
+    std::string MemoryBackend::readBlob(const std::string& name) const {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = blobs.find(name);
+        if (it == blobs.end())
+            throw std::runtime_error("Blob does not exist: " + name);
+        return it->second;
+    }
+
+    std::unique_ptr<BlobWriter> MemoryBackend::openWriter(const std::string& name) {
+        return std::make_unique<MemoryWriter>(*this, name);
+    }
+
+    void MemoryBackend::store(const std::string& name, std::string& data) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto [it, added] = blobs.try_emplace(name);
+        it->second.swap(data);
+        generations[name] = ++lastGeneration;
+        if (added)
+            namesGeneration = lastGeneration;
+    }
+
+    bool MemoryBackend::removeBlob(const std::string& name) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (blobs.erase(name) == 0)
+            return false;
+        generations[name] = namesGeneration = ++lastGeneration;
+        return true;
+    }
+
+    bool MemoryBackend::blobExists(const std::string& name) const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return blobs.count(name) > 0;
+    }
+
+    std::vector<std::string> MemoryBackend::listBlobs() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::vector<std::string> names;
+        names.reserve(blobs.size());
+        for (const auto& [name, data] : blobs) {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    std::unique_ptr<BlobLock> MemoryBackend::lock(const std::string& name) {
+        std::mutex* blobMutex;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto& slot = locks[name];
+            if (!slot)
+                slot = std::make_unique<std::mutex>();
+            blobMutex = slot.get();
+        }
+        return std::make_unique<MutexLock>(*blobMutex);
+    }
+
+    uint64_t MemoryBackend::generation(const std::string& name) const {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = generations.find(name);
+        return it == generations.end() ? 0 : it->second;
+    }
+
+    uint64_t MemoryBackend::listingGeneration() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return namesGeneration;
+    }
+
+    std::shared_ptr<StorageBackend> MemoryBackend::openNamespace(const std::string& name) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto& slot = namespaces[name];
+        if (!slot)
+            slot = std::make_shared<MemoryBackend>();
+        return slot;
+    }
+
+} // namespace storage
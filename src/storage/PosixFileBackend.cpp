@@ -0,0 +1,319 @@
+#include "storage/PosixFileBackend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+
+    namespace {
+        // Lock file descriptor that is flock()'ed for the lifetime of the object
+        class FileLock : public BlobLock {
+        public:
+            explicit FileLock(int fd) : fd(fd) {}
+            ~FileLock() override {
+                flock(fd, LOCK_UN);
+                close(fd);
+            }
+        private:
+            int fd;
+        };
+
+        // Read-only private mapping of a whole file
+        class FileMapping : public BlobMapping {
+        public:
+            FileMapping(void* address, size_t size) : address(address), size(size) {}
+            ~FileMapping() override {
+                if (size > 0)
+                    munmap(address, size);
+            }
+            std::string_view data() const override {
+                return {static_cast<const char*>(address), size};
+            }
+        private:
+            void* address;
+            size_t size;
+        };
+
+        std::string errnoMessage() {
+            return std::strerror(errno);
+        }
+
+        // Makes a completed rename durable
+        void syncDirectory(const std::filesystem::path& directory) {
+            int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0)
+                return;
+            fsync(fd);
+            close(fd);
+        }
+
+        // Writes into a temporary file next to the blob, which replaces the blob on commit
+        class FileWriter : public BlobWriter {
+        public:
+            FileWriter(std::filesystem::path directory, std::filesystem::path filePath, std::filesystem::path tempPath) :
+                directory(std::move(directory)), filePath(std::move(filePath)), tempPath(std::move(tempPath)) {
+                fd = open(this->tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+                if (fd < 0)
+                    throw std::runtime_error("Failed to open file for writing: " + this->tempPath.string() + ": " + errnoMessage());
+            }
+
+            ~FileWriter() override {
+                if (fd >= 0) {
+                    close(fd);
+                    unlink(tempPath.c_str());
+                }
+            }
+
+            void write(std::string_view data) override {
+                size_t written = 0;
+                while (written < data.size()) {
+                    ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+                    if (result < 0) {
+                        if (errno == EINTR)
+                            continue;
+                        throw std::runtime_error("Failed to write file: " + tempPath.string() + ": " + errnoMessage());
+                    }
+                    written += static_cast<size_t>(result);
+                }
+            }
+
+            void commit() override {
+                // The data has to be on disk before the rename makes it visible, otherwise a crash could leave an empty vault
+                int result = fsync(fd);
+                std::string message = errnoMessage();
+                if (close(fd) != 0 && result == 0) {
+                    result = -1;
+                    message = errnoMessage();
+                }
+                fd = -1;
+                if (result != 0) {
+                    unlink(tempPath.c_str());
+                    throw std::runtime_error("Failed to write file: " + tempPath.string() + ": " + message);
+                }
+                if (rename(tempPath.c_str(), filePath.c_str()) != 0) {
+                    message = errnoMessage();
+                    unlink(tempPath.c_str());
+                    throw std::runtime_error("Failed to replace file: " + filePath.string() + ": " + message);
+                }
+                syncDirectory(directory);
+            }
+
+        private:
+            std::filesystem::path directory, filePath, tempPath;
+            int fd;
+        };
+    }
+
+    PosixFileBackend::PosixFileBackend(const std::filesystem::path& directory_val, std::string extension_val) :
+        directory(directory_val), extension(std::move(extension_val)) {
+        std::error_code ec;
+        if (!std::filesystem::exists(directory, ec)) {
+            if (!std::filesystem::create_directories(directory, ec) && ec) {
+                throw std::runtime_error("Failed to create vaults directory: " + ec.message());
+            }
+        }
+    }
+
+    PosixFileBackend::~PosixFileBackend() {
+        if (watchFd >= 0)
+            close(watchFd);
+    }
+
+    std::filesystem::path PosixFileBackend::blobPath(const std::string& name) const {
+        return directory / (name + extension);
+    }
+
+    const std::filesystem::path& PosixFileBackend::getDirectory() const {
+        return directory;
+    }
+
+    std::string PosixFileBackend::readBlob(const std::string& name) const {
+        std::filesystem::path filePath = blobPath(name);
+        std::ifstream ifs(filePath, std::ios::binary);
+        if (!ifs)
+            throw std::runtime_error("Failed to open file for reading: " + filePath.string());
+        return std::string(std::istreambuf_iterator<char>(ifs), {});
+    }
+
+    std::unique_ptr<BlobMapping> PosixFileBackend::mapBlob(const std::string& name) const {
+        std::filesystem::path filePath = blobPath(name);
+        int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::runtime_error("Failed to open file for reading: " + filePath.string());
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            std::string message = errnoMessage();
+            close(fd);
+            throw std::runtime_error("Failed to read file: " + filePath.string() + ": " + message);
+        }
+
+        // mmap can't map zero bytes
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size == 0) {
+            close(fd);
+            return std::make_unique<FileMapping>(nullptr, 0);
+        }
+
+        // The mapping stays valid after the descriptor is closed (and after the file is replaced by a rename)
+        void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        std::string message = errnoMessage();
+        close(fd);
+        if (address == MAP_FAILED)
+            throw std::runtime_error("Failed to map file: " + filePath.string() + ": " + message);
+
+        // The header is scanned and the ciphertext decoded front to back exactly once
+        madvise(address, size, MADV_SEQUENTIAL);
+        return std::make_unique<FileMapping>(address, size);
+    }
+
+    std::unique_ptr<BlobWriter> PosixFileBackend::openWriter(const std::string& name) {
+        return std::make_unique<FileWriter>(directory, blobPath(name), directory / (name + extension + ".tmp"));
+    }
+
+    bool PosixFileBackend::removeBlob(const std::string& name) {
+        return std::filesystem::remove(blobPath(name));
+    }
+
+    bool PosixFileBackend::blobExists(const std::string& name) const {
+        return std::filesystem::exists(blobPath(name));
+    }
+
+    std::vector<std::string> PosixFileBackend::listBlobs() const {
+        std::vector<std::string> names;
+
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            if (!entry.is_regular_file())
+                continue;
+
+            const std::filesystem::path& filePath = entry.path();
+            if (!filePath.has_extension() || filePath.extension() != extension)
+                continue;
+
+            std::string name = filePath.stem().string(); // .stem() gets filename without extension
+            if (!name.empty()) {
+                names.push_back(name);
+            }
+        }
+
+        return names;
+    }
+
+    std::unique_ptr<BlobLock> PosixFileBackend::lock(const std::string& name) {
+        // A separate lock file is used because the blob itself is replaced by rename on every write
+        std::filesystem::path lockPath = directory / (name + ".lock");
+        while (true) {
+            int fd = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+            if (fd < 0)
+                throw std::runtime_error("Failed to open lock file: " + lockPath.string() + ": " + errnoMessage());
+
+            while (flock(fd, LOCK_EX) != 0) {
+                if (errno == EINTR)
+                    continue;
+                std::string message = errnoMessage();
+                close(fd);
+                throw std::runtime_error("Failed to lock: " + lockPath.string() + ": " + message);
+            }
+
+            // The holder may have removed the lock file (removeLock) while this waited, and a lock on the removed
+            // file excludes no one. Then the lock is taken again on the file now at the path
+            struct stat locked{}, current{};
+            if (fstat(fd, &locked) == 0 && stat(lockPath.c_str(), &current) == 0
+                && locked.st_dev == current.st_dev && locked.st_ino == current.st_ino)
+                return std::make_unique<FileLock>(fd);
+            close(fd);
+        }
+    }
+
+    void PosixFileBackend::removeLock(const std::string& name) {
+        unlink((directory / (name + ".lock")).c_str());
+    }
+
+    std::shared_ptr<StorageBackend> PosixFileBackend::openNamespace(const std::string& name) {
+        return std::make_shared<PosixFileBackend>(directory / name, ".blob");
+    }
+
+    bool PosixFileBackend::watching() const {
+        if (watchFailed)
+            return false;
+        if (watchFd >= 0)
+            return true;
+        watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        // Writes replace the file by a rename (IN_MOVED_TO), IN_CLOSE_WRITE catches other programs writing in place
+        uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF;
+        if (watchFd < 0 || inotify_add_watch(watchFd, directory.c_str(), mask) < 0) {
+            if (watchFd >= 0)
+                close(watchFd);
+            watchFd = -1;
+            watchFailed = true;
+            return false;
+        }
+        return true;
+    }
+
+    void PosixFileBackend::readEvents() const {
+        alignas(inotify_event) char buffer[16 * 1024];
+        while (true) {
+            ssize_t got = read(watchFd, buffer, sizeof(buffer));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                return;
+
+            for (size_t offset = 0; offset < static_cast<size_t>(got);) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    allGeneration = namesGeneration = ++lastGeneration;
+                } else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                    // The directory itself is gone, from now on nothing can be told
+                    watchFailed = true;
+                } else if (event->len > 0) {
+                    std::filesystem::path file(event->name);
+                    if (file.extension() != extension)
+                        continue; // Temporary and lock files
+                    generations[file.stem().string()] = ++lastGeneration;
+                    if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+                        namesGeneration = lastGeneration;
+                }
+            }
+        }
+    }
+
+    uint64_t PosixFileBackend::generation(const std::string& name) const {
+        std::lock_guard<std::mutex> guard(watchMutex);
+        // Events are read even once the watch is lost, so the descriptor doesn't stay readable
+        if (watching() || watchFd >= 0)
+            readEvents();
+        if (watchFailed)
+            return ++lastGeneration;
+        auto it = generations.find(name);
+        return std::max(it == generations.end() ? 0 : it->second, allGeneration);
+    }
+
+    uint64_t PosixFileBackend::listingGeneration() const {
+        std::lock_guard<std::mutex> guard(watchMutex);
+        if (watching() || watchFd >= 0)
+            readEvents();
+        if (watchFailed)
+            return ++lastGeneration;
+        return namesGeneration;
+    }
+
+    int PosixFileBackend::changeDescriptor() const {
+        std::lock_guard<std::mutex> guard(watchMutex);
+        watching();
+        return watchFd;
+    }
+
+} // namespace storage
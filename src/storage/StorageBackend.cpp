@@ -0,0 +1,44 @@
+#include "storage/StorageBackend.h"
+
+#include <atomic>
+
+namespace storage {
+
+    namespace {
+        // Handed out by backends that can't track changes, never the same twice
+        std::atomic<uint64_t> unknownGeneration{0};
+
+        class OwnedBlobMapping : public BlobMapping {
+        public:
+            explicit OwnedBlobMapping(std::string contents) : contents(std::move(contents)) {}
+            std::string_view data() const override { return contents; }
+        private:
+            std::string contents;
+        };
+    }
+
+    void StorageBackend::writeBlob(const std::string& name, std::string_view data) {
+        std::unique_ptr<BlobWriter> writer = openWriter(name);
+        writer->write(data);
+        writer->commit();
+    }
+
+    std::unique_ptr<BlobMapping> StorageBackend::mapBlob(const std::string& name) const {
+        return std::make_unique<OwnedBlobMapping>(readBlob(name));
+    }
+
+    void StorageBackend::removeLock(const std::string&) {}
+
+    uint64_t StorageBackend::generation(const std::string&) const {
+        return ++unknownGeneration;
+    }
+
+    uint64_t StorageBackend::listingGeneration() const {
+        return ++unknownGeneration;
+    }
+
+    int StorageBackend::changeDescriptor() const {
+        return -1;
+    }
+
+} // namespace storage
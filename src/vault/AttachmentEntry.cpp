@@ -0,0 +1,29 @@
+// Directory: src/vault/AttachmentEntry.cpp
+#include "vault/AttachmentEntry.h"
+
+namespace vault {
+
+    AttachmentEntry::AttachmentEntry(std::string_view fileName, uint64_t size, std::vector<cryptography::SecureString> chunkKeys) :
+        fileName(fileName), size(size), chunkKeys(std::move(chunkKeys)) {}
+
+    EntryType AttachmentEntry::getType() const {
+        return EntryType::ATTACHMENT;
+    }
+
+    std::unique_ptr<Entry> AttachmentEntry::clone() const {
+        return std::make_unique<AttachmentEntry>(*this);
+    }
+
+    const std::string& AttachmentEntry::getFileName() const {
+        return fileName;
+    }
+
+    uint64_t AttachmentEntry::getSize() const {
+        return size;
+    }
+
+    const std::vector<cryptography::SecureString>& AttachmentEntry::getChunkKeys() const {
+        return chunkKeys;
+    }
+
+} // namespace vault
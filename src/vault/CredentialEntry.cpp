@@ -7,17 +7,21 @@
 
 namespace vault {
 
-    CredentialEntry::CredentialEntry(const std::string& usr, const std::string& pwd) : username(usr), password(pwd) {}
+    CredentialEntry::CredentialEntry(std::string_view usr, std::string_view pwd) : username(usr), password(pwd) {}
 
     EntryType CredentialEntry::getType() const {
         return EntryType::CREDENTIAL;
     }
 
-    const std::string& CredentialEntry::getUsername() const {
+    std::unique_ptr<Entry> CredentialEntry::clone() const {
+        return std::make_unique<CredentialEntry>(*this);
+    }
+
+    std::string_view CredentialEntry::getUsername() const {
         return username;
     }
 
-    const std::string& CredentialEntry::getPassword() const {
+    std::string_view CredentialEntry::getPassword() const {
         return password;
     }
 
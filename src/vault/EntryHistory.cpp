@@ -0,0 +1,257 @@
+// Directory: src/vault/EntryHistory.cpp
+#include "vault/EntryHistory.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "vault/Entry.h"
+#include "vault/NoteEntry.h"
+#include "json/JsonScanner.h"
+
+namespace vault {
+
+    using cryptography::SecureString;
+
+    namespace {
+        // Shortest run of bytes worth a copy instead of an insert
+        constexpr size_t matchLength = 8;
+
+        bool isContinuationByte(char c) {
+            return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+        }
+
+        uint64_t load64(const char* data) {
+            uint64_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        /*
+        Appends target encoded against base as a JSON array of [offset,length] copies from base and string inserts.
+        Every 4th position of base is indexed by its next 8 bytes, target is scanned at every position and each hit
+        is extended in both directions. Copies never split a UTF-8 sequence, so the inserts are valid strings
+        */
+        void appendDelta(SecureString& out, std::string_view base, std::string_view target) {
+            std::unordered_map<uint64_t, size_t> index;
+            for (size_t i = 0; i + matchLength <= base.size(); i += 4) {
+                index.emplace(load64(base.data() + i), i);
+            }
+
+            out += '[';
+            bool first = true;
+            auto separator = [&]() {
+                if (!first)
+                    out += ',';
+                first = false;
+            };
+
+            size_t insertStart = 0;
+            size_t i = 0;
+            while (i + matchLength <= target.size()) {
+                auto it = index.find(load64(target.data() + i));
+                if (it == index.end()) {
+                    i++;
+                    continue;
+                }
+
+                size_t start = i, source = it->second;
+                while (start > insertStart && source > 0 && target[start - 1] == base[source - 1]) {
+                    start--;
+                    source--;
+                }
+                size_t end = i + matchLength, sourceEnd = it->second + matchLength;
+                while (end < target.size() && sourceEnd < base.size() && target[end] == base[sourceEnd]) {
+                    end++;
+                    sourceEnd++;
+                }
+                while (start < end && isContinuationByte(target[start])) {
+                    start++;
+                    source++;
+                }
+                while (end > start && end < target.size() && isContinuationByte(target[end]))
+                    end--;
+                if (end - start < matchLength) {
+                    i++;
+                    continue;
+                }
+
+                if (start > insertStart) {
+                    separator();
+                    appendJsonString(out, target.substr(insertStart, start - insertStart));
+                }
+                separator();
+                out += '[';
+                out += std::to_string(source);
+                out += ',';
+                out += std::to_string(end - start);
+                out += ']';
+                i = insertStart = end;
+            }
+            if (insertStart < target.size()) {
+                separator();
+                appendJsonString(out, target.substr(insertStart));
+            }
+            out += ']';
+        }
+
+        SecureString applyDelta(JsonScanner& scanner, std::string_view base) {
+            SecureString out;
+            scanner.forEachElement([&]() {
+                if (scanner.consume('[')) {
+                    long long offset = scanner.readInteger();
+                    scanner.expect(',');
+                    long long length = scanner.readInteger();
+                    scanner.expect(']');
+                    if (offset < 0 || length < 0 || static_cast<size_t>(offset) > base.size()
+                        || static_cast<size_t>(length) > base.size() - static_cast<size_t>(offset))
+                        throw std::invalid_argument("History delta copies outside of the base text");
+                    out.append(base.data() + offset, static_cast<size_t>(length));
+                } else {
+                    out += decodeJsonString<SecureString>(scanner.readRawString());
+                }
+            });
+            return out;
+        }
+    }
+
+    EntryHistory& Entry::getHistory() {
+        return history;
+    }
+
+    const EntryHistory& Entry::getHistory() const {
+        return history;
+    }
+
+    bool EntryHistory::empty() const {
+        return serialized.empty();
+    }
+
+    size_t EntryHistory::size() const {
+        if (serialized.empty())
+            return 0;
+
+        size_t count = 0;
+        JsonScanner scanner(serialized);
+        scanner.forEachElement([&]() {
+            scanner.skipValue();
+            count++;
+        });
+        return count;
+    }
+
+    std::string_view EntryHistory::raw() const {
+        return serialized;
+    }
+
+    void EntryHistory::setRaw(std::string_view raw) {
+        serialized.assign(raw.data(), raw.size());
+        // An empty array is the same as no history
+        if (size() == 0)
+            serialized.clear();
+    }
+
+    std::vector<Revision> EntryHistory::getRevisions(const Entry& current) const {
+        std::vector<Revision> revisions;
+        if (serialized.empty())
+            return revisions;
+
+        JsonScanner scanner(serialized);
+        const Entry* newer = &current;
+        scanner.forEachElement([&]() {
+            size_t begin = scanner.position();
+            Revision revision{};
+            EntryType type{};
+            SecureString text;
+            bool hasTime = false, hasType = false, hasDelta = false;
+
+            scanner.forEachMember([&](std::string_view key) {
+                if (key == "time") {
+                    revision.time = scanner.readInteger();
+                    hasTime = true;
+                } else if (key == "type") {
+                    type = parseEntryType(scanner.readRawString());
+                    hasType = true;
+                } else if (key == "delta") {
+                    // Deltas are only written between two notes
+                    if (newer->getType() != EntryType::NOTE)
+                        throw std::invalid_argument("History delta does not follow a note");
+                    text = applyDelta(scanner, dynamic_cast<const NoteEntry&>(*newer).getNoteText());
+                    hasDelta = true;
+                } else {
+                    scanner.skipValue();
+                }
+            });
+
+            if (!hasTime)
+                throw std::invalid_argument("Revision time is missing or is not a number");
+            if (!hasType)
+                throw std::invalid_argument("Revision type is missing or is not a string");
+            if (hasDelta)
+                revision.entry = std::make_unique<NoteEntry>(text);
+            else
+                revision.entry = materializeEntry(std::string_view(serialized).substr(begin, scanner.position() - begin), type);
+
+            newer = revision.entry.get();
+            revisions.push_back(std::move(revision));
+        });
+        return revisions;
+    }
+
+    void EntryHistory::record(const Entry& previous, const Entry& current, size_t retention, int64_t time) {
+        if (retention == 0) {
+            serialized.clear();
+            return;
+        }
+
+        SecureString updated = "[{\"time\":";
+        updated += std::to_string(time);
+        if (previous.getType() == EntryType::NOTE && current.getType() == EntryType::NOTE) {
+            updated += ",\"delta\":";
+            appendDelta(updated,
+                dynamic_cast<const NoteEntry&>(current).getNoteText(),
+                dynamic_cast<const NoteEntry&>(previous).getNoteText());
+            updated += ",\"type\":\"NOTE\"";
+        } else {
+            updated += ',';
+            appendEntryMembers(updated, previous, nullptr, nullptr, {});
+        }
+        updated += '}';
+
+        // Older revisions stay as they are: their deltas are against previous, which is the newest revision now
+        if (!serialized.empty()) {
+            std::string_view revisions = serialized;
+            size_t open = revisions.find('[');
+            size_t close = revisions.rfind(']');
+            updated += ',';
+            updated.append(revisions.substr(open + 1, close - open - 1));
+        }
+        updated += ']';
+        serialized.swap(updated);
+
+        truncate(retention);
+    }
+
+    void EntryHistory::truncate(size_t retention) {
+        if (serialized.empty())
+            return;
+        if (retention == 0) {
+            serialized.clear();
+            return;
+        }
+
+        size_t count = 0, keptEnd = 0;
+        JsonScanner scanner(serialized);
+        scanner.forEachElement([&]() {
+            scanner.skipValue();
+            if (++count == retention)
+                keptEnd = scanner.position();
+        });
+
+        if (count > retention) {
+            serialized.resize(keptEnd);
+            serialized += ']';
+        }
+    }
+
+} // namespace vault
@@ -0,0 +1,161 @@
+// Directory: src/vault/EntryIndex.cpp
+#include "vault/EntryIndex.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace vault {
+
+    namespace {
+        constexpr std::array<TimeField, 3> timeFields = {TimeField::CREATED, TimeField::MODIFIED, TimeField::LAST_USED};
+
+        bool inside(int64_t time, const TimeRange& range) {
+            return time >= range.from && time < range.to;
+        }
+    }
+
+    EntryIndex::EntryIndex(const Vault& vault) {
+        for (const Folder* folder : vault.getAllFolders()) {
+            for (const std::string& entryName : folder->getEntryNames()) {
+                add({folder->getName(), entryName}, folder->getEntry(entryName).getMetadata());
+            }
+        }
+    }
+
+    EntryIndex::EntryIndex(const VaultView& vault) {
+        for (const std::string& folderName : vault.getFolderNames()) {
+            for (const std::string& entryName : vault.getEntryNames(folderName)) {
+                add({folderName, entryName}, vault.getEntryMetadata(folderName, entryName));
+            }
+        }
+    }
+
+    int64_t EntryIndex::timeOf(const EntryMetadata& metadata, TimeField field) {
+        switch (field) {
+            case TimeField::CREATED:
+                return metadata.created;
+            case TimeField::MODIFIED:
+                return metadata.modified;
+            case TimeField::LAST_USED:
+                return metadata.lastUsed;
+        }
+        throw std::invalid_argument("Unknown time field");
+    }
+
+    void EntryIndex::add(const EntryPath& path, const EntryMetadata& metadata) {
+        remove(path);
+        for (TimeField field : timeFields) {
+            byTime[static_cast<size_t>(field)].emplace(timeOf(metadata, field), path);
+            byFolderTime[static_cast<size_t>(field)].emplace(path.folder, timeOf(metadata, field), path.entry);
+        }
+        for (const std::string& tag : metadata.tags) {
+            byTag[tag].insert(path);
+        }
+        entries.emplace(path, metadata);
+    }
+
+    void EntryIndex::remove(const EntryPath& path) {
+        auto it = entries.find(path);
+        if (it == entries.end())
+            return;
+
+        for (TimeField field : timeFields) {
+            byTime[static_cast<size_t>(field)].erase({timeOf(it->second, field), path});
+            byFolderTime[static_cast<size_t>(field)].erase({path.folder, timeOf(it->second, field), path.entry});
+        }
+        for (const std::string& tag : it->second.tags) {
+            auto tagged = byTag.find(tag);
+            tagged->second.erase(path);
+            if (tagged->second.empty())
+                byTag.erase(tagged);
+        }
+        entries.erase(it);
+    }
+
+    size_t EntryIndex::size() const {
+        return entries.size();
+    }
+
+    std::vector<EntryPath> EntryIndex::inRange(const TimeRange& range, const std::string& folder) const {
+        std::vector<EntryPath> result;
+        if (range.from >= range.to)
+            return result;
+
+        // Paths (and names) compare greater than the empty one, so these are the first elements with time >= from
+        if (!folder.empty()) {
+            const auto& index = byFolderTime[static_cast<size_t>(range.field)];
+            auto it = index.lower_bound({folder, range.from, std::string()});
+            for (; it != index.end() && std::get<0>(*it) == folder && std::get<1>(*it) < range.to; ++it) {
+                result.push_back({folder, std::get<2>(*it)});
+            }
+            return result;
+        }
+        const auto& index = byTime[static_cast<size_t>(range.field)];
+        auto it = index.lower_bound({range.from, EntryPath{}});
+        for (; it != index.end() && it->first < range.to; ++it) {
+            result.push_back(it->second);
+        }
+        return result;
+    }
+
+    std::vector<EntryPath> EntryIndex::withTag(const std::string& tag, const std::string& folder) const {
+        auto it = byTag.find(tag);
+        if (it == byTag.end())
+            return {};
+        if (folder.empty())
+            return {it->second.begin(), it->second.end()};
+        return {it->second.lower_bound({folder, ""}), it->second.lower_bound({folder + '\0', ""})};
+    }
+
+    std::vector<EntryPath> EntryIndex::query(const EntryFilter& filter) const {
+        std::vector<EntryPath> candidates;
+        if (!filter.tags.empty()) {
+            const std::set<EntryPath>* smallest = nullptr;
+            for (const std::string& tag : filter.tags) {
+                auto it = byTag.find(tag);
+                if (it == byTag.end())
+                    return {};
+                if (!smallest || it->second.size() < smallest->size())
+                    smallest = &it->second;
+            }
+            if (filter.folder.empty())
+                candidates.assign(smallest->begin(), smallest->end());
+            else
+                candidates.assign(smallest->lower_bound({filter.folder, ""}), smallest->lower_bound({filter.folder + '\0', ""}));
+        } else if (!filter.ranges.empty()) {
+            candidates = inRange(filter.ranges.front(), filter.folder);
+            std::sort(candidates.begin(), candidates.end());
+        } else if (filter.folder.empty()) {
+            for (const auto& [path, metadata] : entries) {
+                candidates.push_back(path);
+            }
+        } else {
+            auto end = entries.lower_bound({filter.folder + '\0', ""});
+            for (auto it = entries.lower_bound({filter.folder, ""}); it != end; ++it) {
+                candidates.push_back(it->first);
+            }
+        }
+
+        std::erase_if(candidates, [&](const EntryPath& path) {
+            const EntryMetadata& metadata = entries.at(path);
+            for (const TimeRange& range : filter.ranges) {
+                if (!inside(timeOf(metadata, range.field), range))
+                    return true;
+            }
+            for (const std::string& tag : filter.tags) {
+                if (!metadata.hasTag(tag))
+                    return true;
+            }
+            return false;
+        });
+        return candidates;
+    }
+
+    const EntryMetadata& EntryIndex::getMetadata(const EntryPath& path) const {
+        auto it = entries.find(path);
+        if (it == entries.end())
+            throw std::out_of_range("Entry " + path.folder + "/" + path.entry + " is not indexed");
+        return it->second;
+    }
+
+} // namespace vault
@@ -0,0 +1,67 @@
+// Directory: src/vault/EntryMetadata.cpp
+#include "vault/EntryMetadata.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include "vault/Entry.h"
+#include "json/JsonScanner.h"
+
+namespace vault {
+
+    EntryMetadata& Entry::getMetadata() {
+        return metadata;
+    }
+
+    const EntryMetadata& Entry::getMetadata() const {
+        return metadata;
+    }
+
+    bool EntryMetadata::empty() const {
+        return created == 0 && modified == 0 && lastUsed == 0 && tags.empty();
+    }
+
+    bool EntryMetadata::hasTag(std::string_view tag) const {
+        return std::binary_search(tags.begin(), tags.end(), tag);
+    }
+
+    void EntryMetadata::addTag(std::string_view tag) {
+        if (tag.empty())
+            throw std::invalid_argument("Tag must not be empty");
+        auto it = std::lower_bound(tags.begin(), tags.end(), tag);
+        if (it == tags.end() || *it != tag)
+            tags.emplace(it, tag);
+    }
+
+    void EntryMetadata::removeTag(std::string_view tag) {
+        auto it = std::lower_bound(tags.begin(), tags.end(), tag);
+        if (it != tags.end() && *it == tag)
+            tags.erase(it);
+    }
+
+    bool EntryMetadata::markUsed(int64_t time) {
+        int64_t rounded = time - time % lastUsedGranularity;
+        if (rounded == lastUsed)
+            return false;
+        lastUsed = rounded;
+        return true;
+    }
+
+    bool readMetadataMember(JsonScanner& scanner, std::string_view key, EntryMetadata& metadata) {
+        if (key == "created") {
+            metadata.created = scanner.readInteger();
+        } else if (key == "modified") {
+            metadata.modified = scanner.readInteger();
+        } else if (key == "lastUsed") {
+            metadata.lastUsed = scanner.readInteger();
+        } else if (key == "tags") {
+            metadata.tags.clear();
+            scanner.forEachElement([&]() {
+                metadata.addTag(scanner.readString());
+            });
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+} // namespace vault
@@ -0,0 +1,89 @@
+// Directory: src/vault/Export.cpp
+#include "vault/Export.h"
+
+#include <stdexcept>
+#include "vault/CredentialEntry.h"
+#include "vault/NoteEntry.h"
+
+namespace vault {
+
+    namespace {
+        // Quotes the field if it holds a separator, a quote or a line break (quotes inside are doubled)
+        void appendCsvField(OutputWriter& out, std::string_view field) {
+            if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+                out << field;
+                return;
+            }
+            out << '"';
+            for (size_t quote; (quote = field.find('"')) != std::string_view::npos; field.remove_prefix(quote + 1)) {
+                out << field.substr(0, quote + 1) << '"';
+            }
+            out << field << '"';
+        }
+    }
+
+    ExportFormat parseExportFormat(std::string_view name) {
+        if (name == "jsonl")
+            return ExportFormat::JSONL;
+        if (name == "csv")
+            return ExportFormat::CSV;
+        throw std::invalid_argument("Unknown export format: " + std::string(name));
+    }
+
+    ExportWriter::ExportWriter(ExportFormat format, std::ostream& output) : format(format), output(output) {
+        if (format == ExportFormat::CSV)
+            this->output << "folder,name,type,username,password,notes\n";
+    }
+
+    bool ExportWriter::write(const std::string& folderName, const std::string& entryName, const Entry& entry) {
+        std::string_view type, username, password, notes;
+        switch (entry.getType()) {
+            case EntryType::CREDENTIAL: {
+                const auto& credential = dynamic_cast<const CredentialEntry&>(entry);
+                type = "credential";
+                username = credential.getUsername();
+                password = credential.getPassword();
+                break;
+            }
+            case EntryType::NOTE:
+                type = "note";
+                notes = dynamic_cast<const NoteEntry&>(entry).getNoteText();
+                break;
+            case EntryType::ATTACHMENT:
+                return false;
+        }
+
+        if (format == ExportFormat::CSV) {
+            for (std::string_view field : {std::string_view(folderName), std::string_view(entryName), type, username, password}) {
+                appendCsvField(output, field);
+                output << ',';
+            }
+            appendCsvField(output, notes);
+        } else {
+            output << "{\"folder\":";
+            output.json(folderName) << ",\"name\":";
+            output.json(entryName) << ",\"type\":";
+            output.json(type);
+            if (entry.getType() == EntryType::CREDENTIAL) {
+                output << ",\"username\":";
+                output.json(username) << ",\"password\":";
+                output.json(password);
+            } else {
+                output << ",\"notes\":";
+                output.json(notes);
+            }
+            output << '}';
+        }
+        output << '\n';
+        return true;
+    }
+
+    void ExportWriter::finish() {
+        output.finish();
+    }
+
+    uint64_t ExportWriter::getBytesWritten() const {
+        return output.getBytesWritten();
+    }
+
+} // vault
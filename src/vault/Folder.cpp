@@ -5,6 +5,8 @@
 // Directory: src/vault/Folder.cpp
 #include "vault/Folder.h"
 
+#include <ctime>
+
 namespace vault {
 
     Folder::Folder(const std::string& fnm) : folderName(fnm) {}
@@ -13,7 +15,7 @@ namespace vault {
         if (entryExists(entryName)) {
             throw std::runtime_error("Entry with name " + entryName + " already exists in folder " + folderName);
         }
-        entries[entryName] = std::move(entry);
+        entries.set(entryName, std::move(entry));
     }
 
     void Folder::deleteEntry(const std::string &entryName) {
@@ -22,20 +24,49 @@ namespace vault {
         entries.erase(entryName);
     }
 
+    void Folder::shareEntry(const std::string& entryName, Folder& target, const std::string& newName) const {
+        const std::shared_ptr<Entry>* entry = entries.find(entryName);
+        if (!entry) {
+            throw std::out_of_range("Entry with name " + entryName + " does not exist in folder " + folderName);
+        }
+        if (target.entryExists(newName)) {
+            throw std::runtime_error("Entry with name " + newName + " already exists in folder " + target.folderName);
+        }
+        target.entries.set(newName, *entry);
+    }
+
+    void Folder::replaceEntry(const std::string& entryName, const std::string& newEntryName, std::unique_ptr<Entry> newEntry, size_t retention,
+                              int64_t modified) {
+        if (newEntryName != entryName && entryExists(newEntryName)) {
+            throw std::runtime_error("Entry with name " + newEntryName + " already exists in folder " + folderName);
+        }
+        Entry& entry = getEntry(entryName);
+        newEntry->getHistory() = std::move(entry.getHistory());
+        newEntry->getHistory().record(entry, *newEntry, retention);
+        // Creation time and tags belong to the entry, not to its value
+        newEntry->getMetadata() = entry.getMetadata();
+        newEntry->getMetadata().modified = modified;
+        deleteEntry(entryName);
+        addEntry(std::move(newEntry), newEntryName);
+    }
+
     Entry& Folder::getEntry(const std::string& entryName) {
-        auto it = entries.find(entryName);
-        if (it == entries.end()) {
+        if (!entryExists(entryName)) {
             throw std::out_of_range("Entry with name " + entryName + " does not exist in folder " + folderName);
         }
-        return *it->second.get(); // This is safe because we checked for existence above
+        // The slot returned by edit belongs to this folder only, so anything else holding the entry is a snapshot
+        std::shared_ptr<Entry>& entry = entries.edit(entryName);
+        if (entry.use_count() != 1)
+            entry = entry->clone();
+        return *entry;
     }
 
     const Entry& Folder::getEntry(const std::string& entryName) const {
-        auto it = entries.find(entryName);
-        if (it == entries.end()) {
+        const std::shared_ptr<Entry>* entry = entries.find(entryName);
+        if (!entry) {
             throw std::out_of_range("Entry with name " + entryName + " does not exist in folder " + folderName);
         }
-        return *it->second.get(); // This is safe because we checked for existence above
+        return **entry;
     }
 
     std::vector<const Entry*> Folder::getAllEntries() const {
@@ -63,18 +94,7 @@ namespace vault {
     }
 
     bool Folder::entryExists(const std::string& entryName) const {
-        return entries.find(entryName) != entries.end();
-    }
-
-    Folder::Folder(Folder && other) noexcept :
-    folderName(std::move(other.folderName)), entries(std::move(other.entries)) {}
-
-    Folder& Folder::operator=(Folder && other) noexcept {
-        if (this != &other) {
-            folderName = std::move(other.folderName);
-            entries = std::move(other.entries);
-        }
-        return *this;
+        return entries.contains(entryName);
     }
 
 } // namespace vault
\ No newline at end of file
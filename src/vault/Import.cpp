@@ -0,0 +1,876 @@
+// Directory: src/vault/Import.cpp
+#include "vault/Import.h"
+
+#include <algorithm>
+#include <ctime>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "vault/CredentialEntry.h"
+#include "vault/NoteEntry.h"
+#include "json/JsonScanner.h"
+
+namespace vault {
+
+    using cryptography::SecureString;
+
+    namespace {
+        constexpr size_t readSize = 64 * 1024;
+
+        // Buffered character reader that knows where it is, for error messages
+        class InputReader {
+        public:
+            explicit InputReader(std::istream& input) : input(input), buffer(readSize, '\0') {}
+
+            int peek() {
+                if (pos == end && !fill())
+                    return EOF;
+                return static_cast<unsigned char>(buffer[pos]);
+            }
+
+            int get() {
+                int c = peek();
+                if (c != EOF) {
+                    pos++;
+                    consumed++;
+                    if (c == '\n')
+                        line++;
+                }
+                return c;
+            }
+
+            bool consume(char c) {
+                if (peek() != static_cast<unsigned char>(c))
+                    return false;
+                get();
+                return true;
+            }
+
+            uint64_t bytesRead() const {
+                return consumed;
+            }
+
+            [[noreturn]] void fail(const std::string& message) const {
+                throw std::runtime_error("Malformed import at line " + std::to_string(line) + ": " + message);
+            }
+
+        private:
+            std::istream& input;
+            SecureString buffer; // Holds secrets on their way through
+            size_t pos = 0, end = 0;
+            uint64_t consumed = 0;
+            size_t line = 1;
+
+            bool fill() {
+                input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                if (input.bad())
+                    throw std::runtime_error("Failed to read the import");
+                pos = 0;
+                end = static_cast<size_t>(input.gcount());
+                return end > 0;
+            }
+        };
+
+        std::string lowercase(std::string_view text) {
+            std::string lower(text);
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+            return lower;
+        }
+
+        void appendLine(SecureString& out, std::string_view label, std::string_view value) {
+            if (value.empty())
+                return;
+            if (!out.empty())
+                out += '\n';
+            out.append(label.data(), label.size());
+            out += ": ";
+            out.append(value.data(), value.size());
+        }
+
+        // Puts text in front of the notes read so far (fields that came before the notes themselves)
+        void prependNotes(SecureString& notes, SecureString& text) {
+            if (!notes.empty() && !text.empty())
+                text += '\n';
+            text += notes;
+            notes.swap(text);
+        }
+
+        // Columns and members of the generic formats, by their names in the common exports
+        enum class Field {
+            FOLDER,
+            NAME,
+            URL,
+            USERNAME,
+            PASSWORD,
+            NOTES,
+            TOTP,
+            TYPE,
+            NONE
+        };
+
+        Field fieldFor(std::string_view key) {
+            static const std::unordered_map<std::string, Field> fields{
+                {"folder", Field::FOLDER}, {"grouping", Field::FOLDER}, {"group", Field::FOLDER},
+                {"name", Field::NAME}, {"title", Field::NAME},
+                {"url", Field::URL}, {"uri", Field::URL}, {"login_uri", Field::URL}, {"website", Field::URL},
+                {"username", Field::USERNAME}, {"login_username", Field::USERNAME}, {"login", Field::USERNAME}, {"user", Field::USERNAME},
+                {"password", Field::PASSWORD}, {"login_password", Field::PASSWORD},
+                {"notes", Field::NOTES}, {"note", Field::NOTES}, {"extra", Field::NOTES}, {"comments", Field::NOTES},
+                {"totp", Field::TOTP}, {"login_totp", Field::TOTP},
+                {"type", Field::TYPE},
+            };
+            auto it = fields.find(lowercase(key));
+            return it == fields.end() ? Field::NONE : it->second;
+        }
+
+        void assignField(ImportedRecord& record, Field field, SecureString& value) {
+            switch (field) {
+                case Field::FOLDER:
+                    record.folder.assign(value.data(), value.size());
+                    break;
+                case Field::NAME:
+                    record.name.assign(value.data(), value.size());
+                    break;
+                case Field::URL:
+                    record.url.swap(value);
+                    break;
+                case Field::USERNAME:
+                    record.username.swap(value);
+                    break;
+                case Field::PASSWORD:
+                    record.password.swap(value);
+                    break;
+                case Field::NOTES:
+                    prependNotes(record.notes, value);
+                    break;
+                case Field::TOTP:
+                    appendLine(record.notes, "TOTP", value);
+                    break;
+                case Field::TYPE: {
+                    std::string type = lowercase(std::string_view(value.data(), value.size()));
+                    record.note = type == "note" || type == "securenote" || type == "secure note";
+                    break;
+                }
+                case Field::NONE:
+                    break;
+            }
+        }
+
+        // --- CSV ---
+
+        // Reads one RFC 4180 row, returns false at the end of the input
+        bool readCsvRow(InputReader& in, std::vector<SecureString>& fields) {
+            fields.clear();
+            if (in.peek() == EOF)
+                return false;
+
+            fields.emplace_back();
+            while (true) {
+                int c = in.get();
+                if (c == EOF || c == '\n')
+                    break;
+                if (c == '\r') {
+                    in.consume('\n');
+                    break;
+                }
+                if (c == ',') {
+                    fields.emplace_back();
+                } else if (c == '"' && fields.back().empty()) {
+                    // Quoted field, "" is a quote
+                    while (true) {
+                        c = in.get();
+                        if (c == EOF)
+                            in.fail("unterminated quoted field");
+                        if (c == '"' && !in.consume('"'))
+                            break;
+                        fields.back() += static_cast<char>(c);
+                    }
+                } else {
+                    fields.back() += static_cast<char>(c);
+                }
+            }
+            return true;
+        }
+
+        void readCsv(InputReader& in, const ImportedRecordSink& sink) {
+            std::vector<SecureString> row;
+            if (!readCsvRow(in, row))
+                return;
+            std::vector<Field> columns;
+            for (const SecureString& name : row) {
+                columns.push_back(fieldFor(std::string_view(name.data(), name.size())));
+            }
+            if (std::find(columns.begin(), columns.end(), Field::PASSWORD) == columns.end()
+                && std::find(columns.begin(), columns.end(), Field::NOTES) == columns.end())
+                in.fail("the header has neither a password nor a notes column");
+
+            while (readCsvRow(in, row)) {
+                // Blank lines separate nothing
+                if (row.size() == 1 && row[0].empty())
+                    continue;
+                ImportedRecord record;
+                for (size_t i = 0; i < row.size() && i < columns.size(); i++) {
+                    assignField(record, columns[i], row[i]);
+                }
+                sink(record);
+            }
+        }
+
+        // --- JSON ---
+
+        void skipJsonWhitespace(InputReader& in) {
+            for (int c = in.peek(); c == ' ' || c == '\n' || c == '\r' || c == '\t'; c = in.peek()) {
+                in.get();
+            }
+        }
+
+        bool consumeJson(InputReader& in, char c) {
+            skipJsonWhitespace(in);
+            return in.consume(c);
+        }
+
+        void expectJson(InputReader& in, char c) {
+            if (!consumeJson(in, c))
+                in.fail(std::string("expected '") + c + "'");
+        }
+
+        void copyJsonString(InputReader& in, SecureString& out) {
+            out += static_cast<char>(in.get());
+            while (true) {
+                int c = in.get();
+                if (c == EOF)
+                    in.fail("unterminated string");
+                out += static_cast<char>(c);
+                if (c == '\\') {
+                    c = in.get();
+                    if (c == EOF)
+                        in.fail("unterminated string");
+                    out += static_cast<char>(c);
+                } else if (c == '"') {
+                    return;
+                }
+            }
+        }
+
+        // Appends the text of the next value to out. Only the nesting is checked here, JsonScanner checks the rest
+        void readJsonValue(InputReader& in, SecureString& out) {
+            skipJsonWhitespace(in);
+            int c = in.peek();
+            if (c == EOF)
+                in.fail("unexpected end of input");
+            if (c == '"') {
+                copyJsonString(in, out);
+                return;
+            }
+            if (c == '{' || c == '[') {
+                size_t depth = 0;
+                do {
+                    c = in.peek();
+                    if (c == EOF)
+                        in.fail("unexpected end of input");
+                    if (c == '"') {
+                        copyJsonString(in, out);
+                        continue;
+                    }
+                    if (c == '{' || c == '[')
+                        depth++;
+                    else if (c == '}' || c == ']')
+                        depth--;
+                    out += static_cast<char>(in.get());
+                } while (depth > 0);
+                return;
+            }
+            while (c != EOF && c != ',' && c != ']' && c != '}' && c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+                out += static_cast<char>(in.get());
+                c = in.peek();
+            }
+        }
+
+        // Passes each element of the array that comes next to callback, one at a time
+        template<typename Callback>
+        void forEachStreamedElement(InputReader& in, Callback&& callback) {
+            expectJson(in, '[');
+            if (consumeJson(in, ']'))
+                return;
+            SecureString element;
+            do {
+                element.clear();
+                readJsonValue(in, element);
+                callback(std::string_view(element.data(), element.size()));
+            } while (consumeJson(in, ','));
+            expectJson(in, ']');
+        }
+
+        // Scanner errors point into a single element, so they are reported at the reader's line instead
+        template<typename Parse>
+        void parseElement(InputReader& in, Parse&& parse) {
+            try {
+                parse();
+            } catch (const std::invalid_argument& e) {
+                in.fail(e.what());
+            }
+        }
+
+        SecureString readSecureString(JsonScanner& scanner) {
+            return decodeJsonString<SecureString>(scanner.readRawString());
+        }
+
+        // Strings are read, null and everything else is skipped
+        bool readOptionalString(JsonScanner& scanner, SecureString& out) {
+            if (scanner.peek() != '"') {
+                scanner.skipValue();
+                return false;
+            }
+            out = readSecureString(scanner);
+            return true;
+        }
+
+        void readJsonRecord(InputReader& in, std::string_view element, const ImportedRecordSink& sink) {
+            ImportedRecord record;
+            parseElement(in, [&]() {
+                JsonScanner scanner(element);
+                scanner.forEachMember([&](std::string_view key) {
+                    SecureString value;
+                    if (readOptionalString(scanner, value))
+                        assignField(record, fieldFor(decodeJsonString<std::string>(key)), value);
+                });
+            });
+            sink(record);
+        }
+
+        void readJson(InputReader& in, const ImportedRecordSink& sink) {
+            skipJsonWhitespace(in);
+            if (in.peek() == '[') {
+                forEachStreamedElement(in, [&](std::string_view element) {
+                    readJsonRecord(in, element, sink);
+                });
+                skipJsonWhitespace(in);
+                if (in.peek() != EOF)
+                    in.fail("unexpected data after the array");
+                return;
+            }
+
+            // JSON lines (or any sequence of objects)
+            SecureString element;
+            while (in.peek() != EOF) {
+                element.clear();
+                readJsonValue(in, element);
+                readJsonRecord(in, {element.data(), element.size()}, sink);
+                skipJsonWhitespace(in);
+            }
+        }
+
+        // --- Bitwarden ---
+
+        // Members of a card or an identity, as lines of the note
+        void appendMembers(JsonScanner& scanner, SecureString& notes) {
+            scanner.forEachMember([&](std::string_view key) {
+                SecureString value;
+                if (readOptionalString(scanner, value))
+                    appendLine(notes, decodeJsonString<std::string>(key), value);
+            });
+        }
+
+        void readBitwardenItem(JsonScanner& scanner, const std::unordered_map<std::string, std::string>& folders, ImportedRecord& record) {
+            SecureString customFields;
+            scanner.forEachMember([&](std::string_view key) {
+                SecureString value;
+                if (key == "name") {
+                    readOptionalString(scanner, value);
+                    record.name.assign(value.data(), value.size());
+                } else if (key == "notes") {
+                    readOptionalString(scanner, record.notes);
+                } else if (key == "folderId") {
+                    if (readOptionalString(scanner, value)) {
+                        auto folder = folders.find(std::string(value.data(), value.size()));
+                        if (folder != folders.end())
+                            record.folder = folder->second;
+                    }
+                } else if (key == "type") {
+                    // 1 is a login, 2 a secure note, 3 a card and 4 an identity
+                    record.note = scanner.readInteger() != 1;
+                } else if (key == "login" && scanner.peek() == '{') {
+                    scanner.forEachMember([&](std::string_view loginKey) {
+                        if (loginKey == "username") {
+                            readOptionalString(scanner, record.username);
+                        } else if (loginKey == "password") {
+                            readOptionalString(scanner, record.password);
+                        } else if (loginKey == "totp") {
+                            if (readOptionalString(scanner, value))
+                                appendLine(customFields, "TOTP", value);
+                        } else if (loginKey == "uris" && scanner.peek() == '[') {
+                            scanner.forEachElement([&]() {
+                                scanner.forEachMember([&](std::string_view uriKey) {
+                                    if (uriKey == "uri" && record.url.empty())
+                                        readOptionalString(scanner, record.url);
+                                    else
+                                        scanner.skipValue();
+                                });
+                            });
+                        } else {
+                            scanner.skipValue();
+                        }
+                    });
+                } else if ((key == "card" || key == "identity") && scanner.peek() == '{') {
+                    appendMembers(scanner, customFields);
+                } else if (key == "fields" && scanner.peek() == '[') {
+                    scanner.forEachElement([&]() {
+                        std::string fieldName;
+                        SecureString fieldValue;
+                        scanner.forEachMember([&](std::string_view fieldKey) {
+                            if (fieldKey == "name" && readOptionalString(scanner, value))
+                                fieldName.assign(value.data(), value.size());
+                            else if (fieldKey == "value")
+                                readOptionalString(scanner, fieldValue);
+                            else
+                                scanner.skipValue();
+                        });
+                        appendLine(customFields, fieldName, fieldValue);
+                    });
+                } else {
+                    scanner.skipValue();
+                }
+            });
+            if (!customFields.empty()) {
+                if (!record.notes.empty())
+                    record.notes += '\n';
+                record.notes += customFields;
+            }
+        }
+
+        void readBitwarden(InputReader& in, const ImportedRecordSink& sink) {
+            std::unordered_map<std::string, std::string> folders;
+            bool itemsRead = false;
+            SecureString value;
+
+            expectJson(in, '{');
+            if (consumeJson(in, '}'))
+                return;
+            do {
+                value.clear();
+                skipJsonWhitespace(in);
+                if (in.peek() != '"')
+                    in.fail("expected a member name");
+                readJsonValue(in, value);
+                std::string key;
+                parseElement(in, [&]() {
+                    key = JsonScanner(std::string_view(value.data(), value.size())).readString();
+                });
+                expectJson(in, ':');
+                skipJsonWhitespace(in);
+
+                if (key == "folders" && in.peek() == '[') {
+                    if (itemsRead)
+                        in.fail("folders have to come before items");
+                    forEachStreamedElement(in, [&](std::string_view element) {
+                        parseElement(in, [&]() {
+                            JsonScanner scanner(element);
+                            std::string id, name;
+                            scanner.forEachMember([&](std::string_view folderKey) {
+                                if (folderKey == "id" && scanner.peek() == '"')
+                                    id = scanner.readString();
+                                else if (folderKey == "name" && scanner.peek() == '"')
+                                    name = scanner.readString();
+                                else
+                                    scanner.skipValue();
+                            });
+                            folders[id] = name;
+                        });
+                    });
+                } else if (key == "items" && in.peek() == '[') {
+                    itemsRead = true;
+                    forEachStreamedElement(in, [&](std::string_view element) {
+                        ImportedRecord record;
+                        parseElement(in, [&]() {
+                            JsonScanner scanner(element);
+                            readBitwardenItem(scanner, folders, record);
+                        });
+                        sink(record);
+                    });
+                } else {
+                    value.clear();
+                    readJsonValue(in, value);
+                    if (key == "encrypted" && std::string_view(value.data(), value.size()) == "true")
+                        in.fail("encrypted Bitwarden exports can't be imported, export the vault unencrypted");
+                }
+            } while (consumeJson(in, ','));
+            expectJson(in, '}');
+        }
+
+        // --- KeePass XML ---
+
+        // Appends the character reference or entity after '&' (unknown ones are kept as they are)
+        void readXmlEntity(InputReader& in, SecureString& out) {
+            std::string name;
+            while (name.size() < 12 && in.peek() != EOF && in.peek() != ';' && in.peek() != '<') {
+                name += static_cast<char>(in.get());
+            }
+            if (!in.consume(';')) {
+                out += '&';
+                out += name;
+                return;
+            }
+
+            if (name == "amp")
+                out += '&';
+            else if (name == "lt")
+                out += '<';
+            else if (name == "gt")
+                out += '>';
+            else if (name == "quot")
+                out += '"';
+            else if (name == "apos")
+                out += '\'';
+            else if (name.size() > 1 && name[0] == '#') {
+                bool hex = name[1] == 'x' || name[1] == 'X';
+                uint32_t codePoint;
+                try {
+                    codePoint = static_cast<uint32_t>(std::stoul(name.substr(hex ? 2 : 1), nullptr, hex ? 16 : 10));
+                } catch (const std::exception&) {
+                    in.fail("malformed character reference &" + name + ";");
+                }
+                if (codePoint > 0x10FFFF)
+                    in.fail("malformed character reference &" + name + ";");
+                detail::appendUtf8(out, codePoint);
+            } else {
+                out += '&';
+                out += name;
+                out += ';';
+            }
+        }
+
+        // Skips input up to and including terminator
+        void skipPast(InputReader& in, std::string_view terminator) {
+            size_t matched = 0;
+            while (matched < terminator.size()) {
+                int c = in.get();
+                if (c == EOF)
+                    in.fail("unexpected end of input");
+                matched = c == terminator[matched] ? matched + 1 : (c == terminator[0] ? 1 : 0);
+            }
+        }
+
+        class KeePassReader {
+        public:
+            KeePassReader(InputReader& in, const ImportedRecordSink& sink) : in(in), sink(sink) {}
+
+            void read() {
+                // Everything between two tags is text of the element that is open
+                for (int c = in.get(); c != EOF; c = in.get()) {
+                    if (c == '<')
+                        readMarkup();
+                    else if (c == '&')
+                        readXmlEntity(in, text);
+                    else
+                        text += static_cast<char>(c);
+                }
+                if (!elements.empty())
+                    in.fail("unclosed element <" + elements.back() + ">");
+            }
+
+        private:
+            struct Group {
+                std::string name;
+                bool skipped; // The recycle bin or inside it
+            };
+
+            InputReader& in;
+            const ImportedRecordSink& sink;
+            std::vector<std::string> elements;
+            std::vector<Group> groups;
+            SecureString text;
+            SecureString key; // Of the String being read
+            ImportedRecord record;
+            std::string recycleBin;
+            size_t historyDepth = 0; // Previous versions of an entry are not imported
+            bool inEntry = false;
+
+            std::string readName() {
+                std::string name;
+                for (int c = in.peek(); c != EOF && c != '>' && c != '/' && c != ' ' && c != '\t' && c != '\n' && c != '\r'; c = in.peek()) {
+                    name += static_cast<char>(in.get());
+                }
+                if (name.empty())
+                    in.fail("expected an element name");
+                return name;
+            }
+
+            void readMarkup() {
+                int c = in.peek();
+                if (c == '?') {
+                    skipPast(in, "?>");
+                } else if (c == '!') {
+                    in.get();
+                    if (in.consume('[')) {
+                        // CDATA is text as it is
+                        skipPast(in, "CDATA[");
+                        for (c = in.get(); ; c = in.get()) {
+                            if (c == EOF)
+                                in.fail("unterminated CDATA section");
+                            text += static_cast<char>(c);
+                            if (std::string_view(text).ends_with("]]>")) {
+                                text.resize(text.size() - 3);
+                                break;
+                            }
+                        }
+                    } else if (in.consume('-')) {
+                        skipPast(in, "-->");
+                    } else {
+                        skipPast(in, ">");
+                    }
+                } else if (c == '/') {
+                    in.get();
+                    std::string name = readName();
+                    skipPast(in, ">");
+                    if (elements.empty() || elements.back() != name)
+                        in.fail("unexpected </" + name + ">");
+                    end(name);
+                    elements.pop_back();
+                    text.clear();
+                } else {
+                    std::string name = readName();
+                    // Attributes don't matter, but a quoted '>' must not end the tag
+                    char quote = 0, last = 0;
+                    for (c = in.get(); c != EOF && (quote || c != '>'); c = in.get()) {
+                        if (quote && c == quote)
+                            quote = 0;
+                        else if (!quote && (c == '"' || c == '\''))
+                            quote = static_cast<char>(c);
+                        last = static_cast<char>(c);
+                    }
+                    if (c == EOF)
+                        in.fail("unterminated <" + name + ">");
+                    elements.push_back(name);
+                    start(name);
+                    if (last == '/') {
+                        end(name);
+                        elements.pop_back();
+                    }
+                    text.clear();
+                }
+            }
+
+            const std::string& parent() const {
+                static const std::string none;
+                return elements.size() >= 2 ? elements[elements.size() - 2] : none;
+            }
+
+            void start(const std::string& name) {
+                if (name == "History") {
+                    historyDepth++;
+                } else if (historyDepth == 0 && name == "Group") {
+                    groups.push_back({"", !groups.empty() && groups.back().skipped});
+                } else if (historyDepth == 0 && name == "Entry") {
+                    inEntry = true;
+                    record = ImportedRecord();
+                }
+            }
+
+            void end(const std::string& name) {
+                if (name == "History") {
+                    historyDepth--;
+                    return;
+                }
+                if (historyDepth > 0)
+                    return;
+
+                if (name == "RecycleBinUUID" && parent() == "Meta") {
+                    recycleBin.assign(text.data(), text.size());
+                } else if (name == "UUID" && parent() == "Group" && !groups.empty()) {
+                    if (!recycleBin.empty() && recycleBin == std::string_view(text.data(), text.size()))
+                        groups.back().skipped = true;
+                } else if (name == "Name" && parent() == "Group" && !groups.empty()) {
+                    groups.back().name.assign(text.data(), text.size());
+                } else if (name == "Key" && parent() == "String" && inEntry) {
+                    key.swap(text);
+                } else if (name == "Value" && parent() == "String" && inEntry) {
+                    assignString();
+                } else if (name == "Entry" && inEntry) {
+                    inEntry = false;
+                    if (groups.empty() || !groups.back().skipped) {
+                        // The first group is the database itself
+                        for (size_t i = 1; i < groups.size(); i++) {
+                            record.folder += (i > 1 ? "." : "") + groups[i].name;
+                        }
+                        sink(record);
+                    }
+                } else if (name == "Group" && !groups.empty()) {
+                    groups.pop_back();
+                }
+            }
+
+            void assignString() {
+                std::string_view field(key.data(), key.size());
+                if (field == "Title") {
+                    record.name.assign(text.data(), text.size());
+                } else if (field == "UserName") {
+                    record.username.swap(text);
+                } else if (field == "Password") {
+                    record.password.swap(text);
+                } else if (field == "URL") {
+                    record.url.swap(text);
+                } else if (field == "Notes") {
+                    prependNotes(record.notes, text);
+                } else {
+                    appendLine(record.notes, field == "otp" ? "TOTP" : field, text);
+                }
+            }
+        };
+
+        // '/' separates path segments on the command line, so names can't have it
+        std::string sanitizeName(std::string name) {
+            std::replace(name.begin(), name.end(), '/', '.');
+            size_t first = name.find_first_not_of(" \t\r\n");
+            size_t last = name.find_last_not_of(" \t\r\n");
+            return first == std::string::npos ? std::string() : name.substr(first, last - first + 1);
+        }
+
+        // Host of a URL, for records that have no name
+        std::string hostOf(std::string_view url) {
+            size_t scheme = url.find("://");
+            if (scheme != std::string_view::npos)
+                url.remove_prefix(scheme + 3);
+            url = url.substr(0, url.find_first_of("/?#"));
+            size_t credentials = url.rfind('@');
+            if (credentials != std::string_view::npos)
+                url.remove_prefix(credentials + 1);
+            return std::string(url);
+        }
+    }
+
+    ImportFormat parseImportFormat(std::string_view name) {
+        if (name == "csv")
+            return ImportFormat::CSV;
+        if (name == "json")
+            return ImportFormat::JSON;
+        if (name == "bitwarden")
+            return ImportFormat::BITWARDEN;
+        if (name == "keepass-xml")
+            return ImportFormat::KEEPASS_XML;
+        throw std::invalid_argument("Unknown import format: " + std::string(name));
+    }
+
+    ImportFormat guessImportFormat(std::string_view fileName) {
+        size_t dot = fileName.rfind('.');
+        std::string extension = dot == std::string_view::npos ? std::string() : lowercase(fileName.substr(dot + 1));
+        if (extension == "csv")
+            return ImportFormat::CSV;
+        if (extension == "json" || extension == "jsonl")
+            return ImportFormat::JSON;
+        if (extension == "xml")
+            return ImportFormat::KEEPASS_XML;
+        throw std::invalid_argument("Can't tell the format of " + std::string(fileName) + ", give it with --format");
+    }
+
+    ConflictPolicy parseConflictPolicy(std::string_view name) {
+        if (name == "skip")
+            return ConflictPolicy::SKIP;
+        if (name == "overwrite")
+            return ConflictPolicy::OVERWRITE;
+        if (name == "rename")
+            return ConflictPolicy::RENAME;
+        throw std::invalid_argument("Unknown conflict policy: " + std::string(name));
+    }
+
+    uint64_t readImportRecords(std::istream& input, ImportFormat format, const ImportedRecordSink& sink) {
+        InputReader in(input);
+        // Byte order mark, as written by Windows tools
+        if (in.consume('\xEF') && !(in.consume('\xBB') && in.consume('\xBF')))
+            in.fail("unexpected byte at the start of the input");
+
+        switch (format) {
+            case ImportFormat::CSV:
+                readCsv(in, sink);
+                break;
+            case ImportFormat::JSON:
+                readJson(in, sink);
+                break;
+            case ImportFormat::BITWARDEN:
+                readBitwarden(in, sink);
+                break;
+            case ImportFormat::KEEPASS_XML:
+                KeePassReader(in, sink).read();
+                break;
+        }
+        return in.bytesRead();
+    }
+
+    VaultImporter::VaultImporter(Vault& vault, ConflictPolicy policy, std::string folder_val, bool intoFolder) :
+        vault(vault), policy(policy), folder(sanitizeName(std::move(folder_val))), intoFolder(intoFolder), time(std::time(nullptr)) {
+        if (folder.empty())
+            throw std::invalid_argument("Import folder name must not be empty");
+    }
+
+    const ImportStats& VaultImporter::getStats() const {
+        return stats;
+    }
+
+    void VaultImporter::add(ImportedRecord& record) {
+        std::string folderName = intoFolder ? folder : sanitizeName(record.folder);
+        if (folderName.empty())
+            folderName = folder;
+        std::string host = sanitizeName(hostOf(std::string_view(record.url.data(), record.url.size())));
+        std::string name = sanitizeName(record.name);
+        if (name.empty())
+            name = host;
+        if (name.empty())
+            name = sanitizeName(std::string(record.username.data(), record.username.size()));
+        if (name.empty())
+            name = "Untitled";
+
+        if (!vault.folderExists(folderName))
+            vault.addFolder(std::make_unique<Folder>(folderName));
+
+        if (record.note || (record.username.empty() && record.password.empty())) {
+            SecureString text;
+            appendLine(text, "URL", record.url);
+            if (!text.empty() && !record.notes.empty())
+                text += '\n';
+            text += record.notes;
+            place(folderName, name, std::make_unique<NoteEntry>(text));
+            return;
+        }
+
+        // Browsers name entries after the host, a URL that says no more than the name isn't worth a note
+        std::string placed = place(folderName, name, std::make_unique<CredentialEntry>(record.username, record.password));
+        if (placed.empty() || (record.notes.empty() && (record.url.empty() || host == name)))
+            return;
+        SecureString text;
+        appendLine(text, "URL", record.url);
+        appendLine(text, "Notes", record.notes);
+        place(folderName, placed + " (notes)", std::make_unique<NoteEntry>(text));
+    }
+
+    std::string VaultImporter::place(const std::string& folderName, const std::string& name, std::unique_ptr<Entry> entry) {
+        EntryMetadata& metadata = entry->getMetadata();
+        metadata.created = metadata.modified = time;
+
+        Folder& target = vault.getFolder(folderName);
+        if (!target.entryExists(name)) {
+            target.addEntry(std::move(entry), name);
+            stats.added++;
+            return name;
+        }
+
+        switch (policy) {
+            case ConflictPolicy::SKIP:
+                stats.skipped++;
+                return {};
+            case ConflictPolicy::OVERWRITE: {
+                // Same as an update: the old value becomes a revision, creation time and tags stay
+                target.replaceEntry(name, name, std::move(entry), vault.historyRetention, time);
+                stats.overwritten++;
+                return name;
+            }
+            case ConflictPolicy::RENAME: {
+                std::string renamed;
+                for (size_t i = 2; target.entryExists(renamed = name + " (" + std::to_string(i) + ")"); i++) {}
+                target.addEntry(std::move(entry), renamed);
+                stats.renamed++;
+                return renamed;
+            }
+        }
+        return {};
+    }
+
+} // namespace vault
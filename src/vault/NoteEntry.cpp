@@ -7,13 +7,17 @@
 
 namespace vault {
 
-    NoteEntry::NoteEntry(const std::string &note) : noteText(note) {}
+    NoteEntry::NoteEntry(std::string_view note) : noteText(note) {}
 
     EntryType NoteEntry::getType() const {
         return EntryType::NOTE;
     }
 
-    const std::string &NoteEntry::getNoteText() const {
+    std::unique_ptr<Entry> NoteEntry::clone() const {
+        return std::make_unique<NoteEntry>(*this);
+    }
+
+    std::string_view NoteEntry::getNoteText() const {
         return noteText;
     }
 
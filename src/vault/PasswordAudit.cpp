@@ -0,0 +1,294 @@
+// Directory: src/vault/PasswordAudit.cpp
+#include "vault/PasswordAudit.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+namespace vault {
+
+    namespace {
+        // The most common passwords of public breach compilations, most common first
+        constexpr std::string_view commonPasswords[] = {
+            "123456", "password", "123456789", "12345678", "12345", "qwerty", "1234567", "111111", "123123", "abc123",
+            "1234567890", "password1", "iloveyou", "000000", "qwerty123", "1q2w3e4r", "admin", "letmein", "welcome", "monkey",
+            "dragon", "football", "baseball", "sunshine", "princess", "master", "shadow", "superman", "trustno1", "michael",
+            "qwertyuiop", "123321", "654321", "666666", "7777777", "1qaz2wsx", "zaq12wsx", "passw0rd", "starwars", "whatever",
+            "hello", "freedom", "login", "mustang", "access", "batman", "charlie", "donald", "flower", "loveme",
+            "ninja", "azerty", "solo", "secret", "summer", "winter", "computer", "internet", "changeme", "default",
+            "root", "test", "guest", "pass", "asdfgh", "asdfghjkl", "zxcvbnm", "a1b2c3", "q1w2e3r4", "987654321",
+            "121212", "killer", "jordan", "hunter", "ranger", "buster", "soccer", "hockey", "tigger", "pepper",
+            "ginger", "cheese", "matrix", "maggie", "jessica", "ashley", "nicole", "daniel", "thomas", "robert",
+            "jennifer", "andrew", "joshua", "michelle", "samsung", "google", "manpass", "administrator", "qazwsx", "p@ssw0rd",
+        };
+
+        const std::unordered_map<std::string_view, size_t>& commonPasswordRanks() {
+            static const std::unordered_map<std::string_view, size_t> ranks = []() {
+                std::unordered_map<std::string_view, size_t> result;
+                for (size_t i = 0; i < std::size(commonPasswords); i++) {
+                    result.emplace(commonPasswords[i], i);
+                }
+                return result;
+            }();
+            return ranks;
+        }
+
+        // Row and column of every key on a US keyboard (row 0 means not a key), looked up for every character
+        struct KeyPosition {
+            uint8_t row = 0, column = 0;
+        };
+
+        constexpr std::array<KeyPosition, 128> makeKeyboard() {
+            constexpr std::string_view rows[] = {"`1234567890-=", "qwertyuiop[]\\", "asdfghjkl;'", "zxcvbnm,./"};
+            std::array<KeyPosition, 128> keyboard{};
+            for (uint8_t row = 0; row < std::size(rows); row++) {
+                for (uint8_t column = 0; column < rows[row].size(); column++) {
+                    keyboard[static_cast<uint8_t>(rows[row][column])] = {static_cast<uint8_t>(row + 1), column};
+                }
+            }
+            return keyboard;
+        }
+
+        constexpr std::array<KeyPosition, 128> keyboard = makeKeyboard();
+
+        char toLower(char c) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        char unleet(char c) {
+            switch (c) {
+                case '@': case '4': return 'a';
+                case '3': return 'e';
+                case '1': case '!': return 'i';
+                case '0': return 'o';
+                case '$': case '5': return 's';
+                case '7': return 't';
+                default: return c;
+            }
+        }
+
+        bool isContinuationByte(char c) {
+            return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+        }
+
+        bool keyboardAdjacent(char a, char b) {
+            auto ua = static_cast<unsigned char>(a), ub = static_cast<unsigned char>(b);
+            if (ua >= 128 || ub >= 128)
+                return false;
+            KeyPosition pa = keyboard[ua], pb = keyboard[ub];
+            return pa.row != 0 && pa.row == pb.row && (pa.column + 1 == pb.column || pb.column + 1 == pa.column);
+        }
+
+        // Bits of a password made of a common one (possibly capitalized or with substitutions) and a suffix,
+        // or a negative value if it isn't one
+        double commonPasswordBits(std::string_view password) {
+            std::string lower(password.size(), '\0');
+            std::transform(password.begin(), password.end(), lower.begin(), toLower);
+            bool capitalized = lower != password;
+
+            size_t baseLength = lower.size();
+            while (baseLength > 0 && !std::isalpha(static_cast<unsigned char>(lower[baseLength - 1])))
+                baseLength--;
+
+            double best = -1;
+            auto consider = [&](const std::string& candidate, size_t suffixLength, bool substituted) {
+                auto it = commonPasswordRanks().find(candidate);
+                if (it == commonPasswordRanks().end())
+                    return;
+                double bits = std::log2(static_cast<double>(it->second) + 2) + (capitalized ? 1 : 0) + (substituted ? 1 : 0);
+                for (size_t i = lower.size() - suffixLength; i < lower.size(); i++) {
+                    bits += std::isdigit(static_cast<unsigned char>(lower[i])) ? std::log2(10.0) : std::log2(33.0);
+                }
+                if (best < 0 || bits < best)
+                    best = bits;
+            };
+
+            for (size_t length : {lower.size(), baseLength}) {
+                if (length == 0)
+                    continue;
+                std::string base = lower.substr(0, length);
+                consider(base, lower.size() - length, false);
+                std::string plain = base;
+                std::transform(plain.begin(), plain.end(), plain.begin(), unleet);
+                if (plain != base)
+                    consider(plain, lower.size() - length, true);
+            }
+            return best;
+        }
+    }
+
+    PasswordStrength estimatePasswordStrength(std::string_view password) {
+        if (password.empty())
+            return {0, "empty password"};
+
+        double common = commonPasswordBits(password);
+        if (common >= 0)
+            return {common, common < weakPasswordBits ? "common password" : ""};
+
+        // A password repeating a shorter unit ("abcabcabc") is as strong as the unit and the repeat count
+        size_t period = 1;
+        while (period < password.size()) {
+            bool periodic = password.size() % period == 0;
+            for (size_t i = period; periodic && i < password.size(); i++) {
+                periodic = password[i] == password[i - period];
+            }
+            if (periodic)
+                break;
+            period++;
+        }
+        std::string_view unit = password.substr(0, period);
+
+        bool lower = false, upper = false, digit = false, symbol = false, other = false;
+        for (char c : unit) {
+            auto u = static_cast<unsigned char>(c);
+            if (u >= 0x80)
+                other = true;
+            else if (std::islower(u))
+                lower = true;
+            else if (std::isupper(u))
+                upper = true;
+            else if (std::isdigit(u))
+                digit = true;
+            else
+                symbol = true;
+        }
+        int classes = lower + upper + digit + symbol + other;
+        double pool = (lower ? 26 : 0) + (upper ? 26 : 0) + (digit ? 10 : 0) + (symbol ? 33 : 0) + (other ? 100 : 0);
+        double perCharacter = std::log2(pool);
+
+        // Characters continuing a repeat, an alphabetical/numerical sequence or a keyboard run are nearly free
+        double bits = 0;
+        size_t characters = 0, patterned = 0;
+        char previous = 0;
+        for (char c : unit) {
+            if (isContinuationByte(c))
+                continue;
+            char folded = toLower(c);
+            bool continues = characters > 0 && (folded == previous || folded == previous + 1 || folded == previous - 1
+                                                || keyboardAdjacent(previous, folded));
+            bits += continues ? 1.0 : perCharacter;
+            patterned += continues;
+            characters++;
+            previous = folded;
+        }
+        if (period < password.size())
+            bits += std::log2(static_cast<double>(password.size() / period));
+
+        std::string weakness;
+        if (bits < weakPasswordBits) {
+            if (period < password.size())
+                weakness = "repeated pattern";
+            else if (patterned * 2 >= characters)
+                weakness = "repeats or sequences";
+            else if (characters < 8)
+                weakness = "too short";
+            else if (classes == 1)
+                weakness = "single character class";
+            else
+                weakness = "too short for its character classes";
+        }
+        return {bits, weakness};
+    }
+
+    PasswordAudit::PasswordAudit() :
+        hashKey(cryptography::generateSipHashKey()), fingerprintKey(cryptography::generateSipHashKey()), slots(1024) {}
+
+    PasswordReport PasswordAudit::inspect(std::string_view password) const {
+        return {cryptography::sipHash24(hashKey, password), cryptography::sipHash24(fingerprintKey, password),
+                estimatePasswordStrength(password)};
+    }
+
+    void PasswordAudit::add(CredentialPath credential, const PasswordReport& report) {
+        if ((groupSizes.size() + 1) * 2 > slots.size())
+            grow();
+
+        uint32_t group = findOrInsert(report.hash, report.fingerprint);
+        groupSizes[group]++;
+        groupOf.push_back(group);
+        credentials.push_back(std::move(credential));
+        strengths.push_back(report.strength);
+        breaches.push_back(report.breaches);
+    }
+
+    size_t PasswordAudit::size() const {
+        return credentials.size();
+    }
+
+    uint32_t PasswordAudit::findOrInsert(uint64_t hash, uint64_t fingerprint) {
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.group == 0) {
+                groupSizes.push_back(0);
+                slot = {hash, fingerprint, static_cast<uint32_t>(groupSizes.size())};
+                return slot.group - 1;
+            }
+            if (slot.hash == hash && slot.fingerprint == fingerprint)
+                return slot.group - 1;
+        }
+    }
+
+    void PasswordAudit::grow() {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (const Slot& slot : old) {
+            if (slot.group == 0)
+                continue;
+            size_t i = slot.hash & mask;
+            while (slots[i].group != 0)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+    std::vector<std::vector<CredentialPath>> PasswordAudit::reusedPasswords() const {
+        std::vector<size_t> reused;
+        for (size_t i = 0; i < credentials.size(); i++) {
+            if (groupSizes[groupOf[i]] > 1)
+                reused.push_back(i);
+        }
+        std::sort(reused.begin(), reused.end(), [&](size_t a, size_t b) {
+            return groupOf[a] != groupOf[b] ? groupOf[a] < groupOf[b] : credentials[a] < credentials[b];
+        });
+
+        std::vector<std::vector<CredentialPath>> groups;
+        for (size_t i = 0; i < reused.size(); i++) {
+            if (i == 0 || groupOf[reused[i]] != groupOf[reused[i - 1]])
+                groups.emplace_back();
+            groups.back().push_back(credentials[reused[i]]);
+        }
+        std::stable_sort(groups.begin(), groups.end(), [](const auto& a, const auto& b) {
+            return a.size() != b.size() ? a.size() > b.size() : a.front() < b.front();
+        });
+        return groups;
+    }
+
+    std::vector<WeakPassword> PasswordAudit::weakPasswords(double minimumBits) const {
+        std::vector<WeakPassword> weak;
+        for (size_t i = 0; i < credentials.size(); i++) {
+            if (strengths[i].bits < minimumBits)
+                weak.push_back({credentials[i], strengths[i]});
+        }
+        std::sort(weak.begin(), weak.end(), [](const WeakPassword& a, const WeakPassword& b) {
+            return a.strength.bits != b.strength.bits ? a.strength.bits < b.strength.bits : a.credential < b.credential;
+        });
+        return weak;
+    }
+
+    std::vector<BreachedPassword> PasswordAudit::breachedPasswords() const {
+        std::vector<BreachedPassword> breached;
+        for (size_t i = 0; i < credentials.size(); i++) {
+            if (breaches[i] > 0)
+                breached.push_back({credentials[i], breaches[i]});
+        }
+        std::sort(breached.begin(), breached.end(), [](const BreachedPassword& a, const BreachedPassword& b) {
+            return a.breaches != b.breaches ? a.breaches > b.breaches : a.credential < b.credential;
+        });
+        return breached;
+    }
+
+} // namespace vault
@@ -0,0 +1,66 @@
+// Directory: src/vault/PathPattern.cpp
+#include "vault/PathPattern.h"
+
+#include <algorithm>
+#include <fnmatch.h>
+
+namespace vault {
+
+    namespace {
+        std::vector<std::string> entryNamesOf(const Vault& vault, const std::string& folderName) {
+            return vault.getFolder(folderName).getEntryNames();
+        }
+
+        std::vector<std::string> entryNamesOf(const VaultView& vault, const std::string& folderName) {
+            return vault.getEntryNames(folderName);
+        }
+
+        template<typename V>
+        std::vector<std::string> matchFolderNames(const V& vault, const std::string& folderPattern) {
+            std::vector<std::string> matches = vault.getFolderNames();
+            std::erase_if(matches, [&](const std::string& name) { return !matchesPathPattern(folderPattern, name); });
+            std::sort(matches.begin(), matches.end());
+            return matches;
+        }
+
+        template<typename V>
+        std::vector<EntryPath> matchEntryPaths(const V& vault, const std::string& folderPattern, const std::string& entryPattern) {
+            std::vector<EntryPath> matches;
+            for (const std::string& folderName : matchFolderNames(vault, folderPattern)) {
+                std::vector<std::string> entryNames = entryNamesOf(vault, folderName);
+                std::sort(entryNames.begin(), entryNames.end());
+                for (std::string& entryName : entryNames) {
+                    if (matchesPathPattern(entryPattern, entryName))
+                        matches.push_back({folderName, std::move(entryName)});
+                }
+            }
+            return matches;
+        }
+    }
+
+    bool isPathPattern(std::string_view component) {
+        return component.find_first_of("*?[") != std::string_view::npos;
+    }
+
+    bool matchesPathPattern(const std::string& pattern, const std::string& name) {
+        // FNM_PERIOD is not set, names starting with '.' are matched like any other
+        return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+    }
+
+    std::vector<std::string> matchFolders(const Vault& vault, const std::string& folderPattern) {
+        return matchFolderNames(vault, folderPattern);
+    }
+
+    std::vector<std::string> matchFolders(const VaultView& vault, const std::string& folderPattern) {
+        return matchFolderNames(vault, folderPattern);
+    }
+
+    std::vector<EntryPath> matchEntries(const Vault& vault, const std::string& folderPattern, const std::string& entryPattern) {
+        return matchEntryPaths(vault, folderPattern, entryPattern);
+    }
+
+    std::vector<EntryPath> matchEntries(const VaultView& vault, const std::string& folderPattern, const std::string& entryPattern) {
+        return matchEntryPaths(vault, folderPattern, entryPattern);
+    }
+
+} // vault
@@ -0,0 +1,179 @@
+// Directory: src/vault/Transfer.cpp
+#include "vault/Transfer.h"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include "vault/PathPattern.h"
+#include "crypto/Cryptography.h"
+#include "crypto/SecureArena.h"
+#include "json/json.hpp"
+
+namespace vault {
+
+    namespace {
+        bool pathExists(const Vault& vault, const EntryPath& path) {
+            return vault.folderExists(path.folder) && (path.entry.empty() || vault.entryExists(path.folder, path.entry));
+        }
+
+        std::string describe(const EntryPath& path) {
+            return path.entry.empty() ? path.folder : path.folder + "/" + path.entry;
+        }
+
+        bool sameEntry(const Entry& first, const Entry& second) {
+            if (&first == &second)
+                return true;
+            cryptography::SecureString a, b;
+            appendEntryMembers(a, first, nullptr, &first.getMetadata(), first.getHistory().raw());
+            appendEntryMembers(b, second, nullptr, &second.getMetadata(), second.getHistory().raw());
+            return a == b;
+        }
+
+        // Whether the path in source has the same contents as the one in target
+        // (entries with their metadata and history, folders entry by entry)
+        bool samePath(const Vault& source, const EntryPath& from, const Vault& target, const EntryPath& to) {
+            if (!from.entry.empty())
+                return sameEntry(source.getEntry(from.folder, from.entry), target.getEntry(to.folder, to.entry));
+
+            const Folder& sourceFolder = source.getFolder(from.folder);
+            const Folder& targetFolder = target.getFolder(to.folder);
+            std::vector<std::string> names = sourceFolder.getEntryNames();
+            std::vector<std::string> targetNames = targetFolder.getEntryNames();
+            std::sort(names.begin(), names.end());
+            std::sort(targetNames.begin(), targetNames.end());
+            if (names != targetNames)
+                return false;
+            return std::all_of(names.begin(), names.end(), [&](const std::string& name) {
+                return sameEntry(sourceFolder.getEntry(name), targetFolder.getEntry(name));
+            });
+        }
+    }
+
+    std::vector<TransferPath> planTransfer(const Vault& source, const std::string& folderPattern, const std::string& entryPattern,
+                                           const Vault& target, const std::string& targetFolder, const std::string& targetEntry) {
+        std::vector<TransferPath> paths;
+        if (entryPattern.empty()) {
+            if (!targetEntry.empty())
+                throw std::runtime_error("A folder can only go into a vault");
+            for (std::string& folderName : matchFolders(source, folderPattern)) {
+                std::string newName = targetFolder.empty() ? folderName : targetFolder;
+                paths.push_back({{std::move(folderName), ""}, {std::move(newName), ""}});
+            }
+            if (paths.empty())
+                throw std::runtime_error("No folder matches " + folderPattern);
+        } else {
+            if (targetFolder.empty())
+                throw std::runtime_error("Entries can only go into a folder");
+            for (EntryPath& path : matchEntries(source, folderPattern, entryPattern)) {
+                std::string newName = targetEntry.empty() ? path.entry : targetEntry;
+                paths.push_back({std::move(path), {targetFolder, std::move(newName)}});
+            }
+            if (paths.empty())
+                throw std::runtime_error("No entry matches " + folderPattern + "/" + entryPattern);
+        }
+
+        // Nothing is overwritten, and two paths can't end up in the same place
+        std::set<std::pair<std::string, std::string>> destinations;
+        for (const TransferPath& path : paths) {
+            if (pathExists(target, path.to))
+                throw std::runtime_error(describe(path.to) + " already exists");
+            if (!destinations.emplace(path.to.folder, path.to.entry).second)
+                throw std::runtime_error("More than one match would become " + describe(path.to));
+        }
+        return paths;
+    }
+
+    std::vector<TransferPath> applyTransfer(Vault& source, Vault& target, const std::vector<TransferPath>& paths, bool move) {
+        std::vector<TransferPath> kept;
+        for (const TransferPath& path : paths) {
+            if (!pathExists(source, path.from))
+                continue;
+
+            if (pathExists(target, path.to)) {
+                // Already copied by an interrupted move, unless either side changed since. Then neither is touched
+                if (move && !samePath(std::as_const(source), path.from, std::as_const(target), path.to)) {
+                    kept.push_back(path);
+                    continue;
+                }
+            } else {
+                if (path.from.entry.empty()) {
+                    // A copy of a folder is O(1), its entries are shared with the original
+                    auto folder = std::make_unique<Folder>(std::as_const(source).getFolder(path.from.folder));
+                    folder->setName(path.to.folder);
+                    target.addFolder(std::move(folder));
+                } else {
+                    if (!target.folderExists(path.to.folder))
+                        target.addFolder(std::make_unique<Folder>(path.to.folder));
+                    Folder& targetFolder = target.getFolder(path.to.folder);
+                    std::as_const(source).getFolder(path.from.folder).shareEntry(path.from.entry, targetFolder, path.to.entry);
+                }
+            }
+
+            if (move) {
+                if (path.from.entry.empty())
+                    source.deleteFolder(path.from.folder);
+                else
+                    source.getFolder(path.from.folder).deleteEntry(path.from.entry);
+            }
+        }
+        return kept;
+    }
+
+    std::string encodeTransferMarker(const Vault& source, const TransferMarker& marker, const Botan::secure_vector<char>& masterPassword) {
+        json paths = json::array();
+        for (const TransferPath& path : marker.paths) {
+            paths.push_back({path.from.folder, path.from.entry, path.to.folder, path.to.entry});
+        }
+        std::string plaintext = paths.dump();
+
+        // Encrypted like the source vault, with a fresh salt and nonce
+        cryptography::EncryptedBlob blob = cryptography::encrypt(plaintext, masterPassword, source.cryptoAlgorithm,
+            source.cryptoKDF, cryptography::generateBase64Salt(), source.cryptoKDFIterations);
+        Botan::secure_scrub_memory(plaintext.data(), plaintext.size());
+
+        json j;
+        j["Target"] = marker.targetVault;
+        j["Algorithm"] = blob.algorithm;
+        j["KDF"] = blob.kdf;
+        j["KDFIterations"] = blob.kdfIterations;
+        j["Salt"] = blob.base64Salt;
+        j["Nonce"] = blob.base64Nonce;
+        j["Data"] = blob.base64Ciphertext;
+        return j.dump();
+    }
+
+    TransferMarker decodeTransferMarker(std::string_view encoded, const Botan::secure_vector<char>& masterPassword) {
+        TransferMarker marker;
+        try {
+            json j = json::parse(encoded);
+            cryptography::EncryptedBlob blob;
+            blob.algorithm = j.at("Algorithm").get<std::string>();
+            blob.kdf = j.at("KDF").get<std::string>();
+            blob.kdfIterations = j.at("KDFIterations").get<int>();
+            blob.base64Salt = j.at("Salt").get<std::string>();
+            blob.base64Nonce = j.at("Nonce").get<std::string>();
+            blob.base64Ciphertext = j.at("Data").get<std::string>();
+            marker.targetVault = j.at("Target").get<std::string>();
+
+            std::string plaintext = cryptography::decrypt(blob, masterPassword);
+            for (const json& path : json::parse(plaintext)) {
+                marker.paths.push_back({{path.at(0).get<std::string>(), path.at(1).get<std::string>()},
+                                        {path.at(2).get<std::string>(), path.at(3).get<std::string>()}});
+            }
+            Botan::secure_scrub_memory(plaintext.data(), plaintext.size());
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Failed to read the marker of an interrupted move: " + std::string(e.what()));
+        }
+        return marker;
+    }
+
+    std::string transferMarkerTarget(std::string_view encoded) {
+        try {
+            return json::parse(encoded).at("Target").get<std::string>();
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Failed to read the marker of an interrupted move: " + std::string(e.what()));
+        }
+    }
+
+} // vault
@@ -0,0 +1,43 @@
+// Directory: src/vault/UndoStack.cpp
+#include "vault/UndoStack.h"
+
+#include <stdexcept>
+
+namespace vault {
+
+    UndoStack::UndoStack(size_t limit_val) : limit(limit_val) {}
+
+    void UndoStack::record(const Vault& vault) {
+        redoStates.clear();
+        if (limit == 0)
+            return;
+        if (undoStates.size() == limit)
+            undoStates.pop_front();
+        undoStates.push_back(vault);
+    }
+
+    bool UndoStack::canUndo() const {
+        return !undoStates.empty();
+    }
+
+    bool UndoStack::canRedo() const {
+        return !redoStates.empty();
+    }
+
+    void UndoStack::undo(Vault& vault) {
+        if (undoStates.empty())
+            throw std::out_of_range("Nothing to undo");
+        redoStates.push_back(std::move(vault));
+        vault = std::move(undoStates.back());
+        undoStates.pop_back();
+    }
+
+    void UndoStack::redo(Vault& vault) {
+        if (redoStates.empty())
+            throw std::out_of_range("Nothing to redo");
+        undoStates.push_back(std::move(vault));
+        vault = std::move(redoStates.back());
+        redoStates.pop_back();
+    }
+
+} // namespace vault
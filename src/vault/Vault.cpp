@@ -5,7 +5,10 @@
 // Directory: src/vault/Vault.cpp
 #include "vault/Vault.h"
 
+#include <algorithm>
+#include <tuple>
 #include "crypto/Cryptography.h"
+#include "crypto/Compression.h"
 
 namespace vault {
 
@@ -15,6 +18,7 @@ namespace vault {
         this->cryptoKDF = "PBKDF2(SHA-256)";
         this->cryptoKDFIterations = 500000;
         this->cryptoBase64Salt = cryptography::generateBase64Salt(); // Generate a new salt by default (can be overwritten)
+        this->cryptoCompression = cryptography::defaultCompression();
     }
 
 
@@ -23,7 +27,7 @@ namespace vault {
         if (folderExists(name)) {
             throw std::runtime_error("Folder with name " + name + " already exists in vault " + vaultName);
         }
-        folders[name] = std::move(folder);
+        folders.set(name, std::move(folder));
     }
 
     void Vault::deleteFolder(const std::string &folderName) {
@@ -38,19 +42,22 @@ namespace vault {
 
 
     Folder& Vault::getFolder(const std::string& folderName) {
-        auto it = folders.find(folderName);
-        if (it == folders.end()) {
+        if (!folderExists(folderName)) {
             throw std::out_of_range("Folder with name " + folderName + " does not exist in vault " + vaultName);
         }
-        return *it->second; // This is safe because we checked for existence above
+        // Copying a folder is cheap, its entries stay shared with the snapshot until they are modified
+        std::shared_ptr<Folder>& folder = folders.edit(folderName);
+        if (folder.use_count() != 1)
+            folder = std::make_shared<Folder>(*folder);
+        return *folder;
     }
 
     const Folder& Vault::getFolder(const std::string& folderName) const {
-        auto it = folders.find(folderName);
-        if (it == folders.end()) {
+        const std::shared_ptr<Folder>* folder = folders.find(folderName);
+        if (!folder) {
             throw std::out_of_range("Folder with name " + folderName + " does not exist in vault " + vaultName);
         }
-        return *it->second; // This is safe because we checked for existence above
+        return **folder;
     }
 
     Entry& Vault::getEntry(const std::string& folderName, const std::string& entryName) {
@@ -86,7 +93,7 @@ namespace vault {
     }
 
     bool Vault::folderExists(const std::string& folderName) const {
-        return folders.find(folderName) != folders.end();
+        return folders.contains(folderName);
     }
 
     bool Vault::entryExists(const std::string &folderName, const std::string &entryName) const {
@@ -97,22 +104,34 @@ namespace vault {
         Folder& folder = this->getFolder(oldName);
         folder.setName(newName);
 
-        auto folderNode = folders.extract(oldName);
-        folderNode.key() = newName;
-        folders.insert(std::move(folderNode));
-    }
-
-
-    Vault::Vault(Vault && other) noexcept :
-    vaultName(std::move(other.vaultName)),
-    folders(std::move(other.folders)) {}
-
-    Vault &Vault::operator=(Vault && other) noexcept {
-        if (this != &other) {
-            vaultName = std::move(other.vaultName);
-            folders = std::move(other.folders);
-        }
-        return *this;
+        std::shared_ptr<Folder> renamed = *folders.find(oldName);
+        folders.erase(oldName);
+        folders.set(newName, std::move(renamed));
+    }
+
+    std::vector<VaultChange> diff(const Vault& before, const Vault& after) {
+        std::vector<VaultChange> changes;
+        using FolderMap = PersistentMap<std::shared_ptr<Folder>>;
+        using EntryMap = PersistentMap<std::shared_ptr<Entry>>;
+
+        FolderMap::diff(before.folders, after.folders, [&](const std::string& folderName,
+                const std::shared_ptr<Folder>* beforeFolder, const std::shared_ptr<Folder>* afterFolder) {
+            if (!beforeFolder || !afterFolder) {
+                changes.push_back({beforeFolder ? VaultChange::Kind::REMOVED : VaultChange::Kind::ADDED, folderName, ""});
+                return;
+            }
+            EntryMap::diff((*beforeFolder)->entries, (*afterFolder)->entries, [&](const std::string& entryName,
+                    const std::shared_ptr<Entry>* beforeEntry, const std::shared_ptr<Entry>* afterEntry) {
+                VaultChange::Kind kind = !beforeEntry ? VaultChange::Kind::ADDED
+                    : !afterEntry ? VaultChange::Kind::REMOVED : VaultChange::Kind::MODIFIED;
+                changes.push_back({kind, folderName, entryName});
+            });
+        });
+
+        std::sort(changes.begin(), changes.end(), [](const VaultChange& a, const VaultChange& b) {
+            return std::tie(a.folder, a.entry) < std::tie(b.folder, b.entry);
+        });
+        return changes;
     }
 
 
@@ -0,0 +1,341 @@
+// Directory: src/vault/VaultView.cpp
+#include "vault/VaultView.h"
+
+#include <algorithm>
+#include "vault/CredentialEntry.h"
+#include "vault/NoteEntry.h"
+#include "vault/AttachmentEntry.h"
+#include "json/JsonScanner.h"
+
+namespace vault {
+
+    using cryptography::SecureString;
+
+    EntryType parseEntryType(std::string_view type) {
+        if (type == "CREDENTIAL")
+            return EntryType::CREDENTIAL;
+        if (type == "NOTE")
+            return EntryType::NOTE;
+        if (type == "ATTACHMENT")
+            return EntryType::ATTACHMENT;
+        throw std::invalid_argument("Unknown entry type");
+    }
+
+    // Builds an entry from the object stored in text. Secrets are decoded straight into the secure arena
+    std::unique_ptr<Entry> materializeEntry(std::string_view text, EntryType type) {
+        JsonScanner scanner(text);
+        SecureString username, password, noteText;
+        std::string fileName;
+        long long size = 0;
+        std::vector<SecureString> chunkKeys;
+        bool hasUsername = false, hasPassword = false, hasText = false;
+        bool hasFileName = false, hasSize = false, hasChunks = false;
+        std::string_view history;
+        EntryMetadata metadata;
+
+        scanner.forEachMember([&](std::string_view key) {
+            if (readMetadataMember(scanner, key, metadata))
+                return;
+            if (key == "username") {
+                username = decodeJsonString<SecureString>(scanner.readRawString());
+                hasUsername = true;
+            } else if (key == "password") {
+                password = decodeJsonString<SecureString>(scanner.readRawString());
+                hasPassword = true;
+            } else if (key == "text") {
+                noteText = decodeJsonString<SecureString>(scanner.readRawString());
+                hasText = true;
+            } else if (key == "fileName") {
+                fileName = scanner.readString();
+                hasFileName = true;
+            } else if (key == "size") {
+                size = scanner.readInteger();
+                hasSize = true;
+            } else if (key == "chunks") {
+                scanner.forEachElement([&]() {
+                    chunkKeys.push_back(decodeJsonString<SecureString>(scanner.readRawString()));
+                });
+                hasChunks = true;
+            } else if (key == "history") {
+                // Copied as it is, revisions are only decoded when somebody asks for them
+                scanner.skipWhitespace();
+                size_t historyBegin = scanner.position();
+                scanner.skipValue();
+                history = text.substr(historyBegin, scanner.position() - historyBegin);
+            } else {
+                scanner.skipValue();
+            }
+        });
+
+        std::unique_ptr<Entry> entry;
+        switch (type) {
+            case EntryType::CREDENTIAL:
+                if (!hasUsername)
+                    throw std::invalid_argument("Username is missing or is not a string");
+                if (!hasPassword)
+                    throw std::invalid_argument("Password is missing or is not a string");
+                entry = std::make_unique<CredentialEntry>(username, password);
+                break;
+            case EntryType::NOTE:
+                if (!hasText)
+                    throw std::invalid_argument("Note text is missing or is not a string");
+                entry = std::make_unique<NoteEntry>(noteText);
+                break;
+            case EntryType::ATTACHMENT:
+                if (!hasFileName)
+                    throw std::invalid_argument("Attachment file name is missing or is not a string");
+                if (!hasSize || size < 0)
+                    throw std::invalid_argument("Attachment size is missing or is not a number");
+                if (!hasChunks)
+                    throw std::invalid_argument("Attachment chunks is missing or is not an array");
+                entry = std::make_unique<AttachmentEntry>(fileName, static_cast<uint64_t>(size), std::move(chunkKeys));
+                break;
+        }
+        if (!entry)
+            throw std::invalid_argument("Unknown entry type");
+        entry->getHistory().setRaw(history);
+        entry->getMetadata() = std::move(metadata);
+        return entry;
+    }
+
+    VaultView::VaultView(cryptography::SecureBuffer plaintext) : buffer(std::move(plaintext)) {
+        JsonScanner scanner(text());
+        bool hasName = false, hasFolders = false;
+
+        scanner.forEachMember([&](std::string_view key) {
+            if (key == "name") {
+                vaultName = scanner.readString();
+                hasName = true;
+            } else if (key == "historyRetention") {
+                long long retention = scanner.readInteger();
+                if (retention < 0)
+                    throw std::invalid_argument("History retention is negative");
+                historyRetention = static_cast<size_t>(retention);
+            } else if (key == "folders") {
+                hasFolders = true;
+                scanner.forEachElement([&]() {
+                    // Only the folder name is decoded here, its entries array is just skipped over
+                    FolderRef folder{};
+                    std::string folderName;
+                    bool hasFolderName = false, hasEntries = false;
+
+                    scanner.forEachMember([&](std::string_view folderKey) {
+                        if (folderKey == "name") {
+                            folderName = scanner.readString();
+                            hasFolderName = true;
+                        } else if (folderKey == "entries") {
+                            scanner.skipWhitespace();
+                            folder.entriesBegin = scanner.position();
+                            hasEntries = true;
+                            scanner.skipValue();
+                        } else {
+                            scanner.skipValue();
+                        }
+                    });
+
+                    if (!hasFolderName)
+                        throw std::invalid_argument("Folder name is missing or is not a string");
+                    if (!hasEntries)
+                        throw std::invalid_argument("Folder entries is missing or is not an array");
+                    if (folders.contains(folderName))
+                        throw std::runtime_error("Folder with name " + folderName + " already exists in vault " + vaultName);
+
+                    folders.emplace(std::move(folderName), std::move(folder));
+                });
+            } else {
+                scanner.skipValue();
+            }
+        });
+
+        if (!hasName)
+            throw std::invalid_argument("Vault name is missing or is not a string");
+        if (!hasFolders)
+            throw std::invalid_argument("Vault folders is missing or is not an array");
+    }
+
+    std::string_view VaultView::text() const {
+        return {reinterpret_cast<const char*>(buffer.data()), buffer.size()};
+    }
+
+    const std::string& VaultView::getName() const {
+        return vaultName;
+    }
+
+    std::vector<std::string> VaultView::getFolderNames() const {
+        std::vector<std::string> names;
+        for (const auto& [name, folder] : folders) {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    bool VaultView::folderExists(const std::string& folderName) const {
+        return folders.find(folderName) != folders.end();
+    }
+
+    std::vector<std::string> VaultView::getEntryNames(const std::string& folderName) const {
+        std::vector<std::string> names;
+        for (const auto& [name, entry] : getIndexedFolder(folderName).entries) {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    bool VaultView::entryExists(const std::string& folderName, const std::string& entryName) const {
+        const FolderRef& folder = getIndexedFolder(folderName);
+        return folder.entries.find(entryName) != folder.entries.end();
+    }
+
+    EntryType VaultView::getEntryType(const std::string& folderName, const std::string& entryName) const {
+        return getEntryRef(folderName, entryName).type;
+    }
+
+    EntryMetadata VaultView::getEntryMetadata(const std::string& folderName, const std::string& entryName) const {
+        const EntryRef& ref = getEntryRef(folderName, entryName);
+        if (ref.materialized)
+            return ref.materialized->getMetadata();
+
+        EntryMetadata metadata;
+        JsonScanner scanner(text().substr(ref.begin, ref.end - ref.begin));
+        scanner.forEachMember([&](std::string_view key) {
+            if (!readMetadataMember(scanner, key, metadata))
+                scanner.skipValue();
+        });
+        return metadata;
+    }
+
+    const Entry& VaultView::getEntry(const std::string& folderName, const std::string& entryName) const {
+        const EntryRef& ref = getEntryRef(folderName, entryName);
+        if (!ref.materialized) {
+            // Parsing is limited to the bytes of this single entry
+            ref.materialized = materializeEntry(text().substr(ref.begin, ref.end - ref.begin), ref.type);
+        }
+        return *ref.materialized;
+    }
+
+    void VaultView::forEachEntry(const EntryCallback& callback) const {
+        visitEntries(nullptr, nullptr, callback);
+    }
+
+    void VaultView::forEachEntry(EntryType type, const EntryCallback& callback) const {
+        visitEntries(nullptr, &type, callback);
+    }
+
+    void VaultView::forEachEntry(const std::string& folderName, const EntryCallback& callback) const {
+        visitEntries(&folderName, nullptr, callback);
+    }
+
+    void VaultView::visitEntries(const std::string* onlyFolder, const EntryType* type, const EntryCallback& callback) const {
+        // Sorted names are also the order the entries have in the buffer
+        std::vector<const std::string*> folderNames;
+        if (onlyFolder) {
+            getFolder(*onlyFolder);
+            folderNames.push_back(onlyFolder);
+        } else {
+            for (const auto& [folderName, folderRef] : folders) {
+                folderNames.push_back(&folderName);
+            }
+            std::sort(folderNames.begin(), folderNames.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+        }
+
+        std::vector<const std::pair<const std::string, EntryRef>*> entries;
+        for (const std::string* folderNamePointer : folderNames) {
+            const std::string& folderName = *folderNamePointer;
+            entries.clear();
+            for (const auto& item : getIndexedFolder(folderName).entries) {
+                entries.push_back(&item);
+            }
+            std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+            for (const auto* item : entries) {
+                const std::string& entryName = item->first;
+                const EntryRef& ref = item->second;
+                if (type && ref.type != *type)
+                    continue;
+                if (ref.materialized) {
+                    callback(folderName, entryName, *ref.materialized);
+                } else {
+                    std::unique_ptr<Entry> entry = materializeEntry(text().substr(ref.begin, ref.end - ref.begin), ref.type);
+                    callback(folderName, entryName, *entry);
+                }
+            }
+        }
+    }
+
+    size_t VaultView::getHistoryRetention() const {
+        return historyRetention;
+    }
+
+    Vault VaultView::materialize() {
+        Vault vault(vaultName);
+        vault.historyRetention = historyRetention;
+        for (const auto& [folderName, folderRef] : folders) {
+            auto folder = std::make_unique<Folder>(folderName);
+            for (auto& [entryName, ref] : getIndexedFolder(folderName).entries) {
+                if (!ref.materialized)
+                    getEntry(folderName, entryName);
+                folder->addEntry(std::move(ref.materialized), entryName);
+            }
+            vault.addFolder(std::move(folder));
+        }
+        return vault;
+    }
+
+    const VaultView::FolderRef& VaultView::getFolder(const std::string& folderName) const {
+        auto it = folders.find(folderName);
+        if (it == folders.end()) {
+            throw std::out_of_range("Folder with name " + folderName + " does not exist in vault " + vaultName);
+        }
+        return it->second;
+    }
+
+    const VaultView::FolderRef& VaultView::getIndexedFolder(const std::string& folderName) const {
+        const FolderRef& folder = getFolder(folderName);
+        if (folder.indexed)
+            return folder;
+
+        folder.entries.clear();
+        JsonScanner scanner(text(), folder.entriesBegin);
+        scanner.forEachElement([&]() {
+            EntryRef ref{};
+            ref.begin = scanner.position();
+            std::string entryName;
+            bool hasName = false, hasType = false;
+
+            scanner.forEachMember([&](std::string_view key) {
+                if (key == "name") {
+                    entryName = scanner.readString();
+                    hasName = true;
+                } else if (key == "type") {
+                    ref.type = parseEntryType(scanner.readRawString());
+                    hasType = true;
+                } else {
+                    scanner.skipValue();
+                }
+            });
+            ref.end = scanner.position();
+
+            if (!hasName)
+                throw std::invalid_argument("Entry name is missing or is not a string");
+            if (!hasType)
+                throw std::invalid_argument("Unknown entry type");
+            if (folder.entries.contains(entryName))
+                throw std::runtime_error("Entry with name " + entryName + " already exists in folder " + folderName);
+
+            folder.entries.emplace(std::move(entryName), std::move(ref));
+        });
+
+        folder.indexed = true;
+        return folder;
+    }
+
+    const VaultView::EntryRef& VaultView::getEntryRef(const std::string& folderName, const std::string& entryName) const {
+        const FolderRef& folder = getIndexedFolder(folderName);
+        auto it = folder.entries.find(entryName);
+        if (it == folder.entries.end()) {
+            throw std::out_of_range("Entry with name " + entryName + " does not exist in folder " + folderName);
+        }
+        return it->second;
+    }
+
+} // namespace vault